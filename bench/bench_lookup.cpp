@@ -0,0 +1,101 @@
+// Result lookups against real solved data. The paths come from the
+// environment, since no database ships with the repository:
+//   BOBAIL_BENCH_DB         solved retrograde database directory (RocksDB builds)
+//   BOBAIL_BENCH_TABLEBASE  tablebase file from export_tablebase
+// Benchmarks whose data is missing are skipped.
+
+#include "corpus.h"
+#include "tablebase.h"
+#ifdef HAS_ROCKSDB
+#include "retrograde_db.h"
+#endif
+#include <benchmark/benchmark.h>
+#include <cstdlib>
+#include <memory>
+#include <span>
+
+using namespace bobail;
+
+namespace {
+
+const char* env_path(const char* name) {
+    const char* path = std::getenv(name);
+    return path && *path ? path : nullptr;
+}
+
+void BM_TablebaseProbe(benchmark::State& state) {
+    const char* path = env_path("BOBAIL_BENCH_TABLEBASE");
+    static Tablebase tb;
+    if (!path || (!tb.is_open() && !tb.open(path))) {
+        state.SkipWithError("BOBAIL_BENCH_TABLEBASE not set or not readable");
+        return;
+    }
+
+    const auto& corpus = bench_corpus();
+    size_t i = 0;
+    uint8_t dtw;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(tb.probe(corpus[i], dtw));
+        if (++i == corpus.size()) i = 0;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TablebaseProbe);
+
+#ifdef HAS_ROCKSDB
+// Opened once and shared by the database benchmarks
+RetrogradeSolverDB* bench_db() {
+    static std::unique_ptr<RetrogradeSolverDB> db = [] {
+        std::unique_ptr<RetrogradeSolverDB> d;
+        if (const char* path = env_path("BOBAIL_BENCH_DB")) {
+            d = std::make_unique<RetrogradeSolverDB>();
+            if (!d->open_readonly(path)) d.reset();
+        }
+        return d;
+    }();
+    return db.get();
+}
+
+void BM_DBGetResult(benchmark::State& state) {
+    RetrogradeSolverDB* db = bench_db();
+    if (!db) {
+        state.SkipWithError("BOBAIL_BENCH_DB not set or not openable");
+        return;
+    }
+
+    const auto& corpus = bench_corpus();
+    size_t i = 0;
+    uint8_t dtw;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(db->get_result(corpus[i], dtw));
+        if (++i == corpus.size()) i = 0;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_DBGetResult);
+
+// Arg: positions per get_results() call; items are positions, so the rate
+// compares directly with BM_DBGetResult
+void BM_DBGetResults(benchmark::State& state) {
+    RetrogradeSolverDB* db = bench_db();
+    if (!db) {
+        state.SkipWithError("BOBAIL_BENCH_DB not set or not openable");
+        return;
+    }
+
+    const auto& corpus = bench_corpus();
+    size_t batch = static_cast<size_t>(state.range(0));
+    std::vector<uint8_t> dtw;
+    size_t i = 0;
+    for (auto _ : state) {
+        if (i + batch > corpus.size()) i = 0;
+        auto results = db->get_results(std::span<const State>(corpus.data() + i, batch), &dtw);
+        benchmark::DoNotOptimize(results.data());
+        i += batch;
+    }
+    state.SetItemsProcessed(state.iterations() * batch);
+}
+BENCHMARK(BM_DBGetResults)->Arg(16)->Arg(256)->Arg(4096);
+#endif
+
+} // namespace
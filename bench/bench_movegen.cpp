@@ -0,0 +1,71 @@
+#include "corpus.h"
+#include "movegen.h"
+#include <benchmark/benchmark.h>
+
+using namespace bobail;
+
+namespace {
+
+template <RulesVariant V>
+void BM_GenerateMoves(benchmark::State& state) {
+    const auto& corpus = bench_corpus();
+    MoveList moves;
+    size_t i = 0;
+    for (auto _ : state) {
+        generate_moves<V>(corpus[i], moves);
+        benchmark::DoNotOptimize(moves.count);
+        if (++i == corpus.size()) i = 0;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_GenerateMoves<RulesVariant::OFFICIAL>);
+BENCHMARK(BM_GenerateMoves<RulesVariant::FLEXIBLE>);
+
+template <RulesVariant V>
+void BM_CountMoves(benchmark::State& state) {
+    const auto& corpus = bench_corpus();
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(count_moves<V>(corpus[i]));
+        if (++i == corpus.size()) i = 0;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_CountMoves<RulesVariant::OFFICIAL>);
+BENCHMARK(BM_CountMoves<RulesVariant::FLEXIBLE>);
+
+// Every move of every corpus position, precomputed so only apply_move is timed
+void BM_ApplyMove(benchmark::State& state) {
+    const auto& corpus = bench_corpus();
+    std::vector<std::pair<State, Move>> work;
+    MoveList moves;
+    for (const State& s : corpus) {
+        generate_moves<RulesVariant::OFFICIAL>(s, moves);
+        for (const Move& m : moves) work.emplace_back(s, m);
+    }
+
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(apply_move(work[i].first, work[i].second));
+        if (++i == work.size()) i = 0;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ApplyMove);
+
+template <RulesVariant V>
+void BM_GenerateUnmoves(benchmark::State& state) {
+    const auto& corpus = bench_corpus();
+    std::vector<State> parents;
+    size_t i = 0;
+    for (auto _ : state) {
+        generate_unmoves<V>(corpus[i], parents);
+        benchmark::DoNotOptimize(parents.data());
+        if (++i == corpus.size()) i = 0;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_GenerateUnmoves<RulesVariant::OFFICIAL>);
+BENCHMARK(BM_GenerateUnmoves<RulesVariant::FLEXIBLE>);
+
+} // namespace
@@ -0,0 +1,118 @@
+#include "corpus.h"
+#include "hash.h"
+#include "symmetry.h"
+#include <benchmark/benchmark.h>
+
+using namespace bobail;
+
+namespace {
+
+std::vector<uint64_t> packed_corpus() {
+    std::vector<uint64_t> packed;
+    for (const State& s : bench_corpus()) packed.push_back(pack_state(s));
+    return packed;
+}
+
+void BM_PackState(benchmark::State& state) {
+    const auto& corpus = bench_corpus();
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(pack_state(corpus[i]));
+        if (++i == corpus.size()) i = 0;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_PackState);
+
+void BM_UnpackState(benchmark::State& state) {
+    auto packed = packed_corpus();
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(unpack_state(packed[i]));
+        if (++i == packed.size()) i = 0;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_UnpackState);
+
+void BM_Canonicalize(benchmark::State& state) {
+    const auto& corpus = bench_corpus();
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(canonicalize(corpus[i]));
+        if (++i == corpus.size()) i = 0;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Canonicalize);
+
+void BM_CanonicalPack(benchmark::State& state) {
+    const auto& corpus = bench_corpus();
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(canonical_pack(corpus[i]));
+        if (++i == corpus.size()) i = 0;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_CanonicalPack);
+
+void BM_CanonicalizePackedBatch(benchmark::State& state) {
+    auto packed = packed_corpus();
+    std::vector<uint64_t> out(packed.size());
+    for (auto _ : state) {
+        canonicalize_packed_batch(packed.data(), out.data(), packed.size());
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations() * packed.size());
+}
+BENCHMARK(BM_CanonicalizePackedBatch);
+
+void BM_ComputeHash(benchmark::State& state) {
+    const auto& corpus = bench_corpus();
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(compute_hash(corpus[i]));
+        if (++i == corpus.size()) i = 0;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ComputeHash);
+
+template <HashMode M>
+void BM_CanonicalHash(benchmark::State& state) {
+    const auto& corpus = bench_corpus();
+    HashMode saved = g_hash_mode;
+    g_hash_mode = M;
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(canonical_hash(corpus[i]));
+        if (++i == corpus.size()) i = 0;
+    }
+    g_hash_mode = saved;
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_CanonicalHash<HashMode::ZOBRIST>);
+BENCHMARK(BM_CanonicalHash<HashMode::PACKED>);
+
+// Zobrist key of a child from its parent's, as the engine's search does
+void BM_HashAfterMove(benchmark::State& state) {
+    const auto& corpus = bench_corpus();
+    std::vector<uint64_t> hashes;
+    std::vector<Move> moves;
+    for (const State& s : corpus) {
+        MoveList list;
+        generate_moves(s, list);
+        hashes.push_back(compute_hash(s));
+        moves.push_back(list.empty() ? Move{} : list[list.size() / 2]);
+    }
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(hash_after_move(hashes[i], corpus[i], moves[i]));
+        if (++i == corpus.size()) i = 0;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_HashAfterMove);
+
+} // namespace
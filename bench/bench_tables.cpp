@@ -0,0 +1,103 @@
+#include "bloom_filter.h"
+#include "corpus.h"
+#include "hash.h"
+#include "search_tt.h"
+#include "symmetry.h"
+#include "tt.h"
+#include <benchmark/benchmark.h>
+
+using namespace bobail;
+
+namespace {
+
+std::vector<uint64_t> corpus_hashes() {
+    std::vector<uint64_t> hashes;
+    for (const State& s : bench_corpus()) hashes.push_back(canonical_hash(s));
+    return hashes;
+}
+
+// Arg: table entries. Half the probes are for stored positions.
+void BM_TTProbe(benchmark::State& state) {
+    auto hashes = corpus_hashes();
+    TranspositionTable tt(state.range(0));
+    TTEntry entry;
+    for (size_t i = 0; i < hashes.size(); i += 2) {
+        entry.key = hashes[i];
+        tt.store(hashes[i], entry);
+    }
+
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(tt.probe(hashes[i]));
+        if (++i == hashes.size()) i = 0;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TTProbe)->Arg(1 << 16)->Arg(1 << 24);
+
+void BM_TTStore(benchmark::State& state) {
+    auto hashes = corpus_hashes();
+    TranspositionTable tt(state.range(0));
+    TTEntry entry;
+    size_t i = 0;
+    for (auto _ : state) {
+        entry.key = hashes[i];
+        tt.store(hashes[i], entry);
+        if (++i == hashes.size()) i = 0;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TTStore)->Arg(1 << 16)->Arg(1 << 24);
+
+// Arg: megabytes
+void BM_SearchTTProbeStore(benchmark::State& state) {
+    const auto& corpus = bench_corpus();
+    std::vector<uint64_t> keys;
+    for (const State& s : corpus) keys.push_back(compute_hash(s));
+    SearchTT tt(state.range(0));
+
+    size_t i = 0;
+    SearchTTEntry entry;
+    for (auto _ : state) {
+        if (!tt.probe(keys[i], entry)) tt.store(keys[i], 0, 1, Bound::EXACT, nullptr);
+        if (++i == keys.size()) i = 0;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SearchTTProbeStore)->Arg(1)->Arg(256);
+
+// Arg: filter megabytes; small fits in cache, large does not
+void BM_BloomAdd(benchmark::State& state) {
+    auto hashes = corpus_hashes();
+    BloomFilter filter(static_cast<size_t>(state.range(0)) << 20);
+    filter.clear();  // Fault the pages in now rather than in the timed loop
+    size_t i = 0;
+    uint64_t salt = 0;
+    for (auto _ : state) {
+        filter.add(hashes[i] ^ salt);
+        if (++i == hashes.size()) {
+            i = 0;
+            salt += 0x9E3779B97F4A7C15ULL;  // New keys on every pass
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_BloomAdd)->Arg(1)->Arg(512);
+
+// Half the queried keys were added
+void BM_BloomMaybeContains(benchmark::State& state) {
+    auto hashes = corpus_hashes();
+    BloomFilter filter(static_cast<size_t>(state.range(0)) << 20);
+    filter.clear();
+    for (size_t i = 0; i < hashes.size(); i += 2) filter.add(hashes[i]);
+
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(filter.maybe_contains(hashes[i]));
+        if (++i == hashes.size()) i = 0;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_BloomMaybeContains)->Arg(1)->Arg(512);
+
+} // namespace
@@ -0,0 +1,42 @@
+#include "corpus.h"
+#include "hash.h"
+#include "movegen.h"
+#include "symmetry.h"
+#include <random>
+
+namespace bobail {
+
+namespace {
+
+constexpr int NUM_GAMES = 256;
+constexpr int MAX_PLIES = 200;
+constexpr uint32_t SEED = 20240601;
+
+std::vector<State> sample_games() {
+    init_move_tables();
+    init_zobrist();
+    init_symmetry();
+
+    std::mt19937 rng(SEED);
+    std::vector<State> corpus;
+    MoveList moves;
+    for (int game = 0; game < NUM_GAMES; ++game) {
+        State s = State::starting_position();
+        for (int ply = 0; ply < MAX_PLIES && check_terminal(s) == GameResult::ONGOING; ++ply) {
+            generate_moves<RulesVariant::OFFICIAL>(s, moves);
+            if (moves.empty()) break;
+            corpus.push_back(s);
+            s = apply_move(s, moves[rng() % moves.size()]);
+        }
+    }
+    return corpus;
+}
+
+} // namespace
+
+const std::vector<State>& bench_corpus() {
+    static const std::vector<State> corpus = sample_games();
+    return corpus;
+}
+
+} // namespace bobail
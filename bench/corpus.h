@@ -0,0 +1,14 @@
+#pragma once
+
+#include "board.h"
+#include <vector>
+
+namespace bobail {
+
+// Fixed benchmark corpus: the positions of a few hundred games of random
+// play under the official rules, always from the same seed, so every run
+// and every build times the same work. The first call also initializes
+// the move, Zobrist and symmetry tables.
+const std::vector<State>& bench_corpus();
+
+} // namespace bobail
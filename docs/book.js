@@ -0,0 +1,135 @@
+// Reader for the binary opening book written by `export_book --format binary`
+// (layout described in include/opening_book.h). The whole file stays in one
+// ArrayBuffer; a probe binary-searches the block index and decodes a single
+// block of varint-delta keys. Keys are 56-bit packed positions, so they are
+// handled as BigInt.
+
+const BOOK_MAGIC = 0x314B4F4F42424F42n;  // "BOBBOOK1"
+const BOOK_VERSION = 1;
+const BOOK_RULES_OFFICIAL = 1;
+const BOOK_HAS_DTW = 1;
+const BOOK_RESULTS = ['unknown', 'win', 'loss', 'draw'];
+
+// Mirror of a square across the middle column
+function bookMirrorSquare(sq) {
+    const col = sq % 5;
+    return sq - col + (4 - col);
+}
+
+// Same bit layout as pack_state(): green (white) pawns in bits 0-24, red
+// pawns in 25-49, the Bobail square in 50-54 and the side to move in 55
+function bookPackState(greenPawns, redPawns, bobailSquare, greenToMove) {
+    let wp = 0, bp = 0;
+    for (const sq of greenPawns) wp |= (1 << sq);
+    for (const sq of redPawns) bp |= (1 << sq);
+    return BigInt(wp >>> 0) | (BigInt(bp >>> 0) << 25n) |
+           (BigInt(bobailSquare) << 50n) | ((greenToMove ? 1n : 0n) << 55n);
+}
+
+class OpeningBook {
+    constructor(buffer) {
+        const view = new DataView(buffer);
+        if (buffer.byteLength < 64 || view.getBigUint64(0, true) !== BOOK_MAGIC ||
+            view.getUint32(8, true) !== BOOK_VERSION) {
+            throw new Error('not an opening book');
+        }
+        if (view.getUint32(12, true) !== BOOK_RULES_OFFICIAL) {
+            throw new Error('opening book was built for flexible rules');
+        }
+
+        this.view = view;
+        this.bytes = new Uint8Array(buffer);
+        this.hasDtw = (view.getUint32(16, true) & BOOK_HAS_DTW) !== 0;
+        this.blockEntries = view.getUint32(20, true);
+        this.numEntries = Number(view.getBigUint64(24, true));
+        this.numBlocks = Number(view.getBigUint64(32, true));
+        this.indexOffset = Number(view.getBigUint64(40, true));
+        this.dataOffset = Number(view.getBigUint64(48, true));
+        this.dataBytes = Number(view.getBigUint64(56, true));
+
+        if (this.indexOffset + this.numBlocks * 16 > this.dataOffset ||
+            this.dataOffset + this.dataBytes > buffer.byteLength) {
+            throw new Error('opening book is truncated');
+        }
+    }
+
+    // Fetch and parse a book; null if it is missing or unreadable
+    static async load(url) {
+        try {
+            const response = await fetch(url);
+            if (!response.ok) return null;
+            return new OpeningBook(await response.arrayBuffer());
+        } catch (e) {
+            console.log('Opening book not loaded:', e.message);
+            return null;
+        }
+    }
+
+    blockKey(b) {
+        return this.view.getBigUint64(this.indexOffset + b * 16, true);
+    }
+
+    blockOffset(b) {
+        return this.dataOffset + Number(this.view.getBigUint64(this.indexOffset + b * 16 + 8, true));
+    }
+
+    // Same shape as the solver server's /bestmove answer, or null if the
+    // position is not in the book
+    probe(state) {
+        const packed = bookPackState(state.greenPawns, state.redPawns, state.bobailSquare, state.greenToMove);
+        const mirrored = bookPackState(state.greenPawns.map(bookMirrorSquare), state.redPawns.map(bookMirrorSquare),
+                                       bookMirrorSquare(state.bobailSquare), state.greenToMove);
+        const key = mirrored < packed ? mirrored : packed;
+
+        // Last block whose first key is <= key
+        let lo = 0, hi = this.numBlocks;
+        while (lo < hi) {
+            const mid = (lo + hi) >> 1;
+            if (this.blockKey(mid) <= key) lo = mid + 1;
+            else hi = mid;
+        }
+        if (lo === 0) return null;
+        const b = lo - 1;
+
+        const bytes = this.bytes;
+        let p = this.blockOffset(b);
+        const count = Math.min(this.blockEntries, this.numEntries - b * this.blockEntries);
+        let k = this.blockKey(b);
+
+        for (let i = 0; i < count; i++) {
+            if (i > 0) {
+                let delta = 0n, shift = 0n, byte;
+                do {
+                    byte = bytes[p++];
+                    delta |= BigInt(byte & 0x7f) << shift;
+                    shift += 7n;
+                } while (byte & 0x80);
+                k += delta;
+            }
+            if (k > key) return null;
+
+            const info = bytes[p++];
+            if (k < key) {
+                p += ((info & 8) ? 1 : 0) + ((info & 4) ? 2 : 0);
+                continue;
+            }
+
+            const result = { result: BOOK_RESULTS[info & 3] };
+            if (info & 8) result.dtw = bytes[p++];
+            if (info & 4) {
+                const m = bytes[p] | (bytes[p + 1] << 8);
+                let move = { bobail_to: m & 0x1f, pawn_from: (m >> 5) & 0x1f, pawn_to: (m >> 10) & 0x1f };
+                if (key !== packed) {
+                    move = {
+                        bobail_to: bookMirrorSquare(move.bobail_to),
+                        pawn_from: bookMirrorSquare(move.pawn_from),
+                        pawn_to: bookMirrorSquare(move.pawn_to)
+                    };
+                }
+                result.best_move = move;
+            }
+            return result;
+        }
+        return null;
+    }
+}
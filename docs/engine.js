@@ -0,0 +1,132 @@
+// Optional WebAssembly build of the C++ engine (the bobail_wasm target, see
+// the README). When bobail_wasm.js and bobail_wasm.wasm are deployed next
+// to the page, move generation and probes of the opening book and a
+// tablebase run in the browser; the solver server only sees what neither
+// file covers. Without them LocalEngine.load() returns null and the page
+// works as before.
+
+const ENGINE_SCRIPT_URL = 'bobail_wasm.js';
+const ENGINE_RESULTS = { 0: 'unknown', 1: 'win', '-1': 'loss', 2: 'draw' };
+
+// Square bitmask of a list of squares, as the engine takes it
+function engineMask(squares) {
+    let mask = 0;
+    for (const sq of squares) mask |= (1 << sq);
+    return mask >>> 0;
+}
+
+// Squares set in a bitmask
+function engineSquares(mask) {
+    const squares = [];
+    for (let sq = 0; sq < 25; sq++) {
+        if (mask & (1 << sq)) squares.push(sq);
+    }
+    return squares;
+}
+
+class LocalEngine {
+    constructor(module) {
+        this.module = module;
+        module._bobail_init(1);  // The page plays the official rules
+    }
+
+    // Load the engine script and module; null if they are not deployed
+    static async load(url = ENGINE_SCRIPT_URL) {
+        try {
+            if (typeof createBobailEngine === 'undefined') {
+                await new Promise((resolve, reject) => {
+                    const script = document.createElement('script');
+                    script.src = url;
+                    script.onload = resolve;
+                    script.onerror = () => reject(new Error(`${url} not found`));
+                    document.head.appendChild(script);
+                });
+            }
+            return new LocalEngine(await createBobailEngine());
+        } catch (e) {
+            console.log('Local engine not loaded:', e.message);
+            return null;
+        }
+    }
+
+    // Copy a file image into the module; `loader` takes ownership of it
+    loadImage(buffer, loader) {
+        const bytes = new Uint8Array(buffer);
+        const ptr = this.module._bobail_alloc(bytes.length);
+        if (!ptr) return false;
+        this.module.HEAPU8.set(bytes, ptr);
+        return loader(ptr, bytes.length) === 1;
+    }
+
+    // Opening book image (export_book --format binary)
+    loadBook(buffer) {
+        return this.loadImage(buffer, (ptr, size) => this.module._bobail_load_book(ptr, size));
+    }
+
+    // Fetch a tablebase (export_tablebase); false if it is missing or unreadable
+    async loadTablebase(url) {
+        try {
+            const response = await fetch(url);
+            if (!response.ok) return false;
+            const buffer = await response.arrayBuffer();
+            return this.loadImage(buffer, (ptr, size) => this.module._bobail_load_tablebase(ptr, size));
+        } catch (e) {
+            console.log('Tablebase not loaded:', e.message);
+            return false;
+        }
+    }
+
+    args(state) {
+        return [engineMask(state.greenPawns), engineMask(state.redPawns),
+                state.bobailSquare, state.greenToMove ? 1 : 0];
+    }
+
+    // Legal moves, in the engine's order
+    generateMoves(state) {
+        const count = this.module._bobail_generate_moves(...this.args(state));
+        const ptr = this.module._bobail_moves();
+        const heap = this.module.HEAPU8;
+        const moves = [];
+        for (let i = 0; i < count; i++) {
+            const p = ptr + 3 * i;
+            moves.push({ bobail_to: heap[p], pawn_from: heap[p + 1], pawn_to: heap[p + 2] });
+        }
+        return moves;
+    }
+
+    // Position after `move`
+    applyMove(state, move) {
+        this.module._bobail_apply_move(...this.args(state), move.bobail_to, move.pawn_from, move.pawn_to);
+        const p = this.module._bobail_position() >> 2;
+        const heap = this.module.HEAPU32;
+        return {
+            greenPawns: engineSquares(heap[p]),
+            redPawns: engineSquares(heap[p + 1]),
+            bobailSquare: heap[p + 2],
+            greenToMove: heap[p + 3] === 1
+        };
+    }
+
+    // 'green' or 'red' once the Bobail reaches a home row, else null
+    winner(state) {
+        const w = this.module._bobail_game_over(...this.args(state));
+        return w === 1 ? 'green' : w === 2 ? 'red' : null;
+    }
+
+    // Same shape as the solver server's /bestmove answer (and
+    // OpeningBook.probe), or null if neither the book nor the tablebase
+    // knows the position
+    probe(state) {
+        const code = this.module._bobail_probe(...this.args(state));
+        if (code === 0) return null;
+
+        const p = this.module._bobail_probe_info() >> 2;
+        const info = this.module.HEAP32;
+        const result = { result: ENGINE_RESULTS[code] };
+        if (code !== 2 && info[p] > 0) result.dtw = info[p];
+        if (info[p + 1]) {
+            result.best_move = { bobail_to: info[p + 2], pawn_from: info[p + 3], pawn_to: info[p + 4] };
+        }
+        return result;
+    }
+}
@@ -1314,6 +1314,17 @@ const SOLVER_SERVER = 'http://localhost:8081';
 // Cache for solver lookups to avoid repeated requests
 const solverCache = new Map();
 
+// Opening book served next to the page (export_book --format binary);
+// positions it covers are answered without the solver server
+const OPENING_BOOK_URL = 'opening_book.bin';
+let openingBook = null;
+
+// WebAssembly engine (engine.js), when deployed next to the page; it
+// answers from the book and, if one is set here, a tablebase small enough
+// to download
+const LOCAL_TABLEBASE_URL = null;
+let localEngine = null;
+
 // Convert current game state to position string for solver query
 function stateToSolverPos(state) {
     // Format: WP,BP,BOB,STM (hex,hex,int,int)
@@ -1334,6 +1345,15 @@ async function lookupPosition(state) {
         return solverCache.get(pos);
     }
 
+    const local = localEngine || openingBook;
+    if (local) {
+        const entry = local.probe(state);
+        if (entry && entry.result !== 'unknown') {
+            solverCache.set(pos, entry);
+            return entry;
+        }
+    }
+
     try {
         const controller = new AbortController();
         const timeout = setTimeout(() => controller.abort(), 3000); // 3s timeout
@@ -1911,6 +1931,15 @@ document.addEventListener('DOMContentLoaded', () => {
     loadGameHistory();
     initSounds();
 
+    Promise.all([OpeningBook.load(OPENING_BOOK_URL), LocalEngine.load()]).then(([book, engine]) => {
+        openingBook = book;
+        // The engine takes over lookups once it holds the book too
+        if (engine && (!book || engine.loadBook(book.bytes))) {
+            if (LOCAL_TABLEBASE_URL) engine.loadTablebase(LOCAL_TABLEBASE_URL);
+            localEngine = engine;
+        }
+    });
+
     // Initialize game
     initGame();
 
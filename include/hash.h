@@ -1,6 +1,7 @@
 #pragma once
 
 #include "board.h"
+#include "movegen.h"
 #include <cstdint>
 #include <array>
 
@@ -28,4 +29,57 @@ uint64_t hash_toggle_pawn(uint64_t hash, int sq, bool is_white);
 uint64_t hash_toggle_bobail(uint64_t hash, int from, int to);
 uint64_t hash_toggle_side(uint64_t hash);
 
+// Zobrist hash of apply_move(s, m), given compute_hash(s) == hash
+uint64_t hash_after_move(uint64_t hash, const State& s, const Move& m);
+
+// Bijective multiply-xorshift mixer (the MurmurHash3 finalizer). A packed
+// state already identifies its position, so its mix is a well spread
+// hash that two positions can never share, and unmix_key() gets the
+// packed state back.
+constexpr uint64_t mix_key(uint64_t k) {
+    k ^= k >> 33;
+    k *= 0xFF51AFD7ED558CCDULL;
+    k ^= k >> 33;
+    k *= 0xC4CEB9FE1A85EC53ULL;
+    k ^= k >> 33;
+    return k;
+}
+
+constexpr uint64_t unmix_key(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0x9CB4B2F8129337DBULL;  // Inverse of the second multiplier
+    h ^= h >> 33;
+    h *= 0x4F74430C22A54005ULL;  // Inverse of the first
+    h ^= h >> 33;
+    return h;
+}
+
+// How position keys for the transposition tables are made:
+//   ZOBRIST  compute_hash() (of the canonical form for canonical_hash()).
+//            64 random bits, so two positions can collide.
+//   PACKED   mix_key() of the packed state. Exact, and a couple of
+//            multiplies instead of a walk over every piece.
+// PNS checkpoints and table files record the mode their keys were made
+// in, and loading one switches to it.
+enum class HashMode : uint8_t {
+    ZOBRIST = 0,
+    PACKED = 1
+};
+
+extern HashMode g_hash_mode;
+
+// Switch to the key mode recorded in a PNS file; false if it is unknown
+bool use_hash_mode(uint64_t mode);
+
+// Key of the position itself (not its canonical form) in g_hash_mode
+inline uint64_t position_hash(const State& s) {
+    return g_hash_mode == HashMode::PACKED ? mix_key(pack_state(s)) : compute_hash(s);
+}
+
+// position_hash(child) for child = apply_move(s, m), from hash ==
+// position_hash(s); Zobrist keys are updated rather than recomputed
+inline uint64_t position_hash_after(uint64_t hash, const State& s, const Move& m, const State& child) {
+    return g_hash_mode == HashMode::PACKED ? mix_key(pack_state(child)) : hash_after_move(hash, s, m);
+}
+
 } // namespace bobail
@@ -27,6 +27,32 @@ struct Move {
     std::string to_string() const;
 };
 
+// Upper bound on the number of legal moves from any position:
+// 8 Bobail steps, each followed by at most 14 free destinations
+// (25 squares minus 10 pawns and the Bobail) for each of 5 pawns.
+constexpr size_t MAX_MOVES = 8 * PAWNS_PER_SIDE * (NUM_SQUARES - 2 * PAWNS_PER_SIDE - 1);
+
+// Fixed-capacity move list (stack array + count) for hot loops.
+// Never touches the heap; fill it with generate_moves(s, list).
+struct MoveList {
+    std::array<Move, MAX_MOVES> moves;
+    size_t count = 0;
+
+    void push_back(const Move& m) { moves[count++] = m; }
+    void clear() { count = 0; }
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    Move& operator[](size_t i) { return moves[i]; }
+    const Move& operator[](size_t i) const { return moves[i]; }
+
+    Move* begin() { return moves.data(); }
+    Move* end() { return moves.data() + count; }
+    const Move* begin() const { return moves.data(); }
+    const Move* end() const { return moves.data() + count; }
+};
+
 // Precomputed ray tables for sliding moves
 // rays[sq][dir] = ordered list of squares in that direction from sq
 extern std::array<std::array<std::vector<int>, 8>, NUM_SQUARES> rays;
@@ -35,6 +61,16 @@ extern std::array<std::array<std::vector<int>, 8>, NUM_SQUARES> rays;
 // neighbors[sq] = list of adjacent squares
 extern std::array<std::vector<int>, NUM_SQUARES> neighbors;
 
+// Bitboard versions of the tables above (no heap storage)
+// ray_masks[sq][dir] = bitboard of all squares in that direction from sq
+// ray_squares[sq][dir][i] = i-th square along the ray (nearest first)
+// ray_lengths[sq][dir] = number of squares on the ray
+// neighbor_masks[sq] = bitboard of adjacent squares
+extern std::array<std::array<uint32_t, 8>, NUM_SQUARES> ray_masks;
+extern std::array<std::array<std::array<uint8_t, BOARD_SIZE - 1>, 8>, NUM_SQUARES> ray_squares;
+extern std::array<std::array<uint8_t, 8>, NUM_SQUARES> ray_lengths;
+extern std::array<uint32_t, NUM_SQUARES> neighbor_masks;
+
 // Initialize the precomputed tables (call once at startup)
 void init_move_tables();
 
@@ -55,6 +91,47 @@ bool is_starting_position(const State& s);
 // On first turn (starting position), generates pawn-only moves
 std::vector<Move> generate_moves(const State& s);
 
+// Allocation-free variant: clears `out` and fills it with the same moves,
+// in the same order, as generate_moves(s). Dispatches on g_rules_variant
+// once per call into one of the specializations below.
+void generate_moves(const State& s, MoveList& out);
+
+// Specialized on the rules variant so the pawn kernel has no per-ray
+// variant check. Use these directly when the variant is fixed for the
+// whole run (pick it once in main and call a templated driver).
+template <RulesVariant V>
+void generate_moves(const State& s, MoveList& out);
+
+template <RulesVariant V>
+size_t count_moves(const State& s);
+
+extern template void generate_moves<RulesVariant::FLEXIBLE>(const State&, MoveList&);
+extern template void generate_moves<RulesVariant::OFFICIAL>(const State&, MoveList&);
+extern template size_t count_moves<RulesVariant::FLEXIBLE>(const State&);
+extern template size_t count_moves<RulesVariant::OFFICIAL>(const State&);
+
+// Retro move generation: every parent P of `s`, i.e. every non-terminal
+// position with a legal move m such that apply_move(P, m) == s.
+// A parent is listed once per such move, so a parent reaching `s` by two
+// different moves appears twice. Parents are not canonicalized.
+std::vector<State> generate_unmoves(const State& s);
+
+// Clears `out` and fills it with the same parents as generate_unmoves(s)
+void generate_unmoves(const State& s, std::vector<State>& out);
+
+template <RulesVariant V>
+void generate_unmoves(const State& s, std::vector<State>& out);
+
+extern template void generate_unmoves<RulesVariant::FLEXIBLE>(const State&, std::vector<State>&);
+extern template void generate_unmoves<RulesVariant::OFFICIAL>(const State&, std::vector<State>&);
+
+// Retro edges between canonical positions (see canonical_pack): clears
+// `out` and fills it with the packed canonical parents of the canonical
+// position `canonical`, once per move of that parent whose canonicalized
+// result is `canonical`. This matches the predecessor lists built from
+// forward moves, so it can stand in for them during propagation.
+void generate_canonical_unmoves(uint64_t canonical, std::vector<uint64_t>& out);
+
 // Apply a move to a state, returning the new state
 State apply_move(const State& s, const Move& m);
 
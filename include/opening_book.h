@@ -0,0 +1,108 @@
+#pragma once
+
+#include "board.h"
+#include "movegen.h"
+#include "tt.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace bobail {
+
+// Compact binary opening book, written by export_book and read by the
+// web interface (docs/book.js) and OpeningBook below.
+//
+// Positions are stored once per mirror pair, under their canonical packed
+// state, sorted by that key and cut into blocks of BLOCK_ENTRIES. After
+// the 64-byte header comes an index with the first key and the byte
+// offset of every block, then the blocks. A probe binary-searches the
+// index and decodes one block. Within a block every entry is
+//
+//   key     LEB128 varint of the difference to the previous key
+//           (omitted for the first entry, whose key is in the index)
+//   info    bits 0-1 result code (BITMAP_WIN etc.), bit 2 a best move
+//           follows, bit 3 a DTW byte follows
+//   dtw     plies to the end of the game (WIN/LOSS with DTW only)
+//   move    16-bit bobail_to | pawn_from << 5 | pawn_to << 10, for the
+//           canonical position; mirror it back for the other one
+//
+// All integers are little-endian.
+
+constexpr uint32_t BOOK_HAS_DTW = 1;
+
+struct BookHeader {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t rules_variant;   // RulesVariant the results were computed for
+    uint32_t flags;           // BOOK_HAS_DTW
+    uint32_t block_entries;   // Entries per block
+    uint64_t num_entries;
+    uint64_t num_blocks;
+    uint64_t index_offset;    // Byte offset of the block index
+    uint64_t data_offset;     // Byte offset of the first block
+    uint64_t data_bytes;      // Bytes of block data
+};
+
+static_assert(sizeof(BookHeader) == 64);
+
+struct BookBlock {
+    uint64_t first_key;
+    uint64_t offset;          // From data_offset
+};
+
+struct BookEntry {
+    uint64_t key = 0;         // Canonical packed state
+    Result result = Result::UNKNOWN;
+    uint8_t dtw = 0;
+    bool has_move = false;
+    Move best{};              // Best move of the canonical state
+};
+
+class OpeningBook {
+public:
+    static constexpr uint64_t MAGIC = 0x314B4F4F42424F42ULL;  // "BOBBOOK1"
+    static constexpr uint32_t VERSION = 1;
+    static constexpr uint32_t BLOCK_ENTRIES = 64;
+
+    // Read the book at `path` into memory
+    bool open(const std::string& path);
+
+    // Same, from a copy of a file image
+    bool open_buffer(const void* data, size_t size);
+
+    bool is_open() const { return header_.magic == MAGIC; }
+    bool has_dtw() const { return (header_.flags & BOOK_HAS_DTW) != 0; }
+    uint64_t size() const { return header_.num_entries; }
+
+    // Result for the side to move, UNKNOWN if the position is not in the
+    // book. `dtw` is set for WIN/LOSS when the book has DTW, and `best`,
+    // if given, to the best move of `s` itself (Move{} when there is none).
+    Result probe(const State& s, uint8_t& dtw, Move* best = nullptr) const;
+
+private:
+    bool attach(const std::string& name);
+
+    std::vector<uint8_t> data_;
+    BookHeader header_{};
+    std::vector<BookBlock> index_;
+};
+
+// Write a book; sorts `entries` by key in place. Keys must be unique.
+bool write_opening_book(const std::string& path, std::vector<BookEntry>& entries, bool has_dtw);
+
+// Results of `states` in order, filling `dtw` for each
+using BookLookup = std::function<std::vector<Result>(std::span<const State> states, std::vector<uint8_t>& dtw)>;
+
+// Every position within `max_depth` plies of the start, with its result
+// and best move (fastest win, slowest loss, or a draw). Built level by
+// level on `num_threads` threads: each position's children are looked up
+// in one batch, which gives both its best move and the results of the
+// next level, so every position is looked up once. `progress` is called
+// after each level with the depth and the positions collected so far.
+std::vector<BookEntry> collect_opening_book(const BookLookup& lookup, int max_depth, int num_threads,
+                                            const std::function<void(int, uint64_t)>& progress = {});
+
+} // namespace bobail
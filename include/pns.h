@@ -9,17 +9,48 @@
 
 namespace bobail {
 
-// Node in the proof-number search tree
+// Node in the proof-number search tree. Nodes live in a PNSNodeArena and
+// refer to their children by index: the children of a node are the
+// `num_children` consecutive nodes starting at `first_child`. The
+// position is not stored; the search replays it from the root along
+// `move` as it descends.
 struct PNSNode {
-    State state;
-    uint32_t proof;         // Proof number
-    uint32_t disproof;      // Disproof number
-    bool expanded;          // Has children been generated?
-    std::vector<std::unique_ptr<PNSNode>> children;
-    Move move;              // Move that led to this node (for PV extraction)
-
-    PNSNode(const State& s)
-        : state(s), proof(1), disproof(1), expanded(false) {}
+    uint32_t proof = 1;         // Proof number
+    uint32_t disproof = 1;      // Disproof number
+    uint32_t first_child = 0;   // Arena index of the first child
+    uint16_t num_children = 0;
+    bool expanded = false;      // Has children been generated?
+    Move move{};                // Move that led to this node (for PV extraction)
+};
+
+// Pool of PNSNodes addressed by 32-bit index. Nodes are allocated in
+// fixed-size chunks, so they never move and a sibling range never
+// straddles two chunks.
+class PNSNodeArena {
+public:
+    static constexpr uint32_t CHUNK_BITS = 16;
+    static constexpr uint32_t CHUNK_NODES = 1u << CHUNK_BITS;
+    static constexpr uint32_t NO_NODE = UINT32_MAX;
+
+    PNSNode& operator[](uint32_t index) { return chunks_[index >> CHUNK_BITS][index & (CHUNK_NODES - 1)]; }
+    const PNSNode& operator[](uint32_t index) const {
+        return chunks_[index >> CHUNK_BITS][index & (CHUNK_NODES - 1)];
+    }
+
+    // Allocate `count` consecutive nodes; NO_NODE once indices run out
+    uint32_t allocate(uint32_t count);
+
+    // Drop all nodes, keeping the first chunk for the next search
+    void clear();
+
+    // Nodes handed out, and bytes held by the chunks
+    uint64_t size() const { return used_; }
+    uint64_t bytes() const { return chunks_.size() * CHUNK_NODES * sizeof(PNSNode); }
+
+private:
+    std::vector<std::unique_ptr<PNSNode[]>> chunks_;
+    uint32_t next_ = 0;  // Next free index
+    uint64_t used_ = 0;
 };
 
 // Proof-Number Search solver
@@ -41,6 +72,8 @@ public:
     uint64_t nodes_searched() const { return nodes_searched_; }
     uint64_t nodes_proved() const { return nodes_proved_; }
     uint64_t nodes_disproved() const { return nodes_disproved_; }
+    uint64_t tree_nodes() const { return nodes_.size(); }
+    uint64_t tree_bytes() const { return nodes_.bytes(); }
 
     // Set progress callback (called periodically during search)
     void set_progress_callback(ProgressCallback cb) { progress_cb_ = cb; }
@@ -49,8 +82,19 @@ public:
     void set_node_limit(uint64_t limit) { node_limit_ = limit; }
 
 private:
+    static constexpr uint32_t ROOT = 0;
+
+    // A node on the current root-to-leaf path, with its replayed position
+    struct PathEntry {
+        uint32_t node;
+        State state;
+    };
+
     TranspositionTable tt_;
-    std::unique_ptr<PNSNode> root_;
+    PNSNodeArena nodes_;
+    State root_state_{};
+    std::vector<PathEntry> path_;  // Reused by every iteration
+    bool out_of_nodes_ = false;
 
     uint64_t nodes_searched_ = 0;
     uint64_t nodes_proved_ = 0;
@@ -59,32 +103,30 @@ private:
 
     ProgressCallback progress_cb_;
 
-    // Core PNS algorithm
-    void pns_search(PNSNode* node);
-
-    // Select most proving node (for OR nodes, min proof; for AND nodes, min disproof)
-    PNSNode* select_most_proving(PNSNode* node, bool is_or_node);
+    // One iteration: descend to the most proving node, expand it and
+    // update its ancestors
+    void pns_search();
 
     // Expand a node (generate children)
-    void expand(PNSNode* node);
+    void expand(uint32_t index, const State& state);
 
-    // Update proof/disproof numbers after expansion or child update
-    void update_ancestors(PNSNode* node, bool is_or_node);
+    // Recompute proof numbers from the children; true if they changed
+    bool update_node(uint32_t index, const State& state);
 
     // Set proof numbers based on terminal state
-    void set_terminal(PNSNode* node);
+    void set_terminal(PNSNode& node, const State& state);
+
+    // Record a solved node in the TT
+    void store_solved(const State& state, const PNSNode& node);
+
+    // OR nodes are the root player's turn
+    bool is_or_node(const State& s) const { return s.white_to_move == root_state_.white_to_move; }
 
     // Check if node is terminal (win/loss/no moves)
     bool is_terminal(const State& s);
 
     // Get canonical hash for TT lookup
     uint64_t get_hash(const State& s);
-
-    // Update a single node's proof numbers from children
-    void update_node(PNSNode* node);
-
-    // Update entire tree (post-order traversal)
-    void update_tree(PNSNode* node);
 };
 
 } // namespace bobail
@@ -0,0 +1,149 @@
+#pragma once
+
+#include "tt.h"
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace bobail {
+
+// Checkpoints of a PNSTable that are written while the search keeps
+// running and load in about the time it takes to map a file.
+//
+// A checkpoint is a snapshot file plus a delta log next to it
+// (path + ".delta"):
+//
+// Snapshot   A one-page PNSSnapshotHeader followed by the raw slot array,
+//            exactly as it sits in memory. Loading maps it copy-on-write
+//            (PNSTable::map_file) instead of re-inserting every entry.
+// Delta log  Appended records of the slots written since the snapshot,
+//            from the table's dirty tracking. Each delta starts with a
+//            PNSDeltaHeader naming the snapshot it applies to and ends
+//            with a commit word, so a delta cut short by a crash is
+//            dropped on load.
+//
+// Writes run on a background thread that copies slots with
+// PNSTable::load_slot(), so the result is a fuzzy snapshot: a slot
+// written during the copy may be saved with its old or new numbers, and
+// is dirty again for the next delta either way. Solved results are
+// never lost, and proof numbers are recomputed from the children anyway.
+// Anything that moves slots (grow, sweep, clear) must wait() first; the
+// next checkpoint after a move is a full snapshot.
+//
+// Files written before this format (a stream of PNSTTEntry records with
+// the search mode as the version) still load.
+//
+// Keys are canonical_hash() values; loading a checkpoint switches
+// g_hash_mode to the mode it was written in.
+
+struct PNSSnapshotHeader {
+    uint64_t magic;
+    uint64_t version;
+    uint64_t mode;          // Search mode, chosen by the caller
+    uint64_t snapshot_id;   // Deltas carry the id of their snapshot
+    uint64_t capacity;      // Slots in the array
+    uint64_t size;          // Used slots
+    uint64_t counters[4];
+    uint64_t key_mode;      // HashMode of the keys (0, Zobrist, in older files)
+};
+
+struct PNSDeltaHeader {
+    uint64_t magic;
+    uint64_t snapshot_id;
+    uint64_t num_records;
+    uint64_t counters[4];
+};
+
+// One written slot; a delta ends with the commit word after its records
+struct PNSDeltaRecord {
+    uint64_t index;
+    uint64_t key;
+    uint64_t numbers;
+};
+
+class PNSCheckpointer {
+public:
+    static constexpr uint64_t MAGIC = 0x504E5343484B5054ULL;        // "PNSCHKPT"
+    static constexpr uint64_t DELTA_MAGIC = 0x41544C4544534E50ULL;  // "PNSDELTA"
+    static constexpr uint64_t VERSION = 3;
+    static constexpr size_t HEADER_BYTES = 4096;
+
+    // Mode for load() that accepts a checkpoint of any mode
+    static constexpr uint64_t ANY_MODE = UINT64_MAX;
+
+    // Caller's statistics saved with every checkpoint
+    using Counters = std::array<uint64_t, 4>;
+
+    struct Report {
+        bool ok = true;
+        bool full = false;     // Snapshot rather than delta
+        uint64_t entries = 0;  // Slots written
+        uint64_t bytes = 0;
+        double seconds = 0;
+    };
+
+    explicit PNSCheckpointer(std::string path = "") : path_(std::move(path)) {}
+    ~PNSCheckpointer() { wait(); }
+
+    PNSCheckpointer(const PNSCheckpointer&) = delete;
+    PNSCheckpointer& operator=(const PNSCheckpointer&) = delete;
+
+    void set_path(const std::string& path) { path_ = path; }
+    const std::string& path() const { return path_; }
+    std::string delta_path() const { return path_ + ".delta"; }
+
+    // Replace `table` with the checkpoint at path() and start tracking its
+    // writes. Fails, leaving the table alone, if there is no checkpoint
+    // or it was written in another mode.
+    bool load(PNSTable& table, uint64_t mode, Counters& counters);
+
+    // Load a checkpoint of any mode for reading, without dirty tracking
+    static bool read(const std::string& path, PNSTable& table, Counters& counters);
+
+    // Start writing a checkpoint of `table` in the background: a delta if
+    // the last snapshot still matches the table's layout, otherwise (or
+    // once the deltas outgrow half the snapshot) a new snapshot. Returns
+    // false if the previous write has not finished.
+    bool start(PNSTable& table, uint64_t mode, const Counters& counters);
+
+    // A write is in progress
+    bool busy() const { return running_.load(std::memory_order_acquire); }
+    // A write was started and has not been waited for
+    bool pending() const { return writer_.joinable(); }
+
+    // Wait for the write in progress, if any; false if it failed
+    bool wait();
+
+    // Outcome of the last write, valid after wait()
+    const Report& last_report() const { return report_; }
+
+    // Deltas applied over the snapshot by the last load()
+    uint64_t loaded_deltas() const { return loaded_deltas_; }
+
+private:
+    bool load_legacy(PNSTable& table, uint64_t mode, Counters& counters);
+    uint64_t load_deltas(PNSTable& table, Counters& counters);
+
+    void write_snapshot(const PNSTable& table, uint64_t mode, Counters counters);
+    void write_delta(const PNSTable& table, std::vector<uint64_t> dirty, Counters counters);
+
+    std::string path_;
+    bool read_only_ = false;  // Opened by read(); never modifies the files
+    std::thread writer_;
+    std::atomic<bool> running_{false};
+    Report report_;
+
+    // State of what is on disk
+    bool have_snapshot_ = false;
+    uint64_t snapshot_id_ = 0;
+    uint64_t snapshot_layout_ = 0;  // Table layout_version() it matches
+    uint64_t snapshot_bytes_ = 0;
+    uint64_t delta_bytes_ = 0;
+    uint64_t loaded_deltas_ = 0;
+};
+
+} // namespace bobail
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "pns_checkpoint.h"
+#include "tt.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace bobail {
+
+// Read-only PNS results for the query tools: pns_lookup, pns_export, the
+// trace and verify tools, the engine and bobail_server.
+//
+// `pns_export --write-table` turns a checkpoint into a table file: a
+// one-page header followed by the used PNSSlots of the search, sorted by
+// key. Opening one maps it read-only, so it takes milliseconds and every
+// process serving from the same file shares one page-cache copy. Keys are
+// canonical_hash() values (Zobrist or mixed packed states, see HashMode)
+// and spread evenly, so find() interpolates its way to the entry in a
+// handful of probes.
+//
+// open() also accepts a checkpoint (see pns_checkpoint.h); that is loaded
+// and sorted in memory, which takes as long as it always has. Either way
+// g_hash_mode switches to the mode of the file's keys.
+
+struct PNSTableFileHeader {
+    uint64_t magic;
+    uint64_t version;
+    uint64_t num_entries;
+    uint64_t data_offset;  // Byte offset of the sorted slots
+    uint64_t counters[4];  // Of the checkpoint it was made from
+    uint64_t key_mode;     // HashMode of the keys (0, Zobrist, in older files)
+};
+
+class PNSTableFile {
+public:
+    static constexpr uint64_t MAGIC = 0x31454C4241544E50ULL;  // "PNTABLE1"
+    static constexpr uint64_t VERSION = 1;
+    static constexpr size_t HEADER_BYTES = 4096;
+
+    using Counters = PNSCheckpointer::Counters;
+
+    PNSTableFile() = default;
+    ~PNSTableFile() { close(); }
+
+    PNSTableFile(const PNSTableFile&) = delete;
+    PNSTableFile& operator=(const PNSTableFile&) = delete;
+
+    // Open a table file, or load a checkpoint
+    bool open(const std::string& path);
+    void close();
+
+    bool is_open() const { return entries_ != nullptr || !owned_.empty(); }
+    // Served from a mapped table file rather than a loaded checkpoint
+    bool is_mapped() const { return mapping_ != nullptr; }
+
+    const PNSSlot* find(uint64_t key) const;
+    bool contains(uint64_t key) const { return find(key) != nullptr; }
+
+    size_t size() const { return num_entries_; }
+    bool empty() const { return num_entries_ == 0; }
+    // nodes searched, proved, disproved and retrograde hits of the search
+    const Counters& counters() const { return counters_; }
+
+    // Entries in key order
+    const PNSSlot* begin() const { return entries_; }
+    const PNSSlot* end() const { return entries_ + num_entries_; }
+
+    // Write the used slots of `table` as a table file
+    static bool write(const std::string& path, const PNSTable& table, const Counters& counters);
+
+private:
+    bool open_mapped(const std::string& path);
+
+    const PNSSlot* entries_ = nullptr;
+    size_t num_entries_ = 0;
+    Counters counters_{};
+
+    void* mapping_ = nullptr;
+    size_t mapping_bytes_ = 0;
+    std::vector<PNSSlot> owned_;  // Entries of a loaded checkpoint
+};
+
+} // namespace bobail
@@ -0,0 +1,118 @@
+#pragma once
+
+#include "board.h"
+#include "pns_table.h"
+#include "tablebase.h"
+#include "tt.h"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace bobail {
+
+// Parallel check of the proofs a PNS search left behind.
+//
+// Starting from a claimed result, the verifier walks the proof tree the
+// checkpoint (or table file) implies: a position claimed won for the side
+// to move needs one move to a position that is lost for the opponent, a
+// position claimed lost needs every move to reach one that is won for the
+// opponent. Positions that end the game are checked against the rules and
+// positions the tablebase knows against the tablebase, without looking
+// further. Everything else must carry the claimed result in the checkpoint
+// and is expanded in turn.
+//
+// Positions are tasks on per-thread Chase-Lev deques (as in perft), and a
+// concurrent visited set expands each one once however many paths lead to
+// it. A won position is followed through the first move that ends the
+// game or that the tablebase decides, or else through the first move the
+// checkpoint proves; a failure there is a wrong stored result even if
+// another move would have won.
+//
+// The walk records which expanded positions each proof rests on. Once it
+// is done, positions resolve bottom-up from the ones the rules or the
+// tablebase decide; a position that never resolves has a proof leading
+// back to itself (claims that only prove each other round a repetition)
+// and fails.
+class ProofVerifier {
+public:
+    using ProgressCallback = std::function<void(const char* phase, uint64_t current, uint64_t total)>;
+
+    struct Failure {
+        uint64_t packed;     // The position (pack_state)
+        std::string reason;
+    };
+
+    struct Stats {
+        uint64_t positions = 0;       // Expanded from checkpoint entries
+        uint64_t terminals = 0;       // Decided by the rules
+        uint64_t tablebase_hits = 0;  // Decided by the tablebase
+    };
+
+    // `tablebase` may be null
+    ProofVerifier(const PNSTableFile& pns, const Tablebase* tablebase = nullptr);
+
+    void set_num_threads(int num_threads) { num_threads_ = num_threads; }
+
+    // Stop a verify() after this many failures (default 20); at most
+    // that many are kept per call
+    void set_max_failures(size_t n) { max_failures_ = n; }
+
+    // Called about every million positions
+    void set_progress_callback(ProgressCallback cb) { progress_cb_ = cb; }
+
+    // Check that `root` is `claim` (WIN or LOSS for the side to move).
+    // Statistics and failures add up over calls, and positions a clean
+    // call checked are not expanded again; a call that fails forgets them.
+    bool verify(const State& root, Result claim);
+
+    const Stats& stats() const { return stats_; }
+    const std::vector<Failure>& failures() const { return failures_; }
+
+private:
+    // Expanded positions of one thread and the positions their proofs
+    // rest on, by canonical key
+    struct ProofGraph {
+        std::vector<std::pair<uint64_t, uint64_t>> nodes;  // Key, packed state with the claim bit
+        std::vector<std::pair<uint64_t, uint64_t>> edges;  // Key, key of a child
+    };
+
+    // Check one position against `claim`; calls push(packed, claim) for
+    // the positions its proof rests on and records them in `graph`
+    template <typename Push>
+    void check(const State& s, Result claim, Push&& push, ProofGraph& graph);
+
+    // Fail the positions of this call whose proofs run round a cycle
+    void check_cycles(std::vector<ProofGraph>& graphs);
+
+    // What the rules or the tablebase say about `s` (UNKNOWN if neither
+    // decides it); counts the hit
+    Result decided(const State& s);
+
+    void fail(const State& s, std::string reason);
+
+    const PNSTableFile& pns_;
+    const Tablebase* tablebase_;
+
+    int num_threads_ = 1;
+    size_t max_failures_ = 20;
+    ProgressCallback progress_cb_;
+
+    // Visited set: open addressing over canonical keys, 0 = empty
+    std::vector<std::atomic<uint64_t>> visited_;
+    bool visit(uint64_t key);
+
+    std::atomic<uint64_t> positions_{0};
+    std::atomic<uint64_t> terminals_{0};
+    std::atomic<uint64_t> tablebase_hits_{0};
+    std::atomic<uint64_t> call_failures_{0};  // In the current verify()
+    std::atomic<bool> stop_{false};
+
+    Stats stats_;
+    std::mutex failures_mutex_;
+    std::vector<Failure> failures_;
+};
+
+} // namespace bobail
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "board.h"
+#include <cstdint>
+
+namespace bobail {
+
+// Combinatorial ranking (perfect hash) of canonical positions
+//
+// A position is the Bobail square, 5 white pawns, 5 black pawns and the
+// side to move. Canonical positions (see canonicalize) always have the
+// Bobail in columns 0-2, since the horizontal flip of a Bobail in columns
+// 3-4 packs to a smaller value. The index is laid out mixed-radix as
+//
+//   ((bobail_index * 2 + side) * C(24,5) + white_rank) * C(19,5) + black_rank
+//
+// bobail_index = row * 3 + col   (15 Bobail squares)
+// side         = 1 if White to move
+// white_rank   = colex rank of the white pawns among the 24 squares
+//                not holding the Bobail
+// black_rank   = colex rank of the black pawns among the 19 squares
+//                not holding the Bobail or a white pawn
+//
+// The ranking is near-minimal: positions with the Bobail in the centre
+// column whose mirror image is smaller are not canonical, and their
+// indices go unused (about 17% of the space: half of the 5 centre-column
+// Bobail squares out of 15).
+
+constexpr int RANK_BOBAIL_COLUMNS = 3;
+constexpr int RANK_BOBAIL_SQUARES = BOARD_SIZE * RANK_BOBAIL_COLUMNS;
+
+constexpr uint64_t RANK_WHITE_COMBINATIONS = 42504;  // C(24, 5)
+constexpr uint64_t RANK_BLACK_COMBINATIONS = 11628;  // C(19, 5)
+
+// Positions sharing one Bobail square and side to move
+constexpr uint64_t RANK_SIDE_SLICE_SIZE = RANK_WHITE_COMBINATIONS * RANK_BLACK_COMBINATIONS;
+
+// Positions sharing one Bobail square (both sides to move)
+constexpr uint64_t RANK_SLICE_SIZE = 2 * RANK_SIDE_SLICE_SIZE;
+
+// Total number of indices (about 14.8 billion)
+constexpr uint64_t RANK_SPACE_SIZE = RANK_BOBAIL_SQUARES * RANK_SLICE_SIZE;
+
+// Rank a position, canonicalizing it first
+uint64_t rank_state(const State& s);
+
+// Rank a position that is already canonical (Bobail in columns 0-2)
+uint64_t rank_canonical(const State& canonical);
+
+// Inverse of rank_canonical for any index below RANK_SPACE_SIZE
+State unrank_state(uint64_t index);
+
+// True if the position is its own canonical form
+bool is_canonical(const State& s);
+
+// Bobail square for a Bobail index (0-14) and back
+int rank_bobail_square(int bobail_index);
+int rank_bobail_index(int bobail_sq);
+
+// The same ranking for positions with `pawns` pawns per side (1-5). Moves
+// never change the number of pawns, so every such space is closed under
+// moves and can be solved on its own. RankSpace() is the full game, with
+// the indices of rank_state; the smaller spaces let the solvers run end
+// to end in tests (1 pawn each: 16560 indices).
+class RankSpace {
+public:
+    explicit RankSpace(int pawns = PAWNS_PER_SIDE);
+
+    int pawns() const { return pawns_; }
+    bool is_full() const { return pawns_ == PAWNS_PER_SIDE; }
+
+    // Positions sharing one Bobail square (both sides to move)
+    uint64_t slice_size() const { return 2 * white_combinations_ * black_combinations_; }
+
+    // Total number of indices
+    uint64_t size() const { return RANK_BOBAIL_SQUARES * slice_size(); }
+
+    // Rank a position of this space, canonicalizing it first
+    uint64_t rank(const State& s) const;
+
+    // Rank a canonical position of this space
+    uint64_t rank_canonical(const State& canonical) const;
+
+    // Inverse of rank_canonical for any index below size()
+    State unrank(uint64_t index) const;
+
+private:
+    int pawns_;
+    uint64_t white_combinations_;
+    uint64_t black_combinations_;
+};
+
+} // namespace bobail
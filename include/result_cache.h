@@ -0,0 +1,149 @@
+#pragma once
+
+#include "tt.h"
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+namespace bobail {
+
+// Bounded LRU cache for lookups that are expensive and repeat a lot, such
+// as the results of the opening positions a web client keeps asking for.
+// Keys are split over independently locked shards so concurrent readers
+// rarely wait on each other; every shard evicts its own least recently
+// used entry once it holds capacity / shards entries. A capacity of 0
+// disables the cache: find() always misses and insert() does nothing.
+template <typename V>
+class LruCache {
+public:
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+        uint64_t size = 0;
+        uint64_t capacity = 0;
+    };
+
+    static constexpr size_t DEFAULT_SHARDS = 16;
+
+    // num_shards is rounded up to a power of two
+    explicit LruCache(size_t capacity = 0, size_t num_shards = DEFAULT_SHARDS) {
+        reset(capacity, num_shards);
+    }
+
+    LruCache(const LruCache&) = delete;
+    LruCache& operator=(const LruCache&) = delete;
+
+    // Drop every entry and the counters, and change the capacity.
+    // Not safe against concurrent use.
+    void reset(size_t capacity, size_t num_shards = DEFAULT_SHARDS) {
+        num_shards = std::bit_ceil(std::max<size_t>(num_shards, 1));
+        // Small caches use fewer shards so each still holds a few entries
+        while (num_shards > 1 && capacity / num_shards < 8) num_shards /= 2;
+        shards_ = std::make_unique<Shard[]>(num_shards);
+        mask_ = num_shards - 1;
+        capacity_ = capacity;
+        for (size_t i = 0; i < num_shards; ++i) {
+            shards_[i].capacity = capacity / num_shards + (i < capacity % num_shards ? 1 : 0);
+        }
+        hits_ = 0;
+        misses_ = 0;
+        evictions_ = 0;
+    }
+
+    bool enabled() const { return capacity_ > 0; }
+    size_t capacity() const { return capacity_; }
+
+    bool find(uint64_t key, V& value) {
+        if (!enabled()) return false;
+        Shard& shard = shard_for(key);
+        {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            auto it = shard.index.find(key);
+            if (it != shard.index.end()) {
+                shard.order.splice(shard.order.begin(), shard.order, it->second);
+                value = it->second->second;
+                hits_.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+        misses_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    // Insert or overwrite
+    void insert(uint64_t key, const V& value) {
+        if (!enabled()) return;
+        Shard& shard = shard_for(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.index.find(key);
+        if (it != shard.index.end()) {
+            it->second->second = value;
+            shard.order.splice(shard.order.begin(), shard.order, it->second);
+            return;
+        }
+        if (shard.index.size() >= shard.capacity) {
+            shard.index.erase(shard.order.back().first);
+            shard.order.pop_back();
+            evictions_.fetch_add(1, std::memory_order_relaxed);
+        }
+        shard.order.emplace_front(key, value);
+        shard.index.emplace(key, shard.order.begin());
+    }
+
+    Stats stats() const {
+        Stats s;
+        s.hits = hits_.load(std::memory_order_relaxed);
+        s.misses = misses_.load(std::memory_order_relaxed);
+        s.evictions = evictions_.load(std::memory_order_relaxed);
+        s.capacity = capacity_;
+        for (size_t i = 0; i <= mask_; ++i) {
+            std::lock_guard<std::mutex> lock(shards_[i].mutex);
+            s.size += shards_[i].index.size();
+        }
+        return s;
+    }
+
+private:
+    using Entries = std::list<std::pair<uint64_t, V>>;
+
+    struct Shard {
+        mutable std::mutex mutex;
+        Entries order;  // Most recently used first
+        std::unordered_map<uint64_t, typename Entries::iterator> index;
+        size_t capacity = 0;
+    };
+
+    // Packed states differ mostly in their low bits; mix before picking
+    // a shard so neighbouring positions spread out
+    Shard& shard_for(uint64_t key) {
+        key ^= key >> 33;
+        key *= 0xFF51AFD7ED558CCDULL;
+        key ^= key >> 33;
+        return shards_[key & mask_];
+    }
+
+    std::unique_ptr<Shard[]> shards_;
+    size_t mask_ = 0;
+    size_t capacity_ = 0;
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> misses_{0};
+    std::atomic<uint64_t> evictions_{0};
+};
+
+// Solved result of a position, keyed by its canonical packed state
+struct CachedResult {
+    Result result = Result::UNKNOWN;
+    uint8_t dtw = 0;
+};
+
+using ResultCache = LruCache<CachedResult>;
+
+} // namespace bobail
@@ -0,0 +1,175 @@
+#pragma once
+
+#include "board.h"
+#include "movegen.h"
+#include "rank.h"
+#include "retrograde.h"
+#include "tt.h"
+#include <atomic>
+#include <functional>
+#include <string>
+
+namespace bobail {
+
+// 2-bit result codes stored in the bitmap
+constexpr uint8_t BITMAP_UNKNOWN = 0;
+constexpr uint8_t BITMAP_WIN = 1;
+constexpr uint8_t BITMAP_LOSS = 2;
+constexpr uint8_t BITMAP_DRAW = 3;
+
+uint8_t encode_bitmap_result(Result r);
+Result decode_bitmap_result(uint8_t code);
+
+// On-disk header of a result bitmap file (one page, followed by the cells)
+struct BitmapHeader {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t rules_variant;   // RulesVariant the results were computed for
+    uint64_t num_cells;
+    uint32_t phase;           // SolvePhase
+    uint32_t sweep;           // Completed propagation sweeps
+    uint64_t num_wins;
+    uint64_t num_losses;
+    uint64_t num_draws;
+};
+
+// 2-bit-per-cell array backed by a memory-mapped file.
+// A freshly created file is sparse and reads as all UNKNOWN.
+// Cells only ever move from UNKNOWN to a final value; writers update
+// their word with a compare-and-swap, so concurrent readers and writers
+// of neighbouring cells never see torn values.
+class ResultBitmap {
+public:
+    static constexpr uint64_t MAGIC = 0x31504D4252424F42ULL;  // "BOBRBMP1"
+    static constexpr uint32_t VERSION = 1;
+    static constexpr size_t HEADER_BYTES = 4096;
+
+    ResultBitmap() = default;
+    ~ResultBitmap();
+
+    ResultBitmap(const ResultBitmap&) = delete;
+    ResultBitmap& operator=(const ResultBitmap&) = delete;
+
+    // Open or create the file at `path` holding `num_cells` cells
+    bool open(const std::string& path, uint64_t num_cells);
+    void close();
+
+    // Flush dirty pages to disk
+    bool sync();
+
+    bool is_open() const { return words_ != nullptr; }
+    uint64_t size() const { return num_cells_; }
+
+    // Raw cells, 32 per word
+    const uint64_t* words() const { return words_; }
+    uint64_t* words() { return words_; }
+
+    BitmapHeader& header() { return *header_; }
+    const BitmapHeader& header() const { return *header_; }
+
+    uint8_t get(uint64_t i) const {
+        uint64_t w = std::atomic_ref<uint64_t>(words_[i >> 5]).load(std::memory_order_relaxed);
+        return static_cast<uint8_t>((w >> ((i & 31) * 2)) & 3);
+    }
+
+    // Set an UNKNOWN cell; returns false (leaving it alone) if it
+    // already held a value
+    bool set(uint64_t i, uint8_t code) {
+        int shift = static_cast<int>(i & 31) * 2;
+        std::atomic_ref<uint64_t> word(words_[i >> 5]);
+        uint64_t w = word.load(std::memory_order_relaxed);
+        do {
+            if ((w >> shift) & 3) return false;
+        } while (!word.compare_exchange_weak(w, w | (static_cast<uint64_t>(code) << shift),
+                                             std::memory_order_relaxed));
+        return true;
+    }
+
+private:
+    int fd_ = -1;
+    void* mapping_ = nullptr;
+    size_t mapping_bytes_ = 0;
+    BitmapHeader* header_ = nullptr;
+    uint64_t* words_ = nullptr;
+    uint64_t num_cells_ = 0;
+};
+
+// In-memory retrograde solver over the combinatorial rank space.
+// Every canonical position has a fixed index (see rank.h), so results
+// live in a 2-bit array (~3.7GB) instead of RocksDB. Terminal marking and
+// propagation are parallel sweeps over that array: each sweep re-examines
+// the still-unknown positions against their successors' current results,
+// until a sweep changes nothing. Whatever remains unknown is a draw.
+class RetrogradeSolverBitmap {
+public:
+    using ProgressCallback = std::function<void(const char* phase, uint64_t current, uint64_t total)>;
+
+    // Solves `space`; the default is the full game
+    explicit RetrogradeSolverBitmap(const RankSpace& space = RankSpace()) : space_(space) {}
+    ~RetrogradeSolverBitmap();
+
+    // Open (or create) the result file inside directory `path`
+    bool open(const std::string& path);
+    void close();
+
+    // Run the full solve process (resumes from the saved phase)
+    bool solve();
+
+    // Get result for a specific state (after solving)
+    Result get_result(const State& s) const;
+
+    // Get optimal move from a position (after solving)
+    Move get_best_move(const State& s) const;
+
+    // Statistics
+    uint64_t num_states() const { return space_.size(); }
+    uint64_t num_wins() const { return num_wins_; }
+    uint64_t num_losses() const { return num_losses_; }
+    uint64_t num_draws() const { return num_draws_; }
+
+    // Set progress callback
+    void set_progress_callback(ProgressCallback cb) { progress_cb_ = cb; }
+
+    // Get the result for the starting position
+    Result starting_result() const;
+
+    // Get current phase
+    SolvePhase current_phase() const { return phase_; }
+
+    // Set number of threads for the sweeps
+    void set_num_threads(int num_threads) { num_threads_ = num_threads; }
+
+private:
+    // Run fn(first, last) over every chunk of the rank space in parallel;
+    // returns the sum of the values fn returned
+    uint64_t parallel_sweep(const char* phase, const std::function<uint64_t(uint64_t, uint64_t)>& fn);
+
+    // Phase 3: terminal positions and positions without moves
+    void mark_terminals();
+
+    // Phase 4: sweep until no unknown position can be resolved
+    void propagate();
+
+    // Remaining unknown canonical positions are draws
+    void mark_draws();
+
+    // Try to resolve one unknown canonical position from its successors
+    bool resolve(uint64_t index, const State& s);
+
+    void save_header();
+
+    RankSpace space_;
+    ResultBitmap results_;
+
+    uint64_t num_wins_ = 0;
+    uint64_t num_losses_ = 0;
+    uint64_t num_draws_ = 0;
+
+    SolvePhase phase_ = SolvePhase::NOT_STARTED;
+    uint32_t sweep_ = 0;
+
+    int num_threads_ = 1;
+    ProgressCallback progress_cb_;
+};
+
+} // namespace bobail
@@ -1,7 +1,10 @@
 #pragma once
 
 #include "board.h"
+#include "bloom_filter.h"
 #include "movegen.h"
+#include "result_cache.h"
+#include "solver_metrics.h"
 #include "tt.h"
 #include <functional>
 #include <string>
@@ -11,59 +14,16 @@
 #include <thread>
 #include <vector>
 #include <queue>
+#include <span>
 #include <condition_variable>
+#include <cstring>
 #include <unordered_map>
 #include <rocksdb/db.h>
 #include <rocksdb/options.h>
+#include <rocksdb/statistics.h>
 
 namespace bobail {
 
-// Simple bloom filter for fast duplicate rejection
-// Uses 2GB of memory for ~5 billion entries with ~1% false positive rate
-class BloomFilter {
-public:
-    BloomFilter(size_t size_bytes = 2ULL * 1024 * 1024 * 1024)
-        : bits_(size_bytes * 8, false), num_bits_(size_bytes * 8) {}
-
-    void add(uint64_t value) {
-        for (int i = 0; i < NUM_HASHES; ++i) {
-            size_t idx = hash(value, i) % num_bits_;
-            bits_[idx] = true;
-        }
-    }
-
-    bool maybe_contains(uint64_t value) const {
-        for (int i = 0; i < NUM_HASHES; ++i) {
-            size_t idx = hash(value, i) % num_bits_;
-            if (!bits_[idx]) return false;
-        }
-        return true;
-    }
-
-    void clear() {
-        std::fill(bits_.begin(), bits_.end(), false);
-    }
-
-    size_t memory_bytes() const { return bits_.size() / 8; }
-
-private:
-    static constexpr int NUM_HASHES = 7;
-
-    size_t hash(uint64_t value, int seed) const {
-        // MurmurHash3-style mixing
-        uint64_t h = value ^ (seed * 0x9e3779b97f4a7c15ULL);
-        h ^= h >> 33;
-        h *= 0xff51afd7ed558ccdULL;
-        h ^= h >> 33;
-        h *= 0xc4ceb9fe1a85ec53ULL;
-        h ^= h >> 33;
-        return static_cast<size_t>(h);
-    }
-
-    std::vector<bool> bits_;
-    size_t num_bits_;
-};
-
 // Phases of retrograde solving
 enum class SolvePhaseDB {
     NOT_STARTED = 0,
@@ -74,14 +34,59 @@ enum class SolvePhaseDB {
     COMPLETE = 5
 };
 
+// How phase 2 writes the predecessor lists
+enum class PredecessorBuilder {
+    STREAMING,  // Workers merge per-successor chunks straight into RocksDB
+    SORTED      // External sort of (successor, predecessor) runs, ingested as SST files
+};
+
 // Compact state info stored on disk (fixed size, no variable-length predecessors)
 struct StateInfoCompact {
     uint64_t packed;            // Canonical packed state
     uint8_t result;             // WIN/LOSS/DRAW/UNKNOWN
+    uint8_t dtw = 0;            // Plies to the end of the game for WIN/LOSS (saturates at DTW_MAX)
     uint16_t num_successors;    // Number of legal moves
     uint16_t winning_succs;     // Count of successors that are losses (for opponent)
 };
 
+// dtw occupies what used to be a padding byte, so the record size is unchanged
+static_assert(sizeof(StateInfoCompact) == 16);
+
+constexpr uint8_t DTW_MAX = 255;
+
+// Records in the states column family ("states_v2"). Keys are the state id
+// big-endian, so iteration and the SST files follow id order. A value is
+// one big-endian word holding the rank of the canonical position (34 bits,
+// see rank.h), the result (2), dtw (8), num_successors (10) and
+// winning_succs (10): 8 bytes instead of the 16-byte struct. Databases
+// from before this layout keep host-endian keys and raw StateInfoCompact
+// values in "states" and have to be converted with migrate_states.
+constexpr const char* STATES_CF = "states_v2";
+constexpr const char* LEGACY_STATES_CF = "states";
+constexpr size_t STATE_KEY_SIZE = 4;
+constexpr size_t STATE_VALUE_SIZE = 8;
+
+// Ids sharing a key prefix (256 consecutive ids) share a bucket of the
+// states CF's hash index
+constexpr size_t STATE_KEY_PREFIX = 3;
+
+inline std::string state_key(uint32_t id) {
+    uint32_t be = __builtin_bswap32(id);
+    return std::string(reinterpret_cast<const char*>(&be), sizeof(be));
+}
+
+inline uint32_t state_key_id(const rocksdb::Slice& key) {
+    uint32_t be;
+    std::memcpy(&be, key.data(), sizeof(be));
+    return __builtin_bswap32(be);
+}
+
+// `info.packed` must be canonical
+std::string encode_state_info(const StateInfoCompact& info);
+
+// False (and `info` untouched) if `value` is not a state record
+bool decode_state_info(const rocksdb::Slice& value, StateInfoCompact& info);
+
 // Disk-based retrograde solver using RocksDB
 class RetrogradeSolverDB {
 public:
@@ -92,17 +97,46 @@ public:
 
     // Initialize the database
     bool open(const std::string& db_path);
+
+    // Open an existing database for queries only: no writes, no
+    // compaction, point-lookup tuned reads with a `block_cache_mb` block
+    // cache. Any number of processes can open the same directory this way.
+    bool open_readonly(const std::string& db_path, uint64_t block_cache_mb = 1024);
+    bool is_read_only() const { return read_only_; }
     void close();
 
+    // Keep up to `entries` results and as many best moves in memory in
+    // front of the lookups below. Only used on read-only databases, where
+    // results cannot change. Off (0) by default.
+    void set_result_cache_capacity(size_t entries);
+    ResultCache::Stats result_cache_stats() const { return result_cache_.stats(); }
+    LruCache<Move>::Stats best_move_cache_stats() const { return best_move_cache_.stats(); }
+
     // Run the full solve process
     bool solve();
 
     // Get result for a specific state (after solving)
     Result get_result(const State& s) const;
 
-    // Get optimal move from a position (after solving)
+    // Same, also returning the distance to the end of the game in plies
+    // (0 for draws, unknown states and databases without DTW)
+    Result get_result(const State& s, uint8_t& dtw) const;
+
+    // Results of many states at once, in order: one MultiGet for the ids
+    // and one for the state records. Fills `dtw` the same way if given.
+    std::vector<Result> get_results(std::span<const State> states,
+                                    std::vector<uint8_t>* dtw = nullptr) const;
+
+    // Get optimal move from a position (after solving): with DTW the
+    // fastest win or the slowest loss
     Move get_best_move(const State& s) const;
 
+    // Call fn(packed, result, dtw) for every stored state
+    void for_each_state(const std::function<void(uint64_t packed, Result r, uint8_t dtw)>& fn) const;
+
+    // True if propagation stored exact DTW values
+    bool has_dtw() const { return has_dtw_; }
+
     // Statistics
     uint64_t num_states() const { return num_states_; }
     uint64_t num_wins() const { return num_wins_; }
@@ -110,7 +144,16 @@ public:
     uint64_t num_draws() const { return num_draws_; }
 
     // Set progress callback
-    void set_progress_callback(ProgressCallback cb) { progress_cb_ = cb; }
+    void set_progress_callback(ProgressCallback cb) { user_progress_cb_ = cb; }
+
+    // Collect RocksDB statistics (block cache hits, write stalls) for
+    // metrics_snapshot(). Costs a few percent; call before open().
+    void set_collect_statistics(bool enable) { collect_statistics_ = enable; }
+
+    // Throughput per thread, queue depth, Bloom filter accuracy and time
+    // per phase, plus RocksDB gauges read at the time of the call. Safe
+    // to call from another thread while solve() runs.
+    SolverMetrics::Snapshot metrics_snapshot();
 
     // Get the result for the starting position
     Result starting_result() const;
@@ -124,29 +167,50 @@ public:
     // Set number of threads for parallel processing
     void set_num_threads(int num_threads) { num_threads_ = num_threads; }
 
+    // Select the phase 2 predecessor builder (default: streaming)
+    void set_predecessor_builder(PredecessorBuilder builder) { pred_builder_ = builder; }
+
+    // Derive predecessors on the fly from retro moves during propagation
+    // instead of storing them, which skips phase 2 (building predecessors).
+    // A database that skipped phase 2 keeps using retro moves when resumed.
+    void set_use_unmoves(bool use_unmoves) { use_unmoves_ = use_unmoves; }
+
     // Import from old checkpoint format
     bool import_checkpoint(const std::string& checkpoint_file);
 
+    // Convert a closed database from the old states layout (see
+    // STATES_CF) in place. Safe to rerun after an interruption; the old
+    // records are dropped only once the new ones are flushed.
+    static bool migrate_states(const std::string& db_path, const ProgressCallback& progress = nullptr);
+
 private:
     // Phase 1: Enumerate all reachable states via BFS (parallel version)
     void enumerate_states();
     void enumerate_states_parallel();
     void enumeration_worker(int thread_id);
+    void enumerate_states_levels();  // Level-synchronous BFS (new databases)
 
     // Phase 2: Build predecessor graph (stored in separate column family)
     void build_predecessors();
     void build_predecessors_parallel();
     void build_predecessors_streaming();  // New optimized version
+    bool build_predecessors_sorted();     // External sort + SST ingestion
 
     // Helper: Load packed_to_id mapping into memory for fast lookups
     void load_packed_to_id_cache();
 
+    // Predecessor ids of state `id` (canonical position `packed`), from the
+    // stored lists or from retro moves when use_unmoves_ is set
+    void collect_predecessors(uint32_t id, uint64_t packed, std::vector<uint32_t>& preds) const;
+
     // Phase 3: Mark terminal states
     void mark_terminals();
     void mark_terminals_parallel();
 
     // Phase 4: Retrograde propagation
     void propagate();
+    void propagate_in_memory();  // Ply layers over in-memory counters, computes DTW
+    void propagate_queue();      // Disk queue; resumes pre-existing checkpoints
 
     // Helper: Get or create state ID for a canonical packed state
     uint32_t get_or_create_state(uint64_t packed);
@@ -166,13 +230,27 @@ private:
     // Helper: Get predecessors for a state
     std::vector<uint32_t> get_predecessors(uint32_t state_id) const;
 
+    // Predecessor lists of n states with one MultiGet; out[i] belongs to ids[i]
+    void get_predecessors_batch(const uint32_t* ids, size_t n,
+                                std::vector<std::vector<uint32_t>>& out) const;
+
+    // get_best_move() without the cache
+    Move find_best_move(const State& s) const;
+
+    // Open the column families with the given options (honours read_only_)
+    bool open_column_families(const rocksdb::Options& options,
+                              const rocksdb::ColumnFamilyOptions& cf_opts,
+                              const rocksdb::ColumnFamilyOptions& states_cf_opts,
+                              const rocksdb::ColumnFamilyOptions& pred_cf_opts,
+                              const std::string& db_path);
+
     // Save/load metadata
     void save_metadata();
     void load_metadata();
 
     // RocksDB instance
     std::unique_ptr<rocksdb::DB> db_;
-    rocksdb::ColumnFamilyHandle* cf_states_ = nullptr;      // state_id -> StateInfoCompact
+    rocksdb::ColumnFamilyHandle* cf_states_ = nullptr;      // state_key -> encode_state_info
     rocksdb::ColumnFamilyHandle* cf_packed_to_id_ = nullptr; // packed -> state_id
     rocksdb::ColumnFamilyHandle* cf_predecessors_ = nullptr; // state_id -> list of pred_ids
     rocksdb::ColumnFamilyHandle* cf_queue_ = nullptr;        // BFS queue on disk
@@ -198,7 +276,18 @@ private:
     uint64_t queue_head_ = 0;
     uint64_t queue_tail_ = 0;
 
+    // Level-synchronous enumeration: ids are assigned level by level, so
+    // the current frontier is the id range [queue_head_, queue_tail_) and
+    // cf_queue_ is unused. Older in-progress databases keep the queue path.
+    bool enum_levels_ = false;
+
+    // Records progress in metrics_, then calls user_progress_cb_
     ProgressCallback progress_cb_;
+    ProgressCallback user_progress_cb_;
+
+    SolverMetrics metrics_;
+    bool collect_statistics_ = false;
+    std::shared_ptr<rocksdb::Statistics> statistics_;
 
     // Write options (fast vs durable)
     rocksdb::WriteOptions fast_write_options_;
@@ -207,6 +296,26 @@ private:
     // Parallelization settings
     int num_threads_ = 1;
 
+    // Propagate through retro moves instead of stored predecessor lists
+    bool use_unmoves_ = false;
+
+    // Set when the states CF holds exact DTW values (metadata "has_dtw")
+    bool has_dtw_ = false;
+
+    PredecessorBuilder pred_builder_ = PredecessorBuilder::STREAMING;
+
+    // Opened with open_readonly(): nothing may be written
+    bool read_only_ = false;
+
+    // Lookup caches (read-only databases only). Results are keyed by the
+    // canonical packed state, best moves by the exact packed state since
+    // a mirrored position has mirrored moves.
+    mutable ResultCache result_cache_;
+    mutable LruCache<Move> best_move_cache_;
+
+    // Database directory (external sort runs are spilled below it)
+    std::string db_path_;
+
     // Thread synchronization for parallel enumeration
     std::mutex db_mutex_;                    // Protects database writes
     std::mutex queue_mutex_;                 // Protects in-memory queue
@@ -238,8 +347,10 @@ private:
     std::unique_ptr<BloomFilter> bloom_filter_;
     bool bloom_loaded_ = false;
 
-    // Load bloom filter from existing states
+    // Load bloom filter from <db>/bloom.bin, topping it up with states
+    // created after it was saved, or rebuild it from every key
     void load_bloom_filter();
+    std::string bloom_path() const { return db_path_ + "/bloom.bin"; }
 
     // Batch lookup helper using MultiGet
     std::vector<int64_t> batch_get_state_ids(const std::vector<uint64_t>& packed_states) const;
@@ -0,0 +1,287 @@
+#pragma once
+
+#include "board.h"
+#include "movegen.h"
+#include "rank.h"
+#include "retrograde.h"
+#include "retrograde_bitmap.h"
+#include "tt.h"
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace bobail {
+
+// Partitioned (out-of-core) retrograde solving over the rank space.
+//
+// The Bobail steps one square per move and the mirror image keeps its row,
+// so the positions with the Bobail in one row form a slice whose
+// successors all lie in that row or the rows next to it. Ranks start with
+// the Bobail square (see rank.h), so every slice is one contiguous range
+// of SLICE_CELLS indices.
+//
+// Only one slice is held in memory at a time. A visit loads the slice's
+// results, applies the updates its neighbours sent it, sweeps the slice to
+// a local fixpoint, and sends what it resolved back to the neighbours as
+// sorted update runs on disk. Visits go round the slices until a whole
+// round resolves nothing; whatever is still unknown is a draw.
+
+constexpr int NUM_SLICES = BOARD_SIZE;
+
+// Positions per slice: 3 canonical Bobail squares, both sides to move
+constexpr uint64_t SLICE_CELLS = RANK_BOBAIL_COLUMNS * RANK_SLICE_SIZE;
+
+static_assert(NUM_SLICES * SLICE_CELLS == RANK_SPACE_SIZE);
+static_assert(SLICE_CELLS % 64 == 0, "slices must start on a word of the result bitmap");
+
+inline int slice_of_rank(uint64_t rank) { return static_cast<int>(rank / SLICE_CELLS); }
+
+// The same for any rank space; smaller spaces need not be word aligned
+inline uint64_t slice_cells(const RankSpace& space) { return RANK_BOBAIL_COLUMNS * space.slice_size(); }
+
+// An update tells a slice about one of its positions: bits 0-39 hold the
+// position's rank, bits 40-62 how many of its moves reach a position in
+// another slice that was won (for the opponent), and bit 63 is set once a
+// move reaches one that was lost.
+constexpr uint64_t UPDATE_RANK_MASK = (1ULL << 40) - 1;
+constexpr int UPDATE_COUNT_SHIFT = 40;
+constexpr uint64_t UPDATE_COUNT_MASK = ((1ULL << 23) - 1) << UPDATE_COUNT_SHIFT;
+constexpr uint64_t UPDATE_LOST_SUCCESSOR = 1ULL << 63;
+
+inline uint64_t update_rank(uint64_t u) { return u & UPDATE_RANK_MASK; }
+
+inline uint32_t update_won_successors(uint64_t u) {
+    return static_cast<uint32_t>((u & UPDATE_COUNT_MASK) >> UPDATE_COUNT_SHIFT);
+}
+
+// Merge two updates for the same position
+inline uint64_t combine_updates(uint64_t a, uint64_t b) {
+    return ((a | b) & (UPDATE_LOST_SUCCESSOR | UPDATE_RANK_MASK)) +
+           (a & UPDATE_COUNT_MASK) + (b & UPDATE_COUNT_MASK);
+}
+
+// Moves of the canonical position `s` whose canonical successor lies
+// outside its slice. The position is lost once that many won-successor
+// updates have arrived and its moves within the slice are all won too.
+size_t count_external_moves(const State& s);
+
+// Clears `out` and fills it with the ranks of the canonical parents of the
+// canonical position `canonical` that lie in other slices, once per move
+// (see generate_canonical_unmoves), so the updates sent to them add up to
+// count_external_moves. Ranks are in `space`, the full game by default.
+void external_parent_ranks(uint64_t canonical, std::vector<uint64_t>& out,
+                           const RankSpace& space = RankSpace());
+
+// Visits are numbered round * NUM_SLICES + slice + 1, and the update runs
+// a visit writes are named "<dest>_<visit>.run" after it
+inline uint64_t slice_visit(uint32_t round, int slice) {
+    return static_cast<uint64_t>(round) * NUM_SLICES + slice + 1;
+}
+
+inline int visit_slice(uint64_t visit) { return static_cast<int>((visit - 1) % NUM_SLICES); }
+
+std::string update_run_name(int dest, uint64_t visit);
+
+// Parse an update run's file name; false if it is not one
+bool parse_update_run_name(const std::string& name, int& dest, uint64_t& visit);
+
+// Solver progress, kept in one small file next to the slices
+struct SliceSolveHeader {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t rules_variant;
+    uint32_t phase;                // SolvePhase
+    uint32_t round;                // Completed rounds over all slices
+    uint32_t next_slice;           // Next slice to visit in this round
+    uint32_t converged;            // The solve resolved nothing in a round; drawing and assembling
+    uint32_t barrier_pending;      // A round ended; waiting to learn whether the solve converged
+    uint32_t pawns;                // Pawns per side of the rank space
+    uint32_t node;                 // This machine's index in the cluster (0 alone)
+    uint32_t num_nodes;            // Machines sharing the slices (1 alone)
+    uint64_t visits;               // Last committed visit
+    uint64_t round_resolved;       // Positions resolved so far in this round
+    uint64_t last_round_resolved;  // Positions resolved in the previous round
+    uint64_t slice_version[NUM_SLICES];  // Visit that wrote each slice's results
+    // [slice][source]: runs from the source slice's visits up to this one are applied
+    uint64_t consumed[NUM_SLICES][NUM_SLICES];
+    uint64_t num_wins;
+    uint64_t num_losses;
+    uint64_t num_draws;
+};
+
+// What the solver needs from its peers when the slices are spread over
+// several machines (see slice_cluster.h). Each machine visits only the
+// slices it owns; the update runs it writes for the other slices are its
+// peers' business.
+class SliceExchange {
+public:
+    virtual ~SliceExchange() = default;
+
+    // This machine's index among num_nodes(); the solver directory
+    // records both, as they decide which slices it holds
+    virtual int node() const = 0;
+    virtual int num_nodes() const = 0;
+
+    // Slices visited here, one bit each
+    virtual uint32_t owned_slices() const = 0;
+
+    // True on the one machine that assembles results.bitmap
+    virtual bool assembles() const = 0;
+
+    // End of `round`, in which this machine resolved `resolved` positions:
+    // deliver the runs for slices owned elsewhere, wait for the runs the
+    // others wrote for ours, and learn whether no machine resolved anything
+    virtual bool end_round(uint32_t round, uint64_t resolved, bool& converged) = 0;
+
+    // Hand a finished slice (with its win, loss and draw counts) to the
+    // assembling machine, or receive one there
+    virtual bool publish_slice(int slice, const std::vector<uint64_t>& cells, const uint64_t counts[3]) = 0;
+    virtual bool fetch_slice(int slice, std::vector<uint64_t>& cells, uint64_t counts[3]) = 0;
+
+    // The solve is complete here
+    virtual void finished() {}
+};
+
+// Retrograde solver over Bobail-row slices of the rank space. Peak memory
+// is one slice (2 result bits and 1 flag bit per position, ~1.1GB) plus
+// the update buffers, instead of the 3.7GB the bitmap solver maps. The
+// finished results are assembled into the same results.bitmap file
+// RetrogradeSolverBitmap writes, so the tools that read that file (and
+// export_tablebase --bitmap) work on either.
+class RetrogradeSolverSlices {
+public:
+    using ProgressCallback = std::function<void(const char* phase, uint64_t current, uint64_t total)>;
+
+    static constexpr uint64_t MAGIC = 0x314543494C53424FULL;  // "OBSLICE1"
+    static constexpr uint32_t VERSION = 3;
+
+    // Solves `space`; the default is the full game
+    explicit RetrogradeSolverSlices(const RankSpace& space = RankSpace())
+        : space_(space), slice_cells_(slice_cells(space)), slice_words_((slice_cells_ + 31) / 32) {}
+    ~RetrogradeSolverSlices();
+
+    // Open (or create) the solver directory `path`; resumes a saved solve
+    bool open(const std::string& path);
+    void close();
+
+    // Run (or resume) the solve
+    bool solve();
+
+    // Get result for a specific state (after solving)
+    Result get_result(const State& s) const;
+
+    // Get optimal move from a position (after solving)
+    Move get_best_move(const State& s) const;
+
+    // Statistics
+    uint64_t num_states() const { return space_.size(); }
+    uint64_t num_wins() const { return header_.num_wins; }
+    uint64_t num_losses() const { return header_.num_losses; }
+    uint64_t num_draws() const { return header_.num_draws; }
+
+    // Set progress callback
+    void set_progress_callback(ProgressCallback cb) { progress_cb_ = cb; }
+
+    // Get the result for the starting position
+    Result starting_result() const;
+
+    // Get current phase
+    SolvePhase current_phase() const { return static_cast<SolvePhase>(header_.phase); }
+
+    // Set number of threads for the sweeps
+    void set_num_threads(int num_threads) { num_threads_ = num_threads; }
+
+    // Updates a thread buffers per neighbouring slice before spilling them
+    // to a sorted run (default 1M, 8MB)
+    void set_spill_updates(size_t n) { spill_updates_ = n; }
+
+    // Solve together with other machines; call before open(), and keep it
+    // alive until the solve returns
+    void set_exchange(SliceExchange* exchange) { exchange_ = exchange; }
+
+    // Directory holding the update runs
+    std::string update_dir() const;
+
+private:
+    // Run fn(worker, first, last) over chunks of [0, slice_cells_) in
+    // parallel; returns the sum of the values fn returned
+    uint64_t parallel_sweep(const char* phase,
+                            const std::function<uint64_t(int, uint64_t, uint64_t)>& fn);
+
+    // One visit of `slice`: apply its updates, sweep it to a fixpoint and
+    // send the results on. Returns false on an I/O error.
+    bool visit(int slice);
+
+    // Apply the update runs sent to the loaded slice; won-successor counts
+    // for positions still open are carried to `pending_path`
+    bool apply_updates(const std::string& pending_path);
+
+    // Try to resolve one unknown canonical position of the loaded slice
+    bool resolve(int worker, uint64_t cell, const State& s, bool terminals);
+
+    // Record a newly resolved position and queue updates for its parents
+    void resolved(int worker, const State& s, uint8_t code);
+
+    // Write a thread's buffered updates for `dest` as a sorted spill run
+    bool spill(int worker, int dest);
+
+    // Merge the spills of this visit into one run per neighbouring slice
+    bool merge_spills();
+
+    // After the last visit of a round: decide (or learn from the peers)
+    // whether the solve has converged
+    bool end_round();
+
+    // Draw what is left and write results.bitmap
+    bool assemble();
+
+    bool load_slice(int slice);
+    bool save_slice();
+    bool save_header();
+
+    std::string slice_path(int slice, uint64_t version) const;
+    std::string run_path(int dest, uint64_t visit) const;
+
+    // Runs for `dest` not applied yet, in visit order
+    std::vector<std::pair<uint64_t, std::string>> runs_for(int dest);
+    void remove_stale_files();
+
+    bool owns(int slice) const { return !exchange_ || ((exchange_->owned_slices() >> slice) & 1); }
+
+    int slice_of(uint64_t rank) const { return static_cast<int>(rank / slice_cells_); }
+
+    RankSpace space_;
+    uint64_t slice_cells_;
+    uint64_t slice_words_;             // 64-bit words of a slice's results
+
+    std::string path_;
+    bool open_ = false;
+    SliceSolveHeader header_{};
+    ResultBitmap results_;             // Assembled results once complete
+
+    // The slice being visited
+    int slice_ = -1;
+    uint64_t visit_ = 0;
+    std::vector<uint64_t> cells_;      // 2-bit results, as in ResultBitmap
+    std::vector<uint64_t> complete_;   // 1 bit: every external move reaches a won position
+    std::atomic<uint64_t> resolved_{0};
+
+    // Update buffers per worker and destination slice, and their spills
+    std::vector<std::array<std::vector<uint64_t>, NUM_SLICES>> outbox_;
+    std::vector<std::string> spills_[NUM_SLICES];
+    std::mutex spill_mutex_;
+    std::atomic<uint64_t> spill_seq_{0};
+    std::atomic<bool> io_failed_{false};
+
+    int num_threads_ = 1;
+    size_t spill_updates_ = 1 << 20;
+    ProgressCallback progress_cb_;
+    SliceExchange* exchange_ = nullptr;
+};
+
+} // namespace bobail
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "movegen.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace bobail {
+
+// Transposition table for the play engine's alpha-beta search.
+//
+// Each bucket holds two entries: one kept for the deepest search of its
+// position in the current game move, and one that is always replaced.
+// A deep result survives the flood of shallow ones below it, and the
+// shallow ones still find a home. Keys are position_hash() values, not
+// canonical ones, so a stored best move is playable as is.
+//
+// The search threads of the engine share one table without locks. A
+// slot is two words, the data and the key XORed with the data, so an
+// entry torn by two threads writing at once fails the key check and
+// reads as a miss.
+
+enum class Bound : uint8_t {
+    NONE = 0,
+    UPPER = 1,  // Score is at most this (failed low)
+    LOWER = 2,  // Score is at least this (failed high)
+    EXACT = 3
+};
+
+struct SearchTTEntry {
+    static constexpr uint16_t NO_MOVE = 0xFFFF;
+
+    uint64_t key = 0;
+    int32_t score = 0;
+    int8_t depth = 0;
+    uint8_t bound_age = 0;  // Bound in the low 2 bits, search generation above
+    uint16_t move = NO_MOVE;
+
+    Bound bound() const { return static_cast<Bound>(bound_age & 3); }
+    uint8_t age() const { return bound_age >> 2; }
+    bool has_move() const { return move != NO_MOVE; }
+    Move best_move() const { return unpack_move(move); }
+
+    // 5 bits per square
+    static uint16_t pack_move(const Move& m) {
+        return static_cast<uint16_t>(m.bobail_to | (m.pawn_from << 5) | (m.pawn_to << 10));
+    }
+    static Move unpack_move(uint16_t packed) {
+        return Move{static_cast<uint8_t>(packed & 31), static_cast<uint8_t>((packed >> 5) & 31),
+                    static_cast<uint8_t>((packed >> 10) & 31)};
+    }
+};
+
+class SearchTT {
+public:
+    explicit SearchTT(size_t megabytes = 64) { resize(megabytes); }
+
+    // Reallocate (rounded down to a power of two buckets) and clear
+    void resize(size_t megabytes);
+    void clear();
+
+    // Start a new search: entries of earlier ones become replaceable
+    void new_search() { generation_ = (generation_ + 1) & 63; }
+
+    // Copy the entry for `key` into `out`; false if there is none
+    bool probe(uint64_t key, SearchTTEntry& out) const;
+
+    // Record a search result. `move` may be nullptr, keeping any best move
+    // already stored for the position.
+    void store(uint64_t key, int score, int depth, Bound bound, const Move* move);
+
+    size_t num_buckets() const { return mask_ + 1; }
+    size_t bytes() const { return num_buckets() * 2 * sizeof(Slot); }
+
+    // Permille of depth-preferred slots written in the current search
+    int hashfull() const;
+
+private:
+    // Bucket i is slots 2i (depth-preferred) and 2i + 1 (always replaced)
+    struct Slot {
+        uint64_t check;  // key ^ data
+        uint64_t data;   // score, depth, bound_age and move of SearchTTEntry
+    };
+
+    static uint64_t pack(const SearchTTEntry& e);
+    static SearchTTEntry unpack(uint64_t key, uint64_t data);
+    static bool load(const Slot& slot, SearchTTEntry& out);
+    static void save(Slot& slot, const SearchTTEntry& e);
+
+    std::unique_ptr<Slot[]> slots_;
+    size_t mask_ = 0;
+    uint8_t generation_ = 0;  // Only changed between searches
+};
+
+} // namespace bobail
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "retrograde_slices.h"
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace bobail {
+
+// Slice solving spread over several machines.
+//
+// Node n of N owns the slices with slice % N == n (so up to NUM_SLICES
+// nodes are useful) and visits only those; every node keeps its own solver
+// directory, header and checkpoints. The update runs a node writes for a
+// slice it does not own are delivered to the owner, compressed, when the
+// round ends. Node 0 doubles as the coordinator: each node reports how
+// many positions it resolved in the round and waits until every node has,
+// and the solve has converged once a whole round resolved nothing
+// anywhere. At the end every node draws its slices and sends them to node
+// 0, which assembles results.bitmap.
+//
+// Messages travel over short-lived TCP connections, one request and one
+// reply each, so a node that is restarted simply resumes from its header
+// and retries; runs delivered twice are dropped by the per-source
+// bookkeeping in SliceSolveHeader, and node 0 keeps the verdicts it gave
+// in its directory to answer them again.
+
+// Slices node `node` of `num_nodes` owns, one bit each
+uint32_t cluster_slices(int node, int num_nodes);
+
+// Parse "host:port,host:port,..."; false if an entry is malformed or
+// repeated, or there are more nodes than slices
+bool parse_cluster_peers(const std::string& list, std::vector<std::string>& peers);
+
+// Compressed form of an update run, as it travels between nodes: the rank
+// deltas and the won-successor count (shifted left once, with the
+// lost-successor flag in the low bit) as varints. Runs are sorted by rank,
+// so most updates take 3-4 bytes instead of 8.
+bool compress_update_run(const std::string& run_path, const std::string& out_path);
+bool decompress_update_run(const std::string& in_path, const std::string& run_path);
+
+class SliceCluster : public SliceExchange {
+public:
+    // `peers` lists every node's host:port in node order; `solver_dir` is
+    // this node's slice solver directory
+    SliceCluster(int node, std::vector<std::string> peers, std::string solver_dir);
+    ~SliceCluster() override;
+
+    SliceCluster(const SliceCluster&) = delete;
+    SliceCluster& operator=(const SliceCluster&) = delete;
+
+    // Listen on this node's port; call before solving
+    bool start();
+    void stop();
+
+    // How long to wait before retrying a peer that is not answering
+    // (default 1000 ms)
+    void set_retry_ms(int ms) { retry_ms_ = ms; }
+
+    int node() const override { return node_; }
+    int num_nodes() const override { return static_cast<int>(peers_.size()); }
+    uint32_t owned_slices() const override { return cluster_slices(node_, num_nodes()); }
+    bool assembles() const override { return node_ == 0; }
+    bool end_round(uint32_t round, uint64_t resolved, bool& converged) override;
+    bool publish_slice(int slice, const std::vector<uint64_t>& cells, const uint64_t counts[3]) override;
+    bool fetch_slice(int slice, std::vector<uint64_t>& cells, uint64_t counts[3]) override;
+    void finished() override;
+
+private:
+    enum class Verdict : uint32_t { PENDING = 0, CONTINUE = 1, CONVERGED = 2 };
+
+    void listen_loop();
+    void handle(int fd);
+
+    // Node 0: record `node`'s report for `round` and decide if possible
+    Verdict report(uint32_t round, int node, uint64_t resolved);
+
+    // Node 0 keeps its verdicts on disk: after a restart it may have moved
+    // on (say, to assembling) while the others still ask about a round
+    void load_verdicts();
+    bool save_verdict(uint32_t round, Verdict v);
+
+    // Send one file to `peer`, retrying until it is acknowledged
+    bool send_file(int peer, uint32_t type, uint32_t slice, uint64_t visit, const std::string& path);
+
+    bool deliver_runs();
+    bool import_runs();
+
+    std::string inbox_dir() const { return dir_ + "/inbox"; }
+    std::string outbox_dir() const { return dir_ + "/outbox"; }
+    std::string slice_file(int slice) const;
+    std::string verdicts_file() const;
+
+    int node_;
+    std::vector<std::string> peers_;
+    std::string dir_;
+    int retry_ms_ = 1000;
+
+    int listen_fd_ = -1;
+    std::thread listener_;
+    std::atomic<bool> stop_{false};
+
+    // Coordinator state on node 0: reports per round and node, and the
+    // verdicts reached
+    std::mutex mutex_;
+    std::map<uint32_t, std::map<int, uint64_t>> reports_;
+    std::map<uint32_t, Verdict> verdicts_;
+};
+
+} // namespace bobail
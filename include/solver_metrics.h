@@ -0,0 +1,160 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace bobail {
+
+// Live counters of a long-running solve, for watching where it stalls
+// without attaching a profiler: time per phase, the latest progress,
+// items finished per thread, pending queue depth, Bloom filter accuracy
+// and named gauges the solver fills in (RocksDB statistics, TT size...).
+//
+// Worker threads update their own counter with a relaxed add on its own
+// cache line; snapshot() may run on any thread at the same time.
+class SolverMetrics {
+public:
+    static constexpr int MAX_THREADS = 256;  // Higher thread ids share the last counter
+
+    using Gauges = std::vector<std::pair<std::string, double>>;
+
+    struct Snapshot {
+        double uptime_sec = 0;
+        std::string phase;                  // Empty before the first phase
+        double phase_sec = 0;               // Time in the current phase
+        Gauges phase_times;                 // Seconds per finished phase, in order
+        std::string progress;               // Latest progress label
+        uint64_t progress_current = 0;
+        uint64_t progress_total = 0;
+        std::vector<uint64_t> thread_items; // Items finished by each thread
+        std::vector<double> thread_rates;   // Items per second since the previous snapshot
+        uint64_t queue_head = 0;            // Items [head, tail) are pending
+        uint64_t queue_tail = 0;
+        uint64_t bloom_negatives = 0;       // Keys the filter called new
+        uint64_t bloom_positives = 0;       // Keys it called possibly known
+        uint64_t bloom_false_positives = 0; // Of those, the ones that were new
+        Gauges gauges;
+
+        // False positives over every new key; 0 before any lookup
+        double bloom_fp_rate() const {
+            uint64_t new_keys = bloom_negatives + bloom_false_positives;
+            return new_keys ? static_cast<double>(bloom_false_positives) / new_keys : 0.0;
+        }
+    };
+
+    SolverMetrics();
+
+    SolverMetrics(const SolverMetrics&) = delete;
+    SolverMetrics& operator=(const SolverMetrics&) = delete;
+
+    // Threads reported by snapshot()
+    void set_num_threads(int n) { num_threads_.store(std::clamp(n, 1, MAX_THREADS), std::memory_order_relaxed); }
+
+    // Start timing a phase; this ends the previous one
+    void begin_phase(const std::string& name);
+    void end_phase();
+
+    void set_progress(const char* what, uint64_t current, uint64_t total);
+
+    void add_work(int thread, uint64_t items) {
+        threads_[std::min(thread, MAX_THREADS - 1)].items.fetch_add(items, std::memory_order_relaxed);
+    }
+
+    void set_queue(uint64_t head, uint64_t tail) {
+        queue_head_.store(head, std::memory_order_relaxed);
+        queue_tail_.store(tail, std::memory_order_relaxed);
+    }
+
+    void add_bloom(uint64_t negatives, uint64_t positives, uint64_t false_positives) {
+        bloom_negatives_.fetch_add(negatives, std::memory_order_relaxed);
+        bloom_positives_.fetch_add(positives, std::memory_order_relaxed);
+        bloom_false_positives_.fetch_add(false_positives, std::memory_order_relaxed);
+    }
+
+    // Set or replace a named gauge
+    void set_gauge(const std::string& name, double value);
+
+    // Current values. Rates cover the time since the previous call.
+    Snapshot snapshot();
+
+    // One line of JSON, without the newline
+    static std::string to_json(const Snapshot& s);
+
+    // Prometheus text exposition format; every metric name starts with
+    // `prefix`, e.g. "bobail_retrograde"
+    static std::string to_prometheus(const Snapshot& s, const std::string& prefix);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct alignas(64) ThreadCounter {
+        std::atomic<uint64_t> items{0};
+    };
+
+    std::unique_ptr<ThreadCounter[]> threads_;
+    std::atomic<int> num_threads_{1};
+    std::atomic<uint64_t> queue_head_{0};
+    std::atomic<uint64_t> queue_tail_{0};
+    std::atomic<uint64_t> bloom_negatives_{0};
+    std::atomic<uint64_t> bloom_positives_{0};
+    std::atomic<uint64_t> bloom_false_positives_{0};
+
+    // Everything below is guarded by mutex_
+    std::mutex mutex_;
+    Clock::time_point start_;
+    std::string phase_;
+    Clock::time_point phase_start_;
+    Gauges phase_times_;
+    std::string progress_;
+    uint64_t progress_current_ = 0;
+    uint64_t progress_total_ = 0;
+    Gauges gauges_;
+    Clock::time_point last_snapshot_;
+    std::vector<uint64_t> last_items_;
+};
+
+// Writes a snapshot every `interval_sec` seconds on a background thread,
+// and a last one when stopped: a JSON line appended to `json_path`
+// ("-" for stderr), and/or the Prometheus text written over `prom_path`
+// by rename, as node_exporter's textfile collector expects. An empty
+// path turns that output off.
+class MetricsReporter {
+public:
+    using Source = std::function<SolverMetrics::Snapshot()>;
+
+    MetricsReporter(Source source, std::string json_path, std::string prom_path,
+                    std::string prefix, double interval_sec = 10);
+    ~MetricsReporter() { stop(); }
+
+    MetricsReporter(const MetricsReporter&) = delete;
+    MetricsReporter& operator=(const MetricsReporter&) = delete;
+
+    void stop();
+
+private:
+    void write(const SolverMetrics::Snapshot& s);
+
+    Source source_;
+    std::string json_path_;
+    std::string prom_path_;
+    std::string prefix_;
+    std::chrono::duration<double> interval_;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stopping_ = false;
+    std::thread thread_;
+};
+
+} // namespace bobail
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <memory>
+
+namespace bobail {
+
+// Fixed-capacity single-producer single-consumer ring buffer. One thread
+// pushes and one other thread pops, without locks. push() fails instead
+// of blocking when the ring is full, so the producer decides whether to
+// wait or hand the item to another ring.
+template <typename T>
+class SpscRing {
+public:
+    // capacity is rounded up to a power of two
+    explicit SpscRing(size_t capacity)
+        : capacity_(std::bit_ceil(std::max<size_t>(capacity, 2))),
+          mask_(capacity_ - 1),
+          buffer_(std::make_unique<T[]>(capacity_)) {}
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    // Producer only
+    bool push(T item) {
+        size_t t = tail_.load(std::memory_order_relaxed);
+        if (t - head_cache_ >= capacity_) {
+            head_cache_ = head_.load(std::memory_order_acquire);
+            if (t - head_cache_ >= capacity_) return false;
+        }
+        buffer_[t & mask_] = std::move(item);
+        tail_.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer only
+    bool pop(T& item) {
+        size_t h = head_.load(std::memory_order_relaxed);
+        if (h == tail_cache_) {
+            tail_cache_ = tail_.load(std::memory_order_acquire);
+            if (h == tail_cache_) return false;
+        }
+        item = std::move(buffer_[h & mask_]);
+        head_.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Approximate when the other side is active
+    size_t size() const {
+        size_t t = tail_.load(std::memory_order_relaxed);
+        size_t h = head_.load(std::memory_order_relaxed);
+        return t > h ? t - h : 0;
+    }
+
+    bool empty() const { return size() == 0; }
+    size_t capacity() const { return capacity_; }
+
+private:
+    const size_t capacity_;
+    const size_t mask_;
+    std::unique_ptr<T[]> buffer_;
+
+    // Each side caches the other's index and rereads it only when the
+    // ring looks full (or empty), so the two rarely share a cache line
+    alignas(64) std::atomic<size_t> head_{0};
+    size_t tail_cache_ = 0;  // Consumer's view of tail_
+    alignas(64) std::atomic<size_t> tail_{0};
+    size_t head_cache_ = 0;  // Producer's view of head_
+};
+
+} // namespace bobail
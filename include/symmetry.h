@@ -2,6 +2,7 @@
 
 #include "board.h"
 #include <array>
+#include <cstddef>
 #include <cstdint>
 
 namespace bobail {
@@ -38,9 +39,74 @@ uint32_t transform_bitboard(uint32_t bb, int sym);
 // Returns both the canonical state and which symmetry was applied
 std::pair<State, int> canonicalize(const State& s);
 
-// Get canonical hash (hash of canonical form)
+// Get canonical hash (hash of canonical form) in g_hash_mode
 uint64_t canonical_hash(const State& s);
 
+// ---------------------------------------------------------------------------
+// Fast path on packed states (see pack_state for the bit layout)
+//
+// The pawn fields occupy bits 0-49 as ten consecutive 5-bit rows, so the
+// horizontal flip (symmetry 4) is a per-row bit reversal that can be done
+// with five masks and shifts on the whole word. The Bobail square is
+// mirrored with a 32-entry table. canonical_packed() gives exactly
+// pack_state(canonicalize(unpack_state(p)).first), without building States.
+// ---------------------------------------------------------------------------
+
+namespace detail {
+    // Bit c of every 5-bit row in the 50 pawn bits
+    constexpr uint64_t packed_column_mask(int c) {
+        uint64_t m = 0;
+        for (int row = 0; row < 2 * BOARD_SIZE; ++row) {
+            m |= 1ULL << (row * BOARD_SIZE + c);
+        }
+        return m;
+    }
+
+    // Mirror of a square index within its row: b + 4 - 2 * (b % 5).
+    // (b * 13) >> 6 == b / 5 for every 5-bit b; the batch kernel uses
+    // the same arithmetic so both paths agree on all inputs.
+    constexpr std::array<uint8_t, 32> make_mirror_square_table() {
+        std::array<uint8_t, 32> t{};
+        for (uint32_t b = 0; b < 32; ++b) {
+            uint32_t c = b - 5 * ((b * 13) >> 6);
+            t[b] = static_cast<uint8_t>((b + 4 - 2 * c) & 0x1F);
+        }
+        return t;
+    }
+
+    inline constexpr uint64_t PACKED_COL0 = packed_column_mask(0);
+    inline constexpr uint64_t PACKED_COL1 = packed_column_mask(1);
+    inline constexpr uint64_t PACKED_COL2 = packed_column_mask(2);
+    inline constexpr uint64_t PACKED_COL3 = packed_column_mask(3);
+    inline constexpr uint64_t PACKED_COL4 = packed_column_mask(4);
+    inline constexpr uint64_t PACKED_SIDE_BIT = 1ULL << 55;
+    inline constexpr std::array<uint8_t, 32> MIRROR_SQUARE = make_mirror_square_table();
+}
+
+// Apply the horizontal flip (symmetry 4) to a packed state
+inline uint64_t mirror_packed(uint64_t p) {
+    using namespace detail;
+    uint64_t pawns = ((p & PACKED_COL0) << 4) | ((p & PACKED_COL1) << 2) | (p & PACKED_COL2) |
+                     ((p & PACKED_COL3) >> 2) | ((p & PACKED_COL4) >> 4);
+    uint64_t bobail = MIRROR_SQUARE[(p >> 50) & 0x1F];
+    return pawns | (bobail << 50) | (p & PACKED_SIDE_BIT);
+}
+
+// Canonical packed form of a packed state
+inline uint64_t canonical_packed(uint64_t p) {
+    uint64_t m = mirror_packed(p);
+    return m < p ? m : p;
+}
+
+// Canonical packed form of a state: pack_state(canonicalize(s).first)
+inline uint64_t canonical_pack(const State& s) {
+    return canonical_packed(pack_state(s));
+}
+
+// Canonicalize n packed states at once (in and out may alias).
+// Uses AVX2 when the CPU supports it, the scalar path otherwise.
+void canonicalize_packed_batch(const uint64_t* in, uint64_t* out, size_t n);
+
 // Transform a move under a symmetry (for mapping moves back from canonical form)
 // Given a move in canonical space and the symmetry that was applied,
 // return the equivalent move in the original space
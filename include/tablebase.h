@@ -0,0 +1,113 @@
+#pragma once
+
+#include "board.h"
+#include "movegen.h"
+#include "tt.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace bobail {
+
+// Immutable solved-database file for deployment.
+//
+// Written once by export_tablebase, then memory-mapped read-only by the
+// lookup tools and servers. Positions are identified by their rank (see
+// rank.h), and the file holds one of two layouts after a one-page header:
+//
+// SORTED       Ascending 8-byte entries (rank << 16 | dtw << 8 | code),
+//              one per solved position, followed by a fence array with the
+//              rank of every FENCE_STRIDE-th entry. A probe binary-searches
+//              the fences (a few MB, stays cached) and then a single page
+//              of entries.
+// RANK_BITMAP  The 2-bit result cells of every rank index, as written by
+//              the bitmap solver. A probe reads one cell; there is no DTW.
+//
+// `code` uses the 2-bit bitmap result codes (BITMAP_WIN etc.).
+
+enum class TablebaseKind : uint32_t {
+    SORTED = 1,
+    RANK_BITMAP = 2
+};
+
+constexpr uint32_t TABLEBASE_HAS_DTW = 1;
+
+struct TablebaseHeader {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t kind;            // TablebaseKind
+    uint32_t rules_variant;   // RulesVariant the results were computed for
+    uint32_t flags;           // TABLEBASE_HAS_DTW
+    uint64_t num_entries;     // Entries (SORTED) or cells (RANK_BITMAP)
+    uint64_t num_fences;
+    uint64_t data_offset;     // Byte offset of the entries or cells
+    uint64_t fence_offset;    // Byte offset of the fence array (SORTED)
+    uint64_t num_wins;
+    uint64_t num_losses;
+    uint64_t num_draws;
+};
+
+class Tablebase {
+public:
+    static constexpr uint64_t MAGIC = 0x3153414254424F42ULL;  // "BOBTBAS1"
+    static constexpr uint32_t VERSION = 1;
+    static constexpr size_t HEADER_BYTES = 4096;
+
+    // Entries per fence: one 4KB page
+    static constexpr uint64_t FENCE_STRIDE = HEADER_BYTES / sizeof(uint64_t);
+
+    Tablebase() = default;
+    ~Tablebase();
+
+    Tablebase(const Tablebase&) = delete;
+    Tablebase& operator=(const Tablebase&) = delete;
+
+    // Map the file at `path` read-only
+    bool open(const std::string& path);
+
+    // Use a file image already in memory; `data` must outlive the
+    // tablebase and be 8-byte aligned
+    bool open_buffer(const void* data, size_t size);
+
+    void close();
+
+    bool is_open() const { return header_ != nullptr; }
+    TablebaseKind kind() const { return static_cast<TablebaseKind>(header_->kind); }
+    bool has_dtw() const { return (header_->flags & TABLEBASE_HAS_DTW) != 0; }
+    const TablebaseHeader& header() const { return *header_; }
+
+    // Result for the side to move; UNKNOWN if the position is not stored
+    Result probe(const State& s) const;
+
+    // Same, also returning the plies to the end of the game (0 for draws
+    // and tablebases without DTW)
+    Result probe(const State& s, uint8_t& dtw) const;
+
+    // Fastest win, slowest loss, or a drawing move
+    Move best_move(const State& s) const;
+
+private:
+    bool attach(const void* data, size_t size, const std::string& name);
+
+    int fd_ = -1;
+    void* mapping_ = nullptr;
+    size_t mapping_bytes_ = 0;
+
+    const TablebaseHeader* header_ = nullptr;
+    const uint64_t* data_ = nullptr;
+    const uint64_t* fences_ = nullptr;
+};
+
+// Entry of a SORTED tablebase
+inline uint64_t make_tablebase_entry(uint64_t rank, uint8_t code, uint8_t dtw) {
+    return (rank << 16) | (static_cast<uint64_t>(dtw) << 8) | code;
+}
+
+// Write a SORTED tablebase; sorts `entries` in place. Ranks must be unique.
+bool write_tablebase_sorted(const std::string& path, std::vector<uint64_t>& entries, bool has_dtw);
+
+// Write a RANK_BITMAP tablebase from 2-bit cells packed 32 per word
+bool write_tablebase_bitmap(const std::string& path, const uint64_t* words, uint64_t num_cells);
+
+} // namespace bobail
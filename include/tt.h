@@ -1,7 +1,10 @@
 #pragma once
 
+#include <algorithm>
+#include <cstddef>
 #include <cstdint>
 #include <vector>
+#include <string>
 #include <atomic>
 
 namespace bobail {
@@ -16,7 +19,7 @@ enum class Result : int8_t {
 
 // Transposition table entry for proof-number search
 struct TTEntry {
-    uint64_t key;           // Zobrist hash for verification
+    uint64_t key;           // Position hash for verification (exact in HashMode::PACKED)
     uint32_t proof;         // Proof number (0 = proven true)
     uint32_t disproof;      // Disproof number (0 = proven false)
     Result result;          // Final result if solved
@@ -75,4 +78,202 @@ private:
 // Infinity values for proof numbers
 constexpr uint32_t PN_INFINITY = 0xFFFFFFFF;
 
+// One position of a proof-number search tree: the full 64-bit key, and
+// proof and disproof numbers of 31 bits each. The top bit of each
+// number word holds half of the 2-bit result code (0=unknown, 1=win,
+// 2=loss, 3=draw). Numbers of 2^31 - 1 and more saturate to PN_INFINITY.
+//
+// Both number words share one 64-bit field that is read and written
+// atomically, so concurrent searchers always see a consistent pair. An
+// all-zero field (a slot claimed but not written yet) reads as PN = DN = 1.
+struct PNSSlot {
+    static constexpr uint32_t VALUE_MASK = 0x7FFFFFFF;
+
+    uint64_t key;      // 0 = empty slot
+    uint64_t numbers;  // proof word | disproof word << 32
+
+    uint32_t proof() const { return decode(static_cast<uint32_t>(load())); }
+    uint32_t disproof() const { return decode(static_cast<uint32_t>(load() >> 32)); }
+    uint8_t result() const { return result_of(load()); }
+
+    void set(uint32_t pn, uint32_t dn, uint8_t code) {
+        std::atomic_ref<uint64_t>(numbers).store(encode(pn, dn, code), std::memory_order_relaxed);
+    }
+    void set_numbers(uint32_t pn, uint32_t dn) { set(pn, dn, result()); }
+    void set_result(uint8_t code) { set(proof(), disproof(), code); }
+
+    // Store new numbers unless another thread has solved the slot in the
+    // meantime; a result is never overwritten. Returns false if it was.
+    bool update_unsolved(uint32_t pn, uint32_t dn, uint8_t code) {
+        std::atomic_ref<uint64_t> ref(numbers);
+        uint64_t current = ref.load(std::memory_order_relaxed);
+        uint64_t desired = encode(pn, dn, code);
+        do {
+            uint64_t seen = current ? current : encode(1, 1, 0);
+            if (result_of(seen) != 0 || decode(static_cast<uint32_t>(seen)) == 0 ||
+                decode(static_cast<uint32_t>(seen >> 32)) == 0) {
+                return false;
+            }
+        } while (!ref.compare_exchange_weak(current, desired, std::memory_order_relaxed));
+        return true;
+    }
+
+private:
+    uint64_t load() const {
+        uint64_t v = std::atomic_ref<uint64_t>(const_cast<uint64_t&>(numbers)).load(std::memory_order_relaxed);
+        return v ? v : encode(1, 1, 0);
+    }
+    static uint64_t encode(uint32_t pn, uint32_t dn, uint8_t code) {
+        uint64_t proof_word = std::min(pn, VALUE_MASK) | (static_cast<uint32_t>(code >> 1) << 31);
+        uint64_t disproof_word = std::min(dn, VALUE_MASK) | (static_cast<uint32_t>(code & 1) << 31);
+        return proof_word | (disproof_word << 32);
+    }
+    static uint8_t result_of(uint64_t v) {
+        return static_cast<uint8_t>(((v >> 31) & 1) << 1 | (v >> 63));
+    }
+    static uint32_t decode(uint32_t word) {
+        uint32_t v = word & VALUE_MASK;
+        return v == VALUE_MASK ? PN_INFINITY : v;
+    }
+};
+static_assert(sizeof(PNSSlot) == 16, "PNSSlot must stay 16 bytes");
+
+// Flat open-addressed table of PNSSlots with linear probing, for search
+// trees of hundreds of millions of nodes. Slots live in one anonymous
+// mapping (huge pages where available), so a lookup is one or two cache
+// lines and there is no per-node allocation.
+//
+// Slot pointers stay valid until the table grows or is swept. Inserting
+// into a completely full table grows it. Any number of threads may call
+// find() and insert_shared() at the same time; everything else needs the
+// table to itself.
+//
+// Garbage collection is mark and sweep driven by the caller: clear_marks()
+// then mark() every slot to keep, then sweep() drops the rest and
+// re-packs the probe sequences in place.
+//
+// For incremental checkpoints the table can also track which slots were
+// written (see pns_checkpoint.h). Growing, sweeping or clearing changes
+// the layout, which resets the tracking and bumps layout_version().
+class PNSTable {
+public:
+    // capacity is rounded up to a power of two
+    explicit PNSTable(size_t capacity = 1 << 20);
+    ~PNSTable();
+
+    PNSTable(const PNSTable&) = delete;
+    PNSTable& operator=(const PNSTable&) = delete;
+
+    PNSSlot* find(uint64_t key) {
+        for (size_t i = key & mask_;; i = (i + 1) & mask_) {
+            uint64_t k = std::atomic_ref<uint64_t>(slots_[i].key).load(std::memory_order_acquire);
+            if (k == key) return &slots_[i];
+            if (k == 0) return nullptr;
+        }
+    }
+    const PNSSlot* find(uint64_t key) const {
+        return const_cast<PNSTable*>(this)->find(key);
+    }
+    bool contains(uint64_t key) const { return find(key) != nullptr; }
+
+    // The slot for `key`, created empty (PN = DN = 1, unknown) if new
+    PNSSlot* insert(uint64_t key);
+
+    // Same, safe against concurrent inserts and lookups. Never grows:
+    // returns nullptr once the table is full.
+    PNSSlot* insert_shared(uint64_t key);
+
+    // Position of a slot, for per-slot side arrays of capacity() entries
+    size_t index_of(const PNSSlot* slot) const { return static_cast<size_t>(slot - slots_); }
+
+    size_t size() const { return size_.load(std::memory_order_relaxed); }
+    size_t capacity() const { return mask_ + 1; }
+    double load() const { return static_cast<double>(size()) / capacity(); }
+    size_t memory_bytes() const { return capacity() * sizeof(PNSSlot); }
+
+    void clear();
+
+    // Double the capacity and rehash; false if the memory is not available
+    bool grow();
+
+    // Make sure `n` entries fit under MAX_LOAD
+    bool reserve(size_t n);
+
+    template <typename Fn>
+    void for_each(Fn&& fn) const {
+        for (size_t i = 0; i <= mask_; ++i) {
+            if (slots_[i].key != 0) fn(slots_[i]);
+        }
+    }
+
+    void clear_marks();
+    // Returns true the first time a slot is marked
+    bool mark(const PNSSlot* slot);
+    // Remove every unmarked slot; returns how many were removed
+    size_t sweep();
+
+    // Record writes from now on (or stop); starts with nothing dirty
+    void track_dirty(bool enabled);
+    // Note that a slot was written; inserts do this themselves. Safe to
+    // call from several threads.
+    void mark_dirty(const PNSSlot* slot) {
+        if (dirty_.empty()) return;
+        size_t i = index_of(slot);
+        std::atomic_ref<uint64_t> word(dirty_[i >> 6]);
+        uint64_t bit = 1ULL << (i & 63);
+        if (!(word.load(std::memory_order_relaxed) & bit)) word.fetch_or(bit, std::memory_order_relaxed);
+    }
+    // The slots written since tracking started or the last call, one bit
+    // per slot index; tracking continues with a clean set
+    std::vector<uint64_t> take_dirty();
+
+    // Changes whenever slots move (grow, sweep, clear, map_file)
+    uint64_t layout_version() const { return layout_version_; }
+
+    // Copy of slot `i` that is safe to take while threads write to it:
+    // the key and the numbers are each read atomically
+    PNSSlot load_slot(size_t i) const {
+        PNSSlot copy;
+        copy.key = std::atomic_ref<uint64_t>(slots_[i].key).load(std::memory_order_acquire);
+        copy.numbers = std::atomic_ref<uint64_t>(slots_[i].numbers).load(std::memory_order_relaxed);
+        return copy;
+    }
+    // Overwrite slot `i` with a saved copy of the same layout
+    void restore_slot(size_t i, const PNSSlot& slot) {
+        if (slots_[i].key == 0 && slot.key != 0) ++size_;
+        slots_[i] = slot;
+    }
+
+    // Replace the table with a copy-on-write mapping of `capacity` slots
+    // stored at `offset` (page aligned) in a file, holding `size` entries.
+    // Pages are read on first touch, so this returns at once; the file
+    // itself is never written.
+    bool map_file(const std::string& path, uint64_t offset, size_t capacity, size_t size);
+
+    // Probe sequences get long beyond this; callers grow or collect
+    static constexpr double MAX_LOAD = 0.8;
+
+private:
+    static PNSSlot* allocate(size_t capacity);
+    static void release(PNSSlot* slots, size_t capacity);
+
+    // First empty slot on the probe sequence of `key`
+    size_t free_slot(uint64_t key) const {
+        size_t i = key & mask_;
+        while (slots_[i].key != 0) i = (i + 1) & mask_;
+        return i;
+    }
+
+    PNSSlot* slots_ = nullptr;
+    size_t mask_ = 0;
+    std::atomic<size_t> size_{0};
+    std::vector<uint64_t> marks_;
+    std::vector<uint64_t> dirty_;
+    bool track_dirty_ = false;
+    uint64_t layout_version_ = 0;
+
+    // Called after the slots have moved
+    void layout_changed();
+};
+
 } // namespace bobail
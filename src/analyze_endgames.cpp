@@ -1,7 +1,5 @@
 #include <iostream>
 #include <map>
-#include <rocksdb/db.h>
-#include <rocksdb/options.h>
 #include "board.h"
 #include "retrograde_db.h"
 
@@ -16,37 +14,17 @@ int main(int argc, char* argv[]) {
     std::string db_path = argv[1];
 
     // Open database read-only
-    rocksdb::DB* db;
-    rocksdb::Options options;
-    options.create_if_missing = false;
-
-    std::vector<rocksdb::ColumnFamilyDescriptor> cf_descs;
-    cf_descs.push_back(rocksdb::ColumnFamilyDescriptor(rocksdb::kDefaultColumnFamilyName, rocksdb::ColumnFamilyOptions()));
-    cf_descs.push_back(rocksdb::ColumnFamilyDescriptor("states", rocksdb::ColumnFamilyOptions()));
-    cf_descs.push_back(rocksdb::ColumnFamilyDescriptor("packed_to_id", rocksdb::ColumnFamilyOptions()));
-    cf_descs.push_back(rocksdb::ColumnFamilyDescriptor("predecessors", rocksdb::ColumnFamilyOptions()));
-    cf_descs.push_back(rocksdb::ColumnFamilyDescriptor("queue", rocksdb::ColumnFamilyOptions()));
-    cf_descs.push_back(rocksdb::ColumnFamilyDescriptor("metadata", rocksdb::ColumnFamilyOptions()));
-
-    std::vector<rocksdb::ColumnFamilyHandle*> cf_handles;
-    rocksdb::Status status = rocksdb::DB::OpenForReadOnly(options, db_path, cf_descs, &cf_handles, &db);
-
-    if (!status.ok()) {
-        std::cerr << "Failed to open database: " << status.ToString() << "\n";
+    RetrogradeSolverDB solver;
+    if (!solver.open_readonly(db_path)) {
+        std::cerr << "Failed to open database: " << db_path << "\n";
         return 1;
     }
 
-    auto cf_packed_to_id = cf_handles[2];
-    auto cf_states = cf_handles[1];
-
     // Count states by (white_pawn_count, black_pawn_count)
     std::map<std::pair<int,int>, uint64_t> pawn_counts;
     std::map<std::pair<int,int>, uint64_t> solved_counts;  // WIN or LOSS
     std::map<std::pair<int,int>, uint64_t> draw_counts;
 
-    // Iterate through packed_to_id to get all packed states
-    rocksdb::Iterator* it = db->NewIterator(rocksdb::ReadOptions(), cf_packed_to_id);
-
     uint64_t total = 0;
     uint64_t solved = 0;
     uint64_t draws = 0;
@@ -58,14 +36,9 @@ int main(int argc, char* argv[]) {
     std::cout << "Scanning database (sampling 1 in " << SAMPLE_RATE << ")..." << std::endl;
     std::cout.setf(std::ios::unitbuf);  // Disable buffering
 
-    for (it->SeekToFirst(); it->Valid(); it->Next()) {
+    solver.for_each_state([&](uint64_t packed, Result result, uint8_t) {
         skip_counter++;
-        if (skip_counter % SAMPLE_RATE != 0) continue;  // Skip most entries
-
-        if (it->key().size() != sizeof(uint64_t)) continue;
-
-        uint64_t packed;
-        memcpy(&packed, it->key().data(), sizeof(packed));
+        if (skip_counter % SAMPLE_RATE != 0) return;  // Skip most entries
 
         // Unpack to get pawn counts
         State s = unpack_state(packed);
@@ -75,35 +48,19 @@ int main(int argc, char* argv[]) {
         auto key = std::make_pair(white_pawns, black_pawns);
         pawn_counts[key]++;
 
-        // Get state ID and check if solved
-        if (it->value().size() == sizeof(uint32_t)) {
-            uint32_t state_id;
-            memcpy(&state_id, it->value().data(), sizeof(state_id));
-
-            // Read state info
-            std::string id_key(reinterpret_cast<char*>(&state_id), sizeof(state_id));
-            std::string state_value;
-            if (db->Get(rocksdb::ReadOptions(), cf_states, id_key, &state_value).ok()) {
-                if (state_value.size() >= 1) {
-                    uint8_t result = static_cast<uint8_t>(state_value[0]);
-                    if (result == 1 || result == 2) {  // WIN or LOSS
-                        solved_counts[key]++;
-                        solved++;
-                    } else if (result == 3) {  // DRAW
-                        draw_counts[key]++;
-                        draws++;
-                    }
-                }
-            }
+        if (result == Result::WIN || result == Result::LOSS) {
+            solved_counts[key]++;
+            solved++;
+        } else if (result == Result::DRAW) {
+            draw_counts[key]++;
+            draws++;
         }
 
         total++;
         if (total % 10000 == 0) {
             std::cout << "Sampled " << total << " states (est. " << (skip_counter / 1000000) << "M total)..." << std::endl;
         }
-    }
-
-    delete it;
+    });
 
     std::cout << "\n=== Endgame Analysis (Sampled) ===\n";
     std::cout << "Sampled states: " << total << " (1 in " << SAMPLE_RATE << ")\n";
@@ -126,9 +83,6 @@ int main(int argc, char* argv[]) {
                key.first, key.second, count, s, d, pct);
     }
 
-    // Clean up
-    for (auto h : cf_handles) delete h;
-    delete db;
-
+    solver.close();
     return 0;
 }
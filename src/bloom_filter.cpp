@@ -0,0 +1,94 @@
+#include "bloom_filter.h"
+#include <algorithm>
+#include <bit>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <sys/mman.h>
+
+namespace bobail {
+
+namespace {
+    struct BloomFileHeader {
+        uint64_t magic;
+        uint64_t num_blocks;
+        uint64_t num_entries;
+    };
+}
+
+BloomFilter::BloomFilter(size_t size_bytes) {
+    num_blocks_ = std::bit_floor(std::max<size_t>(size_bytes / BLOCK_BYTES, 2));
+    block_shift_ = 64 - std::countr_zero(num_blocks_);
+
+    // Anonymous mapping: page aligned, and zero pages are only touched
+    // when first written
+    void* mem = mmap(nullptr, memory_bytes(), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) {
+        std::cerr << "Failed to allocate " << memory_bytes() << " byte bloom filter: "
+                  << std::strerror(errno) << "\n";
+        throw std::bad_alloc();
+    }
+#ifdef MADV_HUGEPAGE
+    madvise(mem, memory_bytes(), MADV_HUGEPAGE);
+#endif
+    words_ = static_cast<uint64_t*>(mem);
+}
+
+BloomFilter::~BloomFilter() {
+    if (words_) munmap(words_, memory_bytes());
+}
+
+void BloomFilter::clear() {
+    std::memset(words_, 0, memory_bytes());
+}
+
+bool BloomFilter::save(const std::string& path, uint64_t num_entries) const {
+    // Write to a temporary file and rename, so a crash mid-save never
+    // leaves a truncated filter behind
+    std::string tmp = path + ".tmp";
+    FILE* f = std::fopen(tmp.c_str(), "wb");
+    if (!f) {
+        std::cerr << "Failed to create " << tmp << ": " << std::strerror(errno) << "\n";
+        return false;
+    }
+
+    BloomFileHeader header{MAGIC, num_blocks_, num_entries};
+    bool ok = std::fwrite(&header, sizeof(header), 1, f) == 1 &&
+              std::fwrite(words_, BLOCK_BYTES, num_blocks_, f) == num_blocks_;
+    ok = std::fclose(f) == 0 && ok;
+
+    if (!ok || std::rename(tmp.c_str(), path.c_str()) != 0) {
+        std::cerr << "Failed to write " << path << ": " << std::strerror(errno) << "\n";
+        std::remove(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool BloomFilter::load(const std::string& path, uint64_t& num_entries) {
+    FILE* f = std::fopen(path.c_str(), "rb");
+    if (!f) return false;
+
+    BloomFileHeader header;
+    if (std::fread(&header, sizeof(header), 1, f) != 1 ||
+        header.magic != MAGIC || header.num_blocks != num_blocks_) {
+        std::cerr << "Ignoring bloom filter " << path << ": unrecognized header or size\n";
+        std::fclose(f);
+        return false;
+    }
+
+    bool ok = std::fread(words_, BLOCK_BYTES, num_blocks_, f) == num_blocks_;
+    std::fclose(f);
+    if (!ok) {
+        std::cerr << "Ignoring bloom filter " << path << ": truncated\n";
+        clear();
+        return false;
+    }
+
+    num_entries = header.num_entries;
+    return true;
+}
+
+} // namespace bobail
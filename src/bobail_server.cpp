@@ -0,0 +1,845 @@
+// Native HTTP lookup service for the web UI
+//
+// Keeps a tablebase (see tablebase.h) and/or a PNS checkpoint loaded and
+// answers JSON queries over persistent HTTP/1.1 connections. One thread
+// waits on every socket with epoll and hands each complete request to a
+// pool of workers, so idle keep-alive connections cost no thread:
+//
+//   GET  /lookup?pos=WP,BP,BOB,STM    result, best move and every move's eval
+//   GET  /bestmove?pos=WP,BP,BOB,STM  result and best move only
+//   GET  /batch?pos=P1;P2;...         results of many positions
+//   POST /batch                       same, positions one per line in the body
+//   GET  /health
+//   GET  /stats                       request and cache counters
+//
+// The /lookup response matches lookup_server.py, so docs/game.js can use
+// either.
+
+#include "board.h"
+#include "movegen.h"
+#include "hash.h"
+#include "symmetry.h"
+#include "pns_table.h"
+#include "result_cache.h"
+#include "tablebase.h"
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <queue>
+#include <sstream>
+#include <unordered_map>
+#include <string>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+using namespace bobail;
+
+// ============================================================================
+// Position sources
+// ============================================================================
+
+PNSTableFile pns_table;
+Tablebase tablebase;
+
+bool load_checkpoint(const std::string& path) {
+    if (!pns_table.open(path)) return false;
+    std::cerr << "Loaded " << pns_table.size() << " entries"
+              << (pns_table.is_mapped() ? " (mapped)" : "") << ". Proved: " << pns_table.counters()[1]
+              << ", Disproved: " << pns_table.counters()[2] << "\n";
+    return true;
+}
+
+struct Evaluation {
+    Result result = Result::UNKNOWN;
+    uint8_t dtw = 0;
+    bool has_dtw = false;
+};
+
+// Evaluations of recently asked positions and their children, keyed by
+// canonical packed state
+LruCache<Evaluation> eval_cache;
+std::atomic<uint64_t> num_requests{0};
+
+// Tablebase first, then terminal rules, then the PNS table
+Evaluation probe_sources(const State& s) {
+    Evaluation e;
+    if (tablebase.is_open()) {
+        e.result = tablebase.probe(s, e.dtw);
+        if (e.result != Result::UNKNOWN) {
+            e.has_dtw = tablebase.has_dtw() && e.result != Result::DRAW;
+            return e;
+        }
+    }
+
+    GameResult gr = check_terminal(s);
+    if (gr != GameResult::ONGOING) {
+        if (gr == GameResult::DRAW) {
+            e.result = Result::DRAW;
+        } else {
+            bool side_wins = (gr == GameResult::WHITE_WINS) == s.white_to_move;
+            e.result = side_wins ? Result::WIN : Result::LOSS;
+            e.has_dtw = true;
+        }
+        return e;
+    }
+
+    if (!pns_table.empty()) {
+        const PNSSlot* entry = pns_table.find(canonical_hash(s));
+        if (entry) {
+            switch (entry->result()) {
+                case 1: e.result = Result::WIN; break;
+                case 2: e.result = Result::LOSS; break;
+                case 3: e.result = Result::DRAW; break;
+                default: break;
+            }
+        }
+    }
+    return e;
+}
+
+Evaluation evaluate(const State& s) {
+    uint64_t key = canonical_pack(s);
+    Evaluation e;
+    if (!eval_cache.find(key, e)) {
+        e = probe_sources(s);
+        eval_cache.insert(key, e);
+    }
+    return e;
+}
+
+const char* result_name(Result r) {
+    switch (r) {
+        case Result::WIN: return "win";
+        case Result::LOSS: return "loss";
+        case Result::DRAW: return "draw";
+        default: return "unknown";
+    }
+}
+
+// Result of the move for the player making it
+Result flip(Result r) {
+    if (r == Result::WIN) return Result::LOSS;
+    if (r == Result::LOSS) return Result::WIN;
+    return r;
+}
+
+// Parse a whole field as a number in `base`; trailing characters fail it
+template <typename T>
+bool parse_field(const std::string& field, T& value, int base) {
+    const char* first = field.data();
+    const char* last = first + field.size();
+    auto [ptr, ec] = std::from_chars(first, last, value, base);
+    return ec == std::errc() && ptr == last && ptr != first;
+}
+
+bool parse_position(const std::string& input, State& s) {
+    // Format: WP,BP,BOB,STM (hex,hex,int,0 or 1), nothing else
+    if (std::count(input.begin(), input.end(), ',') != 3) return false;
+    std::istringstream iss(input);
+    std::string wp_str, bp_str, bob_str, stm_str;
+
+    if (!std::getline(iss, wp_str, ',')) return false;
+    if (!std::getline(iss, bp_str, ',')) return false;
+    if (!std::getline(iss, bob_str, ',')) return false;
+    if (!std::getline(iss, stm_str)) return false;
+
+    uint32_t wp, bp;
+    int bob, stm;
+    if (!parse_field(wp_str, wp, 16) || !parse_field(bp_str, bp, 16) ||
+        !parse_field(bob_str, bob, 10) || !parse_field(stm_str, stm, 10)) {
+        return false;
+    }
+    if (wp >= (1u << NUM_SQUARES) || bp >= (1u << NUM_SQUARES)) return false;
+    if (bob < 0 || bob >= NUM_SQUARES) return false;
+    if (stm != 0 && stm != 1) return false;
+    s.white_pawns = wp;
+    s.black_pawns = bp;
+    s.bobail_sq = static_cast<uint8_t>(bob);
+    s.white_to_move = stm == 1;
+
+    uint32_t bobail_bit = 1u << s.bobail_sq;
+    return std::popcount(s.white_pawns) == PAWNS_PER_SIDE &&
+           std::popcount(s.black_pawns) == PAWNS_PER_SIDE &&
+           (s.white_pawns & s.black_pawns) == 0 &&
+           ((s.white_pawns | s.black_pawns) & bobail_bit) == 0;
+}
+
+// The WP,BP,BOB,STM form of a parsed position, as responses echo it
+std::string format_position(const State& s) {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%x,%x,%d,%d", s.white_pawns, s.black_pawns,
+                  static_cast<int>(s.bobail_sq), s.white_to_move ? 1 : 0);
+    return buf;
+}
+
+// ============================================================================
+// JSON responses
+// ============================================================================
+
+void append_move(std::string& out, const Move& m) {
+    out += "{\"bobail_to\":" + std::to_string(m.bobail_to) +
+           ",\"pawn_from\":" + std::to_string(m.pawn_from) +
+           ",\"pawn_to\":" + std::to_string(m.pawn_to);
+}
+
+// Position result plus best move, and every move when `all_moves` is set.
+// Best move: fastest win, slowest loss (any loss without DTW), or a draw.
+std::string lookup_json(const State& s, bool all_moves) {
+    Evaluation e = evaluate(s);
+
+    std::string out = "{\"pos\":\"" + format_position(s) + "\",\"result\":\"" + result_name(e.result) + "\"";
+    if (e.has_dtw) out += ",\"dtw\":" + std::to_string(e.dtw);
+
+    MoveList moves;
+    generate_moves(s, moves);
+    std::vector<Evaluation> evals(moves.size());
+    int best = -1;
+    for (size_t i = 0; i < moves.size(); ++i) {
+        evals[i] = evaluate(apply_move(s, moves[i]));
+        Result mine = flip(evals[i].result);
+        if (mine != e.result || mine == Result::UNKNOWN) continue;
+        if (best < 0) {
+            best = static_cast<int>(i);
+        } else if (mine == Result::WIN && evals[i].dtw < evals[best].dtw) {
+            best = static_cast<int>(i);
+        } else if (mine == Result::LOSS && evals[i].dtw > evals[best].dtw) {
+            best = static_cast<int>(i);
+        }
+    }
+
+    out += ",\"best_move\":";
+    if (best >= 0) {
+        append_move(out, moves[best]);
+        out += "}";
+    } else {
+        out += "null";
+    }
+
+    if (all_moves) {
+        out += ",\"all_moves\":[";
+        bool first = true;
+        for (size_t i = 0; i < moves.size(); ++i) {
+            if (!first) out += ",";
+            first = false;
+            append_move(out, moves[i]);
+            out += ",\"eval\":\"";
+            out += result_name(flip(evals[i].result));
+            out += "\"";
+            if (evals[i].has_dtw) out += ",\"dtw\":" + std::to_string(evals[i].dtw + 1);
+            out += ",\"best\":";
+            out += static_cast<int>(i) == best ? "true" : "false";
+            out += "}";
+        }
+        out += "]";
+    }
+    out += "}";
+    return out;
+}
+
+std::string batch_json(const std::vector<std::string>& positions) {
+    std::string out = "{\"results\":[";
+    for (size_t i = 0; i < positions.size(); ++i) {
+        if (i) out += ",";
+        State s;
+        if (!parse_position(positions[i], s)) {
+            out += "{\"pos\":\"\",\"error\":\"Invalid position\"}";
+            continue;
+        }
+        Evaluation e = evaluate(s);
+        out += "{\"pos\":\"" + format_position(s) + "\",\"result\":\"" + result_name(e.result) + "\"";
+        if (e.has_dtw) out += ",\"dtw\":" + std::to_string(e.dtw);
+        out += "}";
+    }
+    out += "]}";
+    return out;
+}
+
+std::string error_json(const std::string& message) {
+    return "{\"error\":\"" + message + "\"}";
+}
+
+// ============================================================================
+// HTTP
+// ============================================================================
+
+constexpr size_t MAX_HEADER_BYTES = 16 * 1024;
+constexpr size_t MAX_BODY_BYTES = 1024 * 1024;
+constexpr size_t MAX_BATCH = 4096;
+constexpr int IDLE_TIMEOUT_SEC = 60;
+constexpr int SEND_TIMEOUT_SEC = 5;
+
+std::atomic<bool> g_stop{false};
+int g_listen_fd = -1;
+
+struct Request {
+    std::string method;
+    std::string path;
+    std::string query;
+    std::string body;
+    bool keep_alive = true;
+
+    // Set for a malformed request: the status and message to answer with
+    // before closing the connection
+    int error = 0;
+    std::string error_message;
+};
+
+std::string url_decode(const std::string& in) {
+    std::string out;
+    out.reserve(in.size());
+    for (size_t i = 0; i < in.size(); ++i) {
+        if (in[i] == '%' && i + 2 < in.size() && std::isxdigit(static_cast<unsigned char>(in[i + 1])) &&
+            std::isxdigit(static_cast<unsigned char>(in[i + 2]))) {
+            out += static_cast<char>(std::stoi(in.substr(i + 1, 2), nullptr, 16));
+            i += 2;
+        } else if (in[i] == '+') {
+            out += ' ';
+        } else {
+            out += in[i];
+        }
+    }
+    return out;
+}
+
+std::string query_param(const std::string& query, const std::string& name) {
+    size_t start = 0;
+    while (start <= query.size()) {
+        size_t end = query.find('&', start);
+        if (end == std::string::npos) end = query.size();
+        std::string pair = query.substr(start, end - start);
+        size_t eq = pair.find('=');
+        if (eq != std::string::npos && pair.substr(0, eq) == name) {
+            return url_decode(pair.substr(eq + 1));
+        }
+        start = end + 1;
+    }
+    return "";
+}
+
+std::vector<std::string> split_positions(const std::string& text) {
+    std::vector<std::string> out;
+    std::string current;
+    for (char c : text) {
+        if (c == ';' || c == '\n' || c == '\r' || c == ' ') {
+            if (!current.empty()) out.push_back(current);
+            current.clear();
+        } else {
+            current += c;
+        }
+    }
+    if (!current.empty()) out.push_back(current);
+    return out;
+}
+
+bool send_all(int fd, const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            // Sockets are non-blocking; wait for the client to read
+            pollfd p{fd, POLLOUT, 0};
+            if (poll(&p, 1, SEND_TIMEOUT_SEC * 1000) <= 0) return false;
+            continue;
+        }
+        if (n <= 0) return false;
+        sent += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool send_response(int fd, int status, const std::string& body, bool keep_alive) {
+    const char* reason = status == 200 ? "OK" : status == 204 ? "No Content"
+                       : status == 400 ? "Bad Request" : status == 404 ? "Not Found"
+                       : status == 413 ? "Payload Too Large" : "Error";
+    std::string head = "HTTP/1.1 " + std::to_string(status) + " " + reason + "\r\n";
+    head += "Content-Type: application/json\r\n";
+    head += "Access-Control-Allow-Origin: *\r\n";
+    head += "Access-Control-Allow-Methods: GET, POST, OPTIONS\r\n";
+    head += "Access-Control-Allow-Headers: Content-Type\r\n";
+    head += "Content-Length: " + std::to_string(body.size()) + "\r\n";
+    head += keep_alive ? "Connection: keep-alive\r\n\r\n" : "Connection: close\r\n\r\n";
+    return send_all(fd, head + body);
+}
+
+// Take one request off the front of `buffer`, which holds the bytes
+// received so far. Returns false while the request is incomplete. A
+// malformed request is returned with `error` set; the rest of the buffer
+// is dropped, since the connection is closed after answering it.
+bool parse_request(std::string& buffer, Request& req) {
+    req = Request{};
+    auto malformed = [&](int status, const char* message) {
+        req.error = status;
+        req.error_message = message;
+        req.keep_alive = false;
+        buffer.clear();
+        return true;
+    };
+
+    size_t header_end = buffer.find("\r\n\r\n");
+    if (header_end == std::string::npos) {
+        if (buffer.size() > MAX_HEADER_BYTES) return malformed(413, "Request header too large");
+        return false;
+    }
+
+    std::istringstream head(buffer.substr(0, header_end));
+    std::string line;
+    std::getline(head, line);
+    if (!line.empty() && line.back() == '\r') line.pop_back();
+
+    std::istringstream request_line(line);
+    std::string target, version;
+    request_line >> req.method >> target >> version;
+    if (req.method.empty() || target.empty()) return malformed(400, "Malformed request");
+    size_t qpos = target.find('?');
+    req.path = target.substr(0, qpos);
+    req.query = qpos == std::string::npos ? "" : target.substr(qpos + 1);
+    req.keep_alive = version == "HTTP/1.1";
+
+    size_t content_length = 0;
+    while (std::getline(head, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        size_t colon = line.find(':');
+        if (colon == std::string::npos) continue;
+        std::string name = line.substr(0, colon);
+        std::string value = line.substr(colon + 1);
+        value.erase(0, value.find_first_not_of(' '));
+        std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+        std::transform(value.begin(), value.end(), value.begin(), ::tolower);
+        if (name == "content-length") {
+            if (!parse_field(value, content_length, 10)) return malformed(400, "Bad Content-Length");
+        } else if (name == "connection") {
+            if (value == "close") req.keep_alive = false;
+            if (value == "keep-alive") req.keep_alive = true;
+        }
+    }
+    if (content_length > MAX_BODY_BYTES) return malformed(413, "Request body too large");
+
+    size_t body_start = header_end + 4;
+    if (buffer.size() < body_start + content_length) return false;
+    req.body = buffer.substr(body_start, content_length);
+    buffer.erase(0, body_start + content_length);
+    return true;
+}
+
+bool handle_request(int fd, const Request& req) {
+    if (req.error) {
+        return send_response(fd, req.error, error_json(req.error_message), false);
+    }
+
+    if (req.method == "OPTIONS") {
+        return send_response(fd, 204, "", req.keep_alive);
+    }
+
+    if (req.path == "/lookup" || req.path == "/bestmove") {
+        std::string pos = query_param(req.query, "pos");
+        if (pos.empty()) return send_response(fd, 400, error_json("Missing pos parameter"), req.keep_alive);
+        State s;
+        if (!parse_position(pos, s)) return send_response(fd, 400, error_json("Invalid position"), req.keep_alive);
+        return send_response(fd, 200, lookup_json(s, req.path == "/lookup"), req.keep_alive);
+    }
+
+    if (req.path == "/batch") {
+        std::vector<std::string> positions =
+            split_positions(req.method == "POST" ? req.body : query_param(req.query, "pos"));
+        if (positions.size() > MAX_BATCH) {
+            return send_response(fd, 413, error_json("Too many positions"), req.keep_alive);
+        }
+        return send_response(fd, 200, batch_json(positions), req.keep_alive);
+    }
+
+    if (req.path == "/stats") {
+        LruCache<Evaluation>::Stats c = eval_cache.stats();
+        std::string body = "{\"requests\":" + std::to_string(num_requests.load()) +
+                           ",\"cache\":{\"hits\":" + std::to_string(c.hits) +
+                           ",\"misses\":" + std::to_string(c.misses) +
+                           ",\"evictions\":" + std::to_string(c.evictions) +
+                           ",\"size\":" + std::to_string(c.size) +
+                           ",\"capacity\":" + std::to_string(c.capacity) + "}}";
+        return send_response(fd, 200, body, req.keep_alive);
+    }
+
+    if (req.path == "/health") {
+        std::string body = std::string("{\"status\":\"ok\",\"rules\":\"") +
+                           (g_rules_variant == RulesVariant::OFFICIAL ? "official" : "flexible") + "\"" +
+                           ",\"tablebase\":" + (tablebase.is_open() ? "true" : "false") +
+                           ",\"pns_entries\":" + std::to_string(pns_table.size()) + "}";
+        return send_response(fd, 200, body, req.keep_alive);
+    }
+
+    return send_response(fd, 404, error_json("Unknown endpoint"), req.keep_alive);
+}
+
+// A client connection. The event loop owns it while it waits for a
+// complete request; a worker owns it from then until it hands it back.
+struct Connection {
+    int fd = -1;
+    std::string buffer;   // Bytes received and not yet parsed
+    Request request;      // The request handed to the worker
+    bool close = false;   // Set by the worker: close instead of waiting for more
+    bool busy = false;    // With a worker (loop thread only)
+    std::chrono::steady_clock::time_point last_active;
+};
+
+// Answer the connection's request and any further complete requests the
+// client already sent behind it
+void serve_connection(Connection& c) {
+    do {
+        num_requests.fetch_add(1, std::memory_order_relaxed);
+        if (!handle_request(c.fd, c.request) || !c.request.keep_alive) {
+            c.close = true;
+            return;
+        }
+    } while (parse_request(c.buffer, c.request));
+}
+
+// Event loop plus a fixed pool of workers. The loop accepts connections
+// and reads from every socket that has data; once a connection's buffer
+// holds a complete request it leaves the epoll set and goes to the
+// workers' queue. Workers answer it and pass the connection back through
+// `returned_`, waking the loop with an eventfd, and the loop either
+// closes it or watches it again.
+class Server {
+public:
+    Server(int listen_fd, int num_threads) : listen_fd_(listen_fd) {
+        epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+        wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        watch(listen_fd_);
+        watch(wake_fd_);
+        for (int i = 0; i < num_threads; ++i) {
+            workers_.emplace_back([this]() { run_worker(); });
+        }
+    }
+
+    ~Server() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        cv_.notify_all();
+        for (auto& t : workers_) t.join();
+        for (auto& [fd, c] : connections_) close(fd);
+        close(wake_fd_);
+        close(epoll_fd_);
+    }
+
+    bool ok() const { return epoll_fd_ >= 0 && wake_fd_ >= 0; }
+
+    // Serve until g_stop is set
+    void run() {
+        epoll_event events[256];
+        auto last_sweep = std::chrono::steady_clock::now();
+        while (!g_stop.load()) {
+            int n = epoll_wait(epoll_fd_, events, 256, 1000);
+            if (n < 0 && errno != EINTR) break;
+            for (int i = 0; i < n; ++i) {
+                int fd = events[i].data.fd;
+                if (fd == listen_fd_) {
+                    if (!accept_all()) return;
+                } else if (fd == wake_fd_) {
+                    take_back();
+                } else {
+                    receive(fd);
+                }
+            }
+
+            auto now = std::chrono::steady_clock::now();
+            if (now - last_sweep >= std::chrono::seconds(1)) {
+                close_idle(now);
+                last_sweep = now;
+            }
+        }
+    }
+
+private:
+    void watch(int fd) {
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.fd = fd;
+        epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev);
+    }
+
+    void drop(int fd) {
+        epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+        close(fd);
+        connections_.erase(fd);
+    }
+
+    // False once the listening socket is shut down
+    bool accept_all() {
+        while (true) {
+            int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) {
+                if (errno == EAGAIN || errno == EWOULDBLOCK) return true;
+                if (errno == EINTR || errno == ECONNABORTED || errno == EMFILE || errno == ENFILE) return true;
+                return false;
+            }
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            auto c = std::make_unique<Connection>();
+            c->fd = fd;
+            c->last_active = std::chrono::steady_clock::now();
+            connections_[fd] = std::move(c);
+            watch(fd);
+        }
+    }
+
+    void receive(int fd) {
+        auto it = connections_.find(fd);
+        if (it == connections_.end()) return;
+        Connection& c = *it->second;
+
+        char chunk[8192];
+        while (true) {
+            ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+            if (n > 0) {
+                c.buffer.append(chunk, static_cast<size_t>(n));
+                if (c.buffer.size() > MAX_HEADER_BYTES + MAX_BODY_BYTES) break;
+                continue;
+            }
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+            drop(fd);  // EOF or error
+            return;
+        }
+        c.last_active = std::chrono::steady_clock::now();
+
+        if (parse_request(c.buffer, c.request)) {
+            epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+            c.busy = true;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                ready_.push(&c);
+            }
+            cv_.notify_one();
+        }
+    }
+
+    void take_back() {
+        uint64_t count;
+        while (read(wake_fd_, &count, sizeof(count)) > 0) {}
+
+        std::vector<Connection*> returned;
+        {
+            std::lock_guard<std::mutex> lock(returned_mutex_);
+            returned.swap(returned_);
+        }
+        for (Connection* c : returned) {
+            if (c->close) {
+                close(c->fd);
+                connections_.erase(c->fd);
+            } else {
+                c->busy = false;
+                c->last_active = std::chrono::steady_clock::now();
+                watch(c->fd);
+            }
+        }
+    }
+
+    void close_idle(std::chrono::steady_clock::time_point now) {
+        std::vector<int> idle;
+        for (auto& [fd, c] : connections_) {
+            if (!c->busy && now - c->last_active >= std::chrono::seconds(IDLE_TIMEOUT_SEC)) {
+                idle.push_back(fd);
+            }
+        }
+        for (int fd : idle) drop(fd);
+    }
+
+    void run_worker() {
+        while (true) {
+            Connection* c;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cv_.wait(lock, [this]() { return stopping_ || !ready_.empty(); });
+                if (stopping_) return;
+                c = ready_.front();
+                ready_.pop();
+            }
+            serve_connection(*c);
+            {
+                std::lock_guard<std::mutex> lock(returned_mutex_);
+                returned_.push_back(c);
+            }
+            uint64_t one = 1;
+            ssize_t written = write(wake_fd_, &one, sizeof(one));
+            (void)written;
+        }
+    }
+
+    int listen_fd_;
+    int epoll_fd_ = -1;
+    int wake_fd_ = -1;
+
+    // Loop thread only
+    std::unordered_map<int, std::unique_ptr<Connection>> connections_;
+
+    // Complete requests waiting for a worker
+    std::vector<std::thread> workers_;
+    std::queue<Connection*> ready_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stopping_ = false;
+
+    // Connections the workers are done with
+    std::vector<Connection*> returned_;
+    std::mutex returned_mutex_;
+};
+
+void handle_signal(int) {
+    g_stop = true;
+    if (g_listen_fd >= 0) shutdown(g_listen_fd, SHUT_RDWR);
+}
+
+} // namespace
+
+void print_usage(const char* prog) {
+    std::cerr << "Usage: " << prog << " [options]\n"
+              << "Options:\n"
+              << "  --tablebase FILE    Tablebase file from export_tablebase\n"
+              << "  --pns FILE          PNS checkpoint (used for positions not in the tablebase)\n"
+              << "  --port N            Port to listen on (default: 8081)\n"
+              << "  --threads N         Worker threads (default: one per core)\n"
+              << "  --cache-entries N   Evaluations kept in memory (default: 1048576, 0 to disable)\n"
+              << "  --official          Use Official rules [default]\n"
+              << "  --flexible          Use Flexible rules\n"
+              << "  --help              Show this help\n";
+}
+
+int main(int argc, char* argv[]) {
+    std::string tablebase_path;
+    std::string pns_path;
+    int port = 8081;
+    int num_threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    size_t cache_entries = 1 << 20;
+
+    // Parse arguments
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--help") == 0) {
+            print_usage(argv[0]);
+            return 0;
+        } else if (std::strcmp(argv[i], "--tablebase") == 0) {
+            if (i + 1 < argc) {
+                tablebase_path = argv[++i];
+            } else {
+                std::cerr << "Error: --tablebase requires a path\n";
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--pns") == 0) {
+            if (i + 1 < argc) {
+                pns_path = argv[++i];
+            } else {
+                std::cerr << "Error: --pns requires a path\n";
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--port") == 0) {
+            if (i + 1 < argc) {
+                port = std::stoi(argv[++i]);
+            } else {
+                std::cerr << "Error: --port requires a number\n";
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--threads") == 0) {
+            if (i + 1 < argc) {
+                num_threads = std::max(1, std::stoi(argv[++i]));
+            } else {
+                std::cerr << "Error: --threads requires a number\n";
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--cache-entries") == 0) {
+            if (i + 1 < argc) {
+                cache_entries = std::stoull(argv[++i]);
+            } else {
+                std::cerr << "Error: --cache-entries requires a number\n";
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--official") == 0) {
+            bobail::g_rules_variant = bobail::RulesVariant::OFFICIAL;
+        } else if (std::strcmp(argv[i], "--flexible") == 0) {
+            bobail::g_rules_variant = bobail::RulesVariant::FLEXIBLE;
+        } else {
+            std::cerr << "Unknown option: " << argv[i] << "\n";
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (tablebase_path.empty() && pns_path.empty()) {
+        std::cerr << "Error: --tablebase and/or --pns is required\n";
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    // Initialize
+    bobail::init_move_tables();
+    bobail::init_zobrist();
+    bobail::init_symmetry();
+
+    if (!tablebase_path.empty() && !tablebase.open(tablebase_path)) {
+        std::cerr << "Failed to open tablebase: " << tablebase_path << "\n";
+        return 1;
+    }
+    if (!pns_path.empty() && !load_checkpoint(pns_path)) {
+        return 1;
+    }
+    eval_cache.reset(cache_entries);
+
+    g_listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if (g_listen_fd < 0) {
+        std::cerr << "Failed to create socket: " << std::strerror(errno) << "\n";
+        return 1;
+    }
+    int one = 1;
+    setsockopt(g_listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    if (bind(g_listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+        listen(g_listen_fd, SOMAXCONN) != 0) {
+        std::cerr << "Failed to listen on port " << port << ": " << std::strerror(errno) << "\n";
+        close(g_listen_fd);
+        return 1;
+    }
+
+    std::signal(SIGINT, handle_signal);
+    std::signal(SIGTERM, handle_signal);
+    std::signal(SIGPIPE, SIG_IGN);
+
+    std::cerr << "Bobail server listening on port " << port << " with " << num_threads << " threads\n";
+    std::cerr << "Test URL: http://localhost:" << port << "/lookup?pos=1f,1f00000,12,1\n";
+
+    {
+        Server server(g_listen_fd, num_threads);
+        if (!server.ok()) {
+            std::cerr << "Failed to set up epoll: " << std::strerror(errno) << "\n";
+            close(g_listen_fd);
+            return 1;
+        }
+        server.run();
+    }
+
+    close(g_listen_fd);
+    std::cerr << "Server stopped\n";
+    return 0;
+}
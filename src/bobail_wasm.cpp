@@ -0,0 +1,152 @@
+// C interface of the engine for the WebAssembly build (see the EMSCRIPTEN
+// section of CMakeLists.txt), used by docs/engine.js.
+//
+// Positions cross the boundary as the four numbers of the lookup format:
+// white pawn mask, black pawn mask, Bobail square and side to move (1 =
+// White). Moves are 3 bytes each (bobail_to, pawn_from, pawn_to), read
+// from bobail_moves() after bobail_generate_moves(). Lookups go to the
+// opening book first and then to the tablebase, both loaded from file
+// images the page copied into the module's memory with bobail_alloc().
+
+#include "board.h"
+#include "movegen.h"
+#include "hash.h"
+#include "symmetry.h"
+#include "opening_book.h"
+#include "tablebase.h"
+#include <emscripten/emscripten.h>
+#include <cstdint>
+#include <cstdlib>
+
+using namespace bobail;
+
+static_assert(sizeof(Move) == 3, "JS reads moves as 3-byte records");
+
+namespace {
+    MoveList moves;
+    uint32_t position_out[4];
+    // dtw, has move, bobail_to, pawn_from, pawn_to
+    int32_t probe_out[5];
+
+    OpeningBook book;
+    Tablebase tablebase;
+    void* tablebase_image = nullptr;  // Owned; the tablebase reads it in place
+
+    State make_state(uint32_t white_pawns, uint32_t black_pawns, int bobail_sq, int white_to_move) {
+        State s{};
+        s.white_pawns = white_pawns;
+        s.black_pawns = black_pawns;
+        s.bobail_sq = static_cast<uint8_t>(bobail_sq);
+        s.white_to_move = white_to_move != 0;
+        return s;
+    }
+
+    void set_position_out(const State& s) {
+        position_out[0] = s.white_pawns;
+        position_out[1] = s.black_pawns;
+        position_out[2] = s.bobail_sq;
+        position_out[3] = s.white_to_move ? 1 : 0;
+    }
+}
+
+extern "C" {
+
+// Call once before anything else; `official` selects the rules variant
+EMSCRIPTEN_KEEPALIVE void bobail_init(int official) {
+    g_rules_variant = official ? RulesVariant::OFFICIAL : RulesVariant::FLEXIBLE;
+    init_move_tables();
+    init_zobrist();
+    init_symmetry();
+}
+
+// Legal moves of the position; returns how many, see bobail_moves()
+EMSCRIPTEN_KEEPALIVE int bobail_generate_moves(uint32_t white_pawns, uint32_t black_pawns,
+                                               int bobail_sq, int white_to_move) {
+    generate_moves(make_state(white_pawns, black_pawns, bobail_sq, white_to_move), moves);
+    return static_cast<int>(moves.size());
+}
+
+// The moves of the last bobail_generate_moves(), 3 bytes each
+EMSCRIPTEN_KEEPALIVE const uint8_t* bobail_moves() {
+    return reinterpret_cast<const uint8_t*>(moves.begin());
+}
+
+// Play a move on the position; the result is in bobail_position()
+EMSCRIPTEN_KEEPALIVE void bobail_apply_move(uint32_t white_pawns, uint32_t black_pawns,
+                                            int bobail_sq, int white_to_move,
+                                            int bobail_to, int pawn_from, int pawn_to) {
+    Move m{static_cast<uint8_t>(bobail_to), static_cast<uint8_t>(pawn_from), static_cast<uint8_t>(pawn_to)};
+    set_position_out(apply_move(make_state(white_pawns, black_pawns, bobail_sq, white_to_move), m));
+}
+
+// Position written by bobail_apply_move(), in the four-number format
+EMSCRIPTEN_KEEPALIVE const uint32_t* bobail_position() {
+    return position_out;
+}
+
+// 0 while the game goes on, 1 if White has won, 2 if Black has
+EMSCRIPTEN_KEEPALIVE int bobail_game_over(uint32_t white_pawns, uint32_t black_pawns,
+                                          int bobail_sq, int white_to_move) {
+    switch (check_terminal(make_state(white_pawns, black_pawns, bobail_sq, white_to_move))) {
+        case GameResult::WHITE_WINS: return 1;
+        case GameResult::BLACK_WINS: return 2;
+        default: return 0;
+    }
+}
+
+// Memory for a file image; released by the loader it is passed to
+EMSCRIPTEN_KEEPALIVE void* bobail_alloc(size_t size) {
+    return std::malloc(size);
+}
+
+// The book keeps a copy, so the image is freed here
+EMSCRIPTEN_KEEPALIVE int bobail_load_book(void* data, size_t size) {
+    bool ok = book.open_buffer(data, size);
+    std::free(data);
+    return ok ? 1 : 0;
+}
+
+// The tablebase is probed in place, so the image is kept until replaced
+EMSCRIPTEN_KEEPALIVE int bobail_load_tablebase(void* data, size_t size) {
+    tablebase.close();
+    std::free(tablebase_image);
+    tablebase_image = data;
+    return tablebase.open_buffer(data, size) ? 1 : 0;
+}
+
+// Result for the side to move (Result: 1 win, -1 loss, 2 draw, 0 unknown);
+// DTW and the best move, when known, are in bobail_probe_info()
+EMSCRIPTEN_KEEPALIVE int bobail_probe(uint32_t white_pawns, uint32_t black_pawns,
+                                      int bobail_sq, int white_to_move) {
+    State s = make_state(white_pawns, black_pawns, bobail_sq, white_to_move);
+    uint8_t dtw = 0;
+    Move best{};
+    bool has_move = false;
+
+    Result r = Result::UNKNOWN;
+    if (book.is_open()) {
+        r = book.probe(s, dtw, &best);
+        has_move = r != Result::UNKNOWN && !(best == Move{});
+    }
+    if (r == Result::UNKNOWN && tablebase.is_open()) {
+        r = tablebase.probe(s, dtw);
+        if (r != Result::UNKNOWN && check_terminal(s) == GameResult::ONGOING) {
+            best = tablebase.best_move(s);
+            has_move = !(best == Move{});
+        }
+    }
+
+    probe_out[0] = dtw;
+    probe_out[1] = has_move ? 1 : 0;
+    probe_out[2] = best.bobail_to;
+    probe_out[3] = best.pawn_from;
+    probe_out[4] = best.pawn_to;
+    return static_cast<int>(r);
+}
+
+// dtw, has move, bobail_to, pawn_from, pawn_to of the last bobail_probe()
+EMSCRIPTEN_KEEPALIVE const int32_t* bobail_probe_info() {
+    return probe_out;
+}
+
+} // extern "C"
@@ -1,166 +1,439 @@
 // Practical Bobail engine for strong play against humans
-// Uses PNS checkpoint data + alpha-beta search
+// Uses PNS checkpoint data + alpha-beta search, and exact results from a
+// tablebase where one covers the position
 
 #include "board.h"
 #include "movegen.h"
 #include "hash.h"
 #include "symmetry.h"
+#include "pns_table.h"
+#include "result_cache.h"
+#include "search_tt.h"
+#include "tablebase.h"
+#ifdef HAS_ROCKSDB
+#include "retrograde_db.h"
+#endif
 #include <iostream>
-#include <fstream>
-#include <unordered_map>
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <chrono>
+#include <cstring>
+#include <filesystem>
 #include <limits>
+#include <memory>
 #include <sstream>
+#include <thread>
 
 namespace bobail {
 
-// PNS TT entry (must match pns_enhanced.cpp)
-struct PNSTTEntry {
-    uint64_t hash;
-    uint32_t proof;
-    uint32_t disproof;
-    uint8_t result;  // 0=unknown, 1=win, 2=loss, 3=draw
-};
-
 class BobailEngine {
 public:
-    BobailEngine() = default;
+    explicit BobailEngine(size_t tt_mb = 64, int threads = 1) : tt_(tt_mb) { set_threads(threads); }
+    ~BobailEngine() { stop_ponder(); }
+
+    // Threads searching each move (Lazy SMP); a request may use fewer
+    void set_threads(int threads) {
+        threads = std::max(1, threads);
+        while (static_cast<int>(workers_.size()) < threads) {
+            workers_.push_back(std::make_unique<Worker>());
+            workers_.back()->id = static_cast<int>(workers_.size()) - 1;
+        }
+        workers_.resize(threads);
+    }
+    int threads() const { return static_cast<int>(workers_.size()); }
 
     bool load_pns_data(const std::string& checkpoint_path) {
-        std::ifstream in(checkpoint_path, std::ios::binary);
-        if (!in) {
-            std::cerr << "Cannot open checkpoint: " << checkpoint_path << "\n";
-            return false;
-        }
+        if (!pns_table_.open(checkpoint_path)) return false;
+
+        std::cout << "Loaded " << pns_table_.size() << " entries\n";
+        std::cout << "  Proved: " << pns_table_.counters()[1] << "\n";
+        std::cout << "  Disproved: " << pns_table_.counters()[2] << "\n";
 
-        uint64_t magic, version, num_entries;
-        uint64_t nodes_searched, nodes_proved, nodes_disproved, retro_hits;
+        return true;
+    }
 
-        in.read(reinterpret_cast<char*>(&magic), sizeof(magic));
-        if (magic != 0x504E5343484B5054ULL) {
-            std::cerr << "Invalid checkpoint magic\n";
+    // Exact results from a tablebase file, or a solved retrograde database
+    // directory when built with RocksDB. Probed at the root and at nodes
+    // up to `probe_ply` plies below it, behind a cache of `cache_entries`.
+    bool load_tablebase(const std::string& path, int probe_ply = 8, size_t cache_entries = 1 << 20) {
+        if (std::filesystem::is_directory(path)) {
+#ifdef HAS_ROCKSDB
+            db_ = std::make_unique<RetrogradeSolverDB>();
+            if (!db_->open_readonly(path)) {
+                db_.reset();
+                return false;
+            }
+#else
+            std::cerr << path << " is a database directory, but this build has no RocksDB\n";
+            return false;
+#endif
+        } else if (tablebase_.open(path)) {
+            std::cout << "Tablebase: " << tablebase_.header().num_entries << " entries"
+                      << (tablebase_.has_dtw() ? " with DTW" : "") << "\n";
+        } else {
             return false;
         }
+        tb_probe_ply_ = probe_ply;
+        tb_cache_.reset(cache_entries);
+        return true;
+    }
 
-        in.read(reinterpret_cast<char*>(&version), sizeof(version));
-        in.read(reinterpret_cast<char*>(&num_entries), sizeof(num_entries));
-        in.read(reinterpret_cast<char*>(&nodes_searched), sizeof(nodes_searched));
-        in.read(reinterpret_cast<char*>(&nodes_proved), sizeof(nodes_proved));
-        in.read(reinterpret_cast<char*>(&nodes_disproved), sizeof(nodes_disproved));
-        in.read(reinterpret_cast<char*>(&retro_hits), sizeof(retro_hits));
-
-        std::cout << "Loading " << num_entries << " PNS entries...\n";
+    bool has_tablebase() const {
+#ifdef HAS_ROCKSDB
+        if (db_) return true;
+#endif
+        return tablebase_.is_open();
+    }
 
-        pns_table_.clear();
-        pns_table_.reserve(num_entries);
+    // Get best move for a position, searching with up to `max_threads`
+    // threads (0 = all of them)
+    Move get_best_move(const State& state, int time_ms = 5000, int max_threads = 0) {
+        stop_ponder();
+        stop_.store(false, std::memory_order_relaxed);
+        deadline_.store(std::chrono::steady_clock::now() + std::chrono::milliseconds(time_ms),
+                        std::memory_order_relaxed);
+        return search(state, max_threads);
+    }
 
-        for (uint64_t i = 0; i < num_entries; ++i) {
-            PNSTTEntry entry;
-            in.read(reinterpret_cast<char*>(&entry), sizeof(entry));
-            pns_table_[entry.hash] = entry;
+    // Pondering: search `state` in the background with no deadline, quietly,
+    // until ponderhit() or stop_ponder(). Everything it finds stays in the
+    // TT either way.
+    void start_ponder(const State& state, int max_threads = 0) {
+        stop_ponder();
+        stop_.store(false, std::memory_order_relaxed);
+        deadline_.store(std::chrono::steady_clock::time_point::max(), std::memory_order_relaxed);
+        pondering_.store(true, std::memory_order_relaxed);
+        ponder_thread_ = std::thread([this, state, max_threads] { ponder_move_ = search(state, max_threads); });
+    }
 
-            if ((i + 1) % 5000000 == 0) {
-                std::cout << "  Loaded " << (i + 1) / 1000000 << "M entries...\n";
-            }
-        }
+    // The pondered position came up: give the search `time_ms` more from
+    // now and wait for its move
+    Move ponderhit(int time_ms) {
+        deadline_.store(std::chrono::steady_clock::now() + std::chrono::milliseconds(time_ms),
+                        std::memory_order_relaxed);
+        pondering_.store(false, std::memory_order_relaxed);
+        if (ponder_thread_.joinable()) ponder_thread_.join();
+        return ponder_move_;
+    }
 
-        std::cout << "Loaded " << pns_table_.size() << " entries\n";
-        std::cout << "  Proved: " << nodes_proved << "\n";
-        std::cout << "  Disproved: " << nodes_disproved << "\n";
+    // Abandon the ponder search, if any
+    void stop_ponder() {
+        if (!ponder_thread_.joinable()) return;
+        stop_.store(true, std::memory_order_relaxed);
+        ponder_thread_.join();
+        pondering_.store(false, std::memory_order_relaxed);
+    }
 
-        return true;
+    bool pondering() const { return ponder_thread_.joinable(); }
+
+    // Best line from `state` as the TT has it, at most `max_len` moves
+    std::vector<Move> principal_variation(State state, int max_len = MAX_DEPTH) const {
+        std::vector<Move> pv;
+        SearchTTEntry entry;
+        while (static_cast<int>(pv.size()) < max_len && check_terminal(state) == GameResult::ONGOING &&
+               tt_.probe(position_hash(state), entry) && entry.has_move()) {
+            // A key collision can leave a move that is not legal here
+            Move move = entry.best_move();
+            auto moves = generate_moves(state);
+            if (std::find(moves.begin(), moves.end(), move) == moves.end()) break;
+            pv.push_back(move);
+            state = apply_move(state, move);
+        }
+        return pv;
     }
 
-    // Get best move for a position
-    Move get_best_move(const State& state, int time_ms = 5000) {
+    uint64_t nodes_searched() const { return nodes_searched_; }
+
+private:
+    // Search with the clock already set
+    Move search(const State& state, int max_threads) {
         nodes_searched_ = 0;
         auto start = std::chrono::steady_clock::now();
-        deadline_ = start + std::chrono::milliseconds(time_ms);
 
         auto moves = generate_moves(state);
         if (moves.empty()) return Move();
         if (moves.size() == 1) return moves[0];
+        bool quiet = pondering_.load(std::memory_order_relaxed);
 
-        Move best_move = moves[0];
-        int best_score = -INFINITY_SCORE;
+        Move tb_move;
+        if (tablebase_move(state, moves, tb_move)) return tb_move;
 
         // First, check if any move leads to a known win
         for (const auto& move : moves) {
             State child = apply_move(state, move);
             uint64_t child_hash = canonical_hash(child);
 
-            auto it = pns_table_.find(child_hash);
-            if (it != pns_table_.end()) {
+            const PNSSlot* entry = pns_table_.find(child_hash);
+            if (entry) {
                 // Result is from opponent's perspective after our move
-                if (it->second.result == 2) {  // Loss for opponent = win for us
-                    std::cout << "Found forced win: " << move.to_string() << "\n";
+                if (entry->result() == 2) {  // Loss for opponent = win for us
+                    if (!quiet) std::cout << "Found forced win: " << move.to_string() << "\n";
                     return move;
                 }
             }
         }
 
-        // Iterative deepening
-        for (int depth = 1; depth <= 30; ++depth) {
+        int num_threads = threads();
+        if (max_threads > 0) num_threads = std::min(num_threads, max_threads);
+        active_threads_ = num_threads;
+        tt_.new_search();
+        for (int i = 0; i < num_threads; ++i) workers_[i]->new_search();
+
+        // A search of an earlier move may have left a best move for this
+        // position in the TT
+        SearchTTEntry root_entry;
+        bool have_root_entry = tt_.probe(position_hash(state), root_entry) && root_entry.has_move();
+        order_moves(*workers_[0], state, 0, moves, have_root_entry ? &root_entry : nullptr);
+
+        // Lazy SMP: the helpers search the same root and share the TT,
+        // filling it with results the main thread then finds ready
+        std::vector<std::thread> helpers;
+        for (int i = 1; i < num_threads; ++i) {
+            helpers.emplace_back([this, &state, &moves, start, i] { iterate(*workers_[i], state, moves, start); });
+        }
+        iterate(*workers_[0], state, moves, start);
+        stop_.store(true, std::memory_order_relaxed);
+        for (auto& helper : helpers) helper.join();
+
+        // A found win first, then the deepest completed iteration; the
+        // main thread wins ties
+        const Worker* best = workers_[0].get();
+        for (int i = 1; i < num_threads; ++i) {
+            const Worker& w = *workers_[i];
+            bool w_wins = w.completed_depth > 0 && w.best_score > WIN_THRESHOLD;
+            bool best_wins = best->completed_depth > 0 && best->best_score > WIN_THRESHOLD;
+            if ((w_wins && !best_wins) || (w_wins == best_wins && w.completed_depth > best->completed_depth)) {
+                best = &w;
+            }
+        }
+        nodes_searched_ = total_nodes();
+        if (num_threads > 1 && !pondering_.load(std::memory_order_relaxed)) {
+            std::cout << "Threads " << num_threads << ": depth " << best->completed_depth << " from thread "
+                      << best->id << ", nodes=" << nodes_searched_ << "\n";
+        }
+
+        return best->completed_depth > 0 ? best->best_move : moves[0];
+    }
+
+    static constexpr int INFINITY_SCORE = 100000;
+    static constexpr int WIN_SCORE = 99000;
+    static constexpr int LOSS_SCORE = -99000;
+    static constexpr int WIN_THRESHOLD = 90000;  // Below every WIN_SCORE - dtw
+    static constexpr int MAX_DEPTH = 30;
+    static constexpr int MAX_PLY = MAX_DEPTH + 2;
+
+    // Move ordering bonuses, above the PNS heuristic's +-10000 range
+    static constexpr int PROVED_WIN_ORDER = 4000000;
+    static constexpr int TT_MOVE_ORDER = 3000000;
+    static constexpr int KILLER_ORDER = 1000000;
+    static constexpr int PROVED_LOSS_ORDER = -1000000;
+    static constexpr int HISTORY_MAX = 10000;
+
+    // History counters are indexed by side to move and the whole move
+    static constexpr size_t MOVE_INDICES = NUM_SQUARES * NUM_SQUARES * NUM_SQUARES;
+    static constexpr Move NO_KILLER{NUM_SQUARES, NUM_SQUARES, NUM_SQUARES};
+
+    // Search state of one thread; only the TT is shared
+    struct Worker {
+        int id = 0;
+        std::atomic<uint64_t> nodes{0};  // Read by the main thread for reports
+
+        // Two quiet moves per ply that recently caused a beta cutoff
+        std::array<std::array<Move, 2>, MAX_PLY> killers;
+        std::array<std::array<int, MOVE_INDICES>, 2> history{};
+
+        // Last completed iteration
+        int completed_depth = 0;
+        int best_score = -INFINITY_SCORE;
+        Move best_move{};
+        uint64_t tb_hits = 0;
+
+        void new_search() {
+            nodes.store(0, std::memory_order_relaxed);
+            tb_hits = 0;
+            completed_depth = 0;
+            best_score = -INFINITY_SCORE;
+            for (auto& ply : killers) ply.fill(NO_KILLER);
+            // Keep what the history learned, but let this search outweigh it
+            for (auto& side : history) {
+                for (int& h : side) h /= 2;
+            }
+        }
+
+        void count_node() { nodes.store(nodes.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed); }
+    };
+
+    PNSTableFile pns_table_;
+    Tablebase tablebase_;
+#ifdef HAS_ROCKSDB
+    std::unique_ptr<RetrogradeSolverDB> db_;
+#endif
+    ResultCache tb_cache_;  // Keyed by canonical packed state
+    int tb_probe_ply_ = 0;
+    SearchTT tt_;
+    std::vector<std::unique_ptr<Worker>> workers_;
+    uint64_t nodes_searched_ = 0;
+    // Moved by ponderhit() while the search runs
+    std::atomic<std::chrono::steady_clock::time_point> deadline_{};
+    std::atomic<bool> stop_{false};
+    std::atomic<bool> pondering_{false};  // Keeps the search quiet
+    std::thread ponder_thread_;
+    Move ponder_move_{};
+    int active_threads_ = 1;  // Threads in the current search
+
+    bool time_up() const {
+        return stop_.load(std::memory_order_relaxed) ||
+               std::chrono::steady_clock::now() >= deadline_.load(std::memory_order_relaxed);
+    }
+
+    // Result for the side to move; UNKNOWN if no tablebase has it
+    Result probe_tablebase(const State& state, uint8_t& dtw) {
+        uint64_t key = canonical_pack(state);
+        CachedResult r;
+        if (!tb_cache_.find(key, r)) {
+            if (tablebase_.is_open()) {
+                r.result = tablebase_.probe(state, r.dtw);
+            }
+#ifdef HAS_ROCKSDB
+            else if (db_) {
+                r.result = db_->get_result(state, r.dtw);
+            }
+#endif
+            tb_cache_.insert(key, r);
+        }
+        dtw = r.dtw;
+        return r.result;
+    }
+
+    // Faster wins and slower losses score better
+    static int tablebase_score(Result result, uint8_t dtw) {
+        if (result == Result::WIN) return WIN_SCORE - dtw;
+        if (result == Result::LOSS) return LOSS_SCORE + dtw;
+        return 0;
+    }
+
+    // Decide the root from the tablebase alone when it knows every child
+    bool tablebase_move(const State& state, const std::vector<Move>& moves, Move& best) {
+        uint8_t dtw;
+        if (!has_tablebase() || probe_tablebase(state, dtw) == Result::UNKNOWN) return false;
+
+        int best_score = -INFINITY_SCORE;
+        for (const auto& move : moves) {
+            State child = apply_move(state, move);
+            int score;
+            GameResult gr = check_terminal(child);
+            if (gr != GameResult::ONGOING) {
+                bool mover_wins = (gr == GameResult::WHITE_WINS) == state.white_to_move;
+                score = mover_wins ? WIN_SCORE : LOSS_SCORE;
+            } else {
+                uint8_t child_dtw;
+                Result r = probe_tablebase(child, child_dtw);
+                if (r == Result::UNKNOWN) return false;
+                score = -tablebase_score(r, child_dtw);
+            }
+            if (score > best_score) {
+                best_score = score;
+                best = move;
+            }
+        }
+        if (!pondering_.load(std::memory_order_relaxed)) {
+            std::cout << "Tablebase: score=" << best_score << " " << best.to_string() << "\n";
+        }
+        return true;
+    }
+
+    uint64_t total_nodes() const {
+        uint64_t total = 0;
+        for (int i = 0; i < active_threads_; ++i) total += workers_[i]->nodes.load(std::memory_order_relaxed);
+        return total;
+    }
+
+    // Iterative deepening from the root on one thread. Helpers vary it so
+    // they do not all walk the same tree in lockstep: odd ones start a ply
+    // deeper, and each tries the root moves after the first in a rotated
+    // order.
+    void iterate(Worker& w, const State& state, std::vector<Move> moves,
+                 std::chrono::steady_clock::time_point start) {
+        if (w.id > 0 && moves.size() > 2) {
+            size_t shift = static_cast<size_t>(w.id) % (moves.size() - 1);
+            std::rotate(moves.begin() + 1, moves.begin() + 1 + shift, moves.end());
+        }
+
+        const uint64_t key = position_hash(state);
+        for (int depth = 1 + (w.id & 1); depth <= MAX_DEPTH; ++depth) {
             int alpha = -INFINITY_SCORE;
             int beta = INFINITY_SCORE;
-            Move iter_best = moves[0];
+            size_t iter_best = 0;
             int iter_score = -INFINITY_SCORE;
 
-            // Sort moves by previous iteration's scores
-            for (const auto& move : moves) {
+            for (size_t i = 0; i < moves.size(); ++i) {
                 if (time_up()) break;
 
-                State child = apply_move(state, move);
-                int score = -alpha_beta(child, depth - 1, -beta, -alpha);
+                State child = apply_move(state, moves[i]);
+                uint64_t child_key = position_hash_after(key, state, moves[i], child);
+                int score = -alpha_beta(w, child, child_key, depth - 1, 1, -beta, -alpha);
 
                 if (score > iter_score) {
                     iter_score = score;
-                    iter_best = move;
+                    iter_best = i;
                 }
                 if (score > alpha) {
                     alpha = score;
                 }
             }
 
-            if (!time_up()) {
-                best_move = iter_best;
-                best_score = iter_score;
+            if (time_up()) break;
+
+            // The best move of this iteration is searched first in the next
+            std::rotate(moves.begin(), moves.begin() + iter_best, moves.begin() + iter_best + 1);
+            w.best_move = moves[0];
+            w.best_score = iter_score;
+            w.completed_depth = depth;
+            tt_.store(key, iter_score, depth, Bound::EXACT, &moves[0]);
 
+            if (w.id == 0 && !pondering_.load(std::memory_order_relaxed)) {
                 auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
                     std::chrono::steady_clock::now() - start).count();
-                std::cout << "Depth " << depth << ": " << best_move.to_string()
-                          << " score=" << best_score
-                          << " nodes=" << nodes_searched_
-                          << " time=" << elapsed << "ms\n";
+                std::cout << "Depth " << depth << ": " << w.best_move.to_string()
+                          << " score=" << w.best_score
+                          << " nodes=" << total_nodes()
+                          << " hashfull=" << tt_.hashfull();
+                if (has_tablebase()) std::cout << " tbhits=" << w.tb_hits;
+                std::cout << " time=" << elapsed << "ms\n";
+            }
 
-                // If we found a winning score, stop
-                if (best_score > 90000) break;
-            } else {
+            // If we found a winning score, stop
+            if (iter_score > WIN_THRESHOLD) {
+                stop_.store(true, std::memory_order_relaxed);
                 break;
             }
         }
-
-        return best_move;
     }
 
-    uint64_t nodes_searched() const { return nodes_searched_; }
-
-private:
-    static constexpr int INFINITY_SCORE = 100000;
-    static constexpr int WIN_SCORE = 99000;
-    static constexpr int LOSS_SCORE = -99000;
-
-    std::unordered_map<uint64_t, PNSTTEntry> pns_table_;
-    uint64_t nodes_searched_ = 0;
-    std::chrono::steady_clock::time_point deadline_;
+    static size_t move_index(const Move& m) {
+        return (static_cast<size_t>(m.bobail_to) * NUM_SQUARES + m.pawn_from) * NUM_SQUARES + m.pawn_to;
+    }
 
-    bool time_up() const {
-        return std::chrono::steady_clock::now() >= deadline_;
+    // A move caused a beta cutoff: remember it as a killer and in the history
+    static void record_cutoff(Worker& w, const State& state, int ply, const Move& move, int depth) {
+        auto& killers = w.killers[ply];
+        if (!(killers[0] == move)) {
+            killers[1] = killers[0];
+            killers[0] = move;
+        }
+        int& h = w.history[state.white_to_move][move_index(move)];
+        h += depth * depth;
+        if (h > HISTORY_MAX) {
+            for (auto& side : w.history) {
+                for (int& v : side) v /= 2;
+            }
+        }
     }
 
-    int alpha_beta(const State& state, int depth, int alpha, int beta) {
-        ++nodes_searched_;
+    // `key` is position_hash(state)
+    int alpha_beta(Worker& w, const State& state, uint64_t key, int depth, int ply, int alpha, int beta) {
+        w.count_node();
 
         // Check terminal
         GameResult gr = check_terminal(state);
@@ -173,52 +446,82 @@ private:
             }
         }
 
+        // Tablebase results are exact, so they end the search here
+        if (ply <= tb_probe_ply_ && has_tablebase()) {
+            uint8_t dtw;
+            Result r = probe_tablebase(state, dtw);
+            if (r != Result::UNKNOWN) {
+                ++w.tb_hits;
+                return tablebase_score(r, dtw);
+            }
+        }
+
         // Check PNS table
         uint64_t hash = canonical_hash(state);
-        auto it = pns_table_.find(hash);
-        if (it != pns_table_.end()) {
-            const auto& entry = it->second;
-
+        if (const PNSSlot* entry = pns_table_.find(hash)) {
             // Known result
-            if (entry.result == 1) return WIN_SCORE;   // Win
-            if (entry.result == 2) return LOSS_SCORE;  // Loss
-            if (entry.result == 3) return 0;           // Draw
+            if (entry->result() == 1) return WIN_SCORE;   // Win
+            if (entry->result() == 2) return LOSS_SCORE;  // Loss
+            if (entry->result() == 3) return 0;           // Draw
 
             // Use PN/DN as heuristic for leaf evaluation
             if (depth <= 0 || time_up()) {
-                return pn_dn_eval(entry.proof, entry.disproof);
+                return pn_dn_eval(entry->proof(), entry->disproof());
             }
         } else if (depth <= 0 || time_up()) {
             // No PNS data, use simple evaluation
             return evaluate(state);
         }
 
+        // Search TT: a deep enough result answers the node outright, and a
+        // best move is tried first either way
+        SearchTTEntry tt_entry;
+        bool tt_hit = tt_.probe(key, tt_entry);
+        if (tt_hit && tt_entry.depth >= depth) {
+            if (tt_entry.bound() == Bound::EXACT) return tt_entry.score;
+            if (tt_entry.bound() == Bound::LOWER && tt_entry.score >= beta) return tt_entry.score;
+            if (tt_entry.bound() == Bound::UPPER && tt_entry.score <= alpha) return tt_entry.score;
+        }
+
         auto moves = generate_moves(state);
         if (moves.empty()) {
             return LOSS_SCORE;  // No moves = loss
         }
 
-        // Sort moves by PNS heuristic
-        sort_moves(state, moves);
+        order_moves(w, state, ply, moves, tt_hit && tt_entry.has_move() ? &tt_entry : nullptr);
 
+        int original_alpha = alpha;
         int best_score = -INFINITY_SCORE;
-        for (const auto& move : moves) {
+        size_t best = 0;
+        for (size_t i = 0; i < moves.size(); ++i) {
             if (time_up()) break;
 
-            State child = apply_move(state, move);
-            int score = -alpha_beta(child, depth - 1, -beta, -alpha);
+            State child = apply_move(state, moves[i]);
+            uint64_t child_key = position_hash_after(key, state, moves[i], child);
+            int score = -alpha_beta(w, child, child_key, depth - 1, ply + 1, -beta, -alpha);
 
             if (score > best_score) {
                 best_score = score;
+                best = i;
             }
             if (score > alpha) {
                 alpha = score;
             }
             if (alpha >= beta) {
+                record_cutoff(w, state, ply, moves[i], depth);
                 break;  // Beta cutoff
             }
         }
 
+        // A search cut short by the clock is not worth keeping
+        if (time_up()) return best_score;
+
+        if (best_score <= original_alpha) {
+            // Failed low: no move is known to be best
+            tt_.store(key, best_score, depth, Bound::UPPER, nullptr);
+        } else {
+            tt_.store(key, best_score, depth, best_score >= beta ? Bound::LOWER : Bound::EXACT, &moves[best]);
+        }
         return best_score;
     }
 
@@ -257,32 +560,47 @@ private:
         return state.white_to_move ? score : -score;
     }
 
-    // Sort moves by PNS heuristic
-    void sort_moves(const State& state, std::vector<Move>& moves) const {
+    // Order moves: proved wins, the TT move, killers, then the PNS
+    // heuristic plus history, and proved losses last
+    void order_moves(const Worker& w, const State& state, int ply, std::vector<Move>& moves,
+                     const SearchTTEntry* tt_entry) const {
         std::vector<std::pair<int, Move>> scored_moves;
         scored_moves.reserve(moves.size());
 
+        uint16_t tt_move = tt_entry ? tt_entry->move : SearchTTEntry::NO_MOVE;
+        const auto& killers = w.killers[ply];
+        const auto& history = w.history[state.white_to_move];
+
         for (const auto& move : moves) {
             State child = apply_move(state, move);
             uint64_t child_hash = canonical_hash(child);
 
-            int score = 0;
-            auto it = pns_table_.find(child_hash);
-            if (it != pns_table_.end()) {
+            int score = history[move_index(move)];
+            const PNSSlot* entry = pns_table_.find(child_hash);
+            if (entry) {
                 // Result is from opponent's perspective
-                if (it->second.result == 2) {
-                    score = 1000000;  // Forces opponent loss = our win
-                } else if (it->second.result == 1) {
-                    score = -1000000;  // Gives opponent win = our loss
+                if (entry->result() == 2) {
+                    score = PROVED_WIN_ORDER;  // Forces opponent loss = our win
+                } else if (entry->result() == 1) {
+                    score = PROVED_LOSS_ORDER;  // Gives opponent win = our loss
                 } else {
                     // Use inverted PN/DN (opponent's PN is our DN)
-                    score = -pn_dn_eval(it->second.proof, it->second.disproof);
+                    score -= pn_dn_eval(entry->proof(), entry->disproof());
+                }
+            }
+            if (score < PROVED_WIN_ORDER && score > PROVED_LOSS_ORDER) {
+                if (SearchTTEntry::pack_move(move) == tt_move) {
+                    score = TT_MOVE_ORDER;
+                } else if (move == killers[0]) {
+                    score = KILLER_ORDER;
+                } else if (move == killers[1]) {
+                    score = KILLER_ORDER - 1;
                 }
             }
             scored_moves.push_back({score, move});
         }
 
-        std::sort(scored_moves.begin(), scored_moves.end(),
+        std::stable_sort(scored_moves.begin(), scored_moves.end(),
                   [](const auto& a, const auto& b) { return a.first > b.first; });
 
         for (size_t i = 0; i < moves.size(); ++i) {
@@ -291,6 +609,69 @@ private:
     }
 };
 
+// One game against the engine. The engine already keeps its TT and move
+// ordering history from one move to the next; the session also keeps the
+// principal variation of its last search and, while the opponent thinks,
+// ponders the position after the reply that line expects.
+class GameSession {
+public:
+    explicit GameSession(BobailEngine& engine, bool ponder = true) : engine_(engine), ponder_(ponder) {}
+    ~GameSession() { engine_.stop_ponder(); }
+
+    const State& state() const { return state_; }
+    const std::vector<Move>& principal_variation() const { return pv_; }
+
+    void new_game() {
+        engine_.stop_ponder();
+        ponder_hit_ = false;
+        pv_.clear();
+        state_ = State::starting_position();
+    }
+
+    // A move made outside the engine, usually the opponent's
+    void play(const Move& move) {
+        if (engine_.pondering()) {
+            if (!ponder_hit_ && pv_.size() > 1 && move == pv_[1]) {
+                ponder_hit_ = true;  // The search already runs on the new position
+            } else {
+                engine_.stop_ponder();
+                ponder_hit_ = false;
+            }
+        }
+        state_ = apply_move(state_, move);
+    }
+
+    // Let the engine pick a move and play it. With `ponder`, it then goes
+    // on thinking about the expected reply.
+    Move go(int time_ms, int max_threads = 0, bool ponder = true) {
+        Move move;
+        if (ponder_hit_) {
+            std::cout << "Ponder hit\n";
+            move = engine_.ponderhit(time_ms);
+            ponder_hit_ = false;
+        } else {
+            move = engine_.get_best_move(state_, time_ms, max_threads);
+        }
+
+        pv_ = engine_.principal_variation(state_);
+        if (pv_.empty() || !(pv_[0] == move)) pv_.assign(1, move);
+        state_ = apply_move(state_, move);
+
+        if (ponder && ponder_ && pv_.size() > 1 && check_terminal(state_) == GameResult::ONGOING) {
+            State expected = apply_move(state_, pv_[1]);
+            if (check_terminal(expected) == GameResult::ONGOING) engine_.start_ponder(expected, max_threads);
+        }
+        return move;
+    }
+
+private:
+    BobailEngine& engine_;
+    bool ponder_;
+    bool ponder_hit_ = false;  // The opponent played pv_[1]
+    State state_ = State::starting_position();
+    std::vector<Move> pv_;  // From the position before the engine's last move
+};
+
 }  // namespace bobail
 
 void print_board(const bobail::State& state) {
@@ -319,27 +700,52 @@ int main(int argc, char* argv[]) {
     bobail::init_zobrist();
     bobail::init_symmetry();
 
-    bobail::BobailEngine engine;
-
-    // Load PNS data
+    // Usage: bobail_play [CHECKPOINT] [--threads N] [--hash MB] [--no-ponder]
+    //                   [--tablebase PATH] [--tb-depth PLIES] [--tb-cache N]
     std::string checkpoint = "/workspace/pns_checkpoint.bin";
-    if (argc > 1) {
-        checkpoint = argv[1];
+    std::string tablebase_path;
+    int threads = 1;
+    size_t hash_mb = 64;
+    int tb_depth = 8;
+    size_t tb_cache = 1 << 20;
+    bool ponder = true;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = std::max(1, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--hash") == 0 && i + 1 < argc) {
+            hash_mb = std::max(1, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--tablebase") == 0 && i + 1 < argc) {
+            tablebase_path = argv[++i];
+        } else if (strcmp(argv[i], "--tb-depth") == 0 && i + 1 < argc) {
+            tb_depth = std::max(0, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--tb-cache") == 0 && i + 1 < argc) {
+            tb_cache = std::stoull(argv[++i]);
+        } else if (strcmp(argv[i], "--no-ponder") == 0) {
+            ponder = false;
+        } else {
+            checkpoint = argv[i];
+        }
     }
 
+    bobail::BobailEngine engine(hash_mb, threads);
+
     std::cout << "Bobail Engine v1.0\n";
     std::cout << "==================\n\n";
 
     if (!engine.load_pns_data(checkpoint)) {
         std::cout << "Warning: No PNS data loaded, using pure alpha-beta\n";
     }
+    if (!tablebase_path.empty() && !engine.load_tablebase(tablebase_path, tb_depth, tb_cache)) {
+        std::cout << "Warning: Cannot open tablebase " << tablebase_path << "\n";
+    }
 
-    bobail::State state = bobail::State::starting_position();
+    bobail::GameSession session(engine, ponder);
+    const bobail::State& state = session.state();
 
     std::cout << "\nCommands:\n";
     std::cout << "  moves             - Show all legal moves\n";
     std::cout << "  play <n>          - Play move number n from the list\n";
-    std::cout << "  go [time_ms]      - Let engine play (default 5000ms)\n";
+    std::cout << "  go [time_ms] [threads] - Let engine play (default 5000ms, all threads)\n";
     std::cout << "  auto              - Engine plays both sides\n";
     std::cout << "  new               - New game\n";
     std::cout << "  quit              - Exit\n\n";
@@ -355,7 +761,7 @@ int main(int argc, char* argv[]) {
         if (cmd == "quit" || cmd == "exit") {
             break;
         } else if (cmd == "new") {
-            state = bobail::State::starting_position();
+            session.new_game();
             print_board(state);
         } else if (cmd == "moves") {
             auto legal_moves = bobail::generate_moves(state);
@@ -370,7 +776,7 @@ int main(int argc, char* argv[]) {
             if (n >= 1 && n <= (int)legal_moves.size()) {
                 auto move = legal_moves[n - 1];
                 std::cout << "Playing: " << move.to_string() << "\n";
-                state = bobail::apply_move(state, move);
+                session.play(move);
                 print_board(state);
 
                 auto gr = bobail::check_terminal(state);
@@ -384,7 +790,8 @@ int main(int argc, char* argv[]) {
             }
         } else if (cmd == "go") {
             int time_ms = 5000;
-            iss >> time_ms;
+            int max_threads = 0;
+            iss >> time_ms >> max_threads;
 
             auto legal_moves = bobail::generate_moves(state);
             if (legal_moves.empty()) {
@@ -392,9 +799,11 @@ int main(int argc, char* argv[]) {
                 continue;
             }
 
-            auto move = engine.get_best_move(state, time_ms);
+            auto move = session.go(time_ms, max_threads);
             std::cout << "Best move: " << move.to_string() << "\n";
-            state = bobail::apply_move(state, move);
+            std::cout << "PV:";
+            for (const auto& m : session.principal_variation()) std::cout << " " << m.to_string();
+            std::cout << "\n";
             print_board(state);
 
             auto gr = bobail::check_terminal(state);
@@ -422,10 +831,10 @@ int main(int argc, char* argv[]) {
                     break;
                 }
 
-                auto move = engine.get_best_move(state, 2000);
-                std::cout << (state.white_to_move ? "White" : "Black")
+                bool white = state.white_to_move;
+                auto move = session.go(2000, 0, false);
+                std::cout << (white ? "White" : "Black")
                           << " plays: " << move.to_string() << "\n";
-                state = bobail::apply_move(state, move);
                 print_board(state);
             }
         } else if (!cmd.empty()) {
@@ -3,22 +3,29 @@
 #include "hash.h"
 #include "symmetry.h"
 #include "retrograde_db.h"
+#include "opening_book.h"
 #include <iostream>
 #include <fstream>
-#include <queue>
-#include <unordered_set>
+#include <algorithm>
+#include <vector>
 #include <string>
 #include <cstring>
+#include <thread>
 
-// Export opening book from solved database to JSON format
-// The JSON maps position strings to evaluation data
+// Export the opening book from a solved database, either as the compact
+// binary format of opening_book.h or as JSON mapping position strings to
+// evaluation data. Positions are stored once per mirror pair, under the
+// canonical one.
 
 void print_usage(const char* prog) {
     std::cerr << "Usage: " << prog << " [options]\n"
               << "Options:\n"
               << "  --db PATH           Database directory (required)\n"
-              << "  --output FILE       Output JSON file (required)\n"
+              << "  --output FILE       Output file (required)\n"
+              << "  --format FMT        json (default) or binary\n"
               << "  --depth N           Maximum ply depth to export (default: 20)\n"
+              << "  --threads N         Threads expanding each level (default: all cores)\n"
+              << "  --cache-entries N   Results kept in memory between lookups (default: 1000000)\n"
               << "  --official          Use Official rules (pawns must move max distance) [default]\n"
               << "  --flexible          Use Flexible rules (pawns can stop anywhere)\n"
               << "  --help              Show this help\n";
@@ -38,7 +45,10 @@ std::string state_to_key(const bobail::State& s) {
 int main(int argc, char* argv[]) {
     std::string db_path;
     std::string output_file;
+    std::string format = "json";
     int max_depth = 20;
+    int num_threads = std::max(1u, std::thread::hardware_concurrency());
+    size_t cache_entries = 1000000;
 
     // Parse arguments
     for (int i = 1; i < argc; ++i) {
@@ -59,6 +69,24 @@ int main(int argc, char* argv[]) {
                 std::cerr << "Error: --output requires a filename\n";
                 return 1;
             }
+        } else if (std::strcmp(argv[i], "--format") == 0) {
+            if (i + 1 < argc) {
+                format = argv[++i];
+            } else {
+                std::cerr << "Error: --format requires json or binary\n";
+                return 1;
+            }
+            if (format != "json" && format != "binary") {
+                std::cerr << "Error: unknown format " << format << "\n";
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--threads") == 0) {
+            if (i + 1 < argc) {
+                num_threads = std::max(1, std::stoi(argv[++i]));
+            } else {
+                std::cerr << "Error: --threads requires a number\n";
+                return 1;
+            }
         } else if (std::strcmp(argv[i], "--depth") == 0) {
             if (i + 1 < argc) {
                 max_depth = std::stoi(argv[++i]);
@@ -66,6 +94,13 @@ int main(int argc, char* argv[]) {
                 std::cerr << "Error: --depth requires a number\n";
                 return 1;
             }
+        } else if (std::strcmp(argv[i], "--cache-entries") == 0) {
+            if (i + 1 < argc) {
+                cache_entries = std::stoull(argv[++i]);
+            } else {
+                std::cerr << "Error: --cache-entries requires a number\n";
+                return 1;
+            }
         } else if (std::strcmp(argv[i], "--official") == 0) {
             bobail::g_rules_variant = bobail::RulesVariant::OFFICIAL;
         } else if (std::strcmp(argv[i], "--flexible") == 0) {
@@ -98,10 +133,13 @@ int main(int argc, char* argv[]) {
 
     // Open solver database
     bobail::RetrogradeSolverDB solver;
-    if (!solver.open(db_path)) {
+    if (!solver.open_readonly(db_path)) {
         std::cerr << "Failed to open database: " << db_path << "\n";
         return 1;
     }
+    // Children already in the book are looked up again by their other
+    // parents
+    solver.set_result_cache_capacity(cache_entries);
 
     std::cout << "Database opened. Total states: " << solver.num_states() << "\n";
     std::cout << "Starting position result: ";
@@ -113,80 +151,55 @@ int main(int argc, char* argv[]) {
         default: std::cout << "UNKNOWN\n"; break;
     }
 
-    // BFS to explore positions up to max_depth
-    struct QueueEntry {
-        bobail::State state;
-        int depth;
-    };
-
-    std::queue<QueueEntry> queue;
-    std::unordered_set<uint64_t> visited;
-
-    auto start = bobail::State::starting_position();
-    queue.push({start, 0});
-    visited.insert(bobail::pack_state(bobail::canonicalize(start).first));
-
-    std::ofstream out(output_file);
-    if (!out) {
-        std::cerr << "Failed to open output file: " << output_file << "\n";
-        return 1;
-    }
-
-    out << "{\n";
-    bool first = true;
-    uint64_t exported = 0;
-
-    std::cout << "Exporting positions...\n";
-
-    while (!queue.empty()) {
-        auto [state, depth] = queue.front();
-        queue.pop();
-
-        // Get evaluation for this position
-        bobail::Result result = solver.get_result(state);
-
-        // Output position
-        if (!first) out << ",\n";
-        first = false;
-
-        out << "  \"" << state_to_key(state) << "\": {";
-        out << "\"r\":" << static_cast<int>(result);
-
-        // For non-terminal positions, also output best move
-        if (result != bobail::Result::UNKNOWN) {
-            bobail::Move best = solver.get_best_move(state);
-            out << ",\"b\":[" << static_cast<int>(best.bobail_to) << ","
-                << static_cast<int>(best.pawn_from) << ","
-                << static_cast<int>(best.pawn_to) << "]";
+    bool has_dtw = solver.has_dtw();
+    std::vector<bobail::BookEntry> entries = bobail::collect_opening_book(
+        [&solver](std::span<const bobail::State> states, std::vector<uint8_t>& dtw) {
+            return solver.get_results(states, &dtw);
+        },
+        max_depth, num_threads,
+        [](int depth, uint64_t positions) {
+            std::cout << "\rDepth " << depth << ": " << positions << " positions   " << std::flush;
+        });
+    uint64_t exported = entries.size();
+
+    if (format == "binary") {
+        if (!bobail::write_opening_book(output_file, entries, has_dtw)) {
+            return 1;
         }
-        out << "}";
+    } else {
+        std::sort(entries.begin(), entries.end(),
+                  [](const bobail::BookEntry& a, const bobail::BookEntry& b) { return a.key < b.key; });
 
-        exported++;
-        if (exported % 10000 == 0) {
-            std::cout << "\rExported: " << exported << " positions (depth " << depth << ", queue: " << queue.size() << ")   " << std::flush;
+        std::ofstream out(output_file);
+        if (!out) {
+            std::cerr << "Failed to open output file: " << output_file << "\n";
+            return 1;
         }
 
-        // Expand children if not at max depth
-        if (depth < max_depth) {
-            auto moves = bobail::generate_moves(state);
-            for (const auto& move : moves) {
-                bobail::State next = bobail::apply_move(state, move);
-                uint64_t packed = bobail::pack_state(bobail::canonicalize(next).first);
-
-                if (visited.find(packed) == visited.end()) {
-                    visited.insert(packed);
-                    queue.push({next, depth + 1});
-                }
+        out << "{\n";
+        for (size_t i = 0; i < entries.size(); ++i) {
+            const bobail::BookEntry& e = entries[i];
+            if (i > 0) out << ",\n";
+            out << "  \"" << state_to_key(bobail::unpack_state(e.key)) << "\": {";
+            out << "\"r\":" << static_cast<int>(e.result);
+            if (has_dtw && (e.result == bobail::Result::WIN || e.result == bobail::Result::LOSS)) {
+                out << ",\"d\":" << static_cast<int>(e.dtw);
+            }
+            if (e.has_move) {
+                out << ",\"b\":[" << static_cast<int>(e.best.bobail_to) << ","
+                    << static_cast<int>(e.best.pawn_from) << ","
+                    << static_cast<int>(e.best.pawn_to) << "]";
             }
+            out << "}";
         }
+        out << "\n}\n";
     }
 
-    out << "\n}\n";
-    out.close();
-
     std::cout << "\n\nExport complete!\n";
     std::cout << "Total positions exported: " << exported << "\n";
     std::cout << "Output file: " << output_file << "\n";
+    bobail::ResultCache::Stats cache = solver.result_cache_stats();
+    std::cout << "Result cache: " << cache.hits << " hits, " << cache.misses << " misses\n";
 
     solver.close();
     return 0;
@@ -0,0 +1,225 @@
+#include "board.h"
+#include "movegen.h"
+#include "hash.h"
+#include "symmetry.h"
+#include "rank.h"
+#include "retrograde_db.h"
+#include "retrograde_bitmap.h"
+#include "tablebase.h"
+#include <iostream>
+#include <string>
+#include <cstring>
+#include <sys/mman.h>
+
+// Export a solved database to a single immutable tablebase file
+// (see tablebase.h) for the lookup tools and servers
+
+void print_usage(const char* prog) {
+    std::cerr << "Usage: " << prog << " [options]\n"
+              << "Options:\n"
+              << "  --db PATH           Solved RocksDB database directory\n"
+              << "  --bitmap PATH       Solved bitmap engine directory (instead of --db)\n"
+              << "  --output FILE       Output tablebase file (required)\n"
+              << "  --format FORMAT     sorted (rank-sorted entries with DTW) or bitmap\n"
+              << "                      (2 bits per rank index) [default: sorted for --db,\n"
+              << "                      bitmap for --bitmap]\n"
+              << "  --official          Use Official rules [default]\n"
+              << "  --flexible          Use Flexible rules\n"
+              << "  --help              Show this help\n";
+}
+
+namespace {
+
+// Rank-indexed 2-bit cells in anonymous memory: untouched pages stay
+// unallocated, so only the slices that hold positions cost memory
+class CellArray {
+public:
+    explicit CellArray(uint64_t num_cells)
+        : bytes_(((num_cells + 31) / 32) * sizeof(uint64_t)) {
+        void* p = mmap(nullptr, bytes_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        words_ = p == MAP_FAILED ? nullptr : static_cast<uint64_t*>(p);
+    }
+    ~CellArray() {
+        if (words_) munmap(words_, bytes_);
+    }
+
+    bool ok() const { return words_ != nullptr; }
+    const uint64_t* words() const { return words_; }
+
+    void set(uint64_t i, uint8_t code) {
+        words_[i >> 5] |= static_cast<uint64_t>(code) << ((i & 31) * 2);
+    }
+
+private:
+    size_t bytes_;
+    uint64_t* words_ = nullptr;
+};
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::string db_path;
+    std::string bitmap_path;
+    std::string output_file;
+    std::string format;
+
+    // Parse arguments
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--help") == 0) {
+            print_usage(argv[0]);
+            return 0;
+        } else if (std::strcmp(argv[i], "--db") == 0) {
+            if (i + 1 < argc) {
+                db_path = argv[++i];
+            } else {
+                std::cerr << "Error: --db requires a path\n";
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--bitmap") == 0) {
+            if (i + 1 < argc) {
+                bitmap_path = argv[++i];
+            } else {
+                std::cerr << "Error: --bitmap requires a path\n";
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--output") == 0) {
+            if (i + 1 < argc) {
+                output_file = argv[++i];
+            } else {
+                std::cerr << "Error: --output requires a filename\n";
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--format") == 0) {
+            if (i + 1 < argc) {
+                format = argv[++i];
+            } else {
+                std::cerr << "Error: --format requires sorted or bitmap\n";
+                return 1;
+            }
+            if (format != "sorted" && format != "bitmap") {
+                std::cerr << "Error: unknown format: " << format << " (expected sorted or bitmap)\n";
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--official") == 0) {
+            bobail::g_rules_variant = bobail::RulesVariant::OFFICIAL;
+        } else if (std::strcmp(argv[i], "--flexible") == 0) {
+            bobail::g_rules_variant = bobail::RulesVariant::FLEXIBLE;
+        } else {
+            std::cerr << "Unknown option: " << argv[i] << "\n";
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (db_path.empty() == bitmap_path.empty() || output_file.empty()) {
+        std::cerr << "Error: --output and exactly one of --db or --bitmap are required\n";
+        print_usage(argv[0]);
+        return 1;
+    }
+    if (format.empty()) format = db_path.empty() ? "bitmap" : "sorted";
+    if (format == "sorted" && db_path.empty()) {
+        std::cerr << "Error: the sorted format is exported from --db\n";
+        return 1;
+    }
+
+    // Initialize tables
+    bobail::init_move_tables();
+    bobail::init_zobrist();
+    bobail::init_symmetry();
+
+    std::cout << "Tablebase Exporter\n";
+    std::cout << "==================\n";
+    std::cout << "Rules variant: "
+              << (bobail::g_rules_variant == bobail::RulesVariant::OFFICIAL
+                  ? "OFFICIAL" : "FLEXIBLE")
+              << "\n";
+    std::cout << "Format: " << format << "\n\n";
+
+    bool ok = false;
+
+    if (!bitmap_path.empty()) {
+        bobail::ResultBitmap bitmap;
+        if (!bitmap.open(bitmap_path + "/results.bitmap", bobail::RANK_SPACE_SIZE)) {
+            std::cerr << "Failed to open bitmap results in: " << bitmap_path << "\n";
+            return 1;
+        }
+        if (bitmap.header().phase != static_cast<uint32_t>(bobail::SolvePhase::COMPLETE)) {
+            std::cerr << "Bitmap solve is not complete\n";
+            return 1;
+        }
+        if (bitmap.header().rules_variant != static_cast<uint32_t>(bobail::g_rules_variant)) {
+            std::cerr << "Bitmap results were solved with other rules; pass the matching rules flag\n";
+            return 1;
+        }
+        ok = bobail::write_tablebase_bitmap(output_file, bitmap.words(), bitmap.size());
+    } else {
+        bobail::RetrogradeSolverDB solver;
+        if (!solver.open_readonly(db_path)) {
+            std::cerr << "Failed to open database: " << db_path << "\n";
+            return 1;
+        }
+        if (solver.current_phase() != bobail::SolvePhaseDB::COMPLETE) {
+            std::cerr << "Database solve is not complete\n";
+            return 1;
+        }
+        std::cout << "Database opened. Total states: " << solver.num_states()
+                  << (solver.has_dtw() ? " (with DTW)" : " (no DTW)") << "\n";
+
+        uint64_t scanned = 0;
+        auto report = [&]() {
+            if (++scanned % 10000000 == 0) {
+                std::cout << "\rScanned: " << scanned << " / " << solver.num_states() << "   " << std::flush;
+            }
+        };
+
+        if (format == "sorted") {
+            std::vector<uint64_t> entries;
+            entries.reserve(solver.num_states());
+            solver.for_each_state([&](uint64_t packed, bobail::Result r, uint8_t dtw) {
+                report();
+                if (r == bobail::Result::UNKNOWN) return;
+                uint64_t rank = bobail::rank_canonical(bobail::unpack_state(packed));
+                entries.push_back(bobail::make_tablebase_entry(rank, bobail::encode_bitmap_result(r), dtw));
+            });
+            std::cout << "\nWriting " << entries.size() << " entries...\n";
+            ok = bobail::write_tablebase_sorted(output_file, entries, solver.has_dtw());
+        } else {
+            CellArray cells(bobail::RANK_SPACE_SIZE);
+            if (!cells.ok()) {
+                std::cerr << "Failed to allocate the rank bitmap\n";
+                return 1;
+            }
+            solver.for_each_state([&](uint64_t packed, bobail::Result r, uint8_t) {
+                report();
+                if (r == bobail::Result::UNKNOWN) return;
+                cells.set(bobail::rank_canonical(bobail::unpack_state(packed)), bobail::encode_bitmap_result(r));
+            });
+            std::cout << "\nWriting rank bitmap...\n";
+            ok = bobail::write_tablebase_bitmap(output_file, cells.words(), bobail::RANK_SPACE_SIZE);
+        }
+        solver.close();
+    }
+
+    if (!ok) {
+        std::cerr << "Export failed\n";
+        return 1;
+    }
+
+    bobail::Tablebase tb;
+    if (!tb.open(output_file)) {
+        std::cerr << "Failed to reopen " << output_file << "\n";
+        return 1;
+    }
+    const bobail::TablebaseHeader& h = tb.header();
+    std::cout << "\nExport complete!\n";
+    std::cout << "Wins: " << h.num_wins << ", losses: " << h.num_losses << ", draws: " << h.num_draws << "\n";
+    std::cout << "Starting position: ";
+    switch (tb.probe(bobail::State::starting_position())) {
+        case bobail::Result::WIN: std::cout << "WIN\n"; break;
+        case bobail::Result::LOSS: std::cout << "LOSS\n"; break;
+        case bobail::Result::DRAW: std::cout << "DRAW\n"; break;
+        default: std::cout << "UNKNOWN\n"; break;
+    }
+    std::cout << "Output file: " << output_file << "\n";
+    return 0;
+}
@@ -1,10 +1,12 @@
 #include "hash.h"
 #include <bit>
+#include <iostream>
 
 namespace bobail {
 
 std::array<std::array<uint64_t, 3>, NUM_SQUARES> zobrist_pieces;
 uint64_t zobrist_side;
+HashMode g_hash_mode = HashMode::ZOBRIST;
 
 namespace {
     // Simple xorshift64 PRNG for deterministic Zobrist initialization
@@ -69,4 +71,32 @@ uint64_t hash_toggle_side(uint64_t hash) {
     return hash ^ zobrist_side;
 }
 
+bool use_hash_mode(uint64_t mode) {
+    if (mode > static_cast<uint64_t>(HashMode::PACKED)) {
+        std::cerr << "Unknown hash mode " << mode << "\n";
+        return false;
+    }
+    if (static_cast<HashMode>(mode) != g_hash_mode) {
+        g_hash_mode = static_cast<HashMode>(mode);
+        std::cerr << "Using " << (g_hash_mode == HashMode::PACKED ? "packed" : "Zobrist")
+                  << " position keys, as the PNS file was written with\n";
+    }
+    return true;
+}
+
+uint64_t hash_after_move(uint64_t hash, const State& s, const Move& m) {
+    hash ^= zobrist_pieces[s.bobail_sq][2] ^ zobrist_pieces[m.bobail_to][2] ^ zobrist_side;
+
+    // Same pawn update as apply_move(), which may leave the pawns as they were
+    int piece = s.white_to_move ? 0 : 1;
+    uint32_t pawns = s.white_to_move ? s.white_pawns : s.black_pawns;
+    uint32_t changed = pawns ^ ((pawns & ~(1u << m.pawn_from)) | (1u << m.pawn_to));
+    while (changed) {
+        int sq = std::countr_zero(changed);
+        changed &= changed - 1;
+        hash ^= zobrist_pieces[sq][piece];
+    }
+    return hash;
+}
+
 } // namespace bobail
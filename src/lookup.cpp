@@ -3,10 +3,12 @@
 #include "hash.h"
 #include "symmetry.h"
 #include "retrograde_db.h"
+#include "tablebase.h"
 #include <iostream>
 #include <string>
 #include <cstring>
 #include <sstream>
+#include <vector>
 
 // Simple command-line tool to lookup positions in the solved database
 // Can be used as a backend for the web UI via a simple API
@@ -14,7 +16,9 @@
 void print_usage(const char* prog) {
     std::cerr << "Usage: " << prog << " [options]\n"
               << "Options:\n"
-              << "  --db PATH           Database directory (required)\n"
+              << "  --db PATH           Database directory\n"
+              << "  --tablebase FILE    Tablebase file from export_tablebase (instead of --db)\n"
+              << "  --cache-mb N        Block cache size for --db in MB (default: 1024)\n"
               << "  --official          Use Official rules [default]\n"
               << "  --flexible          Use Flexible rules\n"
               << "  --interactive       Interactive mode\n"
@@ -24,10 +28,46 @@ void print_usage(const char* prog) {
               << "  --help              Show this help\n";
 }
 
-void print_position_info(bobail::RetrogradeSolverDB& solver, const bobail::State& s) {
+// The same queries against a RocksDB database or a tablebase file
+bobail::Result query_result(const bobail::RetrogradeSolverDB& db, const bobail::State& s, uint8_t& dtw) {
+    return db.get_result(s, dtw);
+}
+
+bobail::Result query_result(const bobail::Tablebase& tb, const bobail::State& s, uint8_t& dtw) {
+    return tb.probe(s, dtw);
+}
+
+std::vector<bobail::Result> query_results(const bobail::RetrogradeSolverDB& db,
+                                          const std::vector<bobail::State>& states,
+                                          std::vector<uint8_t>& dtw) {
+    return db.get_results(states, &dtw);
+}
+
+std::vector<bobail::Result> query_results(const bobail::Tablebase& tb,
+                                          const std::vector<bobail::State>& states,
+                                          std::vector<uint8_t>& dtw) {
+    std::vector<bobail::Result> results(states.size());
+    dtw.resize(states.size());
+    for (size_t i = 0; i < states.size(); ++i) {
+        results[i] = tb.probe(states[i], dtw[i]);
+    }
+    return results;
+}
+
+bobail::Move query_best_move(const bobail::RetrogradeSolverDB& db, const bobail::State& s) {
+    return db.get_best_move(s);
+}
+
+bobail::Move query_best_move(const bobail::Tablebase& tb, const bobail::State& s) {
+    return tb.best_move(s);
+}
+
+template <typename Source>
+void print_position_info(const Source& solver, const bobail::State& s) {
     std::cout << s.to_string() << "\n";
 
-    bobail::Result result = solver.get_result(s);
+    uint8_t dtw;
+    bobail::Result result = query_result(solver, s, dtw);
     std::cout << "Result: ";
     switch (result) {
         case bobail::Result::WIN: std::cout << "WIN (for " << (s.white_to_move ? "White" : "Black") << ")\n"; break;
@@ -35,17 +75,30 @@ void print_position_info(bobail::RetrogradeSolverDB& solver, const bobail::State
         case bobail::Result::DRAW: std::cout << "DRAW\n"; break;
         default: std::cout << "UNKNOWN\n"; break;
     }
+    if (solver.has_dtw() && (result == bobail::Result::WIN || result == bobail::Result::LOSS)) {
+        std::cout << "Depth: " << static_cast<int>(dtw) << " plies"
+                  << (dtw == bobail::DTW_MAX ? " or more" : "") << "\n";
+    }
 
     if (result != bobail::Result::UNKNOWN) {
-        bobail::Move best = solver.get_best_move(s);
+        bobail::Move best = query_best_move(solver, s);
         std::cout << "Best move: " << best.to_string() << "\n";
 
         // Show all moves with their evaluations
         std::cout << "\nAll moves:\n";
         auto moves = bobail::generate_moves(s);
+        std::vector<bobail::State> children;
+        children.reserve(moves.size());
         for (const auto& m : moves) {
-            bobail::State next = bobail::apply_move(s, m);
-            bobail::Result r = solver.get_result(next);
+            children.push_back(bobail::apply_move(s, m));
+        }
+        std::vector<uint8_t> child_dtw;
+        std::vector<bobail::Result> child_results = query_results(solver, children, child_dtw);
+
+        for (size_t i = 0; i < moves.size(); ++i) {
+            const bobail::Move& m = moves[i];
+            bobail::Result r = child_results[i];
+            uint8_t next_dtw = child_dtw[i];
 
             std::cout << "  " << m.to_string() << " -> ";
             // Result is from opponent's perspective after the move
@@ -55,6 +108,9 @@ void print_position_info(bobail::RetrogradeSolverDB& solver, const bobail::State
                 case bobail::Result::DRAW: std::cout << "DRAW"; break;
                 default: std::cout << "?"; break;
             }
+            if (solver.has_dtw() && (r == bobail::Result::WIN || r == bobail::Result::LOSS)) {
+                std::cout << " in " << (static_cast<int>(next_dtw) + 1);
+            }
             if (m == best) std::cout << " *";
             std::cout << "\n";
         }
@@ -84,8 +140,50 @@ bool parse_position(const std::string& input, bobail::State& s) {
     return true;
 }
 
+template <typename Source>
+bool run_queries(const Source& solver, bool interactive, const std::string& query) {
+    if (!query.empty()) {
+        // Single query mode
+        bobail::State s;
+        if (parse_position(query, s)) {
+            print_position_info(solver, s);
+        } else {
+            std::cerr << "Invalid position format. Use: WP,BP,BOB,STM (hex,hex,int,int)\n";
+            return false;
+        }
+    } else if (interactive) {
+        // Interactive mode
+        std::cout << "Interactive lookup mode. Enter positions as: WP,BP,BOB,STM\n";
+        std::cout << "Example: 1f,1f00000,12,1 (starting position)\n";
+        std::cout << "Or 'start' for starting position, 'quit' to exit\n\n";
+
+        std::string line;
+        while (std::cout << "> " && std::getline(std::cin, line)) {
+            if (line == "quit" || line == "q") break;
+
+            bobail::State s;
+            if (line == "start" || line == "s") {
+                s = bobail::State::starting_position();
+            } else if (!parse_position(line, s)) {
+                std::cout << "Invalid format. Use: WP,BP,BOB,STM or 'start'\n";
+                continue;
+            }
+
+            print_position_info(solver, s);
+            std::cout << "\n";
+        }
+    } else {
+        // Default: show starting position
+        auto s = bobail::State::starting_position();
+        print_position_info(solver, s);
+    }
+    return true;
+}
+
 int main(int argc, char* argv[]) {
     std::string db_path;
+    std::string tablebase_path;
+    uint64_t cache_mb = 1024;
     bool interactive = false;
     std::string query;
 
@@ -96,6 +194,10 @@ int main(int argc, char* argv[]) {
             return 0;
         } else if (std::strcmp(argv[i], "--db") == 0) {
             if (i + 1 < argc) db_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--tablebase") == 0) {
+            if (i + 1 < argc) tablebase_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--cache-mb") == 0) {
+            if (i + 1 < argc) cache_mb = std::stoull(argv[++i]);
         } else if (std::strcmp(argv[i], "--official") == 0) {
             bobail::g_rules_variant = bobail::RulesVariant::OFFICIAL;
         } else if (std::strcmp(argv[i], "--flexible") == 0) {
@@ -107,8 +209,8 @@ int main(int argc, char* argv[]) {
         }
     }
 
-    if (db_path.empty()) {
-        std::cerr << "Error: --db is required\n";
+    if (db_path.empty() == tablebase_path.empty()) {
+        std::cerr << "Error: one of --db or --tablebase is required\n";
         print_usage(argv[0]);
         return 1;
     }
@@ -118,9 +220,21 @@ int main(int argc, char* argv[]) {
     bobail::init_zobrist();
     bobail::init_symmetry();
 
+    if (!tablebase_path.empty()) {
+        bobail::Tablebase tb;
+        if (!tb.open(tablebase_path)) {
+            std::cerr << "Failed to open tablebase: " << tablebase_path << "\n";
+            return 1;
+        }
+        std::cerr << "Tablebase opened. Rules: "
+                  << (bobail::g_rules_variant == bobail::RulesVariant::OFFICIAL ? "OFFICIAL" : "FLEXIBLE")
+                  << "\n";
+        return run_queries(tb, interactive, query) ? 0 : 1;
+    }
+
     // Open database
     bobail::RetrogradeSolverDB solver;
-    if (!solver.open(db_path)) {
+    if (!solver.open_readonly(db_path, cache_mb)) {
         std::cerr << "Failed to open database: " << db_path << "\n";
         return 1;
     }
@@ -129,42 +243,8 @@ int main(int argc, char* argv[]) {
               << (bobail::g_rules_variant == bobail::RulesVariant::OFFICIAL ? "OFFICIAL" : "FLEXIBLE")
               << "\n";
 
-    if (!query.empty()) {
-        // Single query mode
-        bobail::State s;
-        if (parse_position(query, s)) {
-            print_position_info(solver, s);
-        } else {
-            std::cerr << "Invalid position format. Use: WP,BP,BOB,STM (hex,hex,int,int)\n";
-            return 1;
-        }
-    } else if (interactive) {
-        // Interactive mode
-        std::cout << "Interactive lookup mode. Enter positions as: WP,BP,BOB,STM\n";
-        std::cout << "Example: 1f,1f00000,12,1 (starting position)\n";
-        std::cout << "Or 'start' for starting position, 'quit' to exit\n\n";
-
-        std::string line;
-        while (std::cout << "> " && std::getline(std::cin, line)) {
-            if (line == "quit" || line == "q") break;
-
-            bobail::State s;
-            if (line == "start" || line == "s") {
-                s = bobail::State::starting_position();
-            } else if (!parse_position(line, s)) {
-                std::cout << "Invalid format. Use: WP,BP,BOB,STM or 'start'\n";
-                continue;
-            }
-
-            print_position_info(solver, s);
-            std::cout << "\n";
-        }
-    } else {
-        // Default: show starting position
-        auto s = bobail::State::starting_position();
-        print_position_info(solver, s);
-    }
+    bool ok = run_queries(solver, interactive, query);
 
     solver.close();
-    return 0;
+    return ok ? 0 : 1;
 }
@@ -22,6 +22,7 @@ import sys
 # Global config
 LOOKUP_PATH = "./build/lookup"
 DB_PATH = ""
+SOURCE_FLAG = "--db"
 RULES = "official"
 USE_PNS = False
 PNS_LOOKUP_PATH = "./build/pns_lookup"
@@ -105,7 +106,7 @@ class LookupHandler(BaseHTTPRequestHandler):
 
                 rules_flag = "--official" if RULES == "official" else "--flexible"
                 result = subprocess.run(
-                    [LOOKUP_PATH, "--db", DB_PATH, rules_flag, "--query", pos],
+                    [LOOKUP_PATH, SOURCE_FLAG, DB_PATH, rules_flag, "--query", pos],
                     capture_output=True,
                     text=True,
                     timeout=5
@@ -157,13 +158,17 @@ class LookupHandler(BaseHTTPRequestHandler):
                 elif "DRAW" in line:
                     result["result"] = "draw"
 
+            elif line.startswith("Depth:"):
+                # "Depth: 7 plies" (only for solved wins/losses with DTW)
+                result["dtw"] = int(line.split()[1])
+
             elif line.startswith("Best move:"):
                 # Parse "B->7 P:0->15"
                 move_str = line.replace("Best move:", "").strip()
                 result["best_move"] = self.parse_move(move_str)
 
             elif line.startswith("B->") and "->" in line:
-                # Parse move line like "  B->7 P:0->15 -> DRAW *"
+                # Parse move line like "  B->7 P:0->15 -> DRAW *" or "... -> WIN in 5 *"
                 parts = line.split("->")
                 if len(parts) >= 3:
                     move_str = "->".join(parts[:2]).strip()  # "B->7 P:0->15"
@@ -171,8 +176,10 @@ class LookupHandler(BaseHTTPRequestHandler):
 
                     move = self.parse_move(move_str)
                     if move:
-                        eval_str = eval_part.replace("*", "").strip().lower()
-                        move["eval"] = eval_str
+                        eval_words = eval_part.replace("*", "").split()
+                        move["eval"] = eval_words[0].lower() if eval_words else ""
+                        if len(eval_words) == 3 and eval_words[1] == "in":
+                            move["dtw"] = int(eval_words[2])
                         move["best"] = "*" in eval_part
                         result["all_moves"].append(move)
 
@@ -207,10 +214,11 @@ class LookupHandler(BaseHTTPRequestHandler):
         pass
 
 def main():
-    global DB_PATH, RULES, LOOKUP_PATH, USE_PNS, PNS_LOOKUP_PATH, PNS_CHECKPOINT
+    global DB_PATH, SOURCE_FLAG, RULES, LOOKUP_PATH, USE_PNS, PNS_LOOKUP_PATH, PNS_CHECKPOINT
 
     parser = argparse.ArgumentParser(description='Bobail lookup server')
     parser.add_argument('--db', help='Path to solver database (for retrograde mode)')
+    parser.add_argument('--tablebase', help='Path to tablebase file from export_tablebase (instead of --db)')
     parser.add_argument('--rules', choices=['official', 'flexible'], default='official')
     parser.add_argument('--port', type=int, default=8080)
     parser.add_argument('--lookup', default='./build/lookup', help='Path to lookup binary')
@@ -226,15 +234,16 @@ def main():
         print(f"  PNS Checkpoint: {PNS_CHECKPOINT}")
         # Start the persistent PNS lookup process
         start_pns_process()
-    elif args.db:
-        DB_PATH = args.db
+    elif args.db or args.tablebase:
+        DB_PATH = args.tablebase or args.db
+        SOURCE_FLAG = "--tablebase" if args.tablebase else "--db"
         RULES = args.rules
         LOOKUP_PATH = args.lookup
         print(f"Starting Bobail retrograde lookup server...")
-        print(f"  Database: {DB_PATH}")
+        print(f"  {'Tablebase' if args.tablebase else 'Database'}: {DB_PATH}")
         print(f"  Rules: {RULES}")
     else:
-        print("Error: Must specify either --db or --pns")
+        print("Error: Must specify --db, --tablebase or --pns")
         return
 
     print(f"  Port: {args.port}")
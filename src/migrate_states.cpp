@@ -0,0 +1,60 @@
+#include "retrograde_db.h"
+#include <iostream>
+#include <string>
+#include <cstring>
+
+// One-shot conversion of a RocksDB solver database to the current states
+// layout (big-endian id keys, 8-byte records; see retrograde_db.h). Like
+// migrate_metadata, it takes the database path as its argument and opens
+// whatever column families the database has; the other column families
+// are left as they are.
+
+void print_usage(const char* prog) {
+    std::cerr << "Usage: " << prog << " <db_path>\n"
+              << "Options:\n"
+              << "  --db PATH           Same as <db_path>, as the other tools take it\n"
+              << "  --help              Show this help\n"
+              << "The database must not be open elsewhere.\n";
+}
+
+int main(int argc, char* argv[]) {
+    std::string db_path;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--help") == 0) {
+            print_usage(argv[0]);
+            return 0;
+        } else if (std::strcmp(argv[i], "--db") == 0) {
+            if (i + 1 < argc) {
+                db_path = argv[++i];
+            } else {
+                std::cerr << "Error: --db requires a path\n";
+                return 1;
+            }
+        } else if (argv[i][0] != '-' && db_path.empty()) {
+            db_path = argv[i];
+        } else {
+            std::cerr << "Unknown option: " << argv[i] << "\n";
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (db_path.empty()) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    auto progress = [](const char* phase, uint64_t current, uint64_t total) {
+        std::cerr << "\r" << phase << ": " << current;
+        if (total) std::cerr << " / " << total;
+        std::cerr << std::flush;
+    };
+
+    std::cerr << "Migrating states in " << db_path << "\n";
+    if (!bobail::RetrogradeSolverDB::migrate_states(db_path, progress)) {
+        return 1;
+    }
+    std::cerr << "Done\n";
+    return 0;
+}
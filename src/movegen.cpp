@@ -1,4 +1,5 @@
 #include "movegen.h"
+#include "symmetry.h"
 #include <bit>
 
 namespace bobail {
@@ -9,6 +10,11 @@ RulesVariant g_rules_variant = RulesVariant::OFFICIAL;
 std::array<std::array<std::vector<int>, 8>, NUM_SQUARES> rays;
 std::array<std::vector<int>, NUM_SQUARES> neighbors;
 
+std::array<std::array<uint32_t, 8>, NUM_SQUARES> ray_masks;
+std::array<std::array<std::array<uint8_t, BOARD_SIZE - 1>, 8>, NUM_SQUARES> ray_squares;
+std::array<std::array<uint8_t, 8>, NUM_SQUARES> ray_lengths;
+std::array<uint32_t, NUM_SQUARES> neighbor_masks;
+
 namespace {
     // Direction index mapping
     constexpr int dir_to_index(Direction d) {
@@ -42,6 +48,76 @@ namespace {
         }
         return false;
     }
+
+    // Number of free squares along a ray before the first blocker.
+    // Squares along rays with a positive offset increase, so the nearest
+    // blocker is the lowest set bit; for negative offsets it is the highest.
+    inline int ray_reach(int sq, int di, uint32_t occupied) {
+        uint32_t mask = ray_masks[sq][di];
+        uint32_t blockers = mask & occupied;
+        if (!blockers) {
+            return ray_lengths[sq][di];
+        }
+        uint32_t before;
+        if (static_cast<int>(ALL_DIRECTIONS[di]) > 0) {
+            before = (blockers & (0u - blockers)) - 1;
+        } else {
+            before = ~((std::bit_floor(blockers) << 1) - 1);
+        }
+        return std::popcount(mask & before);
+    }
+
+    // Core pawn move kernel shared by every generate_* entry point.
+    // Calls emit(from, to) for each legal slide, in ray order.
+    template <RulesVariant V, typename Emit>
+    inline void for_each_pawn_move(uint32_t pawns, uint32_t occupied, Emit&& emit) {
+        uint32_t remaining = pawns;
+        while (remaining) {
+            int sq = std::countr_zero(remaining);
+            remaining &= remaining - 1;
+
+            for (int di = 0; di < 8; ++di) {
+                int reach = ray_reach(sq, di, occupied);
+                if (reach == 0) continue;
+
+                const auto& ray = ray_squares[sq][di];
+                if constexpr (V == RulesVariant::FLEXIBLE) {
+                    // Flexible: can stop at any square along the ray
+                    for (int i = 0; i < reach; ++i) {
+                        emit(sq, ray[i]);
+                    }
+                } else {
+                    // Official: must move to furthest unoccupied square
+                    emit(sq, ray[reach - 1]);
+                }
+            }
+        }
+    }
+
+    inline void push_move(MoveList& out, int bobail_to, int from, int to) {
+        Move m;
+        m.bobail_to = static_cast<uint8_t>(bobail_to);
+        m.pawn_from = static_cast<uint8_t>(from);
+        m.pawn_to = static_cast<uint8_t>(to);
+        out.push_back(m);
+    }
+
+    // Ray index pointing the opposite way (N<->S, E<->W, NE<->SW, NW<->SE)
+    constexpr int opposite_dir(int di) {
+        return di < 4 ? di ^ 1 : di ^ 3;
+    }
+
+    // Rows 1-3: a Bobail anywhere else has already ended the game
+    constexpr uint32_t INNER_ROWS_MASK = ((1u << (NUM_SQUARES - BOARD_SIZE)) - 1) & ~((1u << BOARD_SIZE) - 1);
+
+    template <RulesVariant V>
+    std::vector<std::pair<int, int>> pawn_moves_impl(uint32_t pawns, uint32_t occupied) {
+        std::vector<std::pair<int, int>> moves;
+        for_each_pawn_move<V>(pawns, occupied, [&](int from, int to) {
+            moves.emplace_back(from, to);
+        });
+        return moves;
+    }
 }
 
 void init_move_tables() {
@@ -50,20 +126,27 @@ void init_move_tables() {
         for (int di = 0; di < 8; ++di) {
             Direction d = ALL_DIRECTIONS[di];
             rays[sq][di].clear();
+            ray_masks[sq][di] = 0;
+            ray_lengths[sq][di] = 0;
+            ray_squares[sq][di].fill(0);
 
             int curr = sq;
             while (can_move(curr, d)) {
                 curr += static_cast<int>(d);
                 rays[sq][di].push_back(curr);
+                ray_masks[sq][di] |= 1u << curr;
+                ray_squares[sq][di][ray_lengths[sq][di]++] = static_cast<uint8_t>(curr);
             }
         }
 
         // Build neighbor table (1-step moves for Bobail)
         // Bobail moves to any adjacent square (including diagonals)
         neighbors[sq].clear();
+        neighbor_masks[sq] = 0;
         for (Direction d : ALL_DIRECTIONS) {
             if (can_move(sq, d)) {
                 neighbors[sq].push_back(sq + static_cast<int>(d));
+                neighbor_masks[sq] |= 1u << (sq + static_cast<int>(d));
             }
         }
     }
@@ -82,38 +165,10 @@ std::vector<int> generate_bobail_moves(const State& s) {
 }
 
 std::vector<std::pair<int, int>> generate_pawn_moves(uint32_t pawns, uint32_t occupied) {
-    std::vector<std::pair<int, int>> moves;
-
-    uint32_t remaining = pawns;
-    while (remaining) {
-        int sq = std::countr_zero(remaining);
-        remaining &= remaining - 1;
-
-        for (int di = 0; di < 8; ++di) {
-            if (g_rules_variant == RulesVariant::FLEXIBLE) {
-                // Flexible: can stop at any square along the ray
-                for (int dest : rays[sq][di]) {
-                    if (occupied & (1u << dest)) {
-                        break;  // Blocked
-                    }
-                    moves.emplace_back(sq, dest);
-                }
-            } else {
-                // Official: must move to furthest unoccupied square
-                int furthest = -1;
-                for (int dest : rays[sq][di]) {
-                    if (occupied & (1u << dest)) {
-                        break;  // Blocked
-                    }
-                    furthest = dest;
-                }
-                if (furthest >= 0) {
-                    moves.emplace_back(sq, furthest);
-                }
-            }
-        }
+    if (g_rules_variant == RulesVariant::FLEXIBLE) {
+        return pawn_moves_impl<RulesVariant::FLEXIBLE>(pawns, occupied);
     }
-    return moves;
+    return pawn_moves_impl<RulesVariant::OFFICIAL>(pawns, occupied);
 }
 
 bool is_starting_position(const State& s) {
@@ -125,34 +180,44 @@ bool is_starting_position(const State& s) {
 }
 
 std::vector<Move> generate_moves(const State& s) {
-    std::vector<Move> moves;
+    MoveList list;
+    generate_moves(s, list);
+    return std::vector<Move>(list.begin(), list.end());
+}
+
+void generate_moves(const State& s, MoveList& out) {
+    if (g_rules_variant == RulesVariant::FLEXIBLE) {
+        generate_moves<RulesVariant::FLEXIBLE>(s, out);
+    } else {
+        generate_moves<RulesVariant::OFFICIAL>(s, out);
+    }
+}
+
+template <RulesVariant V>
+void generate_moves(const State& s, MoveList& out) {
+    out.clear();
 
     uint32_t our_pawns = s.white_to_move ? s.white_pawns : s.black_pawns;
+    uint32_t pawns_occupied = s.white_pawns | s.black_pawns;
 
     // First turn (starting position): only pawn moves, Bobail stays put
     if (is_starting_position(s)) {
-        uint32_t occupied = s.occupied();
-        auto pawn_moves = generate_pawn_moves(our_pawns, occupied);
-
-        for (auto [from, to] : pawn_moves) {
-            Move m;
-            m.bobail_to = s.bobail_sq;  // Bobail doesn't move
-            m.pawn_from = static_cast<uint8_t>(from);
-            m.pawn_to = static_cast<uint8_t>(to);
-            moves.push_back(m);
-        }
-        return moves;
+        int bobail = s.bobail_sq;
+        for_each_pawn_move<V>(our_pawns, s.occupied(), [&](int from, int to) {
+            push_move(out, bobail, from, to);
+        });
+        return;
     }
 
     // Normal turn: Bobail move + pawn move
-    auto bobail_moves = generate_bobail_moves(s);
-
-    if (bobail_moves.empty()) {
-        return moves;  // No legal moves - current player loses
-    }
+    // The Bobail's neighbor in each direction is the first square of that ray.
+    // No free neighbor means no legal moves - current player loses
+    uint32_t occupied = pawns_occupied | (1u << s.bobail_sq);
+    for (int di = 0; di < 8; ++di) {
+        if (ray_lengths[s.bobail_sq][di] == 0) continue;
+        int bobail_dest = ray_squares[s.bobail_sq][di][0];
+        if (occupied & (1u << bobail_dest)) continue;
 
-    // For each Bobail move, generate all pawn moves
-    for (int bobail_dest : bobail_moves) {
         int bobail_row = State::row(bobail_dest);
 
         // Check if bobail move is terminal (reaches goal row)
@@ -163,27 +228,128 @@ std::vector<Move> generate_moves(const State& s) {
             // Terminal move - no pawn move needed, game ends immediately
             // Use first pawn staying in place as a dummy move
             int first_pawn = std::countr_zero(our_pawns);
-            Move m;
-            m.bobail_to = static_cast<uint8_t>(bobail_dest);
-            m.pawn_from = static_cast<uint8_t>(first_pawn);
-            m.pawn_to = static_cast<uint8_t>(first_pawn);  // No actual pawn move
-            moves.push_back(m);
+            push_move(out, bobail_dest, first_pawn, first_pawn);
         } else {
             // Non-terminal: generate all pawn moves
-            uint32_t new_occupied = (s.white_pawns | s.black_pawns | (1u << bobail_dest));
-            auto pawn_moves = generate_pawn_moves(our_pawns, new_occupied);
-
-            for (auto [from, to] : pawn_moves) {
-                Move m;
-                m.bobail_to = static_cast<uint8_t>(bobail_dest);
-                m.pawn_from = static_cast<uint8_t>(from);
-                m.pawn_to = static_cast<uint8_t>(to);
-                moves.push_back(m);
+            uint32_t new_occupied = pawns_occupied | (1u << bobail_dest);
+            for_each_pawn_move<V>(our_pawns, new_occupied, [&](int from, int to) {
+                push_move(out, bobail_dest, from, to);
+            });
+        }
+    }
+}
+
+std::vector<State> generate_unmoves(const State& s) {
+    std::vector<State> parents;
+    generate_unmoves(s, parents);
+    return parents;
+}
+
+void generate_unmoves(const State& s, std::vector<State>& out) {
+    if (g_rules_variant == RulesVariant::FLEXIBLE) {
+        generate_unmoves<RulesVariant::FLEXIBLE>(s, out);
+    } else {
+        generate_unmoves<RulesVariant::OFFICIAL>(s, out);
+    }
+}
+
+template <RulesVariant V>
+void generate_unmoves(const State& s, std::vector<State>& out) {
+    out.clear();
+
+    // The parent's side moved into s
+    bool parent_white = !s.white_to_move;
+    uint32_t mover = parent_white ? s.white_pawns : s.black_pawns;
+    uint32_t pawns_occupied = s.white_pawns | s.black_pawns;
+    int bobail = s.bobail_sq;
+
+    auto push_parent = [&](uint32_t parent_mover, int bobail_from) {
+        State p;
+        p.white_pawns = parent_white ? parent_mover : s.white_pawns;
+        p.black_pawns = parent_white ? s.black_pawns : parent_mover;
+        p.bobail_sq = static_cast<uint8_t>(bobail_from);
+        p.white_to_move = parent_white;
+        out.push_back(p);
+    };
+
+    // First turn: a pawn-only move out of the starting position
+    if (!s.white_to_move && bobail == 12 && s.black_pawns == 0b11111'00000'00000'00000'00000) {
+        State start = State::starting_position();
+        MoveList moves;
+        generate_moves<V>(start, moves);
+        for (const auto& m : moves) {
+            if (apply_move(start, m) == s) out.push_back(start);
+        }
+    }
+
+    // Terminal move: the Bobail stepped onto a goal row and no pawn moved
+    int bobail_row = State::row(bobail);
+    if (bobail_row == 0 || bobail_row == BOARD_SIZE - 1) {
+        uint32_t origins = neighbor_masks[bobail] & ~pawns_occupied & INNER_ROWS_MASK;
+        while (origins) {
+            push_parent(mover, std::countr_zero(origins));
+            origins &= origins - 1;
+        }
+        return;
+    }
+
+    // Normal move: walk each pawn back along every ray it could have slid
+    // in. The slide happened after the Bobail reached its square, so the
+    // Bobail blocks the path as in the child; its origin may lie on the path.
+    uint32_t occupied = pawns_occupied | (1u << bobail);
+    uint32_t remaining = mover;
+    while (remaining) {
+        int to = std::countr_zero(remaining);
+        remaining &= remaining - 1;
+
+        for (int di = 0; di < 8; ++di) {
+            if constexpr (V == RulesVariant::OFFICIAL) {
+                // Official: the pawn must have stopped at the furthest square,
+                // so the next square in its direction is blocked or off board
+                if (ray_lengths[to][di] != 0 && !(occupied & (1u << ray_squares[to][di][0]))) continue;
+            }
+
+            int back = opposite_dir(di);
+            int reach = ray_reach(to, back, occupied);
+            for (int i = 0; i < reach; ++i) {
+                int from = ray_squares[to][back][i];
+                uint32_t parent_mover = mover ^ (1u << to) ^ (1u << from);
+                uint32_t parent_pawns = pawns_occupied ^ (1u << to) ^ (1u << from);
+
+                uint32_t origins = neighbor_masks[bobail] & ~parent_pawns & INNER_ROWS_MASK;
+                while (origins) {
+                    int origin = std::countr_zero(origins);
+                    origins &= origins - 1;
+                    push_parent(parent_mover, origin);
+                    // The starting position only has pawn-only moves
+                    if (is_starting_position(out.back())) out.pop_back();
+                }
             }
         }
     }
+}
 
-    return moves;
+template void generate_unmoves<RulesVariant::FLEXIBLE>(const State&, std::vector<State>&);
+template void generate_unmoves<RulesVariant::OFFICIAL>(const State&, std::vector<State>&);
+
+void generate_canonical_unmoves(uint64_t canonical, std::vector<uint64_t>& out) {
+    out.clear();
+    thread_local std::vector<State> parents;
+
+    // A canonical parent P reaches the class of C by moving to C itself or
+    // to its mirror image; the non-canonical parents of C are the mirrors
+    // of parents of mirror(C) and are counted from that side instead.
+    auto add_parents = [&](uint64_t child) {
+        generate_unmoves(unpack_state(child), parents);
+        for (const State& p : parents) {
+            uint64_t packed = pack_state(p);
+            if (canonical_packed(packed) == packed) out.push_back(packed);
+        }
+    };
+
+    add_parents(canonical);
+    uint64_t mirrored = mirror_packed(canonical);
+    if (mirrored != canonical) add_parents(mirrored);
 }
 
 State apply_move(const State& s, const Move& m) {
@@ -209,7 +375,8 @@ State apply_move(const State& s, const Move& m) {
 }
 
 bool is_legal_move(const State& s, const Move& m) {
-    auto legal = generate_moves(s);
+    MoveList legal;
+    generate_moves(s, legal);
     for (const auto& lm : legal) {
         if (lm == m) return true;
     }
@@ -217,9 +384,23 @@ bool is_legal_move(const State& s, const Move& m) {
 }
 
 size_t count_moves(const State& s) {
-    return generate_moves(s).size();
+    MoveList list;
+    generate_moves(s, list);
+    return list.size();
 }
 
+template <RulesVariant V>
+size_t count_moves(const State& s) {
+    MoveList list;
+    generate_moves<V>(s, list);
+    return list.size();
+}
+
+template void generate_moves<RulesVariant::FLEXIBLE>(const State&, MoveList&);
+template void generate_moves<RulesVariant::OFFICIAL>(const State&, MoveList&);
+template size_t count_moves<RulesVariant::FLEXIBLE>(const State&);
+template size_t count_moves<RulesVariant::OFFICIAL>(const State&);
+
 bool Move::operator==(const Move& other) const {
     return bobail_to == other.bobail_to &&
            pawn_from == other.pawn_from &&
@@ -0,0 +1,358 @@
+#include "opening_book.h"
+#include "retrograde_bitmap.h"
+#include "symmetry.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <thread>
+
+namespace bobail {
+
+namespace {
+    constexpr uint8_t INFO_RESULT = 0x3;
+    constexpr uint8_t INFO_MOVE = 0x4;
+    constexpr uint8_t INFO_DTW = 0x8;
+
+    void put_varint(std::vector<uint8_t>& out, uint64_t v) {
+        while (v >= 0x80) {
+            out.push_back(static_cast<uint8_t>(v) | 0x80);
+            v >>= 7;
+        }
+        out.push_back(static_cast<uint8_t>(v));
+    }
+
+    // False if the varint runs past `end`
+    bool get_varint(const uint8_t*& p, const uint8_t* end, uint64_t& v) {
+        v = 0;
+        for (int shift = 0; p < end && shift < 64; shift += 7) {
+            uint8_t b = *p++;
+            v |= static_cast<uint64_t>(b & 0x7F) << shift;
+            if (!(b & 0x80)) return true;
+        }
+        return false;
+    }
+
+    Move mirror_move(const Move& m) {
+        return Move{detail::MIRROR_SQUARE[m.bobail_to], detail::MIRROR_SQUARE[m.pawn_from],
+                    detail::MIRROR_SQUARE[m.pawn_to]};
+    }
+
+    // Fastest win, slowest loss, or a drawing move; same rule as
+    // RetrogradeSolverDB::get_best_move
+    size_t best_move_index(Result my_result, const std::vector<Result>& child_results,
+                           const std::vector<uint8_t>& child_dtw) {
+        size_t best = 0;
+        bool found = false;
+        uint8_t best_dtw = 0;
+
+        for (size_t i = 0; i < child_results.size(); ++i) {
+            Result opp_result = child_results[i];
+            uint8_t opp_dtw = child_dtw[i];
+
+            if (my_result == Result::WIN && opp_result == Result::LOSS) {
+                if (!found || opp_dtw < best_dtw) {
+                    best = i;
+                    best_dtw = opp_dtw;
+                    found = true;
+                }
+            }
+            if (my_result == Result::DRAW && opp_result == Result::DRAW) {
+                return i;
+            }
+            if (my_result == Result::LOSS) {
+                if (opp_result == Result::DRAW) return i;
+                if (opp_result == Result::WIN && (!found || opp_dtw > best_dtw)) {
+                    best = i;
+                    best_dtw = opp_dtw;
+                    found = true;
+                }
+            }
+        }
+        return best;
+    }
+}
+
+bool OpeningBook::open(const std::string& path) {
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in) {
+        std::cerr << "Failed to open " << path << ": " << std::strerror(errno) << "\n";
+        return false;
+    }
+    data_.resize(static_cast<size_t>(in.tellg()));
+    in.seekg(0);
+    in.read(reinterpret_cast<char*>(data_.data()), static_cast<std::streamsize>(data_.size()));
+    if (!in) {
+        std::cerr << "Failed to read " << path << "\n";
+        data_.clear();
+        return false;
+    }
+    return attach(path);
+}
+
+bool OpeningBook::open_buffer(const void* data, size_t size) {
+    const auto* p = static_cast<const uint8_t*>(data);
+    data_.assign(p, p + size);
+    return attach("buffer");
+}
+
+bool OpeningBook::attach(const std::string& name) {
+    header_ = BookHeader{};
+    index_.clear();
+
+    BookHeader h;
+    if (data_.size() < sizeof(h)) {
+        std::cerr << "Opening book " << name << " is too small\n";
+        return false;
+    }
+    std::memcpy(&h, data_.data(), sizeof(h));
+    if (h.magic != MAGIC || h.version != VERSION || h.block_entries == 0) {
+        std::cerr << "Opening book " << name << " has an unrecognized header\n";
+        return false;
+    }
+    if (h.rules_variant != static_cast<uint32_t>(g_rules_variant)) {
+        std::cerr << "Opening book " << name << " was built with "
+                  << (h.rules_variant == static_cast<uint32_t>(RulesVariant::OFFICIAL) ? "official" : "flexible")
+                  << " rules; pass the matching rules flag\n";
+        return false;
+    }
+    if (h.num_blocks != (h.num_entries + h.block_entries - 1) / h.block_entries ||
+        h.index_offset + h.num_blocks * sizeof(BookBlock) > h.data_offset ||
+        h.data_offset + h.data_bytes > data_.size()) {
+        std::cerr << "Opening book " << name << " is truncated or corrupt\n";
+        return false;
+    }
+
+    index_.resize(h.num_blocks);
+    std::memcpy(index_.data(), data_.data() + h.index_offset, h.num_blocks * sizeof(BookBlock));
+    for (const BookBlock& b : index_) {
+        if (b.offset > h.data_bytes) {
+            std::cerr << "Opening book " << name << " is truncated or corrupt\n";
+            index_.clear();
+            return false;
+        }
+    }
+    header_ = h;
+    return true;
+}
+
+Result OpeningBook::probe(const State& s, uint8_t& dtw, Move* best) const {
+    dtw = 0;
+    if (best) *best = Move{};
+    if (!is_open() || index_.empty()) return Result::UNKNOWN;
+
+    uint64_t packed = pack_state(s);
+    uint64_t key = canonical_packed(packed);
+
+    // Last block starting at or before the key
+    auto block = std::upper_bound(index_.begin(), index_.end(), key,
+                                  [](uint64_t k, const BookBlock& b) { return k < b.first_key; });
+    if (block == index_.begin()) return Result::UNKNOWN;
+    --block;
+
+    size_t b = static_cast<size_t>(block - index_.begin());
+    uint64_t count = std::min<uint64_t>(header_.block_entries, header_.num_entries - b * header_.block_entries);
+    const uint8_t* base = data_.data() + header_.data_offset;
+    const uint8_t* p = base + block->offset;
+    const uint8_t* end = base + (b + 1 < index_.size() ? index_[b + 1].offset : header_.data_bytes);
+
+    uint64_t k = block->first_key;
+    for (uint64_t i = 0; i < count; ++i) {
+        if (i > 0) {
+            uint64_t delta;
+            if (!get_varint(p, end, delta)) return Result::UNKNOWN;
+            k += delta;
+        }
+        if (k > key || p >= end) return Result::UNKNOWN;
+
+        uint8_t info = *p++;
+        size_t extra = ((info & INFO_DTW) ? 1 : 0) + ((info & INFO_MOVE) ? 2 : 0);
+        if (static_cast<size_t>(end - p) < extra) return Result::UNKNOWN;
+        if (k < key) {
+            p += extra;
+            continue;
+        }
+
+        if (info & INFO_DTW) dtw = *p++;
+        if ((info & INFO_MOVE) && best) {
+            uint16_t m = static_cast<uint16_t>(p[0] | (p[1] << 8));
+            Move mv{static_cast<uint8_t>(m & 0x1F), static_cast<uint8_t>((m >> 5) & 0x1F),
+                    static_cast<uint8_t>((m >> 10) & 0x1F)};
+            *best = key == packed ? mv : mirror_move(mv);
+        }
+        return decode_bitmap_result(info & INFO_RESULT);
+    }
+    return Result::UNKNOWN;
+}
+
+bool write_opening_book(const std::string& path, std::vector<BookEntry>& entries, bool has_dtw) {
+    std::sort(entries.begin(), entries.end(),
+              [](const BookEntry& a, const BookEntry& b) { return a.key < b.key; });
+    for (size_t i = 1; i < entries.size(); ++i) {
+        if (entries[i].key == entries[i - 1].key) {
+            std::cerr << "Duplicate key " << entries[i].key << " in opening book entries\n";
+            return false;
+        }
+    }
+
+    const uint32_t block_entries = OpeningBook::BLOCK_ENTRIES;
+    std::vector<BookBlock> index;
+    std::vector<uint8_t> data;
+    data.reserve(entries.size() * 8);
+
+    for (size_t i = 0; i < entries.size(); ++i) {
+        const BookEntry& e = entries[i];
+        if (i % block_entries == 0) {
+            index.push_back({e.key, data.size()});
+        } else {
+            put_varint(data, e.key - entries[i - 1].key);
+        }
+
+        bool with_dtw = has_dtw && (e.result == Result::WIN || e.result == Result::LOSS);
+        uint8_t info = encode_bitmap_result(e.result);
+        if (e.has_move) info |= INFO_MOVE;
+        if (with_dtw) info |= INFO_DTW;
+        data.push_back(info);
+        if (with_dtw) data.push_back(e.dtw);
+        if (e.has_move) {
+            uint16_t m = static_cast<uint16_t>(e.best.bobail_to | (e.best.pawn_from << 5) | (e.best.pawn_to << 10));
+            data.push_back(static_cast<uint8_t>(m));
+            data.push_back(static_cast<uint8_t>(m >> 8));
+        }
+    }
+
+    BookHeader h{};
+    h.magic = OpeningBook::MAGIC;
+    h.version = OpeningBook::VERSION;
+    h.rules_variant = static_cast<uint32_t>(g_rules_variant);
+    h.flags = has_dtw ? BOOK_HAS_DTW : 0;
+    h.block_entries = block_entries;
+    h.num_entries = entries.size();
+    h.num_blocks = index.size();
+    h.index_offset = sizeof(BookHeader);
+    h.data_offset = h.index_offset + index.size() * sizeof(BookBlock);
+    h.data_bytes = data.size();
+
+    // Written aside and renamed so a reader never sees half a book
+    std::string tmp_path = path + ".tmp";
+    std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        std::cerr << "Failed to create " << tmp_path << "\n";
+        return false;
+    }
+    out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+    out.write(reinterpret_cast<const char*>(index.data()),
+              static_cast<std::streamsize>(index.size() * sizeof(BookBlock)));
+    out.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+    out.close();
+
+    if (!out) {
+        std::cerr << "Failed to write " << tmp_path << "\n";
+        std::remove(tmp_path.c_str());
+        return false;
+    }
+    if (std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+        std::cerr << "Failed to rename " << tmp_path << " to " << path << ": "
+                  << std::strerror(errno) << "\n";
+        std::remove(tmp_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+std::vector<BookEntry> collect_opening_book(const BookLookup& lookup, int max_depth, int num_threads,
+                                            const std::function<void(int, uint64_t)>& progress) {
+    num_threads = std::max(1, num_threads);
+
+    // A position of the next level, with the result its parent looked up
+    struct Pending {
+        uint64_t key;
+        Result result;
+        uint8_t dtw;
+    };
+
+    State start = State::starting_position();
+    std::vector<uint8_t> start_dtw;
+    std::vector<Result> start_result = lookup(std::span<const State>(&start, 1), start_dtw);
+
+    std::vector<Pending> frontier = {{canonical_pack(start), start_result[0], start_dtw[0]}};
+    std::vector<uint64_t> visited = {frontier[0].key};  // Sorted
+    std::vector<BookEntry> entries;
+
+    for (int depth = 0; depth <= max_depth && !frontier.empty(); ++depth) {
+        size_t base = entries.size();
+        entries.resize(base + frontier.size());
+        bool expand = depth < max_depth;
+
+        std::vector<std::vector<Pending>> thread_next(num_threads);
+        auto work = [&](int t) {
+            size_t per_thread = (frontier.size() + num_threads - 1) / num_threads;
+            size_t first = t * per_thread;
+            size_t last = std::min(first + per_thread, frontier.size());
+            auto& next = thread_next[t];
+            std::vector<State> children;
+            std::vector<uint8_t> child_dtw;
+
+            for (size_t i = first; i < last; ++i) {
+                const Pending& node = frontier[i];
+                BookEntry& e = entries[base + i];
+                e.key = node.key;
+                e.result = node.result;
+                e.dtw = node.dtw;
+
+                State s = unpack_state(node.key);
+                if (check_terminal(s) != GameResult::ONGOING) continue;
+                MoveList moves;
+                generate_moves(s, moves);
+                if (moves.empty()) continue;
+
+                children.clear();
+                for (const Move& m : moves) children.push_back(apply_move(s, m));
+                std::vector<Result> child_results = lookup(children, child_dtw);
+
+                if (node.result != Result::UNKNOWN) {
+                    e.has_move = true;
+                    e.best = moves[best_move_index(node.result, child_results, child_dtw)];
+                }
+                if (!expand) continue;
+
+                for (size_t c = 0; c < children.size(); ++c) {
+                    uint64_t key = canonical_pack(children[c]);
+                    if (!std::binary_search(visited.begin(), visited.end(), key)) {
+                        next.push_back({key, child_results[c], child_dtw[c]});
+                    }
+                }
+            }
+        };
+
+        if (num_threads == 1) {
+            work(0);
+        } else {
+            std::vector<std::thread> threads;
+            for (int t = 0; t < num_threads; ++t) threads.emplace_back(work, t);
+            for (auto& th : threads) th.join();
+        }
+
+        std::vector<Pending> next;
+        for (auto& v : thread_next) {
+            next.insert(next.end(), v.begin(), v.end());
+            std::vector<Pending>().swap(v);
+        }
+        std::sort(next.begin(), next.end(), [](const Pending& a, const Pending& b) { return a.key < b.key; });
+        next.erase(std::unique(next.begin(), next.end(),
+                               [](const Pending& a, const Pending& b) { return a.key == b.key; }),
+                   next.end());
+
+        size_t old_size = visited.size();
+        for (const Pending& p : next) visited.push_back(p.key);
+        std::inplace_merge(visited.begin(), visited.begin() + old_size, visited.end());
+
+        frontier = std::move(next);
+        if (progress) progress(depth, entries.size());
+    }
+    return entries;
+}
+
+} // namespace bobail
@@ -2,15 +2,97 @@
 #include "movegen.h"
 #include "hash.h"
 #include "symmetry.h"
+#include "work_stealing_deque.h"
 #include <iostream>
+#include <algorithm>
+#include <atomic>
 #include <chrono>
-#include <unordered_set>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
 
 using namespace bobail;
 
+// Leaf counts of subtrees, keyed by canonical packed state and remaining
+// depth. Mirror images have the same perft, and the packed state is exact,
+// so a hit is never wrong. Lock-free like SearchTT: a slot stores the key
+// XORed with the count, so a torn write reads as a miss. Each bucket has a
+// slot kept for the deepest subtree and one that is always replaced.
+class PerftTable {
+public:
+    explicit PerftTable(size_t megabytes) {
+        size_t count = (megabytes << 20) / (2 * sizeof(Slot));
+        if (count == 0) return;
+        size_t buckets = 1;
+        while (buckets * 2 <= count) buckets *= 2;
+        slots_ = std::make_unique<Slot[]>(2 * buckets);
+        mask_ = buckets - 1;
+    }
+
+    bool enabled() const { return slots_ != nullptr; }
+
+    // Bits 0-55 hold the packed state, so the depth fits above them
+    static uint64_t make_key(const State& s, int depth) {
+        return canonical_pack(s) | static_cast<uint64_t>(depth) << 56;
+    }
+
+    bool probe(uint64_t key, uint64_t& count) const {
+        Slot* bucket = &slots_[2 * index(key)];
+        for (int i = 0; i < 2; ++i) {
+            uint64_t check, data;
+            load(bucket[i], check, data);
+            if ((check ^ data) == key) {
+                count = data;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void store(uint64_t key, uint64_t count) {
+        Slot* bucket = &slots_[2 * index(key)];
+        uint64_t check, data;
+        load(bucket[0], check, data);
+        int stored_depth = static_cast<int>((check ^ data) >> 56);
+        Slot& slot = static_cast<int>(key >> 56) >= stored_depth ? bucket[0] : bucket[1];
+        std::atomic_ref<uint64_t>(slot.data).store(count, std::memory_order_relaxed);
+        std::atomic_ref<uint64_t>(slot.check).store(key ^ count, std::memory_order_relaxed);
+    }
+
+private:
+    struct Slot {
+        uint64_t check = 0;  // key ^ data
+        uint64_t data = 0;   // Leaf count
+    };
+
+    size_t index(uint64_t key) const {
+        // MurmurHash3 finalizer: packed states differ mostly in high bits
+        key ^= key >> 33;
+        key *= 0xff51afd7ed558ccdULL;
+        key ^= key >> 33;
+        key *= 0xc4ceb9fe1a85ec53ULL;
+        key ^= key >> 33;
+        return key & mask_;
+    }
+
+    static void load(Slot& slot, uint64_t& check, uint64_t& data) {
+        check = std::atomic_ref<uint64_t>(slot.check).load(std::memory_order_relaxed);
+        data = std::atomic_ref<uint64_t>(slot.data).load(std::memory_order_relaxed);
+    }
+
+    std::unique_ptr<Slot[]> slots_;
+    size_t mask_ = 0;
+};
+
 // Perft: count positions at depth N
 // Used to validate move generation
-uint64_t perft(const State& s, int depth) {
+// Specialized on the rules variant, which main() selects once.
+// Depth 1 is counted in bulk from the move count; subtrees of depth 2 and
+// up go through the table when there is one.
+template <RulesVariant V>
+uint64_t perft(const State& s, int depth, PerftTable* table = nullptr) {
     if (depth == 0) {
         return 1;
     }
@@ -21,7 +103,8 @@ uint64_t perft(const State& s, int depth) {
         return 0;  // No further moves from terminal
     }
 
-    auto moves = generate_moves(s);
+    MoveList moves;
+    generate_moves<V>(s, moves);
     if (moves.empty()) {
         return 0;  // Player has no moves (loss)
     }
@@ -30,78 +113,148 @@ uint64_t perft(const State& s, int depth) {
         return moves.size();
     }
 
+    uint64_t key = 0;
+    if (table) {
+        key = PerftTable::make_key(s, depth);
+        uint64_t count;
+        if (table->probe(key, count)) return count;
+    }
+
     uint64_t count = 0;
     for (const auto& m : moves) {
         State ns = apply_move(s, m);
-        count += perft(ns, depth - 1);
+        count += perft<V>(ns, depth - 1, table);
+    }
+    if (table) table->store(key, count);
+    return count;
+}
+
+// Perft on several threads. A task is a packed state with its remaining
+// depth in the top byte. Tasks deeper than SPLIT_DEPTH are expanded into
+// their children; shallower ones are counted by perft() on the thread that
+// takes them. Each thread works off its own Chase-Lev deque and steals from
+// the others when it runs dry. Leaf counts just add up, so no task waits
+// for another.
+template <RulesVariant V>
+uint64_t parallel_perft(const State& s, int depth, int num_threads, PerftTable* table) {
+    static constexpr int SPLIT_DEPTH = 3;
+    static constexpr size_t DEQUE_CAPACITY = 1 << 16;
+
+    if (num_threads <= 1 || depth <= SPLIT_DEPTH) return perft<V>(s, depth, table);
+
+    std::vector<std::unique_ptr<WorkStealingDeque<uint64_t>>> deques;
+    for (int i = 0; i < num_threads; ++i) {
+        deques.push_back(std::make_unique<WorkStealingDeque<uint64_t>>(DEQUE_CAPACITY));
+    }
+    // Tasks queued or being worked on; everyone stops when it hits zero
+    std::atomic<int64_t> pending{1};
+    deques[0]->push(pack_state(s) | static_cast<uint64_t>(depth) << 56);
+
+    auto worker = [&](int id) -> uint64_t {
+        WorkStealingDeque<uint64_t>& own = *deques[id];
+        std::minstd_rand rng(id + 1);
+        uint64_t total = 0;
+        uint64_t task;
+        while (pending.load(std::memory_order_acquire) > 0) {
+            if (!own.pop(task) && !deques[rng() % num_threads]->steal(task)) {
+                std::this_thread::yield();
+                continue;
+            }
+
+            State ts = unpack_state(task & ((1ULL << 56) - 1));
+            int d = static_cast<int>(task >> 56);
+            if (d <= SPLIT_DEPTH || check_terminal(ts) != GameResult::ONGOING) {
+                total += perft<V>(ts, d, table);
+            } else {
+                MoveList moves;
+                generate_moves<V>(ts, moves);
+                for (const auto& m : moves) {
+                    State ns = apply_move(ts, m);
+                    pending.fetch_add(1, std::memory_order_relaxed);
+                    if (!own.push(pack_state(ns) | static_cast<uint64_t>(d - 1) << 56)) {
+                        // Deque full: count it here instead
+                        pending.fetch_sub(1, std::memory_order_relaxed);
+                        total += perft<V>(ns, d - 1, table);
+                    }
+                }
+            }
+            pending.fetch_sub(1, std::memory_order_acq_rel);
+        }
+        return total;
+    };
+
+    std::vector<uint64_t> totals(num_threads);
+    std::vector<std::thread> threads;
+    for (int i = 1; i < num_threads; ++i) {
+        threads.emplace_back([&, i] { totals[i] = worker(i); });
     }
+    totals[0] = worker(0);
+    for (auto& t : threads) t.join();
+
+    uint64_t count = 0;
+    for (uint64_t t : totals) count += t;
     return count;
 }
 
 // Divide: show perft for each first move
-void divide(const State& s, int depth) {
-    auto moves = generate_moves(s);
+template <RulesVariant V>
+void divide(const State& s, int depth, int num_threads, PerftTable* table) {
+    MoveList moves;
+    generate_moves<V>(s, moves);
     uint64_t total = 0;
 
     std::cout << "Divide at depth " << depth << ":\n";
     for (const auto& m : moves) {
         State ns = apply_move(s, m);
-        uint64_t count = perft(ns, depth - 1);
+        uint64_t count = parallel_perft<V>(ns, depth - 1, num_threads, table);
         std::cout << "  " << m.to_string() << ": " << count << "\n";
         total += count;
     }
     std::cout << "Total: " << total << "\n";
 }
 
-// Count unique canonical positions at depth
-uint64_t unique_positions(const State& s, int depth, std::unordered_set<uint64_t>& seen) {
+// Collect the canonical positions at depth; the caller sorts and dedups
+template <RulesVariant V>
+void unique_positions(const State& s, int depth, std::vector<uint64_t>& seen) {
     if (depth == 0) {
-        auto [canonical, _] = canonicalize(s);
-        uint64_t key = pack_state(canonical);
-        if (seen.insert(key).second) {
-            return 1;
-        }
-        return 0;
+        seen.push_back(canonical_pack(s));
+        return;
     }
 
     GameResult result = check_terminal(s);
     if (result != GameResult::ONGOING) {
-        return 0;
-    }
-
-    auto moves = generate_moves(s);
-    if (moves.empty()) {
-        return 0;
+        return;
     }
 
-    uint64_t count = 0;
+    MoveList moves;
+    generate_moves<V>(s, moves);
     for (const auto& m : moves) {
         State ns = apply_move(s, m);
-        count += unique_positions(ns, depth - 1, seen);
+        unique_positions<V>(ns, depth - 1, seen);
     }
-    return count;
 }
 
-int main(int argc, char* argv[]) {
-    int max_depth = 4;
-    if (argc > 1) {
-        max_depth = std::stoi(argv[1]);
-    }
-
-    // Initialize
-    init_move_tables();
-    init_zobrist();
-    init_symmetry();
-
+template <RulesVariant V>
+void run_perft(int max_depth, int num_threads, size_t hash_mb, int divide_depth) {
     State start = State::starting_position();
     std::cout << "Bobail Perft\n";
     std::cout << "============\n\n";
     std::cout << start.to_string() << "\n";
+    std::cout << "Threads: " << num_threads << ", hash: " << hash_mb << " MB\n\n";
+
+    // Shared by every depth: entries carry their own depth
+    PerftTable table(hash_mb);
+    PerftTable* tp = table.enabled() ? &table : nullptr;
+
+    if (divide_depth > 0) {
+        divide<V>(start, divide_depth, num_threads, tp);
+        return;
+    }
 
     // Run perft for each depth
     for (int d = 0; d <= max_depth; ++d) {
         auto t0 = std::chrono::high_resolution_clock::now();
-        uint64_t count = perft(start, d);
+        uint64_t count = parallel_perft<V>(start, d, num_threads, tp);
         auto t1 = std::chrono::high_resolution_clock::now();
         auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count();
 
@@ -115,10 +268,62 @@ int main(int argc, char* argv[]) {
     // Show unique positions with symmetry reduction
     std::cout << "\nUnique canonical positions:\n";
     for (int d = 0; d <= std::min(max_depth, 3); ++d) {
-        std::unordered_set<uint64_t> seen;
-        unique_positions(start, d, seen);
+        std::vector<uint64_t> seen;
+        unique_positions<V>(start, d, seen);
+        std::sort(seen.begin(), seen.end());
+        seen.erase(std::unique(seen.begin(), seen.end()), seen.end());
         std::cout << "depth " << d << ": " << seen.size() << " unique positions\n";
     }
+}
+
+void print_usage(const char* prog) {
+    std::cerr << "Usage: " << prog << " [depth] [options]\n"
+              << "Options:\n"
+              << "  --official   Use official rules (pawns move max distance) [default]\n"
+              << "  --flexible   Use flexible rules (pawns can stop anywhere)\n"
+              << "  --threads N  Search threads [default: all cores]\n"
+              << "  --hash MB    Perft table size, 0 to disable [default: 256]\n"
+              << "  --divide D   Print perft(D - 1) after each first move instead\n";
+}
+
+int main(int argc, char* argv[]) {
+    int max_depth = 4;
+    int num_threads = std::max(1u, std::thread::hardware_concurrency());
+    size_t hash_mb = 256;
+    int divide_depth = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--official") == 0) {
+            g_rules_variant = RulesVariant::OFFICIAL;
+        } else if (std::strcmp(argv[i], "--flexible") == 0) {
+            g_rules_variant = RulesVariant::FLEXIBLE;
+        } else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            num_threads = std::max(1, std::stoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--hash") == 0 && i + 1 < argc) {
+            hash_mb = std::stoull(argv[++i]);
+        } else if (std::strcmp(argv[i], "--divide") == 0 && i + 1 < argc) {
+            divide_depth = std::stoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--help") == 0 || std::strcmp(argv[i], "-h") == 0) {
+            print_usage(argv[0]);
+            return 0;
+        } else {
+            max_depth = std::stoi(argv[i]);
+        }
+    }
+
+    // Initialize
+    init_move_tables();
+    init_zobrist();
+    init_symmetry();
+
+    std::cout << "Rules: " << (g_rules_variant == RulesVariant::OFFICIAL ? "official" : "flexible") << "\n";
+
+    // Pick the specialized kernels once for the whole run
+    if (g_rules_variant == RulesVariant::FLEXIBLE) {
+        run_perft<RulesVariant::FLEXIBLE>(max_depth, num_threads, hash_mb, divide_depth);
+    } else {
+        run_perft<RulesVariant::OFFICIAL>(max_depth, num_threads, hash_mb, divide_depth);
+    }
 
     return 0;
 }
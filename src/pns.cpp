@@ -7,6 +7,30 @@
 
 namespace bobail {
 
+uint32_t PNSNodeArena::allocate(uint32_t count) {
+    uint32_t offset = next_ & (CHUNK_NODES - 1);
+    uint64_t start = next_;
+    if (offset != 0 && offset + count > CHUNK_NODES) {
+        start += CHUNK_NODES - offset;  // Keep the range inside one chunk
+    }
+    if (count > CHUNK_NODES || start + count >= NO_NODE) return NO_NODE;
+
+    while (chunks_.size() <= ((start + count - 1) >> CHUNK_BITS)) {
+        chunks_.push_back(std::make_unique<PNSNode[]>(CHUNK_NODES));
+    }
+    auto first = static_cast<uint32_t>(start);
+    std::fill_n(&(*this)[first], count, PNSNode{});  // Chunks are reused across searches
+    next_ = first + count;
+    used_ += count;
+    return first;
+}
+
+void PNSNodeArena::clear() {
+    if (chunks_.size() > 1) chunks_.resize(1);
+    next_ = 0;
+    used_ = 0;
+}
+
 PNSSolver::PNSSolver(size_t tt_size) : tt_(tt_size) {}
 
 Result PNSSolver::solve(const State& root_state) {
@@ -15,22 +39,29 @@ Result PNSSolver::solve(const State& root_state) {
     nodes_disproved_ = 0;
     tt_.clear();
 
-    root_ = std::make_unique<PNSNode>(root_state);
+    nodes_.clear();
+    out_of_nodes_ = false;
+    root_state_ = root_state;
+    nodes_.allocate(1);  // ROOT
+    PNSNode& root = nodes_[ROOT];
 
     // Check if root is already terminal
     if (is_terminal(root_state)) {
-        set_terminal(root_.get());
-        if (root_->proof == 0) return Result::WIN;
-        if (root_->disproof == 0) return Result::LOSS;
+        set_terminal(root, root_state);
+        if (root.proof == 0) return Result::WIN;
+        if (root.disproof == 0) return Result::LOSS;
     }
 
     // Main PNS loop
-    while (root_->proof != 0 && root_->disproof != 0) {
+    while (root.proof != 0 && root.disproof != 0) {
         if (node_limit_ > 0 && nodes_searched_ >= node_limit_) {
             break;  // Hit node limit
         }
+        if (out_of_nodes_) {
+            break;  // Tree indices exhausted
+        }
 
-        pns_search(root_.get());
+        pns_search();
 
         // Progress callback
         if (progress_cb_ && (nodes_searched_ % 100000 == 0)) {
@@ -38,268 +69,218 @@ Result PNSSolver::solve(const State& root_state) {
         }
     }
 
-    if (root_->proof == 0) {
+    if (root.proof == 0) {
         return Result::WIN;
-    } else if (root_->disproof == 0) {
+    } else if (root.disproof == 0) {
         return Result::LOSS;
     }
     return Result::UNKNOWN;  // Hit limit before solving
 }
 
-void PNSSolver::pns_search(PNSNode* node) {
+void PNSSolver::pns_search() {
     // Collect path from root to most proving node
-    std::vector<PNSNode*> path;
-    path.push_back(node);
+    path_.clear();
+    path_.push_back({ROOT, root_state_});
 
-    PNSNode* current = node;
-    bool is_or = (current->state.white_to_move == root_->state.white_to_move);
+    uint32_t current = ROOT;
+    while (nodes_[current].expanded && nodes_[current].num_children > 0) {
+        const PNSNode& node = nodes_[current];
+        bool is_or = is_or_node(path_.back().state);
 
-    while (current->expanded && !current->children.empty()) {
         // Select best child
-        PNSNode* best = nullptr;
+        uint32_t best = PNSNodeArena::NO_NODE;
         uint32_t best_value = PN_INFINITY;
-
-        for (auto& child : current->children) {
-            uint32_t value = is_or ? child->proof : child->disproof;
+        for (uint32_t i = node.first_child; i < node.first_child + node.num_children; ++i) {
+            const PNSNode& child = nodes_[i];
+            uint32_t value = is_or ? child.proof : child.disproof;
             if (value < best_value) {
                 best_value = value;
-                best = child.get();
+                best = i;
             }
         }
 
-        if (best == nullptr || best_value == 0) {
+        if (best == PNSNodeArena::NO_NODE || best_value == 0) {
             break;  // Solved or no valid child
         }
 
-        path.push_back(best);
+        path_.push_back({best, apply_move(path_.back().state, nodes_[best].move)});
         current = best;
-        is_or = !is_or;
     }
 
     // Expand the leaf node
-    if (!current->expanded) {
-        expand(current);
+    if (!nodes_[current].expanded) {
+        expand(current, path_.back().state);
     }
 
-    // Update only nodes on the path (from leaf to root)
-    for (auto it = path.rbegin(); it != path.rend(); ++it) {
-        update_node(*it);
+    // Update ancestors from the leaf up. A node whose numbers did not
+    // change leaves everything above it unchanged too.
+    for (size_t i = path_.size() - 1; i-- > 0;) {
+        if (!update_node(path_[i].node, path_[i].state)) break;
     }
 }
 
-PNSNode* PNSSolver::select_most_proving(PNSNode* node, bool is_or_node) {
-    if (!node->expanded) {
-        return node;  // This node needs expansion
-    }
-
-    if (node->children.empty()) {
-        return nullptr;  // Terminal node
-    }
-
-    // Select child based on node type
-    PNSNode* best = nullptr;
-    uint32_t best_value = PN_INFINITY;
-
-    for (auto& child : node->children) {
-        uint32_t value = is_or_node ? child->proof : child->disproof;
-
-        if (value < best_value) {
-            best_value = value;
-            best = child.get();
-        }
-    }
-
-    if (best == nullptr || best_value == 0) {
-        return nullptr;  // Already solved
-    }
-
-    // Recurse
-    return select_most_proving(best, !is_or_node);
-}
-
-void PNSSolver::expand(PNSNode* node) {
-    if (node->expanded) return;
-
-    node->expanded = true;
-    ++nodes_searched_;
+void PNSSolver::expand(uint32_t index, const State& state) {
+    PNSNode& node = nodes_[index];
+    if (node.expanded) return;
 
     // Check TT first
-    uint64_t hash = get_hash(node->state);
+    uint64_t hash = get_hash(state);
     TTEntry* tt_entry = tt_.probe(hash);
     if (tt_entry && tt_entry->is_solved()) {
+        node.expanded = true;
+        ++nodes_searched_;
         if (tt_entry->result == Result::WIN) {
-            node->proof = 0;
-            node->disproof = PN_INFINITY;
+            node.proof = 0;
+            node.disproof = PN_INFINITY;
             ++nodes_proved_;
         } else if (tt_entry->result == Result::LOSS) {
-            node->proof = PN_INFINITY;
-            node->disproof = 0;
+            node.proof = PN_INFINITY;
+            node.disproof = 0;
             ++nodes_disproved_;
         }
         return;
     }
 
     // Check terminal
-    if (is_terminal(node->state)) {
-        set_terminal(node);
-        // Store in TT
-        TTEntry entry;
-        entry.key = hash;
-        entry.proof = node->proof;
-        entry.disproof = node->disproof;
-        if (node->proof == 0) entry.result = Result::WIN;
-        else if (node->disproof == 0) entry.result = Result::LOSS;
-        tt_.store(hash, entry);
+    if (is_terminal(state)) {
+        node.expanded = true;
+        ++nodes_searched_;
+        set_terminal(node, state);
+        store_solved(state, node);
         return;
     }
 
     // Generate moves and create children
-    auto moves = generate_moves(node->state);
+    MoveList moves;
+    generate_moves(state, moves);
 
     if (moves.empty()) {
         // No legal moves = loss for side to move
-        node->proof = PN_INFINITY;
-        node->disproof = 0;
-        ++nodes_disproved_;
+        node.expanded = true;
+        ++nodes_searched_;
+        if (is_or_node(state)) {
+            node.proof = PN_INFINITY;
+            node.disproof = 0;
+            ++nodes_disproved_;
+        } else {
+            node.proof = 0;
+            node.disproof = PN_INFINITY;
+            ++nodes_proved_;
+        }
+        store_solved(state, node);
+        return;
+    }
 
-        TTEntry entry;
-        entry.key = hash;
-        entry.proof = PN_INFINITY;
-        entry.disproof = 0;
-        entry.result = Result::LOSS;
-        tt_.store(hash, entry);
+    uint32_t first = nodes_.allocate(static_cast<uint32_t>(moves.size()));
+    if (first == PNSNodeArena::NO_NODE) {
+        out_of_nodes_ = true;
         return;
     }
+    node.expanded = true;
+    node.first_child = first;
+    node.num_children = static_cast<uint16_t>(moves.size());
+    ++nodes_searched_;
 
-    for (const auto& move : moves) {
-        State child_state = apply_move(node->state, move);
-        auto child = std::make_unique<PNSNode>(child_state);
-        child->move = move;
+    for (size_t i = 0; i < moves.size(); ++i) {
+        PNSNode& child = nodes_[first + static_cast<uint32_t>(i)];
+        child.move = moves[i];
+        State child_state = apply_move(state, moves[i]);
 
         // Check if child is terminal or in TT
         uint64_t child_hash = get_hash(child_state);
         TTEntry* child_tt = tt_.probe(child_hash);
         if (child_tt && child_tt->is_solved()) {
-            child->proof = child_tt->proof;
-            child->disproof = child_tt->disproof;
-            child->expanded = true;
+            child.proof = child_tt->proof;
+            child.disproof = child_tt->disproof;
+            child.expanded = true;
         } else if (is_terminal(child_state)) {
-            set_terminal(child.get());
-            child->expanded = true;
+            set_terminal(child, child_state);
+            child.expanded = true;
         }
-
-        node->children.push_back(std::move(child));
     }
 
     // Update this node's proof numbers based on children
-    update_node(node);
+    update_node(index, state);
 }
 
-void PNSSolver::update_node(PNSNode* node) {
-    if (node->children.empty()) return;
+bool PNSSolver::update_node(uint32_t index, const State& state) {
+    PNSNode& node = nodes_[index];
+    if (node.num_children == 0) return false;
 
-    // Determine node type
-    bool is_or_node = (node->state.white_to_move == root_->state.white_to_move);
-
-    if (is_or_node) {
+    uint32_t proof;
+    uint32_t disproof;
+    uint32_t end = node.first_child + node.num_children;
+    if (is_or_node(state)) {
         // OR node: proof = min(children.proof), disproof = sum(children.disproof)
         uint32_t min_proof = PN_INFINITY;
         uint64_t sum_disproof = 0;
 
-        for (auto& child : node->children) {
-            min_proof = std::min(min_proof, child->proof);
-            sum_disproof += child->disproof;
+        for (uint32_t i = node.first_child; i < end; ++i) {
+            const PNSNode& child = nodes_[i];
+            min_proof = std::min(min_proof, child.proof);
+            sum_disproof += child.disproof;
             if (sum_disproof > PN_INFINITY) sum_disproof = PN_INFINITY;
         }
 
-        node->proof = min_proof;
-        node->disproof = static_cast<uint32_t>(std::min(sum_disproof, static_cast<uint64_t>(PN_INFINITY)));
+        proof = min_proof;
+        disproof = static_cast<uint32_t>(std::min(sum_disproof, static_cast<uint64_t>(PN_INFINITY)));
     } else {
         // AND node: proof = sum(children.proof), disproof = min(children.disproof)
         uint64_t sum_proof = 0;
         uint32_t min_disproof = PN_INFINITY;
 
-        for (auto& child : node->children) {
-            sum_proof += child->proof;
+        for (uint32_t i = node.first_child; i < end; ++i) {
+            const PNSNode& child = nodes_[i];
+            sum_proof += child.proof;
             if (sum_proof > PN_INFINITY) sum_proof = PN_INFINITY;
-            min_disproof = std::min(min_disproof, child->disproof);
+            min_disproof = std::min(min_disproof, child.disproof);
         }
 
-        node->proof = static_cast<uint32_t>(std::min(sum_proof, static_cast<uint64_t>(PN_INFINITY)));
-        node->disproof = min_disproof;
+        proof = static_cast<uint32_t>(std::min(sum_proof, static_cast<uint64_t>(PN_INFINITY)));
+        disproof = min_disproof;
     }
 
+    if (proof == node.proof && disproof == node.disproof) return false;
+    node.proof = proof;
+    node.disproof = disproof;
+
     // Track solved nodes
-    if (node->proof == 0) {
+    if (node.proof == 0) {
         ++nodes_proved_;
-        uint64_t hash = get_hash(node->state);
-        TTEntry entry;
-        entry.key = hash;
-        entry.proof = 0;
-        entry.disproof = PN_INFINITY;
-        entry.result = Result::WIN;
-        tt_.store(hash, entry);
-    } else if (node->disproof == 0) {
+        store_solved(state, node);
+    } else if (node.disproof == 0) {
         ++nodes_disproved_;
-        uint64_t hash = get_hash(node->state);
-        TTEntry entry;
-        entry.key = hash;
-        entry.proof = PN_INFINITY;
-        entry.disproof = 0;
-        entry.result = Result::LOSS;
-        tt_.store(hash, entry);
+        store_solved(state, node);
     }
+    return true;
 }
 
-void PNSSolver::update_tree(PNSNode* node) {
-    if (!node->expanded || node->children.empty()) return;
-
-    // Update children first (post-order)
-    for (auto& child : node->children) {
-        update_tree(child.get());
-    }
-
-    // Then update this node
-    update_node(node);
+void PNSSolver::store_solved(const State& state, const PNSNode& node) {
+    if (node.proof != 0 && node.disproof != 0) return;
+    uint64_t hash = get_hash(state);
+    TTEntry entry;
+    entry.key = hash;
+    entry.proof = node.proof;
+    entry.disproof = node.disproof;
+    entry.result = node.proof == 0 ? Result::WIN : Result::LOSS;
+    tt_.store(hash, entry);
 }
 
-void PNSSolver::set_terminal(PNSNode* node) {
-    GameResult result = check_terminal(node->state);
-
-    if (result == GameResult::WHITE_WINS) {
-        if (node->state.white_to_move) {
-            // Current player (white) just won - but this shouldn't happen
-            // as terminal is checked after opponent's move
-            // Actually in Bobail, you win when Bobail reaches YOUR home row
-            // So if it's white's turn and Bobail is on row 0, white already won
-            // This means the PREVIOUS player (black) moved Bobail to white's home row
-            // which would be a loss for black... Let me reconsider.
-
-            // After a move, we check terminal. The state has already switched sides.
-            // If white_to_move and Bobail on row 0, that means black just moved
-            // and Bobail ended on white's home row. White wins!
-            node->proof = 0;
-            node->disproof = PN_INFINITY;
-            ++nodes_proved_;
-        } else {
-            // It's black's turn, Bobail on row 0 = white wins
-            // From black's perspective, this is a loss
-            node->proof = PN_INFINITY;
-            node->disproof = 0;
-            ++nodes_disproved_;
-        }
-    } else if (result == GameResult::BLACK_WINS) {
-        if (!node->state.white_to_move) {
-            // Black's turn, Bobail on row 4 = black wins = win for current player
-            node->proof = 0;
-            node->disproof = PN_INFINITY;
-            ++nodes_proved_;
-        } else {
-            // White's turn, Bobail on row 4 = black wins = loss for current player
-            node->proof = PN_INFINITY;
-            node->disproof = 0;
-            ++nodes_disproved_;
-        }
+void PNSSolver::set_terminal(PNSNode& node, const State& state) {
+    GameResult result = check_terminal(state);
+    if (result == GameResult::ONGOING) return;
+
+    // Proof numbers are from the root player's point of view: a proof
+    // means the player to move at the root wins
+    bool white_won = result == GameResult::WHITE_WINS;
+    if (white_won == root_state_.white_to_move) {
+        node.proof = 0;
+        node.disproof = PN_INFINITY;
+        ++nodes_proved_;
+    } else {
+        node.proof = PN_INFINITY;
+        node.disproof = 0;
+        ++nodes_disproved_;
     }
 }
 
@@ -313,36 +294,28 @@ uint64_t PNSSolver::get_hash(const State& s) {
 
 std::vector<Move> PNSSolver::get_pv() const {
     std::vector<Move> pv;
-    if (!root_) return pv;
+    if (nodes_.size() == 0) return pv;
 
-    PNSNode* node = root_.get();
-    while (node && node->expanded && !node->children.empty()) {
+    uint32_t index = ROOT;
+    bool is_or = true;  // The root is an OR node and the sides alternate
+    while (nodes_[index].expanded && nodes_[index].num_children > 0) {
         // Find the best child (proved if this is proved, or best proof number)
-        PNSNode* best = nullptr;
-        bool is_or = (node->state.white_to_move == root_->state.white_to_move);
+        const PNSNode& node = nodes_[index];
+        uint32_t best = node.first_child;
 
-        for (auto& child : node->children) {
-            if (best == nullptr) {
-                best = child.get();
-            } else if (is_or) {
+        for (uint32_t i = node.first_child + 1; i < node.first_child + node.num_children; ++i) {
+            if (is_or) {
                 // OR node: want min proof
-                if (child->proof < best->proof) {
-                    best = child.get();
-                }
+                if (nodes_[i].proof < nodes_[best].proof) best = i;
             } else {
                 // AND node: want min disproof
-                if (child->disproof < best->disproof) {
-                    best = child.get();
-                }
+                if (nodes_[i].disproof < nodes_[best].disproof) best = i;
             }
         }
 
-        if (best) {
-            pv.push_back(best->move);
-            node = best;
-        } else {
-            break;
-        }
+        pv.push_back(nodes_[best].move);
+        index = best;
+        is_or = !is_or;
     }
 
     return pv;
@@ -0,0 +1,312 @@
+#include "pns_checkpoint.h"
+#include "hash.h"
+#include <algorithm>
+#include <bit>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace bobail {
+
+namespace {
+
+// Record of the original checkpoint format
+struct LegacyEntry {
+    uint64_t hash;
+    uint32_t proof;
+    uint32_t disproof;
+    uint8_t result;
+};
+
+// Slots copied per write() call
+constexpr size_t CHUNK_SLOTS = 1 << 16;
+
+bool write_all(int fd, const void* data, size_t bytes) {
+    const char* p = static_cast<const char*>(data);
+    while (bytes > 0) {
+        ssize_t n = ::write(fd, p, bytes);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        p += n;
+        bytes -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+uint64_t new_snapshot_id() {
+    std::random_device rd;
+    uint64_t id = (static_cast<uint64_t>(rd()) << 32) ^ rd() ^
+                  static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+    return id ? id : 1;
+}
+
+} // namespace
+
+bool PNSCheckpointer::load(PNSTable& table, uint64_t mode, Counters& counters) {
+    wait();
+    std::ifstream in(path_, std::ios::binary);
+    if (!in) return false;
+
+    uint64_t prefix[2] = {0, 0};
+    in.read(reinterpret_cast<char*>(prefix), sizeof(prefix));
+    if (!in || prefix[0] != MAGIC) {
+        std::cerr << "Invalid checkpoint magic\n";
+        return false;
+    }
+    if (prefix[1] == 1 || prefix[1] == 2) return load_legacy(table, mode, counters);
+    if (prefix[1] != VERSION) {
+        std::cerr << "Unsupported checkpoint version " << prefix[1] << "\n";
+        return false;
+    }
+
+    PNSSnapshotHeader header{};
+    in.seekg(0);
+    in.read(reinterpret_cast<char*>(&header), sizeof(header));
+    in.close();
+    if (mode != ANY_MODE && header.mode != mode) {
+        std::cerr << "Checkpoint was written by another search mode; resume it in the same mode\n";
+        return false;
+    }
+    if (!use_hash_mode(header.key_mode)) return false;
+    struct stat st;
+    uint64_t expected = HEADER_BYTES + header.capacity * sizeof(PNSSlot);
+    if (stat(path_.c_str(), &st) != 0 || static_cast<uint64_t>(st.st_size) != expected) {
+        std::cerr << "Checkpoint " << path_ << " is truncated\n";
+        return false;
+    }
+    if (!table.map_file(path_, HEADER_BYTES, header.capacity, header.size)) return false;
+
+    std::copy(std::begin(header.counters), std::end(header.counters), counters.begin());
+    have_snapshot_ = true;
+    snapshot_id_ = header.snapshot_id;
+    snapshot_bytes_ = expected;
+    loaded_deltas_ = load_deltas(table, counters);
+
+    table.track_dirty(true);
+    snapshot_layout_ = table.layout_version();
+    return true;
+}
+
+bool PNSCheckpointer::read(const std::string& path, PNSTable& table, Counters& counters) {
+    PNSCheckpointer reader(path);
+    reader.read_only_ = true;
+    if (!reader.load(table, ANY_MODE, counters)) return false;
+    table.track_dirty(false);
+    return true;
+}
+
+bool PNSCheckpointer::load_legacy(PNSTable& table, uint64_t mode, Counters& counters) {
+    std::ifstream in(path_, std::ios::binary);
+    uint64_t version = 0, num_entries = 0;
+    in.seekg(sizeof(uint64_t));
+    in.read(reinterpret_cast<char*>(&version), sizeof(version));
+    // The version of these files was the search mode
+    if (mode != ANY_MODE && version != mode) {
+        std::cerr << "Checkpoint was written by another search mode; resume it in the same mode\n";
+        return false;
+    }
+    in.read(reinterpret_cast<char*>(&num_entries), sizeof(num_entries));
+    in.read(reinterpret_cast<char*>(counters.data()), sizeof(uint64_t) * counters.size());
+    use_hash_mode(static_cast<uint64_t>(HashMode::ZOBRIST));
+
+    table.clear();
+    if (!table.reserve(num_entries)) return false;
+    for (uint64_t i = 0; i < num_entries; ++i) {
+        LegacyEntry entry;
+        in.read(reinterpret_cast<char*>(&entry), sizeof(entry));
+        if (!in) break;
+        table.insert(entry.hash)->set(entry.proof, entry.disproof, entry.result);
+    }
+
+    // The next checkpoint rewrites it in the current format
+    have_snapshot_ = false;
+    loaded_deltas_ = 0;
+    table.track_dirty(true);
+    return true;
+}
+
+uint64_t PNSCheckpointer::load_deltas(PNSTable& table, Counters& counters) {
+    delta_bytes_ = 0;
+    std::ifstream in(delta_path(), std::ios::binary);
+    if (!in) return 0;
+
+    uint64_t applied = 0;
+    std::vector<PNSDeltaRecord> records(CHUNK_SLOTS);
+    while (true) {
+        PNSDeltaHeader header{};
+        in.read(reinterpret_cast<char*>(&header), sizeof(header));
+        if (!in || header.magic != DELTA_MAGIC || header.snapshot_id != snapshot_id_) break;
+
+        // Check the commit word before touching the table
+        uint64_t records_bytes = header.num_records * sizeof(PNSDeltaRecord);
+        uint64_t start = delta_bytes_ + sizeof(header);
+        uint64_t commit = 0;
+        in.seekg(static_cast<std::streamoff>(start + records_bytes));
+        in.read(reinterpret_cast<char*>(&commit), sizeof(commit));
+        if (!in || commit != (DELTA_MAGIC ^ header.num_records)) break;
+        in.seekg(static_cast<std::streamoff>(start));
+
+        bool valid = true;
+        for (uint64_t done = 0; done < header.num_records && valid;) {
+            size_t n = static_cast<size_t>(std::min<uint64_t>(records.size(), header.num_records - done));
+            in.read(reinterpret_cast<char*>(records.data()), n * sizeof(PNSDeltaRecord));
+            for (size_t i = 0; i < n && valid; ++i) {
+                valid = records[i].index < table.capacity();
+                if (valid) table.restore_slot(records[i].index, PNSSlot{records[i].key, records[i].numbers});
+            }
+            done += n;
+        }
+        if (!in || !valid) break;
+        in.seekg(static_cast<std::streamoff>(sizeof(commit)), std::ios::cur);
+
+        std::copy(std::begin(header.counters), std::end(header.counters), counters.begin());
+        delta_bytes_ = start + records_bytes + sizeof(commit);
+        ++applied;
+    }
+    in.close();
+
+    // Cut off a torn or stale tail so new deltas follow the last good one.
+    // Readers leave it alone: the search may be appending right now.
+    if (!read_only_ && ::truncate(delta_path().c_str(), static_cast<off_t>(delta_bytes_)) != 0) {
+        std::cerr << "Failed to truncate " << delta_path() << ": " << std::strerror(errno) << "\n";
+    }
+    return applied;
+}
+
+bool PNSCheckpointer::start(PNSTable& table, uint64_t mode, const Counters& counters) {
+    if (busy()) return false;
+    if (writer_.joinable()) writer_.join();
+
+    bool full = !have_snapshot_ || snapshot_layout_ != table.layout_version() ||
+                delta_bytes_ > snapshot_bytes_ / 2;
+    running_.store(true, std::memory_order_release);
+    if (full) {
+        // Writes from here on go to the first delta
+        table.track_dirty(true);
+        snapshot_id_ = new_snapshot_id();
+        snapshot_layout_ = table.layout_version();
+        writer_ = std::thread(&PNSCheckpointer::write_snapshot, this, std::cref(table), mode, counters);
+    } else {
+        writer_ = std::thread(&PNSCheckpointer::write_delta, this, std::cref(table), table.take_dirty(), counters);
+    }
+    return true;
+}
+
+bool PNSCheckpointer::wait() {
+    if (writer_.joinable()) writer_.join();
+    return report_.ok;
+}
+
+void PNSCheckpointer::write_snapshot(const PNSTable& table, uint64_t mode, Counters counters) {
+    auto t0 = std::chrono::steady_clock::now();
+    report_ = Report{};
+    report_.full = true;
+    // Until this one is complete, the files on disk are stale
+    have_snapshot_ = false;
+
+    std::string temp_path = path_ + ".tmp";
+    int fd = ::open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    bool ok = fd >= 0;
+
+    PNSSnapshotHeader header{};
+    header.magic = MAGIC;
+    header.version = VERSION;
+    header.mode = mode;
+    header.snapshot_id = snapshot_id_;
+    header.capacity = table.capacity();
+    std::copy(counters.begin(), counters.end(), header.counters);
+    header.key_mode = static_cast<uint64_t>(g_hash_mode);
+    std::vector<char> page(HEADER_BYTES, 0);
+    ok = ok && write_all(fd, page.data(), page.size());
+
+    std::vector<PNSSlot> chunk(CHUNK_SLOTS);
+    for (size_t i = 0; ok && i < table.capacity(); i += CHUNK_SLOTS) {
+        size_t n = std::min(CHUNK_SLOTS, table.capacity() - i);
+        for (size_t j = 0; j < n; ++j) {
+            chunk[j] = table.load_slot(i + j);
+            if (chunk[j].key != 0) ++header.size;
+        }
+        ok = write_all(fd, chunk.data(), n * sizeof(PNSSlot));
+    }
+
+    // The header goes in last, with the number of slots actually copied
+    std::memcpy(page.data(), &header, sizeof(header));
+    ok = ok && ::pwrite(fd, page.data(), page.size(), 0) == static_cast<ssize_t>(page.size());
+    ok = ok && ::fdatasync(fd) == 0;
+    if (fd >= 0) ok = ::close(fd) == 0 && ok;
+    ok = ok && std::rename(temp_path.c_str(), path_.c_str()) == 0;
+    if (ok) {
+        // The old deltas belong to the previous snapshot
+        std::remove(delta_path().c_str());
+        have_snapshot_ = true;
+        snapshot_bytes_ = HEADER_BYTES + table.capacity() * sizeof(PNSSlot);
+        delta_bytes_ = 0;
+    } else {
+        std::cerr << "\nFailed to write checkpoint " << path_ << ": " << std::strerror(errno) << "\n";
+        std::remove(temp_path.c_str());
+    }
+
+    report_.ok = ok;
+    report_.entries = header.size;
+    report_.bytes = HEADER_BYTES + table.capacity() * sizeof(PNSSlot);
+    report_.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    running_.store(false, std::memory_order_release);
+}
+
+void PNSCheckpointer::write_delta(const PNSTable& table, std::vector<uint64_t> dirty, Counters counters) {
+    auto t0 = std::chrono::steady_clock::now();
+    report_ = Report{};
+
+    PNSDeltaHeader header{};
+    header.magic = DELTA_MAGIC;
+    header.snapshot_id = snapshot_id_;
+    for (uint64_t word : dirty) header.num_records += std::popcount(word);
+    std::copy(counters.begin(), counters.end(), header.counters);
+
+    int fd = ::open(delta_path().c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    bool ok = fd >= 0 && write_all(fd, &header, sizeof(header));
+
+    std::vector<PNSDeltaRecord> records;
+    records.reserve(CHUNK_SLOTS);
+    for (size_t w = 0; ok && w < dirty.size(); ++w) {
+        for (uint64_t bits = dirty[w]; bits; bits &= bits - 1) {
+            size_t i = w * 64 + std::countr_zero(bits);
+            PNSSlot slot = table.load_slot(i);
+            records.push_back({i, slot.key, slot.numbers});
+        }
+        if (records.size() + 64 > CHUNK_SLOTS || w + 1 == dirty.size()) {
+            ok = write_all(fd, records.data(), records.size() * sizeof(PNSDeltaRecord));
+            records.clear();
+        }
+    }
+    uint64_t commit = DELTA_MAGIC ^ header.num_records;
+    ok = ok && write_all(fd, &commit, sizeof(commit));
+    ok = ok && ::fdatasync(fd) == 0;
+    if (fd >= 0) ok = ::close(fd) == 0 && ok;
+
+    uint64_t bytes = sizeof(header) + header.num_records * sizeof(PNSDeltaRecord) + sizeof(commit);
+    if (ok) {
+        delta_bytes_ += bytes;
+    } else {
+        // A torn delta is cut off at the next load; start over with a snapshot
+        std::cerr << "\nFailed to append checkpoint delta " << delta_path() << ": " << std::strerror(errno) << "\n";
+        have_snapshot_ = false;
+    }
+
+    report_.ok = ok;
+    report_.entries = header.num_records;
+    report_.bytes = bytes;
+    report_.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    running_.store(false, std::memory_order_release);
+}
+
+} // namespace bobail
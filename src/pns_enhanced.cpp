@@ -3,106 +3,83 @@
 #include "hash.h"
 #include "symmetry.h"
 #include "retrograde_db.h"
+#include "pns_checkpoint.h"
+#include "solver_metrics.h"
 #include <iostream>
 #include <fstream>
 #include <chrono>
 #include <csignal>
+#include <algorithm>
 #include <atomic>
-#include <unordered_map>
+#include <memory>
+#include <thread>
+#include <vector>
 
 // Enhanced PNS solver with:
-// 1. Checkpoint support (saves TT to disk periodically)
+// 1. Checkpoint support (snapshots and deltas of the TT, written in the background)
 // 2. Retrograde DB integration (uses already-solved positions)
+// 3. Optional depth-first search (df-pn) instead of root-to-leaf descents
 
 namespace bobail {
 
 // PN_INFINITY is already defined in tt.h (included via retrograde_db.h)
 
-// Simplified TT entry for disk storage
-struct PNSTTEntry {
-    uint64_t hash;
-    uint32_t proof;
-    uint32_t disproof;
-    uint8_t result;  // 0=unknown, 1=win, 2=loss, 3=draw
-};
-
 class EnhancedPNSSolver {
 public:
-    EnhancedPNSSolver(size_t tt_size = 1 << 24) : tt_size_(tt_size) {
-        tt_.reserve(tt_size);
-    }
+    // The TT doubles as it fills until it reaches `max_tt_bytes`; past
+    // that, finished subtrees are collected to make room
+    explicit EnhancedPNSSolver(size_t max_tt_bytes = 4ULL << 30) : max_tt_bytes_(max_tt_bytes) {}
 
     void set_retrograde_db(RetrogradeSolverDB* db) { retro_db_ = db; }
-    void set_checkpoint_path(const std::string& path) { checkpoint_path_ = path; }
+    void set_checkpoint_path(const std::string& path) { checkpointer_.set_path(path); }
     void set_checkpoint_interval(uint64_t interval) { checkpoint_interval_ = interval; }
 
-    bool load_checkpoint() {
-        if (checkpoint_path_.empty()) return false;
-
-        std::ifstream in(checkpoint_path_, std::ios::binary);
-        if (!in) return false;
-
-        // Read header
-        uint64_t magic, version, num_entries;
-        in.read(reinterpret_cast<char*>(&magic), sizeof(magic));
-        if (magic != 0x504E5343484B5054ULL) {  // "PNSCHKPT"
-            std::cerr << "Invalid checkpoint magic\n";
-            return false;
-        }
-        in.read(reinterpret_cast<char*>(&version), sizeof(version));
-        in.read(reinterpret_cast<char*>(&num_entries), sizeof(num_entries));
-        in.read(reinterpret_cast<char*>(&nodes_searched_), sizeof(nodes_searched_));
-        in.read(reinterpret_cast<char*>(&nodes_proved_), sizeof(nodes_proved_));
-        in.read(reinterpret_cast<char*>(&nodes_disproved_), sizeof(nodes_disproved_));
-        in.read(reinterpret_cast<char*>(&retro_hits_), sizeof(retro_hits_));
-
-        // Read entries
-        tt_.clear();
-        for (uint64_t i = 0; i < num_entries; ++i) {
-            PNSTTEntry entry;
-            in.read(reinterpret_cast<char*>(&entry), sizeof(entry));
-            tt_[entry.hash] = entry;
-        }
-
-        std::cout << "Loaded checkpoint: " << num_entries << " entries, "
-                  << nodes_searched_ << " nodes searched\n";
-        return true;
+    // Search with df-pn: stay below a node until its numbers cross the
+    // thresholds it was given, using the 1+epsilon trick for the sibling
+    // threshold. Checkpoints record the mode; a checkpoint only resumes
+    // in the mode that wrote it.
+    void set_dfpn(bool enabled, double epsilon = 0.25) {
+        dfpn_ = enabled;
+        dfpn_epsilon_ = epsilon;
     }
 
-    bool save_checkpoint() {
-        if (checkpoint_path_.empty()) return false;
+    // df-pn threads sharing the TT
+    void set_num_threads(int n) { num_threads_ = std::max(1, n); }
 
-        std::string temp_path = checkpoint_path_ + ".tmp";
-        std::ofstream out(temp_path, std::ios::binary);
-        if (!out) {
-            std::cerr << "Failed to open checkpoint file for writing\n";
-            return false;
-        }
-
-        // Write header
-        uint64_t magic = 0x504E5343484B5054ULL;  // "PNSCHKPT"
-        uint64_t version = 1;
-        uint64_t num_entries = tt_.size();
-        out.write(reinterpret_cast<const char*>(&magic), sizeof(magic));
-        out.write(reinterpret_cast<const char*>(&version), sizeof(version));
-        out.write(reinterpret_cast<const char*>(&num_entries), sizeof(num_entries));
-        out.write(reinterpret_cast<const char*>(&nodes_searched_), sizeof(nodes_searched_));
-        out.write(reinterpret_cast<const char*>(&nodes_proved_), sizeof(nodes_proved_));
-        out.write(reinterpret_cast<const char*>(&nodes_disproved_), sizeof(nodes_disproved_));
-        out.write(reinterpret_cast<const char*>(&retro_hits_), sizeof(retro_hits_));
+    bool load_checkpoint() {
+        if (checkpointer_.path().empty()) return false;
 
-        // Write entries
-        for (const auto& [hash, entry] : tt_) {
-            out.write(reinterpret_cast<const char*>(&entry), sizeof(entry));
-        }
+        PNSCheckpointer::Counters counters;
+        if (!checkpointer_.load(tt_, checkpoint_mode(), counters)) return false;
+        nodes_searched_ = counters[0];
+        nodes_proved_ = counters[1];
+        nodes_disproved_ = counters[2];
+        retro_hits_ = counters[3];
 
-        out.close();
+        std::cout << "Loaded checkpoint: " << tt_.size() << " entries (" << checkpointer_.loaded_deltas()
+                  << " deltas), " << nodes_searched_ << " nodes searched\n";
+        return true;
+    }
 
-        // Atomic rename
-        std::remove(checkpoint_path_.c_str());
-        std::rename(temp_path.c_str(), checkpoint_path_.c_str());
+    // Start writing a checkpoint in the background; false if the last
+    // one is still being written
+    bool start_checkpoint() {
+        if (checkpointer_.path().empty()) return false;
+        PNSCheckpointer::Counters counters = {nodes_searched_, nodes_proved_, nodes_disproved_, retro_hits_};
+        return checkpointer_.start(tt_, checkpoint_mode(), counters);
+    }
 
-        return true;
+    // Wait for a checkpoint being written, and report it
+    void finish_checkpoint() {
+        if (!checkpointer_.pending()) return;
+        checkpointer_.wait();
+        const PNSCheckpointer::Report& r = checkpointer_.last_report();
+        if (!r.ok) {
+            std::cout << "\nCheckpoint FAILED!\n";
+            return;
+        }
+        std::cout << "\nCheckpoint " << (r.full ? "snapshot" : "delta") << ": " << r.entries << " entries, "
+                  << (r.bytes >> 20) << " MB in " << r.seconds << "s\n";
     }
 
     Result solve(const State& root_state, std::atomic<bool>& stop_flag) {
@@ -119,35 +96,60 @@ public:
         }
 
         // Initialize root if not in TT
-        if (tt_.find(root_hash_) == tt_.end()) {
-            PNSTTEntry entry;
-            entry.hash = root_hash_;
-            entry.proof = 1;
-            entry.disproof = 1;
-            entry.result = 0;
-            tt_[root_hash_] = entry;
-        }
+        new_entry(root_hash_);
+
+        metrics_.set_num_threads(dfpn_ ? num_threads_ : 1);
+        metrics_.begin_phase(dfpn_ ? "dfpn" : "pns");
 
         auto last_checkpoint = std::chrono::steady_clock::now();
         auto last_progress = std::chrono::steady_clock::now();
+        auto last_metrics = std::chrono::steady_clock::now();
         uint64_t last_nodes = nodes_searched_;
 
         // Main PNS loop
         while (!stop_flag) {
-            auto& root_entry = tt_[root_hash_];
+            if (checkpointer_.pending() && !checkpointer_.busy()) finish_checkpoint();
+            maintain_table();
+            const PNSSlot& root_entry = *tt_.find(root_hash_);
 
-            if (root_entry.proof == 0) {
+            if (root_entry.proof() == 0) {
+                metrics_.end_phase();
                 return Result::WIN;
             }
-            if (root_entry.disproof == 0) {
+            if (root_entry.disproof() == 0) {
+                metrics_.end_phase();
                 return Result::LOSS;
             }
+            if (dfpn_ && root_entry.proof() == PN_INFINITY && root_entry.disproof() == PN_INFINITY) {
+                // Every line ends in a drawn position
+                metrics_.end_phase();
+                return Result::DRAW;
+            }
+            if (dfpn_ && repetition_draw_.exchange(false) && confirm_repetition_draw()) {
+                // Neither side can force a win without repeating
+                metrics_.end_phase();
+                return Result::DRAW;
+            }
+
+            // Do one iteration of PNS, or a slice of df-pn
+            if (dfpn_) {
+                dfpn_slice(stop_flag);
+            } else {
+                pns_iteration(root_state_, root_hash_, true);
+            }
 
-            // Do one iteration of PNS
-            pns_iteration(root_state_, root_hash_, true);
+            // The table is only safe to read between slices, so the
+            // TT gauges are refreshed here rather than by the reporter
+            auto now = std::chrono::steady_clock::now();
+            if (now - last_metrics >= std::chrono::seconds(1)) {
+                const PNSSlot* root = tt_.find(root_hash_);
+                metrics_.set_gauge("tt_size", static_cast<double>(tt_.size()));
+                metrics_.set_gauge("root_pn", root->proof());
+                metrics_.set_gauge("root_dn", root->disproof());
+                last_metrics = now;
+            }
 
             // Progress reporting
-            auto now = std::chrono::steady_clock::now();
             auto progress_elapsed = std::chrono::duration_cast<std::chrono::seconds>(now - last_progress).count();
             if (progress_elapsed >= 10) {
                 uint64_t nodes_delta = nodes_searched_ - last_nodes;
@@ -159,35 +161,49 @@ public:
                           << " | RetroDB hits: " << retro_hits_
                           << " | TT size: " << tt_.size()
                           << " | Rate: " << (int)rate << "/s"
-                          << " | Root PN: " << root_entry.proof
-                          << " DN: " << root_entry.disproof
+                          << " | Root PN: " << tt_.find(root_hash_)->proof()
+                          << " DN: " << tt_.find(root_hash_)->disproof()
                           << std::flush;
 
                 last_progress = now;
                 last_nodes = nodes_searched_;
             }
 
-            // Checkpoint
+            // Checkpoint; the search carries on while it is written
             auto checkpoint_elapsed = std::chrono::duration_cast<std::chrono::seconds>(now - last_checkpoint).count();
-            if (checkpoint_interval_ > 0 && (uint64_t)checkpoint_elapsed >= checkpoint_interval_) {
-                std::cout << "\nSaving checkpoint... " << std::flush;
-                if (save_checkpoint()) {
-                    std::cout << "done.\n";
-                } else {
-                    std::cout << "FAILED!\n";
-                }
-                last_checkpoint = now;
+            if (checkpoint_interval_ > 0 && (uint64_t)checkpoint_elapsed >= checkpoint_interval_ &&
+                !checkpointer_.busy()) {
+                finish_checkpoint();
+                if (start_checkpoint()) last_checkpoint = now;
             }
         }
 
         // Save final checkpoint on stop
         std::cout << "\nStopping, saving checkpoint... " << std::flush;
-        save_checkpoint();
-        std::cout << "done.\n";
+        finish_checkpoint();
+        if (start_checkpoint()) finish_checkpoint();
 
+        metrics_.end_phase();
         return Result::UNKNOWN;
     }
 
+    // Nodes expanded per thread and time per phase, with the node counts,
+    // TT size and root numbers as gauges, and the RocksDB gauges of the
+    // retrograde database if one is attached. Safe to call from another
+    // thread while solve() runs.
+    SolverMetrics::Snapshot metrics_snapshot() {
+        metrics_.set_gauge("nodes_searched", static_cast<double>(nodes_searched_.load()));
+        metrics_.set_gauge("nodes_proved", static_cast<double>(nodes_proved_.load()));
+        metrics_.set_gauge("nodes_disproved", static_cast<double>(nodes_disproved_.load()));
+        metrics_.set_gauge("retro_hits", static_cast<double>(retro_hits_.load()));
+        if (retro_db_) {
+            for (const auto& [name, value] : retro_db_->metrics_snapshot().gauges) {
+                metrics_.set_gauge("retrodb_" + name, value);
+            }
+        }
+        return metrics_.snapshot();
+    }
+
     uint64_t nodes_searched() const { return nodes_searched_; }
     uint64_t nodes_proved() const { return nodes_proved_; }
     uint64_t nodes_disproved() const { return nodes_disproved_; }
@@ -197,30 +213,36 @@ public:
 private:
     static constexpr int MAX_DEPTH = 500;  // Prevent stack overflow
 
+    // Checkpoint modes: the two searches keep proof numbers from
+    // different points of view. Older checkpoints stored them as the
+    // file version.
+    static constexpr uint64_t PNS_MODE = 1;
+    static constexpr uint64_t DFPN_MODE = 2;
+    uint64_t checkpoint_mode() const { return dfpn_ ? DFPN_MODE : PNS_MODE; }
+
     void pns_iteration(const State& state, uint64_t hash, bool is_or_node, int depth = 0) {
         // Depth limit to prevent stack overflow
         if (depth >= MAX_DEPTH) {
             return;  // Stop recursion, will be continued in next iteration
         }
 
-        auto it = tt_.find(hash);
-        if (it == tt_.end()) {
+        PNSSlot* entry = tt_.find(hash);
+        if (!entry) {
             // Expand this node
             expand_node(state, hash, is_or_node);
             return;
         }
 
-        auto& entry = it->second;
-        if (entry.proof == 0 || entry.disproof == 0) {
+        if (entry->proof() == 0 || entry->disproof() == 0) {
             return;  // Already solved
         }
 
         // Generate moves and find most proving child
-        auto moves = generate_moves(state);
+        MoveList moves;
+        generate_moves(state, moves);
         if (moves.empty()) {
-            entry.proof = PN_INFINITY;
-            entry.disproof = 0;
-            entry.result = 2;  // Loss
+            entry->set(PN_INFINITY, 0, 2);  // Loss
+            tt_.mark_dirty(entry);
             ++nodes_disproved_;
             return;
         }
@@ -234,8 +256,8 @@ private:
             State child_state = apply_move(state, move);
             uint64_t child_hash = canonical_hash(child_state);
 
-            auto child_it = tt_.find(child_hash);
-            if (child_it == tt_.end()) {
+            const PNSSlot* child_entry = tt_.find(child_hash);
+            if (!child_entry) {
                 // Check if unexpanded child is terminal
                 GameResult gr = check_terminal(child_state);
                 if (gr != GameResult::ONGOING) {
@@ -244,8 +266,8 @@ private:
                     // Update this node with new terminal child
                     update_node(state, hash, is_or_node);
                     // Re-check if we're now solved
-                    auto& entry = tt_[hash];
-                    if (entry.proof == 0 || entry.disproof == 0) {
+                    const PNSSlot* updated = tt_.find(hash);
+                    if (updated->proof() == 0 || updated->disproof() == 0) {
                         return;  // Solved by terminal child
                     }
                     continue;  // Check next child
@@ -256,7 +278,7 @@ private:
                 break;
             }
 
-            uint32_t value = is_or_node ? child_it->second.proof : child_it->second.disproof;
+            uint32_t value = is_or_node ? child_entry->proof() : child_entry->disproof();
             if (value < best_value && value > 0) {
                 best_value = value;
                 best_child_state = child_state;
@@ -275,30 +297,15 @@ private:
 
     void expand_node(const State& state, uint64_t hash, bool is_or_node) {
         ++nodes_searched_;
+        metrics_.add_work(0, 1);
 
-        // Check retrograde DB first
+        // Check retrograde DB first (children are looked up together below,
+        // so a node usually arrives here already stored from its parent)
         if (retro_db_) {
             Result r = retro_db_->get_result(state);
             if (r != Result::UNKNOWN) {
                 ++retro_hits_;
-                PNSTTEntry entry;
-                entry.hash = hash;
-                if (r == Result::WIN) {
-                    entry.proof = 0;
-                    entry.disproof = PN_INFINITY;
-                    entry.result = 1;
-                    ++nodes_proved_;
-                } else if (r == Result::LOSS) {
-                    entry.proof = PN_INFINITY;
-                    entry.disproof = 0;
-                    entry.result = 2;
-                    ++nodes_disproved_;
-                } else {
-                    entry.proof = PN_INFINITY;
-                    entry.disproof = PN_INFINITY;
-                    entry.result = 3;
-                }
-                tt_[hash] = entry;
+                store_retro_result(hash, r);
                 return;
             }
         }
@@ -306,8 +313,7 @@ private:
         // Check terminal
         GameResult gr = check_terminal(state);
         if (gr != GameResult::ONGOING) {
-            PNSTTEntry entry;
-            entry.hash = hash;
+            PNSSlot* entry = new_entry(hash);
 
             bool current_player_wins =
                 (gr == GameResult::WHITE_WINS && state.white_to_move) ||
@@ -317,41 +323,88 @@ private:
                 (gr == GameResult::BLACK_WINS && state.white_to_move);
 
             if (current_player_wins) {
-                entry.proof = 0;
-                entry.disproof = PN_INFINITY;
-                entry.result = 1;
+                entry->set(0, PN_INFINITY, 1);
                 ++nodes_proved_;
             } else if (current_player_loses) {
-                entry.proof = PN_INFINITY;
-                entry.disproof = 0;
-                entry.result = 2;
+                entry->set(PN_INFINITY, 0, 2);
                 ++nodes_disproved_;
             }
-            tt_[hash] = entry;
             return;
         }
 
         // Initialize with default proof numbers
-        PNSTTEntry entry;
-        entry.hash = hash;
-        entry.proof = 1;
-        entry.disproof = 1;
-        entry.result = 0;
-        tt_[hash] = entry;
+        new_entry(hash)->set(1, 1, 0);
+
+        probe_children(state);
 
         // Immediately update based on children (if any are in TT)
         update_node(state, hash, is_or_node);
     }
 
+    // One batched DB lookup for all children not in the TT yet; solved
+    // ones go straight into the TT
+    void probe_children(const State& state) {
+        if (retro_db_) {
+            MoveList moves;
+            generate_moves(state, moves);
+            std::vector<State> children;
+            std::vector<uint64_t> child_hashes;
+            for (const auto& move : moves) {
+                State child_state = apply_move(state, move);
+                uint64_t child_hash = canonical_hash(child_state);
+                if (tt_.contains(child_hash)) continue;
+                children.push_back(child_state);
+                child_hashes.push_back(child_hash);
+            }
+            std::vector<Result> child_results = retro_db_->get_results(children);
+            for (size_t i = 0; i < children.size(); ++i) {
+                if (child_results[i] == Result::UNKNOWN) continue;
+                ++retro_hits_;
+                store_retro_result(child_hashes[i], child_results[i]);
+            }
+        }
+    }
+
+    // TT entry for `hash`, created if new. df-pn threads share the table,
+    // which then never grows mid-slice: nullptr when it is full.
+    PNSSlot* new_entry(uint64_t hash) {
+        PNSSlot* entry;
+        if (dfpn_) {
+            entry = tt_.insert_shared(hash);
+        } else {
+            // A full table grows on insert; not while a checkpoint reads it
+            if (tt_.size() + 1 >= tt_.capacity()) finish_checkpoint();
+            entry = tt_.insert(hash);
+        }
+        // The caller writes it next
+        if (entry) tt_.mark_dirty(entry);
+        return entry;
+    }
+
+    // Record a position solved by the retrograde DB
+    void store_retro_result(uint64_t hash, Result r) {
+        PNSSlot* entry = new_entry(hash);
+        if (!entry) return;
+        if (r == Result::WIN) {
+            entry->set(0, PN_INFINITY, 1);
+            ++nodes_proved_;
+        } else if (r == Result::LOSS) {
+            entry->set(PN_INFINITY, 0, 2);
+            ++nodes_disproved_;
+        } else {
+            entry->set(PN_INFINITY, PN_INFINITY, 3);
+        }
+    }
+
     void update_node(const State& state, uint64_t hash, bool is_or_node) {
-        auto it = tt_.find(hash);
-        if (it == tt_.end()) return;
+        PNSSlot* entry = tt_.find(hash);
+        if (!entry) return;
 
-        auto moves = generate_moves(state);
+        MoveList moves;
+        generate_moves(state, moves);
+        tt_.mark_dirty(entry);
         if (moves.empty()) {
-            it->second.proof = PN_INFINITY;
-            it->second.disproof = 0;
-            it->second.result = 2;
+            entry->set(PN_INFINITY, 0, 2);
             return;
         }
 
@@ -368,11 +421,11 @@ private:
             uint32_t child_proof = 1;
             uint32_t child_disproof = 1;
 
-            auto child_it = tt_.find(child_hash);
-            if (child_it != tt_.end()) {
+            const PNSSlot* child_entry = tt_.find(child_hash);
+            if (child_entry) {
                 ++known_children;
-                child_proof = child_it->second.proof;
-                child_disproof = child_it->second.disproof;
+                child_proof = child_entry->proof();
+                child_disproof = child_entry->disproof();
             } else {
                 // Check if child is terminal (even if not in TT)
                 GameResult gr = check_terminal(child_state);
@@ -403,36 +456,387 @@ private:
         if (sum_disproof > PN_INFINITY) sum_disproof = PN_INFINITY;
 
         if (is_or_node) {
-            it->second.proof = min_proof;
-            it->second.disproof = static_cast<uint32_t>(sum_disproof);
+            entry->set_numbers(min_proof, static_cast<uint32_t>(sum_disproof));
         } else {
-            it->second.proof = static_cast<uint32_t>(sum_proof);
-            it->second.disproof = min_disproof;
+            entry->set_numbers(static_cast<uint32_t>(sum_proof), min_disproof);
         }
 
         // Check if solved
-        if (it->second.proof == 0) {
-            it->second.result = 1;
+        if (entry->proof() == 0) {
+            entry->set_result(1);
             ++nodes_proved_;
-        } else if (it->second.disproof == 0) {
-            it->second.result = 2;
+        } else if (entry->disproof() == 0) {
+            entry->set_result(2);
             ++nodes_disproved_;
         }
     }
 
-    std::unordered_map<uint64_t, PNSTTEntry> tt_;
-    size_t tt_size_;
+    // ------------------------------------------------------------------
+    // df-pn
+    //
+    // Numbers are from the point of view of the side to move, as the
+    // terminal and retrograde entries already are: proof = the side to
+    // move can force a win, disproof = it cannot avoid a loss. A node's
+    // proof number is then the smallest child disproof number and its
+    // disproof number the sum of the child proof numbers.
+    // ------------------------------------------------------------------
+
+    // Largest finite number; PNSSlot saturates above it
+    static constexpr uint32_t DFPN_MAX = PNSSlot::VALUE_MASK - 1;
+
+    // Nodes per thread and slice before returning to the root loop for
+    // progress, checkpoints and table maintenance
+    static constexpr uint64_t DFPN_SLICE_NODES = 1 << 16;
+
+    struct DfpnChild {
+        State state;
+        uint64_t hash;
+        uint32_t proof;     // Fixed for terminal children, else read from the TT
+        uint32_t disproof;
+        bool fixed;
+        bool repeated;      // Numbers its last descent returned, held for this visit
+    };
+
+    // Numbers a visit reached for a node on its current path. `repeated`
+    // is set when they count a repetition of the path as a draw and so
+    // differ from what the TT holds for the node.
+    struct DfpnNumbers {
+        uint32_t proof = 1;
+        uint32_t disproof = 1;
+        bool repeated = false;
+    };
+
+    // Best and runner-up child by some value
+    struct Choice {
+        size_t best = 0;
+        uint64_t best_value = UINT64_MAX;
+        uint64_t second = PN_INFINITY;
+
+        void offer(size_t i, uint64_t value) {
+            if (value < best_value) {
+                second = std::min<uint64_t>(best_value, PN_INFINITY);
+                best_value = value;
+                best = i;
+            } else if (value < second) {
+                second = value;
+            }
+        }
+    };
+
+    // Per-thread search state
+    struct DfpnContext {
+        std::vector<uint64_t> path;  // Hashes from the root to the current node
+        bool cutoff = false;         // A descent hit MAX_DEPTH
+        int thread = 0;              // Counter in metrics_
+    };
+
+    // Threads share the TT and start at the root. Each marks the nodes it
+    // is inside of in working_, and a child other threads are working
+    // below looks twice as hard to disprove per thread, so the threads
+    // spread over different parts of the proof frontier.
+    void dfpn_slice(std::atomic<bool>& stop_flag) {
+        stop_flag_ = &stop_flag;
+        slice_end_ = nodes_searched_ + DFPN_SLICE_NODES * num_threads_;
+        if (working_size_ != tt_.capacity()) {
+            working_size_ = tt_.capacity();
+            working_ = std::make_unique<std::atomic<uint8_t>[]>(working_size_);
+        }
+
+        auto run = [this](int thread) {
+            DfpnContext ctx;
+            ctx.thread = thread;
+            if (is_draw(mid(ctx, root_state_, root_hash_, PN_INFINITY, PN_INFINITY, 0))) {
+                repetition_draw_.store(true);
+            }
+        };
+        if (num_threads_ == 1) {
+            run(0);
+            return;
+        }
+        std::vector<std::thread> threads;
+        for (int t = 0; t < num_threads_; ++t) threads.emplace_back(run, t);
+        for (auto& t : threads) t.join();
+    }
+
+    static bool is_draw(const DfpnNumbers& n) {
+        return n.proof == PN_INFINITY && n.disproof == PN_INFINITY;
+    }
+
+    // A root visit found every line to end in a repetition or a draw.
+    // Nothing of that is in the TT, so confirm it with a fresh visit from
+    // the root before reporting it.
+    bool confirm_repetition_draw() {
+        slice_end_ = nodes_searched_ + DFPN_SLICE_NODES * num_threads_;
+        DfpnContext ctx;
+        return is_draw(mid(ctx, root_state_, root_hash_, PN_INFINITY, PN_INFINITY, 0));
+    }
+
+    bool dfpn_pause() const {
+        return nodes_searched_ >= slice_end_ || tt_.load() >= PNSTable::MAX_LOAD || *stop_flag_;
+    }
+
+    // Create the TT entry of a node seen for the first time
+    void dfpn_expand(const State& state, uint64_t hash) {
+        ++nodes_searched_;
+        if (retro_db_) {
+            Result r = retro_db_->get_result(state);
+            if (r != Result::UNKNOWN) {
+                ++retro_hits_;
+                store_retro_result(hash, r);
+                return;
+            }
+        }
+        if (!new_entry(hash)) return;
+        probe_children(state);
+    }
+
+    static void terminal_numbers(const State& s, GameResult gr, uint32_t& pn, uint32_t& dn) {
+        if (gr == GameResult::DRAW) {
+            pn = dn = PN_INFINITY;
+            return;
+        }
+        bool side_wins = (gr == GameResult::WHITE_WINS) == s.white_to_move;
+        pn = side_wins ? 0 : PN_INFINITY;
+        dn = side_wins ? PN_INFINITY : 0;
+    }
+
+    static bool exceeds(uint64_t value, uint32_t threshold) {
+        return threshold != PN_INFINITY && value >= threshold;
+    }
+
+    // Disproof number a thread picks children by
+    static uint64_t selection_value(uint32_t disproof, uint8_t workers) {
+        if (disproof == PN_INFINITY || workers == 0) return disproof;
+        return (static_cast<uint64_t>(disproof) << std::min<int>(workers, 16)) + workers;
+    }
+
+    // Search below `state` until its numbers cross the thresholds. A child
+    // that repeats a position on the current path is a draw for this
+    // visit only: the numbers that count it that way steer the visit and
+    // are returned to the caller, while the TT gets the numbers with every
+    // child taken from its own entry. Otherwise a node reached by another
+    // path would inherit a draw that does not hold there.
+    DfpnNumbers mid(DfpnContext& ctx, const State& state, uint64_t hash, uint32_t th_pn, uint32_t th_dn, int depth) {
+        if (!tt_.contains(hash)) {
+            dfpn_expand(state, hash);
+            metrics_.add_work(ctx.thread, 1);
+        } else if (depth >= MAX_DEPTH) {
+            ctx.cutoff = true;
+            return {};
+        }
+        if (depth >= MAX_DEPTH) return {};
+
+        PNSSlot* entry = tt_.find(hash);
+        if (!entry) return {};  // TT full; the slice is about to end
+        if (entry->proof() == 0 || entry->disproof() == 0 || entry->result() != 0) {
+            return {entry->proof(), entry->disproof(), false};
+        }
+
+        MoveList moves;
+        generate_moves(state, moves);
+        if (moves.empty()) {
+            if (entry->update_unsolved(PN_INFINITY, 0, 2)) {
+                tt_.mark_dirty(entry);
+                ++nodes_disproved_;
+            }
+            return {PN_INFINITY, 0, false};
+        }
+
+        // Children are generated and classified once per visit; only
+        // their TT numbers are re-read between descents
+        std::vector<DfpnChild> children;
+        children.reserve(moves.size());
+        for (const auto& move : moves) {
+            DfpnChild c;
+            c.state = apply_move(state, move);
+            c.hash = canonical_hash(c.state);
+            c.proof = c.disproof = 1;
+            c.fixed = false;
+            c.repeated = false;
+            GameResult gr = check_terminal(c.state);
+            if (gr != GameResult::ONGOING) {
+                terminal_numbers(c.state, gr, c.proof, c.disproof);
+                c.fixed = true;
+            }
+            children.push_back(c);
+        }
+
+        DfpnNumbers result;
+        std::atomic<uint8_t>& working = working_[tt_.index_of(entry)];
+        working.fetch_add(1, std::memory_order_relaxed);
+        ctx.path.push_back(hash);
+        while (true) {
+            // Collect child numbers twice: as stored (for the TT) and as
+            // this visit sees them, with children on the current path and
+            // those whose descent came back repeated counted as such
+            uint32_t pn = PN_INFINITY;
+            uint64_t dn = 0;
+            uint32_t stored_pn = PN_INFINITY;
+            uint64_t stored_dn = 0;
+            Choice by_value;    // Ranked by selection value
+            Choice by_number;   // Ranked by disproof number alone
+            for (size_t i = 0; i < children.size(); ++i) {
+                DfpnChild& c = children[i];
+                uint8_t workers = 0;
+                uint32_t stored_proof = c.proof;
+                uint32_t stored_disproof = c.disproof;
+                if (!c.fixed) {
+                    const PNSSlot* child = tt_.find(c.hash);
+                    stored_proof = child ? child->proof() : 1;
+                    stored_disproof = child ? child->disproof() : 1;
+                    if (child) workers = working_[tt_.index_of(child)].load(std::memory_order_relaxed);
+                    if (std::find(ctx.path.begin(), ctx.path.end(), c.hash) != ctx.path.end()) {
+                        c.proof = c.disproof = PN_INFINITY;
+                        c.repeated = true;
+                    } else if (!c.repeated) {
+                        c.proof = stored_proof;
+                        c.disproof = stored_disproof;
+                    }
+                }
+                by_value.offer(i, selection_value(c.disproof, workers));
+                by_number.offer(i, c.disproof);
+                pn = std::min(pn, c.disproof);
+                if (dn != PN_INFINITY) {
+                    dn = c.proof == PN_INFINITY ? PN_INFINITY : std::min<uint64_t>(dn + c.proof, DFPN_MAX);
+                }
+                stored_pn = std::min(stored_pn, stored_disproof);
+                if (stored_dn != PN_INFINITY) {
+                    stored_dn = stored_proof == PN_INFINITY
+                        ? PN_INFINITY : std::min<uint64_t>(stored_dn + stored_proof, DFPN_MAX);
+                }
+            }
+            result = {pn, static_cast<uint32_t>(dn), pn != stored_pn || dn != stored_dn};
+
+            // A win or loss never rests on a repetition, so the stored
+            // numbers reach 0 whenever the visit's own numbers do
+            uint8_t code = stored_pn == 0 ? 1 : stored_dn == 0 ? 2 : 0;
+            entry = tt_.find(hash);
+            if (!entry->update_unsolved(stored_pn, static_cast<uint32_t>(stored_dn), code)) {
+                result = {entry->proof(), entry->disproof(), false};  // Solved elsewhere
+                break;
+            }
+            tt_.mark_dirty(entry);
+            if (code == 1) {
+                ++nodes_proved_;
+                break;
+            }
+            if (code == 2) {
+                ++nodes_disproved_;
+                break;
+            }
+            // Infinite thresholds never stop the search: at the root a
+            // position that cannot be lost is still worth proving won
+            if (pn == PN_INFINITY || exceeds(pn, th_pn) || exceeds(dn, th_dn) || dfpn_pause()) break;
+
+            // Thresholds of the chosen child: its disproof number may grow
+            // until it passes the runner-up by a factor of 1+epsilon, and
+            // its proof number until this node's disproof number would
+            // reach its own threshold. A child picked for having fewer
+            // threads in it may already be past this node's threshold;
+            // then the plain most-proving child is taken.
+            const Choice* choice = &by_value;
+            if (exceeds(children[by_value.best].disproof, th_pn)) choice = &by_number;
+            DfpnChild& c = children[choice->best];
+            uint64_t sibling = choice->second >= PN_INFINITY
+                ? PN_INFINITY
+                : std::max<uint64_t>(choice->second + 1,
+                                     static_cast<uint64_t>(choice->second * (1.0 + dfpn_epsilon_)));
+            uint32_t child_th_dn = static_cast<uint32_t>(std::min<uint64_t>(th_pn, sibling));
+            uint32_t child_th_pn = th_dn == PN_INFINITY
+                ? PN_INFINITY
+                : static_cast<uint32_t>(std::min<uint64_t>(th_dn - dn + c.proof, DFPN_MAX));
+            DfpnNumbers child = mid(ctx, c.state, c.hash, child_th_pn, child_th_dn, depth + 1);
+            c.repeated = child.repeated;
+            if (child.repeated) {
+                c.proof = child.proof;
+                c.disproof = child.disproof;
+            }
+
+            // A descent cut off by the depth limit changed nothing; unwind
+            // to the root instead of retrying it
+            if (ctx.cutoff) break;
+        }
+        ctx.path.pop_back();
+        working.fetch_sub(1, std::memory_order_relaxed);
+        return result;
+    }
+
+    // Runs between iterations, when no slot pointers are held: grow the
+    // TT while under budget, then collect
+    void maintain_table() {
+        if (tt_.load() < PNSTable::MAX_LOAD) return;
+        // Growing and collecting move slots under a checkpoint writer
+        finish_checkpoint();
+        if (tt_.memory_bytes() * 2 <= max_tt_bytes_ && tt_.grow()) return;
+
+        collect_garbage();
+        if (tt_.load() >= PNSTable::MAX_LOAD * 0.9) {
+            // Almost everything is live: going over budget beats thrashing
+            std::cout << "\nTT over budget, growing to "
+                      << (tt_.memory_bytes() * 2 >> 20) << " MB\n";
+            tt_.grow();
+        }
+    }
+
+    // Keep the search tree below the root that is still being worked on,
+    // plus the solved children its nodes read their numbers from. The
+    // inside of solved subtrees is no longer needed: their roots carry
+    // the result.
+    void collect_garbage() {
+        size_t before = tt_.size();
+        tt_.clear_marks();
+
+        std::vector<State> stack;
+        PNSSlot* root = tt_.find(root_hash_);
+        if (root) {
+            tt_.mark(root);
+            stack.push_back(root_state_);
+        }
+        while (!stack.empty()) {
+            State state = stack.back();
+            stack.pop_back();
+
+            MoveList moves;
+            generate_moves(state, moves);
+            for (const auto& move : moves) {
+                State child_state = apply_move(state, move);
+                PNSSlot* child = tt_.find(canonical_hash(child_state));
+                if (!child || !tt_.mark(child)) continue;
+                // Solved children are kept but not descended into
+                if (child->proof() != 0 && child->disproof() != 0 && child->result() == 0) {
+                    stack.push_back(child_state);
+                }
+            }
+        }
+
+        size_t removed = tt_.sweep();
+        std::cout << "\nTT collection: removed " << removed << " of " << before << " entries\n";
+    }
+
+    PNSTable tt_;
+    size_t max_tt_bytes_;
+
+    bool dfpn_ = false;
+    double dfpn_epsilon_ = 0.25;
+    uint64_t slice_end_ = 0;
+    int num_threads_ = 1;
+    std::unique_ptr<std::atomic<uint8_t>[]> working_;
+    size_t working_size_ = 0;
+    std::atomic<bool>* stop_flag_ = nullptr;
+    std::atomic<bool> repetition_draw_{false};  // A root visit came back drawn
     RetrogradeSolverDB* retro_db_ = nullptr;
-    std::string checkpoint_path_;
+    PNSCheckpointer checkpointer_;  // After tt_: its writer reads the table
     uint64_t checkpoint_interval_ = 300;  // 5 minutes default
 
     State root_state_;
     uint64_t root_hash_;
 
-    uint64_t nodes_searched_ = 0;
-    uint64_t nodes_proved_ = 0;
-    uint64_t nodes_disproved_ = 0;
-    uint64_t retro_hits_ = 0;
+    std::atomic<uint64_t> nodes_searched_{0};
+    std::atomic<uint64_t> nodes_proved_{0};
+    std::atomic<uint64_t> nodes_disproved_{0};
+    std::atomic<uint64_t> retro_hits_{0};
+
+    SolverMetrics metrics_;
 };
 
 }  // namespace bobail
@@ -450,6 +854,13 @@ int main(int argc, char* argv[]) {
     std::string checkpoint_path = "pns_checkpoint.bin";
     uint64_t checkpoint_interval = 300;  // 5 minutes
     bool resume = false;
+    uint64_t tt_mb = 4096;
+    bool dfpn = false;
+    double epsilon = 0.25;
+    int num_threads = 1;
+    std::string metrics_json;
+    std::string metrics_prom;
+    double metrics_interval = 10;
 
     // Parse arguments
     for (int i = 1; i < argc; ++i) {
@@ -459,20 +870,51 @@ int main(int argc, char* argv[]) {
             checkpoint_path = argv[++i];
         } else if (std::string(argv[i]) == "--interval" && i + 1 < argc) {
             checkpoint_interval = std::stoull(argv[++i]);
+        } else if (std::string(argv[i]) == "--tt-mb" && i + 1 < argc) {
+            tt_mb = std::stoull(argv[++i]);
+        } else if (std::string(argv[i]) == "--dfpn") {
+            dfpn = true;
+        } else if (std::string(argv[i]) == "--threads" && i + 1 < argc) {
+            num_threads = std::stoi(argv[++i]);
+        } else if (std::string(argv[i]) == "--epsilon" && i + 1 < argc) {
+            epsilon = std::stod(argv[++i]);
+        } else if (std::string(argv[i]) == "--metrics" && i + 1 < argc) {
+            metrics_json = argv[++i];
+        } else if (std::string(argv[i]) == "--metrics-prom" && i + 1 < argc) {
+            metrics_prom = argv[++i];
+        } else if (std::string(argv[i]) == "--metrics-interval" && i + 1 < argc) {
+            metrics_interval = std::stod(argv[++i]);
         } else if (std::string(argv[i]) == "--resume") {
             resume = true;
+        } else if (std::string(argv[i]) == "--packed-keys") {
+            bobail::g_hash_mode = bobail::HashMode::PACKED;
         } else if (std::string(argv[i]) == "--help") {
             std::cout << "Usage: " << argv[0] << " [options]\n"
                       << "Options:\n"
                       << "  --db PATH          Retrograde database path (optional)\n"
                       << "  --checkpoint PATH  Checkpoint file path (default: pns_checkpoint.bin)\n"
                       << "  --interval SECS    Checkpoint interval in seconds (default: 300)\n"
+                      << "  --tt-mb N          TT memory before finished subtrees are collected (default: 4096)\n"
+                      << "  --dfpn             Depth-first proof-number search (df-pn)\n"
+                      << "  --epsilon X        df-pn sibling threshold factor 1+X (default: 0.25)\n"
+                      << "  --threads N        df-pn threads sharing the TT (default: 1)\n"
+                      << "  --metrics FILE     Append solver metrics as JSON lines to FILE (- for stderr)\n"
+                      << "  --metrics-prom FILE  Keep Prometheus text metrics in FILE\n"
+                      << "  --metrics-interval SECS  Seconds between metrics snapshots (default: 10)\n"
                       << "  --resume           Resume from checkpoint\n"
+                      << "  --packed-keys      Key the TT by mixed packed positions instead of Zobrist\n"
+                      << "                     hashes: exact, and cheaper to compute (a resumed\n"
+                      << "                     checkpoint keeps the keys it was written with)\n"
                       << "  --help             Show this help\n";
             return 0;
         }
     }
 
+    if (num_threads > 1 && !dfpn) {
+        std::cerr << "Error: --threads requires --dfpn\n";
+        return 1;
+    }
+
     // Set up signal handler
     std::signal(SIGINT, signal_handler);
     std::signal(SIGTERM, signal_handler);
@@ -489,7 +931,8 @@ int main(int argc, char* argv[]) {
     std::unique_ptr<bobail::RetrogradeSolverDB> retro_db;
     if (!db_path.empty()) {
         retro_db = std::make_unique<bobail::RetrogradeSolverDB>();
-        if (retro_db->open(db_path)) {
+        retro_db->set_collect_statistics(!metrics_json.empty() || !metrics_prom.empty());
+        if (retro_db->open_readonly(db_path)) {
             std::cout << "Opened retrograde DB: " << db_path << "\n";
             std::cout << "  States: " << retro_db->num_states() << "\n";
             std::cout << "  Wins: " << retro_db->num_wins() << "\n";
@@ -501,17 +944,23 @@ int main(int argc, char* argv[]) {
     }
 
     // Create solver
-    bobail::EnhancedPNSSolver solver(1 << 26);  // 64M entry TT
+    bobail::EnhancedPNSSolver solver(tt_mb << 20);
     if (retro_db) {
         solver.set_retrograde_db(retro_db.get());
     }
     solver.set_checkpoint_path(checkpoint_path);
     solver.set_checkpoint_interval(checkpoint_interval);
+    solver.set_dfpn(dfpn, epsilon);
+    solver.set_num_threads(num_threads);
 
     // Resume from checkpoint if requested
     if (resume) {
         if (solver.load_checkpoint()) {
             std::cout << "Resumed from checkpoint\n";
+        } else if (std::ifstream(checkpoint_path)) {
+            // Starting fresh would overwrite it
+            std::cerr << "Cannot resume from " << checkpoint_path << "\n";
+            return 1;
         } else {
             std::cout << "No checkpoint found, starting fresh\n";
         }
@@ -520,13 +969,24 @@ int main(int argc, char* argv[]) {
     // Get starting position
     auto start = bobail::State::starting_position();
     std::cout << "\nStarting position:\n" << start.to_string() << "\n";
+    std::cout << "Search: " << (dfpn ? "df-pn" : "PNS");
+    if (dfpn) std::cout << ", " << num_threads << " thread" << (num_threads == 1 ? "" : "s");
+    std::cout << "\n";
     std::cout << "Checkpoint interval: " << checkpoint_interval << " seconds\n";
     std::cout << "Checkpoint file: " << checkpoint_path << "\n\n";
     std::cout << "Press Ctrl+C to stop and save checkpoint\n\n";
 
+    std::unique_ptr<bobail::MetricsReporter> reporter;
+    if (!metrics_json.empty() || !metrics_prom.empty()) {
+        reporter = std::make_unique<bobail::MetricsReporter>(
+            [&solver] { return solver.metrics_snapshot(); },
+            metrics_json, metrics_prom, "bobail_pns", metrics_interval);
+    }
+
     auto t0 = std::chrono::high_resolution_clock::now();
 
     bobail::Result result = solver.solve(start, g_stop_flag);
+    reporter.reset();
 
     auto t1 = std::chrono::high_resolution_clock::now();
     auto seconds = std::chrono::duration_cast<std::chrono::seconds>(t1 - t0).count();
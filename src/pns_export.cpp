@@ -1,28 +1,24 @@
 // Export proved positions from PNS checkpoint with web app URLs
 // Usage: pns_export --checkpoint FILE [--wins N] [--losses N]
+//        pns_export --checkpoint FILE --write-table OUT
+//
+// --write-table writes the sorted table file the other PNS query tools
+// map instead of loading the checkpoint (see pns_table.h).
 
 #include "board.h"
 #include "movegen.h"
 #include "hash.h"
 #include "symmetry.h"
+#include "pns_table.h"
 #include <iostream>
-#include <fstream>
 #include <vector>
 #include <string>
 #include <cstring>
 #include <algorithm>
-#include <unordered_map>
 #include <unordered_set>
 
 namespace bobail {
 
-struct PNSTTEntry {
-    uint64_t hash;
-    uint32_t proof;
-    uint32_t disproof;
-    uint8_t result;  // 0=unknown, 1=win, 2=loss, 3=draw
-};
-
 // Convert position to web app URL format
 std::string to_web_url(const State& s) {
     std::string url = "https://jasondaming.github.io/bobail-solver/?pos=";
@@ -82,6 +78,7 @@ int main(int argc, char* argv[]) {
     std::string checkpoint_path = "/workspace/pns_checkpoint.bin";
     int max_wins = 5;
     int max_losses = 5;
+    std::string table_path;
 
     for (int i = 1; i < argc; ++i) {
         if (strcmp(argv[i], "--checkpoint") == 0 && i + 1 < argc) {
@@ -90,50 +87,39 @@ int main(int argc, char* argv[]) {
             max_wins = std::stoi(argv[++i]);
         } else if (strcmp(argv[i], "--losses") == 0 && i + 1 < argc) {
             max_losses = std::stoi(argv[++i]);
+        } else if (strcmp(argv[i], "--write-table") == 0 && i + 1 < argc) {
+            table_path = argv[++i];
         }
     }
 
-    // Load checkpoint
-    std::ifstream in(checkpoint_path, std::ios::binary);
-    if (!in) {
-        std::cerr << "Cannot open checkpoint: " << checkpoint_path << "\n";
-        return 1;
+    if (!table_path.empty()) {
+        // Sorted copy for the query tools to map
+        bobail::PNSTable table;
+        bobail::PNSCheckpointer::Counters counters;
+        if (!bobail::PNSCheckpointer::read(checkpoint_path, table, counters)) {
+            std::cerr << "Cannot load checkpoint: " << checkpoint_path << "\n";
+            return 1;
+        }
+        if (!bobail::PNSTableFile::write(table_path, table, counters)) return 1;
+        std::cout << "Wrote " << table.size() << " entries to " << table_path << "\n";
+        return 0;
     }
 
-    uint64_t magic, version, num_entries;
-    uint64_t nodes_searched, nodes_proved, nodes_disproved, retro_hits;
-
-    in.read(reinterpret_cast<char*>(&magic), sizeof(magic));
-    if (magic != 0x504E5343484B5054ULL) {
-        std::cerr << "Invalid checkpoint magic\n";
+    // Load checkpoint
+    bobail::PNSTableFile tt;
+    if (!tt.open(checkpoint_path)) {
+        std::cerr << "Cannot load checkpoint: " << checkpoint_path << "\n";
         return 1;
     }
 
-    in.read(reinterpret_cast<char*>(&version), sizeof(version));
-    in.read(reinterpret_cast<char*>(&num_entries), sizeof(num_entries));
-    in.read(reinterpret_cast<char*>(&nodes_searched), sizeof(nodes_searched));
-    in.read(reinterpret_cast<char*>(&nodes_proved), sizeof(nodes_proved));
-    in.read(reinterpret_cast<char*>(&nodes_disproved), sizeof(nodes_disproved));
-    in.read(reinterpret_cast<char*>(&retro_hits), sizeof(retro_hits));
-
-    std::cout << "Loading PNS checkpoint: " << num_entries << " entries\n";
-    std::cout << "Proved: " << nodes_proved << ", Disproved: " << nodes_disproved << "\n\n";
+    std::cout << "Loaded PNS checkpoint: " << tt.size() << " entries\n";
+    std::cout << "Proved: " << tt.counters()[1] << ", Disproved: " << tt.counters()[2] << "\n\n";
 
     // We need to regenerate positions from the game tree to find ones matching hashes
     // For now, let's explore from starting position and collect proved positions
 
-    std::vector<std::pair<bobail::State, bobail::PNSTTEntry>> wins;
-    std::vector<std::pair<bobail::State, bobail::PNSTTEntry>> losses;
-
-    // Load all entries into a map
-    std::unordered_map<uint64_t, bobail::PNSTTEntry> tt;
-    for (uint64_t i = 0; i < num_entries; ++i) {
-        bobail::PNSTTEntry entry;
-        in.read(reinterpret_cast<char*>(&entry), sizeof(entry));
-        tt[entry.hash] = entry;
-    }
-
-    std::cout << "Loaded " << tt.size() << " entries\n\n";
+    std::vector<std::pair<bobail::State, const bobail::PNSSlot*>> wins;
+    std::vector<std::pair<bobail::State, const bobail::PNSSlot*>> losses;
 
     // BFS from starting position to find proved positions
     std::vector<bobail::State> queue;
@@ -153,12 +139,12 @@ int main(int argc, char* argv[]) {
 
         // Check PNS table
         uint64_t hash = bobail::canonical_hash(s);
-        auto it = tt.find(hash);
-        if (it != tt.end()) {
-            if (it->second.result == 1 && wins.size() < 100) {
-                wins.push_back({s, it->second});
-            } else if (it->second.result == 2 && losses.size() < 100) {
-                losses.push_back({s, it->second});
+        const bobail::PNSSlot* entry = tt.find(hash);
+        if (entry) {
+            if (entry->result() == 1 && wins.size() < 100) {
+                wins.push_back({s, entry});
+            } else if (entry->result() == 2 && losses.size() < 100) {
+                losses.push_back({s, entry});
             }
         }
 
@@ -186,7 +172,7 @@ int main(int argc, char* argv[]) {
         const auto& [state, entry] = wins[i];
         std::cout << "Position " << (i+1) << ":\n";
         bobail::print_board(state);
-        std::cout << "PN=" << entry.proof << " DN=" << entry.disproof << "\n";
+        std::cout << "PN=" << entry->proof() << " DN=" << entry->disproof() << "\n";
         std::cout << "URL: " << bobail::to_web_url(state) << "\n\n";
     }
 
@@ -196,7 +182,7 @@ int main(int argc, char* argv[]) {
         const auto& [state, entry] = losses[i];
         std::cout << "Position " << (i+1) << ":\n";
         bobail::print_board(state);
-        std::cout << "PN=" << entry.proof << " DN=" << entry.disproof << "\n";
+        std::cout << "PN=" << entry->proof() << " DN=" << entry->disproof() << "\n";
         std::cout << "URL: " << bobail::to_web_url(state) << "\n\n";
     }
 
@@ -6,58 +6,20 @@
 #include "movegen.h"
 #include "hash.h"
 #include "symmetry.h"
+#include "pns_table.h"
 #include <iostream>
-#include <fstream>
 #include <sstream>
-#include <unordered_map>
 #include <cstring>
 
 namespace bobail {
 
-struct PNSTTEntry {
-    uint64_t hash;
-    uint32_t proof;
-    uint32_t disproof;
-    uint8_t result;  // 0=unknown, 1=win, 2=loss, 3=draw
-};
-
-std::unordered_map<uint64_t, PNSTTEntry> pns_table;
+PNSTableFile pns_table;
 
 bool load_checkpoint(const std::string& path) {
-    std::ifstream in(path, std::ios::binary);
-    if (!in) {
-        std::cerr << "Cannot open: " << path << "\n";
-        return false;
-    }
-
-    uint64_t magic, version, num_entries;
-    uint64_t nodes_searched, nodes_proved, nodes_disproved, retro_hits;
-
-    in.read(reinterpret_cast<char*>(&magic), sizeof(magic));
-    if (magic != 0x504E5343484B5054ULL) {
-        std::cerr << "Invalid checkpoint magic\n";
-        return false;
-    }
-
-    in.read(reinterpret_cast<char*>(&version), sizeof(version));
-    in.read(reinterpret_cast<char*>(&num_entries), sizeof(num_entries));
-    in.read(reinterpret_cast<char*>(&nodes_searched), sizeof(nodes_searched));
-    in.read(reinterpret_cast<char*>(&nodes_proved), sizeof(nodes_proved));
-    in.read(reinterpret_cast<char*>(&nodes_disproved), sizeof(nodes_disproved));
-    in.read(reinterpret_cast<char*>(&retro_hits), sizeof(retro_hits));
-
-    std::cerr << "Loading " << num_entries << " PNS entries...\n";
-
-    pns_table.clear();
-    pns_table.reserve(num_entries);
-
-    for (uint64_t i = 0; i < num_entries; ++i) {
-        PNSTTEntry entry;
-        in.read(reinterpret_cast<char*>(&entry), sizeof(entry));
-        pns_table[entry.hash] = entry;
-    }
-
-    std::cerr << "Loaded. Proved: " << nodes_proved << ", Disproved: " << nodes_disproved << "\n";
+    if (!pns_table.open(path)) return false;
+    std::cerr << "Loaded " << pns_table.size() << " entries"
+              << (pns_table.is_mapped() ? " (mapped)" : "") << ". Proved: " << pns_table.counters()[1]
+              << ", Disproved: " << pns_table.counters()[2] << "\n";
     return true;
 }
 
@@ -94,14 +56,12 @@ void lookup_position(const State& s) {
 
     std::cout << s.to_string() << "\n";
 
-    auto it = pns_table.find(hash);
-    if (it != pns_table.end()) {
-        const auto& entry = it->second;
-        std::cout << "Result: " << result_to_string(entry.result) << "\n";
-        std::cout << "PN: " << entry.proof << ", DN: " << entry.disproof << "\n";
+    if (const PNSSlot* entry = pns_table.find(hash)) {
+        std::cout << "Result: " << result_to_string(entry->result()) << "\n";
+        std::cout << "PN: " << entry->proof() << ", DN: " << entry->disproof() << "\n";
 
         // If position is solved, show best moves
-        if (entry.result == 1 || entry.result == 2) {
+        if (entry->result() == 1 || entry->result() == 2) {
             std::cout << "\nMoves:\n";
             auto moves = generate_moves(s);
             for (const auto& m : moves) {
@@ -119,9 +79,9 @@ void lookup_position(const State& s) {
                     child_result_code = child_loses ? 2 : 1;  // 2=LOSS, 1=WIN
                     child_result_str = child_loses ? "LOSS" : "WIN";
                 } else {
-                    auto child_it = pns_table.find(child_hash);
-                    if (child_it != pns_table.end()) {
-                        child_result_code = child_it->second.result;
+                    const PNSSlot* child_entry = pns_table.find(child_hash);
+                    if (child_entry) {
+                        child_result_code = child_entry->result();
                         child_result_str = result_to_string(child_result_code);
                     } else {
                         child_result_str = "?";
@@ -129,7 +89,7 @@ void lookup_position(const State& s) {
                 }
 
                 std::cout << "  " << m.to_string() << " -> " << child_result_str;
-                if (entry.result == 1 && child_result_code == 2) {
+                if (entry->result() == 1 && child_result_code == 2) {
                     std::cout << " *";  // Mark winning moves
                 }
                 std::cout << "\n";
@@ -144,7 +104,7 @@ void lookup_position(const State& s) {
         for (const auto& m : moves) {
             State child = apply_move(s, m);
             uint64_t child_hash = canonical_hash(child);
-            if (pns_table.find(child_hash) != pns_table.end()) {
+            if (pns_table.contains(child_hash)) {
                 ++known;
             }
         }
@@ -154,10 +114,10 @@ void lookup_position(const State& s) {
                 State child = apply_move(s, m);
                 uint64_t child_hash = canonical_hash(child);
 
-                auto child_it = pns_table.find(child_hash);
-                if (child_it != pns_table.end()) {
+                const PNSSlot* child_entry = pns_table.find(child_hash);
+                if (child_entry) {
                     std::cout << "  " << m.to_string() << " -> "
-                              << result_to_string(child_it->second.result) << "\n";
+                              << result_to_string(child_entry->result()) << "\n";
                 }
             }
         }
@@ -170,15 +130,13 @@ void lookup_json(const State& s) {
 
     std::cout << "{";
 
-    auto it = pns_table.find(hash);
-    if (it != pns_table.end()) {
-        const auto& entry = it->second;
-        std::string result = result_to_string(entry.result);
+    if (const PNSSlot* entry = pns_table.find(hash)) {
+        std::string result = result_to_string(entry->result());
         std::transform(result.begin(), result.end(), result.begin(), ::tolower);
 
         std::cout << "\"result\":\"" << result << "\",";
-        std::cout << "\"pn\":" << entry.proof << ",";
-        std::cout << "\"dn\":" << entry.disproof << ",";
+        std::cout << "\"pn\":" << entry->proof() << ",";
+        std::cout << "\"dn\":" << entry->disproof() << ",";
 
         // Find best move
         std::cout << "\"moves\":[";
@@ -203,9 +161,9 @@ void lookup_json(const State& s) {
                 else child_result = "draw";
             } else {
                 // Check PNS table
-                auto child_it = pns_table.find(child_hash);
-                if (child_it != pns_table.end()) {
-                    child_result = result_to_string(child_it->second.result);
+                const PNSSlot* child_entry = pns_table.find(child_hash);
+                if (child_entry) {
+                    child_result = result_to_string(child_entry->result());
                     std::transform(child_result.begin(), child_result.end(), child_result.begin(), ::tolower);
                 } else {
                     continue;  // Skip moves with unknown non-terminal children
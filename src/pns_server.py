@@ -21,62 +21,148 @@ import sys
 pns_table = {}
 stats = {}
 
+CHECKPOINT_MAGIC = 0x504E5343484B5054  # "PNSCHKPT"
+DELTA_MAGIC = 0x41544C4544534E50       # "PNSDELTA"
+TABLE_MAGIC = 0x31454C4241544E50       # "PNTABLE1", from pns_export --write-table
+SNAPSHOT_VERSION = 3
+HEADER_BYTES = 4096
+PN_INFINITY = 0xFFFFFFFF
+VALUE_MASK = 0x7FFFFFFF
+
+
+def decode_numbers(numbers):
+    """Unpack a PNSSlot numbers word into (proof, disproof, result)"""
+    if numbers == 0:
+        return 1, 1, 0
+    proof_word = numbers & 0xFFFFFFFF
+    disproof_word = numbers >> 32
+    result = (proof_word >> 31) << 1 | (disproof_word >> 31)
+    proof = proof_word & VALUE_MASK
+    disproof = disproof_word & VALUE_MASK
+    return (PN_INFINITY if proof == VALUE_MASK else proof,
+            PN_INFINITY if disproof == VALUE_MASK else disproof,
+            result)
+
+
+def store_slot(key, numbers):
+    proof, disproof, result = decode_numbers(numbers)
+    pns_table[key] = {
+        'proof': proof,
+        'disproof': disproof,
+        'result': result  # 0=unknown, 1=win, 2=loss, 3=draw
+    }
+
+
+def load_snapshot(f, path):
+    """Snapshot: header page, then the raw 16-byte slot array (key, numbers)"""
+    header = struct.unpack('<10Q', f.read(80))
+    snapshot_id, capacity = header[3], header[4]
+    counters = header[6:10]
+
+    f.seek(HEADER_BYTES)
+    chunk_slots = 1 << 16
+    for start in range(0, capacity, chunk_slots):
+        data = f.read(16 * min(chunk_slots, capacity - start))
+        for key, numbers in struct.iter_unpack('<QQ', data):
+            if key != 0:
+                store_slot(key, numbers)
+
+    # Deltas appended since the snapshot, up to the first incomplete one
+    deltas = 0
+    try:
+        with open(path + '.delta', 'rb') as d:
+            while True:
+                head = d.read(56)
+                if len(head) < 56:
+                    break
+                magic, delta_id, num_records = struct.unpack('<3Q', head[:24])
+                if magic != DELTA_MAGIC or delta_id != snapshot_id:
+                    break
+                data = d.read(24 * num_records)
+                commit = d.read(8)
+                if len(data) < 24 * num_records or len(commit) < 8:
+                    break
+                if struct.unpack('<Q', commit)[0] != DELTA_MAGIC ^ num_records:
+                    break
+                for _, key, numbers in struct.iter_unpack('<QQQ', data):
+                    store_slot(key, numbers)
+                counters = struct.unpack('<4Q', head[24:56])
+                deltas += 1
+    except FileNotFoundError:
+        pass
+    print(f"  Deltas applied: {deltas}")
+    return counters
+
+
+def load_table(f):
+    """Table file: header page, then the used slots sorted by key"""
+    header = struct.unpack('<8Q', f.read(64))
+    num_entries, data_offset = header[2], header[3]
+    f.seek(data_offset)
+    chunk_slots = 1 << 16
+    for start in range(0, num_entries, chunk_slots):
+        data = f.read(16 * min(chunk_slots, num_entries - start))
+        for key, numbers in struct.iter_unpack('<QQ', data):
+            store_slot(key, numbers)
+    return header[4:8]
+
+
+def load_stream(f):
+    """Original format: header, then one padded 24-byte record per entry"""
+    num_entries = struct.unpack('<Q', f.read(8))[0]
+    counters = struct.unpack('<4Q', f.read(32))
+    for i in range(num_entries):
+        data = f.read(24)
+        if len(data) < 17:
+            break
+
+        hash_val = struct.unpack('<Q', data[0:8])[0]
+        proof = struct.unpack('<I', data[8:12])[0]
+        disproof = struct.unpack('<I', data[12:16])[0]
+        pns_table[hash_val] = {
+            'proof': proof,
+            'disproof': disproof,
+            'result': data[16]
+        }
+
+        if (i + 1) % 1000000 == 0:
+            print(f"  Loaded {(i+1)//1000000}M entries...")
+    return counters
+
+
 def load_checkpoint(path):
     """Load PNS checkpoint file into memory"""
     global pns_table, stats
 
     print(f"Loading checkpoint: {path}")
 
+    pns_table.clear()
     with open(path, 'rb') as f:
-        # Read header
-        magic = struct.unpack('<Q', f.read(8))[0]
-        if magic != 0x504E5343484B5054:  # "PNSCHKPT"
+        magic, version = struct.unpack('<2Q', f.read(16))
+        if magic == TABLE_MAGIC:
+            f.seek(0)
+            counters = load_table(f)
+        elif magic != CHECKPOINT_MAGIC:
             print("Invalid checkpoint magic")
             return False
 
-        version = struct.unpack('<Q', f.read(8))[0]
-        num_entries = struct.unpack('<Q', f.read(8))[0]
-        nodes_searched = struct.unpack('<Q', f.read(8))[0]
-        nodes_proved = struct.unpack('<Q', f.read(8))[0]
-        nodes_disproved = struct.unpack('<Q', f.read(8))[0]
-        retro_hits = struct.unpack('<Q', f.read(8))[0]
-
-        stats['entries'] = num_entries
-        stats['nodes_searched'] = nodes_searched
-        stats['proved'] = nodes_proved
-        stats['disproved'] = nodes_disproved
-
-        print(f"  Entries: {num_entries}")
-        print(f"  Proved: {nodes_proved}")
-        print(f"  Disproved: {nodes_disproved}")
-
-        # Read entries
-        # Each entry: hash(8) + proof(4) + disproof(4) + result(1) = 17 bytes
-        # But struct packing likely makes it 24 bytes
-        entry_size = 17  # Try packed size first
-
-        pns_table.clear()
-        for i in range(num_entries):
-            data = f.read(24)  # Padded to 24 bytes due to alignment
-            if len(data) < 17:
-                break
-
-            hash_val = struct.unpack('<Q', data[0:8])[0]
-            proof = struct.unpack('<I', data[8:12])[0]
-            disproof = struct.unpack('<I', data[12:16])[0]
-            result = data[16]
-
-            pns_table[hash_val] = {
-                'proof': proof,
-                'disproof': disproof,
-                'result': result  # 0=unknown, 1=win, 2=loss, 3=draw
-            }
-
-            if (i + 1) % 1000000 == 0:
-                print(f"  Loaded {(i+1)//1000000}M entries...")
-
-        print(f"Loaded {len(pns_table)} entries into memory")
-        return True
+        elif version == SNAPSHOT_VERSION:
+            f.seek(0)
+            counters = load_snapshot(f, path)
+        else:
+            counters = load_stream(f)
+
+    nodes_searched, nodes_proved, nodes_disproved, _ = counters
+    stats['entries'] = len(pns_table)
+    stats['nodes_searched'] = nodes_searched
+    stats['proved'] = nodes_proved
+    stats['disproved'] = nodes_disproved
+
+    print(f"  Entries: {len(pns_table)}")
+    print(f"  Proved: {nodes_proved}")
+    print(f"  Disproved: {nodes_disproved}")
+    print(f"Loaded {len(pns_table)} entries into memory")
+    return True
 
 def pos_to_hash(pos_str):
     """
@@ -0,0 +1,152 @@
+#include "pns_table.h"
+#include "hash.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace bobail {
+
+bool PNSTableFile::open(const std::string& path) {
+    close();
+
+    uint64_t magic = 0;
+    {
+        std::ifstream in(path, std::ios::binary);
+        if (!in) {
+            std::cerr << "Cannot open: " << path << "\n";
+            return false;
+        }
+        in.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+    }
+    if (magic == MAGIC) return open_mapped(path);
+
+    // A checkpoint: load it and sort its entries
+    PNSTable table;
+    if (!PNSCheckpointer::read(path, table, counters_)) return false;
+    owned_.reserve(table.size());
+    table.for_each([this](const PNSSlot& slot) { owned_.push_back(slot); });
+    std::sort(owned_.begin(), owned_.end(), [](const PNSSlot& a, const PNSSlot& b) { return a.key < b.key; });
+    entries_ = owned_.data();
+    num_entries_ = owned_.size();
+    return true;
+}
+
+bool PNSTableFile::open_mapped(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        std::cerr << "Failed to open " << path << ": " << std::strerror(errno) << "\n";
+        if (fd >= 0) ::close(fd);
+        return false;
+    }
+    size_t bytes = static_cast<size_t>(st.st_size);
+    void* mem = bytes >= HEADER_BYTES ? mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+    ::close(fd);
+    if (mem == MAP_FAILED) {
+        std::cerr << "Failed to map " << path << ": " << std::strerror(errno) << "\n";
+        return false;
+    }
+    mapping_ = mem;
+    mapping_bytes_ = bytes;
+
+    const auto* h = static_cast<const PNSTableFileHeader*>(mem);
+    if (h->version != VERSION || h->data_offset % sizeof(PNSSlot) != 0 ||
+        h->data_offset + h->num_entries * sizeof(PNSSlot) > bytes) {
+        std::cerr << "PNS table " << path << " is truncated or corrupt\n";
+        close();
+        return false;
+    }
+    if (!use_hash_mode(h->key_mode)) {
+        close();
+        return false;
+    }
+    // Probes jump around the file; readahead would only waste page cache
+    madvise(mapping_, mapping_bytes_, MADV_RANDOM);
+
+    entries_ = reinterpret_cast<const PNSSlot*>(static_cast<const char*>(mem) + h->data_offset);
+    num_entries_ = h->num_entries;
+    std::copy(std::begin(h->counters), std::end(h->counters), counters_.begin());
+    return true;
+}
+
+void PNSTableFile::close() {
+    if (mapping_) munmap(mapping_, mapping_bytes_);
+    mapping_ = nullptr;
+    mapping_bytes_ = 0;
+    owned_.clear();
+    owned_.shrink_to_fit();
+    entries_ = nullptr;
+    num_entries_ = 0;
+    counters_ = {};
+}
+
+const PNSSlot* PNSTableFile::find(uint64_t key) const {
+    size_t lo = 0;
+    size_t hi = num_entries_;  // Search [lo, hi)
+    // Interpolate while that keeps paying off, then bisect. Uneven keys
+    // can make interpolation crawl, so it gets a fixed number of steps.
+    for (int step = 0; hi - lo > 8; ++step) {
+        uint64_t first = entries_[lo].key;
+        uint64_t last = entries_[hi - 1].key;
+        if (key < first || key > last) return nullptr;
+
+        size_t mid = lo + (hi - lo) / 2;
+        if (step < 8 && last > first) {
+            double fraction = static_cast<double>(key - first) / static_cast<double>(last - first);
+            mid = lo + std::min(static_cast<size_t>(fraction * (hi - 1 - lo)), hi - 1 - lo);
+        }
+        uint64_t k = entries_[mid].key;
+        if (k == key) return &entries_[mid];
+        if (k < key) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    for (size_t i = lo; i < hi; ++i) {
+        if (entries_[i].key == key) return &entries_[i];
+    }
+    return nullptr;
+}
+
+bool PNSTableFile::write(const std::string& path, const PNSTable& table, const Counters& counters) {
+    std::vector<PNSSlot> entries;
+    entries.reserve(table.size());
+    table.for_each([&entries](const PNSSlot& slot) { entries.push_back(slot); });
+    std::sort(entries.begin(), entries.end(), [](const PNSSlot& a, const PNSSlot& b) { return a.key < b.key; });
+
+    PNSTableFileHeader header{};
+    header.magic = MAGIC;
+    header.version = VERSION;
+    header.num_entries = entries.size();
+    header.data_offset = HEADER_BYTES;
+    std::copy(counters.begin(), counters.end(), header.counters);
+    header.key_mode = static_cast<uint64_t>(g_hash_mode);
+
+    std::string temp_path = path + ".tmp";
+    std::ofstream out(temp_path, std::ios::binary);
+    if (!out) {
+        std::cerr << "Failed to open " << temp_path << " for writing\n";
+        return false;
+    }
+    std::vector<char> page(HEADER_BYTES, 0);
+    std::memcpy(page.data(), &header, sizeof(header));
+    out.write(page.data(), page.size());
+    out.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(PNSSlot));
+    out.close();
+    if (!out || std::rename(temp_path.c_str(), path.c_str()) != 0) {
+        std::cerr << "Failed to write " << path << "\n";
+        std::remove(temp_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+} // namespace bobail
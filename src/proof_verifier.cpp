@@ -0,0 +1,267 @@
+#include "proof_verifier.h"
+#include "movegen.h"
+#include "symmetry.h"
+#include "work_stealing_deque.h"
+#include <algorithm>
+#include <bit>
+#include <memory>
+#include <random>
+#include <thread>
+
+namespace bobail {
+
+namespace {
+    // A task is a packed state with the claimed result in the bit above it
+    constexpr uint64_t TASK_STATE_MASK = (1ULL << 56) - 1;
+    constexpr uint64_t TASK_CLAIMS_WIN = 1ULL << 56;
+    constexpr size_t DEQUE_CAPACITY = 1 << 16;
+    constexpr uint64_t PROGRESS_INTERVAL = 1 << 20;
+
+    uint8_t claim_code(Result claim) { return claim == Result::WIN ? 1 : 2; }
+
+    const char* result_name(Result r) {
+        switch (r) {
+            case Result::WIN: return "won";
+            case Result::LOSS: return "lost";
+            case Result::DRAW: return "drawn";
+            default: return "unknown";
+        }
+    }
+}
+
+ProofVerifier::ProofVerifier(const PNSTableFile& pns, const Tablebase* tablebase)
+    : pns_(pns), tablebase_(tablebase),
+      visited_(std::bit_ceil(std::max<size_t>(2 * pns.size(), 1024))) {}
+
+bool ProofVerifier::visit(uint64_t key) {
+    // Keys are hashes and spread evenly, so they index the set directly
+    if (key == 0) key = 1;
+    size_t mask = visited_.size() - 1;
+    size_t i = key & mask;
+    for (size_t probes = 0; probes < visited_.size(); ++probes, i = (i + 1) & mask) {
+        uint64_t current = visited_[i].load(std::memory_order_relaxed);
+        if (current == 0 &&
+            visited_[i].compare_exchange_strong(current, key, std::memory_order_relaxed)) {
+            return true;
+        }
+        if (current == key) return false;
+    }
+    // Only positions stored in the checkpoint are added, so this is unreachable
+    return true;
+}
+
+Result ProofVerifier::decided(const State& s) {
+    GameResult gr = check_terminal(s);
+    if (gr != GameResult::ONGOING) {
+        terminals_.fetch_add(1, std::memory_order_relaxed);
+        bool mover_wins = (gr == GameResult::WHITE_WINS) == s.white_to_move;
+        return mover_wins ? Result::WIN : Result::LOSS;
+    }
+    if (tablebase_) {
+        Result r = tablebase_->probe(s);
+        if (r != Result::UNKNOWN) {
+            tablebase_hits_.fetch_add(1, std::memory_order_relaxed);
+            return r;
+        }
+    }
+    return Result::UNKNOWN;
+}
+
+void ProofVerifier::fail(const State& s, std::string reason) {
+    uint64_t n = call_failures_.fetch_add(1, std::memory_order_relaxed) + 1;
+    if (n >= max_failures_) stop_.store(true, std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(failures_mutex_);
+    if (n <= max_failures_) failures_.push_back({pack_state(s), std::move(reason)});
+}
+
+template <typename Push>
+void ProofVerifier::check(const State& s, Result claim, Push&& push, ProofGraph& graph) {
+    Result known = decided(s);
+    if (known != Result::UNKNOWN) {
+        if (known != claim) {
+            fail(s, std::string("claimed ") + result_name(claim) + ", but " +
+                    (check_terminal(s) != GameResult::ONGOING ? "the game is over and " : "the tablebase says ") +
+                    "it is " + result_name(known));
+        }
+        return;
+    }
+
+    uint64_t key = canonical_hash(s);
+    const PNSSlot* entry = pns_.find(key);
+    uint8_t code = entry ? entry->result() : 0;
+    if (code != claim_code(claim)) {
+        fail(s, std::string("claimed ") + result_name(claim) + ", but the checkpoint " +
+                (code == 0 ? "has not proved it" : "has the opposite result"));
+        return;
+    }
+    if (!visit(key)) return;
+    graph.nodes.emplace_back(key, pack_state(s) | (claim == Result::WIN ? TASK_CLAIMS_WIN : 0));
+
+    uint64_t n = positions_.fetch_add(1, std::memory_order_relaxed) + 1;
+    if (progress_cb_ && n % PROGRESS_INTERVAL == 0) progress_cb_("Verifying", n, pns_.size());
+
+    MoveList moves;
+    generate_moves(s, moves);
+    if (moves.empty()) {
+        terminals_.fetch_add(1, std::memory_order_relaxed);
+        if (claim != Result::LOSS) fail(s, "claimed won, but there is no legal move");
+        return;
+    }
+
+    if (claim == Result::LOSS) {
+        // Children the rules or the tablebase decide never become nodes,
+        // so edges to them count as resolved
+        size_t first = graph.edges.size();
+        for (const auto& move : moves) {
+            State child = apply_move(s, move);
+            graph.edges.emplace_back(key, canonical_hash(child));
+            push(pack_state(child), Result::WIN);
+        }
+        std::sort(graph.edges.begin() + first, graph.edges.end());
+        graph.edges.erase(std::unique(graph.edges.begin() + first, graph.edges.end()), graph.edges.end());
+        return;
+    }
+
+    // One winning move is enough; prefer one that needs no further proof
+    uint64_t witness = 0;
+    uint64_t witness_key = 0;
+    for (const auto& move : moves) {
+        State child = apply_move(s, move);
+        Result r = decided(child);
+        if (r == Result::LOSS) return;
+        if (r != Result::UNKNOWN || witness) continue;
+        uint64_t child_key = canonical_hash(child);
+        const PNSSlot* child_entry = pns_.find(child_key);
+        if (child_entry && child_entry->result() == claim_code(Result::LOSS)) {
+            witness = pack_state(child);
+            witness_key = child_key;
+        }
+    }
+    if (witness) {
+        graph.edges.emplace_back(key, witness_key);
+        push(witness, Result::LOSS);
+    } else {
+        fail(s, "claimed won, but no move reaches a position proved lost");
+    }
+}
+
+void ProofVerifier::check_cycles(std::vector<ProofGraph>& graphs) {
+    std::vector<std::pair<uint64_t, uint64_t>> nodes;
+    std::vector<std::pair<uint64_t, uint64_t>> edges;
+    for (auto& g : graphs) {
+        nodes.insert(nodes.end(), g.nodes.begin(), g.nodes.end());
+        edges.insert(edges.end(), g.edges.begin(), g.edges.end());
+        g = {};
+    }
+    std::sort(nodes.begin(), nodes.end());
+    auto index_of = [&](uint64_t key) -> int64_t {
+        auto it = std::lower_bound(nodes.begin(), nodes.end(), std::make_pair(key, uint64_t(0)));
+        return it != nodes.end() && it->first == key ? it - nodes.begin() : -1;
+    };
+
+    // Edges to positions that are not nodes of this call end in the rules,
+    // the tablebase or a clean earlier call, so only the others wait.
+    // Each waiting edge becomes (child, parent) to walk it backwards.
+    std::vector<uint32_t> waiting(nodes.size(), 0);
+    std::vector<std::pair<uint32_t, uint32_t>> parents;
+    parents.reserve(edges.size());
+    for (const auto& [parent_key, child_key] : edges) {
+        int64_t child = index_of(child_key);
+        if (child < 0) continue;
+        uint32_t parent = static_cast<uint32_t>(index_of(parent_key));
+        ++waiting[parent];
+        parents.emplace_back(static_cast<uint32_t>(child), parent);
+    }
+    edges = {};
+    std::sort(parents.begin(), parents.end());
+
+    // Kahn: resolve nodes with nothing left to wait for, then their parents
+    std::vector<uint32_t> ready;
+    for (uint32_t i = 0; i < nodes.size(); ++i) {
+        if (waiting[i] == 0) ready.push_back(i);
+    }
+    size_t resolved = 0;
+    while (!ready.empty()) {
+        uint32_t child = ready.back();
+        ready.pop_back();
+        ++resolved;
+        auto it = std::lower_bound(parents.begin(), parents.end(), std::make_pair(child, uint32_t(0)));
+        for (; it != parents.end() && it->first == child; ++it) {
+            if (--waiting[it->second] == 0) ready.push_back(it->second);
+        }
+    }
+    if (resolved == nodes.size()) return;
+
+    for (uint32_t i = 0; i < nodes.size() && !stop_.load(std::memory_order_relaxed); ++i) {
+        if (waiting[i] == 0) continue;
+        uint64_t task = nodes[i].second;
+        fail(unpack_state(task & TASK_STATE_MASK),
+             std::string("claimed ") + result_name((task & TASK_CLAIMS_WIN) ? Result::WIN : Result::LOSS) +
+             ", but the proof leads round a cycle");
+    }
+}
+
+bool ProofVerifier::verify(const State& root, Result claim) {
+    call_failures_.store(0, std::memory_order_relaxed);
+    stop_.store(false, std::memory_order_relaxed);
+    if (claim != Result::WIN && claim != Result::LOSS) {
+        fail(root, std::string("only won and lost positions have proofs, not ") + result_name(claim));
+        return false;
+    }
+
+    int num_threads = std::max(1, num_threads_);
+    std::vector<std::unique_ptr<WorkStealingDeque<uint64_t>>> deques;
+    for (int i = 0; i < num_threads; ++i) {
+        deques.push_back(std::make_unique<WorkStealingDeque<uint64_t>>(DEQUE_CAPACITY));
+    }
+    std::vector<ProofGraph> graphs(num_threads);
+    // Tasks queued or being checked; everyone stops when it hits zero
+    std::atomic<int64_t> pending{1};
+    deques[0]->push(pack_state(root) | (claim == Result::WIN ? TASK_CLAIMS_WIN : 0));
+
+    auto worker = [&](int id) {
+        WorkStealingDeque<uint64_t>& own = *deques[id];
+        std::vector<uint64_t> overflow;  // Tasks that did not fit in the deque
+        std::minstd_rand rng(id + 1);
+
+        auto push = [&](uint64_t packed, Result child_claim) {
+            uint64_t task = packed | (child_claim == Result::WIN ? TASK_CLAIMS_WIN : 0);
+            pending.fetch_add(1, std::memory_order_relaxed);
+            if (!own.push(task)) overflow.push_back(task);
+        };
+
+        uint64_t task;
+        while (pending.load(std::memory_order_acquire) > 0 && !stop_.load(std::memory_order_relaxed)) {
+            if (!own.pop(task)) {
+                if (!overflow.empty()) {
+                    task = overflow.back();
+                    overflow.pop_back();
+                } else if (!deques[rng() % num_threads]->steal(task)) {
+                    std::this_thread::yield();
+                    continue;
+                }
+            }
+            check(unpack_state(task & TASK_STATE_MASK),
+                  (task & TASK_CLAIMS_WIN) ? Result::WIN : Result::LOSS, push, graphs[id]);
+            pending.fetch_sub(1, std::memory_order_acq_rel);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 1; i < num_threads; ++i) threads.emplace_back(worker, i);
+    worker(0);
+    for (auto& t : threads) t.join();
+    if (call_failures_.load() == 0) check_cycles(graphs);
+
+    stats_.positions = positions_.load();
+    stats_.terminals = terminals_.load();
+    stats_.tablebase_hits = tablebase_hits_.load();
+
+    // Only a clean call leaves nothing but fully checked positions marked;
+    // otherwise a later claim could skip a subtree that failed or was cut off
+    if (call_failures_.load() == 0) return true;
+    for (auto& slot : visited_) slot.store(0, std::memory_order_relaxed);
+    return false;
+}
+
+} // namespace bobail
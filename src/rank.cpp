@@ -0,0 +1,180 @@
+#include "rank.h"
+#include "symmetry.h"
+#include <array>
+#include <bit>
+
+#if defined(__BMI2__)
+#include <immintrin.h>
+#endif
+
+namespace bobail {
+
+namespace {
+    // binomial[n][k] = C(n, k) for n <= 25, k <= 5
+    constexpr auto make_binomial_table() {
+        std::array<std::array<uint32_t, PAWNS_PER_SIDE + 1>, NUM_SQUARES + 1> t{};
+        for (int n = 0; n <= NUM_SQUARES; ++n) {
+            t[n][0] = 1;
+            for (int k = 1; k <= PAWNS_PER_SIDE; ++k) {
+                t[n][k] = n == 0 ? 0 : t[n - 1][k - 1] + t[n - 1][k];
+            }
+        }
+        return t;
+    }
+
+    constexpr auto binomial = make_binomial_table();
+
+    static_assert(binomial[24][5] == RANK_WHITE_COMBINATIONS);
+    static_assert(binomial[19][5] == RANK_BLACK_COMBINATIONS);
+
+    constexpr uint32_t BOARD_MASK = (1u << NUM_SQUARES) - 1;
+
+    // Gather the bits of `bits` at the positions set in `free_mask`
+    // into the low bits of the result (pext)
+    inline uint32_t compress_bits(uint32_t bits, uint32_t free_mask) {
+#if defined(__BMI2__)
+        return _pext_u32(bits, free_mask);
+#else
+        uint32_t result = 0;
+        int out = 0;
+        while (free_mask) {
+            uint32_t low = free_mask & (0u - free_mask);
+            if (bits & low) result |= 1u << out;
+            ++out;
+            free_mask &= free_mask - 1;
+        }
+        return result;
+#endif
+    }
+
+    // Scatter the low bits of `bits` to the positions set in `free_mask` (pdep)
+    inline uint32_t expand_bits(uint32_t bits, uint32_t free_mask) {
+#if defined(__BMI2__)
+        return _pdep_u32(bits, free_mask);
+#else
+        uint32_t result = 0;
+        while (free_mask && bits) {
+            uint32_t low = free_mask & (0u - free_mask);
+            if (bits & 1u) result |= low;
+            bits >>= 1;
+            free_mask &= free_mask - 1;
+        }
+        return result;
+#endif
+    }
+
+    // Colex rank of a k-element subset: sum of C(c_i, i) over its
+    // elements c_1 < ... < c_k
+    inline uint32_t combination_rank(uint32_t subset) {
+        uint32_t r = 0;
+        int i = 1;
+        while (subset) {
+            int c = std::countr_zero(subset);
+            subset &= subset - 1;
+            r += binomial[c][i++];
+        }
+        return r;
+    }
+
+    // Inverse of combination_rank for a k-element subset of n elements
+    inline uint32_t combination_unrank(uint32_t r, int n, int k) {
+        uint32_t subset = 0;
+        int c = n;
+        for (int i = k; i >= 1; --i) {
+            do {
+                --c;
+            } while (binomial[c][i] > r);
+            r -= binomial[c][i];
+            subset |= 1u << c;
+        }
+        return subset;
+    }
+}
+
+int rank_bobail_square(int bobail_index) {
+    return State::square(bobail_index / RANK_BOBAIL_COLUMNS, bobail_index % RANK_BOBAIL_COLUMNS);
+}
+
+int rank_bobail_index(int bobail_sq) {
+    return State::row(bobail_sq) * RANK_BOBAIL_COLUMNS + State::col(bobail_sq);
+}
+
+namespace {
+    // The ranking for `pawns` pawns per side, with `white_combinations` =
+    // C(24, pawns) and `black_combinations` = C(24 - pawns, pawns). The
+    // free functions pass constants, so the full space loses nothing to
+    // the generality.
+    inline uint64_t rank_canonical_in(const State& s, uint64_t white_combinations,
+                                      uint64_t black_combinations) {
+        uint32_t bobail_bit = 1u << s.bobail_sq;
+        uint32_t white_free = BOARD_MASK & ~bobail_bit;
+        uint32_t black_free = white_free & ~s.white_pawns;
+
+        uint64_t white_rank = combination_rank(compress_bits(s.white_pawns, white_free));
+        uint64_t black_rank = combination_rank(compress_bits(s.black_pawns, black_free));
+
+        uint64_t slice = static_cast<uint64_t>(rank_bobail_index(s.bobail_sq)) * 2 +
+                         (s.white_to_move ? 1 : 0);
+        return (slice * white_combinations + white_rank) * black_combinations + black_rank;
+    }
+
+    inline State unrank_in(uint64_t index, int pawns, uint64_t white_combinations,
+                           uint64_t black_combinations) {
+        uint64_t black_rank = index % black_combinations;
+        index /= black_combinations;
+        uint64_t white_rank = index % white_combinations;
+        index /= white_combinations;
+
+        State s;
+        s.white_to_move = (index & 1) != 0;
+        s.bobail_sq = static_cast<uint8_t>(rank_bobail_square(static_cast<int>(index >> 1)));
+
+        uint32_t white_free = BOARD_MASK & ~(1u << s.bobail_sq);
+        s.white_pawns = expand_bits(
+            combination_unrank(static_cast<uint32_t>(white_rank), NUM_SQUARES - 1, pawns), white_free);
+
+        uint32_t black_free = white_free & ~s.white_pawns;
+        s.black_pawns = expand_bits(
+            combination_unrank(static_cast<uint32_t>(black_rank), NUM_SQUARES - 1 - pawns, pawns),
+            black_free);
+        return s;
+    }
+}
+
+uint64_t rank_canonical(const State& s) {
+    return rank_canonical_in(s, RANK_WHITE_COMBINATIONS, RANK_BLACK_COMBINATIONS);
+}
+
+uint64_t rank_state(const State& s) {
+    return rank_canonical(unpack_state(canonical_pack(s)));
+}
+
+State unrank_state(uint64_t index) {
+    return unrank_in(index, PAWNS_PER_SIDE, RANK_WHITE_COMBINATIONS, RANK_BLACK_COMBINATIONS);
+}
+
+RankSpace::RankSpace(int pawns)
+    : pawns_(pawns),
+      white_combinations_(binomial[NUM_SQUARES - 1][pawns]),
+      black_combinations_(binomial[NUM_SQUARES - 1 - pawns][pawns]) {}
+
+uint64_t RankSpace::rank_canonical(const State& canonical) const {
+    if (is_full()) return bobail::rank_canonical(canonical);
+    return rank_canonical_in(canonical, white_combinations_, black_combinations_);
+}
+
+uint64_t RankSpace::rank(const State& s) const {
+    return rank_canonical(unpack_state(canonical_pack(s)));
+}
+
+State RankSpace::unrank(uint64_t index) const {
+    if (is_full()) return unrank_state(index);
+    return unrank_in(index, pawns_, white_combinations_, black_combinations_);
+}
+
+bool is_canonical(const State& s) {
+    uint64_t packed = pack_state(s);
+    return canonical_packed(packed) == packed;
+}
+
+} // namespace bobail
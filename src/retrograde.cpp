@@ -69,8 +69,7 @@ void RetrogradeSolver::enumerate_states() {
     } else {
         // Fresh start - BFS from starting position
         State start = State::starting_position();
-        auto [canonical_start, _] = canonicalize(start);
-        uint64_t start_packed = pack_state(canonical_start);
+        uint64_t start_packed = canonical_pack(start);
 
         start_id_ = get_or_create_state(start_packed);
         queue.push(start_id_);
@@ -106,8 +105,7 @@ void RetrogradeSolver::enumerate_states() {
         // Process each successor
         for (const auto& move : moves) {
             State ns = apply_move(s, move);
-            auto [canonical_ns, __] = canonicalize(ns);
-            uint64_t ns_packed = pack_state(canonical_ns);
+            uint64_t ns_packed = canonical_pack(ns);
 
             auto it = state_to_id_.find(ns_packed);
             if (it == state_to_id_.end()) {
@@ -160,8 +158,7 @@ void RetrogradeSolver::build_predecessors() {
 
         for (const auto& move : moves) {
             State ns = apply_move(s, move);
-            auto [canonical_ns, _] = canonicalize(ns);
-            uint64_t ns_packed = pack_state(canonical_ns);
+            uint64_t ns_packed = canonical_pack(ns);
 
             int64_t succ_id = get_state_id(ns_packed);
             if (succ_id >= 0) {
@@ -314,8 +311,7 @@ int64_t RetrogradeSolver::get_state_id(uint64_t packed) const {
 }
 
 Result RetrogradeSolver::get_result(const State& s) const {
-    auto [canonical, _] = canonicalize(s);
-    uint64_t packed = pack_state(canonical);
+    uint64_t packed = canonical_pack(s);
     int64_t id = get_state_id(packed);
     if (id >= 0) {
         return states_[id].result;
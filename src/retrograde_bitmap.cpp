@@ -0,0 +1,422 @@
+#include "retrograde_bitmap.h"
+#include "symmetry.h"
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace bobail {
+
+uint8_t encode_bitmap_result(Result r) {
+    switch (r) {
+        case Result::WIN: return BITMAP_WIN;
+        case Result::LOSS: return BITMAP_LOSS;
+        case Result::DRAW: return BITMAP_DRAW;
+        default: return BITMAP_UNKNOWN;
+    }
+}
+
+Result decode_bitmap_result(uint8_t code) {
+    switch (code) {
+        case BITMAP_WIN: return Result::WIN;
+        case BITMAP_LOSS: return Result::LOSS;
+        case BITMAP_DRAW: return Result::DRAW;
+        default: return Result::UNKNOWN;
+    }
+}
+
+// ============================================================================
+// ResultBitmap
+// ============================================================================
+
+ResultBitmap::~ResultBitmap() {
+    close();
+}
+
+bool ResultBitmap::open(const std::string& path, uint64_t num_cells) {
+    close();
+
+    fd_ = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd_ < 0) {
+        std::cerr << "Failed to open " << path << ": " << std::strerror(errno) << "\n";
+        return false;
+    }
+
+    uint64_t data_bytes = ((num_cells + 31) / 32) * sizeof(uint64_t);
+    mapping_bytes_ = HEADER_BYTES + data_bytes;
+
+    struct stat st;
+    if (fstat(fd_, &st) != 0) {
+        std::cerr << "Failed to stat " << path << ": " << std::strerror(errno) << "\n";
+        close();
+        return false;
+    }
+    bool fresh = st.st_size == 0;
+
+    if (!fresh && static_cast<uint64_t>(st.st_size) != mapping_bytes_) {
+        std::cerr << "Result file " << path << " has size " << st.st_size
+                  << ", expected " << mapping_bytes_ << "\n";
+        close();
+        return false;
+    }
+
+    // Sparse file: untouched pages read back as zero (UNKNOWN)
+    if (fresh && ftruncate(fd_, static_cast<off_t>(mapping_bytes_)) != 0) {
+        std::cerr << "Failed to size " << path << ": " << std::strerror(errno) << "\n";
+        close();
+        return false;
+    }
+
+    mapping_ = mmap(nullptr, mapping_bytes_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (mapping_ == MAP_FAILED) {
+        mapping_ = nullptr;
+        std::cerr << "Failed to map " << path << ": " << std::strerror(errno) << "\n";
+        close();
+        return false;
+    }
+
+    header_ = static_cast<BitmapHeader*>(mapping_);
+    words_ = reinterpret_cast<uint64_t*>(static_cast<char*>(mapping_) + HEADER_BYTES);
+    num_cells_ = num_cells;
+
+    if (fresh) {
+        std::memset(header_, 0, sizeof(BitmapHeader));
+        header_->magic = MAGIC;
+        header_->version = VERSION;
+        header_->num_cells = num_cells;
+    } else if (header_->magic != MAGIC || header_->version != VERSION ||
+               header_->num_cells != num_cells) {
+        std::cerr << "Result file " << path << " has an unrecognized header\n";
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+void ResultBitmap::close() {
+    if (mapping_) {
+        msync(mapping_, mapping_bytes_, MS_SYNC);
+        munmap(mapping_, mapping_bytes_);
+        mapping_ = nullptr;
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+    header_ = nullptr;
+    words_ = nullptr;
+    num_cells_ = 0;
+    mapping_bytes_ = 0;
+}
+
+bool ResultBitmap::sync() {
+    if (!mapping_) return false;
+    return msync(mapping_, mapping_bytes_, MS_SYNC) == 0;
+}
+
+// ============================================================================
+// RetrogradeSolverBitmap
+// ============================================================================
+
+namespace {
+    constexpr uint64_t SWEEP_CHUNK = 1ULL << 20;
+    constexpr const char* RESULT_FILE = "/results.bitmap";
+}
+
+RetrogradeSolverBitmap::~RetrogradeSolverBitmap() {
+    close();
+}
+
+bool RetrogradeSolverBitmap::open(const std::string& path) {
+    if (mkdir(path.c_str(), 0755) != 0 && errno != EEXIST) {
+        std::cerr << "Failed to create directory " << path << ": " << std::strerror(errno) << "\n";
+        return false;
+    }
+
+    if (!results_.open(path + RESULT_FILE, space_.size())) {
+        return false;
+    }
+
+    BitmapHeader& h = results_.header();
+    if (h.phase == static_cast<uint32_t>(SolvePhase::NOT_STARTED)) {
+        h.rules_variant = static_cast<uint32_t>(g_rules_variant);
+    } else if (h.rules_variant != static_cast<uint32_t>(g_rules_variant)) {
+        std::cerr << "Result file was solved with "
+                  << (h.rules_variant == static_cast<uint32_t>(RulesVariant::OFFICIAL) ? "official" : "flexible")
+                  << " rules; pass the matching rules flag\n";
+        results_.close();
+        return false;
+    }
+
+    phase_ = static_cast<SolvePhase>(h.phase);
+    sweep_ = h.sweep;
+    num_wins_ = h.num_wins;
+    num_losses_ = h.num_losses;
+    num_draws_ = h.num_draws;
+
+    std::cout << "Opened result bitmap: " << space_.size() << " positions, "
+              << (results_.size() / 4) / (1024 * 1024) << " MB\n";
+    std::cout << "  Phase: " << static_cast<int>(phase_) << ", sweeps completed: " << sweep_ << "\n";
+    return true;
+}
+
+void RetrogradeSolverBitmap::close() {
+    if (results_.is_open()) {
+        save_header();
+        results_.close();
+    }
+}
+
+void RetrogradeSolverBitmap::save_header() {
+    BitmapHeader& h = results_.header();
+    h.phase = static_cast<uint32_t>(phase_);
+    h.sweep = sweep_;
+    h.num_wins = num_wins_;
+    h.num_losses = num_losses_;
+    h.num_draws = num_draws_;
+    results_.sync();
+}
+
+uint64_t RetrogradeSolverBitmap::parallel_sweep(
+        const char* phase, const std::function<uint64_t(uint64_t, uint64_t)>& fn) {
+    const uint64_t space_size = space_.size();
+    const uint64_t num_chunks = (space_size + SWEEP_CHUNK - 1) / SWEEP_CHUNK;
+    std::atomic<uint64_t> next_chunk{0};
+    std::atomic<uint64_t> chunks_done{0};
+    std::atomic<uint64_t> total{0};
+    std::atomic<int> workers_done{0};
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < num_threads_; ++t) {
+        workers.emplace_back([&]() {
+            uint64_t local = 0;
+            for (;;) {
+                uint64_t chunk = next_chunk.fetch_add(1);
+                if (chunk >= num_chunks) break;
+                uint64_t first = chunk * SWEEP_CHUNK;
+                uint64_t last = std::min(first + SWEEP_CHUNK, space_size);
+                local += fn(first, last);
+                chunks_done.fetch_add(1);
+            }
+            total.fetch_add(local);
+            workers_done.fetch_add(1);
+        });
+    }
+
+    auto last_report = std::chrono::steady_clock::now();
+    while (workers_done.load() < num_threads_) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        auto now = std::chrono::steady_clock::now();
+        if (progress_cb_ && now - last_report >= std::chrono::seconds(1)) {
+            progress_cb_(phase, std::min(chunks_done.load() * SWEEP_CHUNK, space_size), space_size);
+            last_report = now;
+        }
+    }
+    for (auto& w : workers) {
+        w.join();
+    }
+    if (progress_cb_) {
+        progress_cb_(phase, space_size, space_size);
+    }
+    return total.load();
+}
+
+bool RetrogradeSolverBitmap::solve() {
+    if (!results_.is_open()) {
+        std::cerr << "Result bitmap not open\n";
+        return false;
+    }
+
+    if (phase_ == SolvePhase::NOT_STARTED ||
+        phase_ == SolvePhase::ENUMERATING ||
+        phase_ == SolvePhase::BUILDING_PREDECESSORS) {
+        // Rank indexing makes enumeration and the predecessor graph unnecessary
+        phase_ = SolvePhase::MARKING_TERMINALS;
+        save_header();
+    }
+
+    if (phase_ == SolvePhase::MARKING_TERMINALS) {
+        std::cout << "\n=== Phase 1: Marking terminal positions ===\n";
+        mark_terminals();
+        phase_ = SolvePhase::PROPAGATING;
+        save_header();
+    }
+
+    if (phase_ == SolvePhase::PROPAGATING) {
+        std::cout << "\n=== Phase 2: Propagating results ===\n";
+        propagate();
+        mark_draws();
+        phase_ = SolvePhase::COMPLETE;
+        save_header();
+    }
+
+    std::cout << "\nSolve complete: " << num_wins_ << " wins, " << num_losses_
+              << " losses, " << num_draws_ << " draws\n";
+    return true;
+}
+
+void RetrogradeSolverBitmap::mark_terminals() {
+    auto t0 = std::chrono::steady_clock::now();
+
+    uint64_t marked = parallel_sweep("Marking terminals", [this](uint64_t first, uint64_t last) {
+        uint64_t local = 0;
+        for (uint64_t i = first; i < last; ++i) {
+            if (results_.get(i) != BITMAP_UNKNOWN) continue;
+            State s = space_.unrank(i);
+            if (!is_canonical(s)) continue;
+
+            uint8_t code = BITMAP_UNKNOWN;
+            GameResult gr = check_terminal(s);
+            if (gr == GameResult::WHITE_WINS) {
+                code = s.white_to_move ? BITMAP_WIN : BITMAP_LOSS;
+            } else if (gr == GameResult::BLACK_WINS) {
+                code = s.white_to_move ? BITMAP_LOSS : BITMAP_WIN;
+            } else if (count_moves(s) == 0) {
+                code = BITMAP_LOSS;  // No legal moves - side to move loses
+            }
+
+            if (code != BITMAP_UNKNOWN && results_.set(i, code)) {
+                ++local;
+            }
+        }
+        return local;
+    });
+
+    auto secs = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::steady_clock::now() - t0).count();
+    std::cout << "\nMarked " << marked << " terminal positions in " << secs << "s\n";
+}
+
+bool RetrogradeSolverBitmap::resolve(uint64_t index, const State& s) {
+    MoveList moves;
+    generate_moves(s, moves);
+
+    std::array<uint64_t, MAX_MOVES> successors;
+    for (size_t m = 0; m < moves.size(); ++m) {
+        successors[m] = pack_state(apply_move(s, moves[m]));
+    }
+    canonicalize_packed_batch(successors.data(), successors.data(), moves.size());
+
+    // Results are from the successor's point of view (opponent to move)
+    bool all_win = true;
+    for (size_t m = 0; m < moves.size(); ++m) {
+        uint8_t code = results_.get(space_.rank_canonical(unpack_state(successors[m])));
+        if (code == BITMAP_LOSS) {
+            return results_.set(index, BITMAP_WIN);
+        }
+        if (code != BITMAP_WIN) {
+            all_win = false;
+        }
+    }
+
+    if (all_win && !moves.empty()) {
+        return results_.set(index, BITMAP_LOSS);
+    }
+    return false;
+}
+
+void RetrogradeSolverBitmap::propagate() {
+    // Gauss-Seidel style: results written during a sweep are visible to the
+    // rest of that sweep, so most chains resolve in far fewer sweeps than
+    // their length. Results are final once written, so resuming simply
+    // restarts the interrupted sweep.
+    for (;;) {
+        auto t0 = std::chrono::steady_clock::now();
+
+        uint64_t changed = parallel_sweep("Propagating", [this](uint64_t first, uint64_t last) {
+            uint64_t local = 0;
+            for (uint64_t i = first; i < last; ++i) {
+                if (results_.get(i) != BITMAP_UNKNOWN) continue;
+                State s = space_.unrank(i);
+                if (!is_canonical(s)) continue;
+                if (resolve(i, s)) ++local;
+            }
+            return local;
+        });
+
+        ++sweep_;
+        save_header();
+
+        auto secs = std::chrono::duration_cast<std::chrono::seconds>(
+            std::chrono::steady_clock::now() - t0).count();
+        std::cout << "\nSweep " << sweep_ << ": resolved " << changed << " positions in "
+                  << secs << "s\n";
+
+        if (changed == 0) break;
+    }
+}
+
+void RetrogradeSolverBitmap::mark_draws() {
+    std::atomic<uint64_t> wins{0};
+    std::atomic<uint64_t> losses{0};
+    std::atomic<uint64_t> draws{0};
+
+    parallel_sweep("Marking draws", [&](uint64_t first, uint64_t last) {
+        uint64_t w = 0, l = 0, d = 0;
+        for (uint64_t i = first; i < last; ++i) {
+            uint8_t code = results_.get(i);
+            if (code == BITMAP_UNKNOWN) {
+                if (!is_canonical(space_.unrank(i))) continue;
+                results_.set(i, BITMAP_DRAW);
+                code = BITMAP_DRAW;
+            }
+            if (code == BITMAP_WIN) ++w;
+            else if (code == BITMAP_LOSS) ++l;
+            else ++d;
+        }
+        wins.fetch_add(w);
+        losses.fetch_add(l);
+        draws.fetch_add(d);
+        return static_cast<uint64_t>(0);
+    });
+
+    num_wins_ = wins.load();
+    num_losses_ = losses.load();
+    num_draws_ = draws.load();
+}
+
+Result RetrogradeSolverBitmap::get_result(const State& s) const {
+    if (!results_.is_open()) return Result::UNKNOWN;
+    return decode_bitmap_result(results_.get(space_.rank(s)));
+}
+
+Move RetrogradeSolverBitmap::get_best_move(const State& s) const {
+    Result my_result = get_result(s);
+
+    MoveList moves;
+    generate_moves(s, moves);
+    if (moves.empty()) {
+        return Move{};
+    }
+
+    for (const auto& move : moves) {
+        Result opp_result = get_result(apply_move(s, move));
+
+        if (my_result == Result::WIN && opp_result == Result::LOSS) {
+            return move;
+        }
+        if (my_result == Result::DRAW && opp_result == Result::DRAW) {
+            return move;
+        }
+        if (my_result == Result::LOSS) {
+            if (opp_result == Result::DRAW) return move;
+            if (opp_result == Result::WIN) return move;
+        }
+    }
+
+    return moves[0];
+}
+
+Result RetrogradeSolverBitmap::starting_result() const {
+    return get_result(State::starting_position());
+}
+
+} // namespace bobail
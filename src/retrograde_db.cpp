@@ -1,7 +1,9 @@
 #include "retrograde_db.h"
 #include "movegen.h"
 #include "hash.h"
+#include "rank.h"
 #include "symmetry.h"
+#include "spsc_ring.h"
 #include <iostream>
 #include <iomanip>
 #include <fstream>
@@ -10,19 +12,292 @@
 #include <chrono>
 #include <thread>
 #include <atomic>
+#include <deque>
 #include <mutex>
 #include <rocksdb/write_batch.h>
 #include <rocksdb/table.h>
 #include <rocksdb/cache.h>
+#include <rocksdb/merge_operator.h>
+#include <rocksdb/sst_file_writer.h>
+#include <rocksdb/slice_transform.h>
+#include <cstdio>
+#include <filesystem>
 
 namespace bobail {
 
+namespace {
+    // Merge operator for the predecessors column family. A value is a packed
+    // array of uint32 predecessor ids and an operand is a chunk to append,
+    // so writers can issue blind Merge() calls instead of read-modify-write.
+    // Full merges (reads, compaction) sort the list; duplicates are kept,
+    // since a parent with two moves into the same child is two edges and
+    // propagation counts each against num_successors.
+    class PredecessorListMerge : public rocksdb::MergeOperator {
+    public:
+        const char* Name() const override { return "PredecessorListMerge"; }
+
+        bool FullMergeV2(const MergeOperationInput& in, MergeOperationOutput* out) const override {
+            size_t bytes = in.existing_value ? in.existing_value->size() : 0;
+            for (const auto& op : in.operand_list) bytes += op.size();
+
+            std::vector<uint32_t> ids(bytes / sizeof(uint32_t));
+            char* dst = reinterpret_cast<char*>(ids.data());
+            if (in.existing_value) {
+                std::memcpy(dst, in.existing_value->data(), in.existing_value->size());
+                dst += in.existing_value->size();
+            }
+            for (const auto& op : in.operand_list) {
+                std::memcpy(dst, op.data(), op.size());
+                dst += op.size();
+            }
+            std::sort(ids.begin(), ids.end());
+
+            out->new_value.assign(reinterpret_cast<const char*>(ids.data()), ids.size() * sizeof(uint32_t));
+            return true;
+        }
+
+        bool PartialMergeMulti(const rocksdb::Slice&, const std::deque<rocksdb::Slice>& operands,
+                               std::string* new_value, rocksdb::Logger*) const override {
+            new_value->clear();
+            for (const auto& op : operands) new_value->append(op.data(), op.size());
+            return true;
+        }
+
+        bool AllowSingleOperand() const override { return true; }
+    };
+
+    // External sort edges pack (successor, predecessor) into one word with
+    // the successor byte-swapped into the high half, so sorting the words
+    // orders successors by their little-endian 4-byte RocksDB key (the
+    // bytewise order SstFileWriter requires), then predecessors ascending.
+    inline uint64_t make_sort_edge(uint32_t succ_id, uint32_t pred_id) {
+        return (static_cast<uint64_t>(__builtin_bswap32(succ_id)) << 32) | pred_id;
+    }
+
+    inline uint32_t sort_edge_succ(uint64_t edge) {
+        return __builtin_bswap32(static_cast<uint32_t>(edge >> 32));
+    }
+
+    // LSD radix sort of 64-bit words, 16 bits per pass
+    void radix_sort_edges(std::vector<uint64_t>& data, std::vector<uint64_t>& scratch) {
+        scratch.resize(data.size());
+        std::vector<size_t> counts(1 << 16);
+        for (int shift = 0; shift < 64; shift += 16) {
+            std::fill(counts.begin(), counts.end(), 0);
+            for (uint64_t v : data) ++counts[(v >> shift) & 0xFFFF];
+            size_t sum = 0;
+            for (auto& c : counts) {
+                size_t n = c;
+                c = sum;
+                sum += n;
+            }
+            for (uint64_t v : data) scratch[counts[(v >> shift) & 0xFFFF]++] = v;
+            data.swap(scratch);
+        }
+    }
+
+    // Buffered sequential reader over one sorted run file
+    class RunReader {
+    public:
+        explicit RunReader(const std::string& path) : file_(std::fopen(path.c_str(), "rb")), buf_(1 << 16) {}
+        ~RunReader() { if (file_) std::fclose(file_); }
+
+        RunReader(const RunReader&) = delete;
+        RunReader& operator=(const RunReader&) = delete;
+
+        bool ok() const { return file_ != nullptr; }
+
+        bool next(uint64_t& edge) {
+            if (pos_ == len_) {
+                len_ = std::fread(buf_.data(), sizeof(uint64_t), buf_.size(), file_);
+                pos_ = 0;
+                if (len_ == 0) return false;
+            }
+            edge = buf_[pos_++];
+            return true;
+        }
+
+    private:
+        FILE* file_;
+        std::vector<uint64_t> buf_;
+        size_t pos_ = 0;
+        size_t len_ = 0;
+    };
+
+    // k-way merge of sorted run files; calls sink(edge) in sorted order
+    template <typename Sink>
+    bool merge_runs(const std::vector<std::string>& paths, Sink&& sink) {
+        std::vector<std::unique_ptr<RunReader>> readers;
+        using HeapItem = std::pair<uint64_t, size_t>;
+        std::priority_queue<HeapItem, std::vector<HeapItem>, std::greater<HeapItem>> heap;
+
+        for (const auto& path : paths) {
+            readers.push_back(std::make_unique<RunReader>(path));
+            if (!readers.back()->ok()) {
+                std::cerr << "Failed to open sort run " << path << "\n";
+                return false;
+            }
+            uint64_t edge;
+            if (readers.back()->next(edge)) heap.emplace(edge, readers.size() - 1);
+        }
+
+        while (!heap.empty()) {
+            auto [edge, src] = heap.top();
+            heap.pop();
+            if (!sink(edge)) return false;
+            uint64_t next_edge;
+            if (readers[src]->next(next_edge)) heap.emplace(next_edge, src);
+        }
+        return true;
+    }
+
+    // Options for the states CF: a hash index over key prefixes for the
+    // point lookups, and ZSTD with a trained dictionary, since the records
+    // of nearby ids share most of their bytes
+    rocksdb::ColumnFamilyOptions states_cf_options(const rocksdb::ColumnFamilyOptions& cf_opts,
+                                                   rocksdb::BlockBasedTableOptions table_options) {
+        table_options.index_type = rocksdb::BlockBasedTableOptions::kHashSearch;
+        rocksdb::ColumnFamilyOptions opts = cf_opts;
+        opts.table_factory.reset(rocksdb::NewBlockBasedTableFactory(table_options));
+        opts.prefix_extractor.reset(rocksdb::NewFixedPrefixTransform(STATE_KEY_PREFIX));
+        opts.compression = rocksdb::kZSTD;
+        opts.bottommost_compression = rocksdb::kZSTD;
+        opts.compression_opts.max_dict_bytes = 16 * 1024;
+        opts.compression_opts.zstd_max_train_bytes = 100 * 16 * 1024;
+        opts.bottommost_compression_opts = opts.compression_opts;
+        opts.bottommost_compression_opts.enabled = true;
+        return opts;
+    }
+
+    bool write_run(const std::string& path, const std::vector<uint64_t>& edges) {
+        FILE* f = std::fopen(path.c_str(), "wb");
+        if (!f) return false;
+        bool ok = std::fwrite(edges.data(), sizeof(uint64_t), edges.size(), f) == edges.size();
+        return std::fclose(f) == 0 && ok;
+    }
+
+    // Windows a ring holds per worker before the reader has to wait
+    constexpr size_t PIPELINE_RING_WINDOWS = 8;
+
+    // Items [first, last) (state ids or queue positions) that the reader
+    // loaded for one worker. The worker sets `done` once it has written
+    // everything the window produced.
+    struct PipelineWindow {
+        uint64_t first = 0;
+        uint64_t last = 0;
+        std::atomic<bool> done{false};
+    };
+
+    // Hands windows from the thread that reads the database to the compute
+    // workers, through one bounded SPSC ring per worker, so the reads for
+    // the next windows are in flight while the workers process the ones
+    // already loaded. Windows finish out of order; first_open() tells the
+    // reader how far everything is finished, which is what a checkpoint
+    // may record.
+    template <typename Window>
+    class WindowPipeline {
+    public:
+        explicit WindowPipeline(int num_workers) {
+            for (int i = 0; i < num_workers; ++i) {
+                rings_.push_back(std::make_unique<SpscRing<Window*>>(PIPELINE_RING_WINDOWS));
+            }
+        }
+
+        // Reader: queue `w` on the next ring with room, waiting while all are full
+        void dispatch(std::unique_ptr<Window> w) {
+            Window* window = w.get();
+            in_flight_.push_back(std::move(w));
+            for (;;) {
+                for (size_t i = 0; i < rings_.size(); ++i) {
+                    size_t r = (next_ring_ + i) % rings_.size();
+                    if (rings_[r]->push(window)) {
+                        next_ring_ = r + 1;
+                        return;
+                    }
+                }
+                std::this_thread::yield();
+            }
+        }
+
+        // Reader: first item of the oldest window not done yet, or `next`
+        // (the first item not dispatched) if none is in flight
+        uint64_t first_open(uint64_t next) {
+            while (!in_flight_.empty() && in_flight_.front()->done.load(std::memory_order_acquire)) {
+                in_flight_.pop_front();
+            }
+            return in_flight_.empty() ? next : in_flight_.front()->first;
+        }
+
+        // Reader: no more windows; workers return once their ring is empty
+        void finish() { finished_.store(true, std::memory_order_release); }
+
+        // Worker: next window, or nullptr after finish() and an empty ring
+        Window* next(int worker) {
+            Window* window;
+            for (;;) {
+                if (rings_[worker]->pop(window)) return window;
+                if (finished_.load(std::memory_order_acquire)) {
+                    return rings_[worker]->pop(window) ? window : nullptr;
+                }
+                std::this_thread::yield();
+            }
+        }
+
+    private:
+        std::vector<std::unique_ptr<SpscRing<Window*>>> rings_;
+        std::deque<std::unique_ptr<Window>> in_flight_;  // In dispatch order
+        size_t next_ring_ = 0;
+        std::atomic<bool> finished_{false};
+    };
+}
+
+namespace {
+    constexpr int STATE_RANK_SHIFT = 30;
+    constexpr int STATE_RESULT_SHIFT = 28;
+    constexpr int STATE_DTW_SHIFT = 20;
+    constexpr int STATE_SUCCESSORS_SHIFT = 10;
+    constexpr uint64_t STATE_COUNT_MASK = (1 << 10) - 1;
+
+    static_assert(RANK_SPACE_SIZE <= 1ULL << (64 - STATE_RANK_SHIFT));
+    static_assert(MAX_MOVES <= STATE_COUNT_MASK);
+}
+
+std::string encode_state_info(const StateInfoCompact& info) {
+    uint64_t word = rank_canonical(unpack_state(info.packed)) << STATE_RANK_SHIFT;
+    // Result codes 0-2 as they are; LOSS (-1, 0xFF) becomes 3
+    word |= static_cast<uint64_t>(info.result & 3) << STATE_RESULT_SHIFT;
+    word |= static_cast<uint64_t>(info.dtw) << STATE_DTW_SHIFT;
+    word |= static_cast<uint64_t>(info.num_successors) << STATE_SUCCESSORS_SHIFT;
+    word |= info.winning_succs;
+    uint64_t be = __builtin_bswap64(word);
+    return std::string(reinterpret_cast<const char*>(&be), sizeof(be));
+}
+
+bool decode_state_info(const rocksdb::Slice& value, StateInfoCompact& info) {
+    if (value.size() != STATE_VALUE_SIZE) return false;
+    uint64_t be;
+    std::memcpy(&be, value.data(), sizeof(be));
+    uint64_t word = __builtin_bswap64(be);
+    info.packed = pack_state(unrank_state(word >> STATE_RANK_SHIFT));
+    uint8_t code = (word >> STATE_RESULT_SHIFT) & 3;
+    info.result = code == 3 ? static_cast<uint8_t>(Result::LOSS) : code;
+    info.dtw = (word >> STATE_DTW_SHIFT) & 0xFF;
+    info.num_successors = (word >> STATE_SUCCESSORS_SHIFT) & STATE_COUNT_MASK;
+    info.winning_succs = word & STATE_COUNT_MASK;
+    return true;
+}
+
 RetrogradeSolverDB::RetrogradeSolverDB() {
     fast_write_options_.disableWAL = true;
     fast_write_options_.sync = false;
 
     metadata_write_options_.disableWAL = false;
     metadata_write_options_.sync = true;
+
+    progress_cb_ = [this](const char* phase, uint64_t current, uint64_t total) {
+        metrics_.set_progress(phase, current, total);
+        if (user_progress_cb_) user_progress_cb_(phase, current, total);
+    };
 }
 
 RetrogradeSolverDB::~RetrogradeSolverDB() {
@@ -66,31 +341,90 @@ bool RetrogradeSolverDB::open(const std::string& db_path) {
     rocksdb::ColumnFamilyOptions cf_opts;
     cf_opts.table_factory.reset(rocksdb::NewBlockBasedTableFactory(table_options));
 
+    // Predecessor lists are appended with Merge()
+    rocksdb::ColumnFamilyOptions pred_cf_opts = cf_opts;
+    pred_cf_opts.merge_operator = std::make_shared<PredecessorListMerge>();
+
+    read_only_ = false;
+    return open_column_families(options, cf_opts, states_cf_options(cf_opts, table_options),
+                                pred_cf_opts, db_path);
+}
+
+bool RetrogradeSolverDB::open_readonly(const std::string& db_path, uint64_t block_cache_mb) {
+    rocksdb::Options options;
+
+    // A read-only instance never flushes or compacts; keep the other
+    // background pools to a minimum and every table reader open
+    options.max_background_jobs = 1;
+    options.max_open_files = -1;
+    options.skip_stats_update_on_db_open = true;
+
+    // Block cache plus in-block hash index and whole-key bloom filters
+    // (used for the SST files that were written with them)
+    rocksdb::ColumnFamilyOptions cf_opts;
+    cf_opts.OptimizeForPointLookup(block_cache_mb);
+
+    rocksdb::ColumnFamilyOptions pred_cf_opts = cf_opts;
+    pred_cf_opts.merge_operator = std::make_shared<PredecessorListMerge>();
+
+    // The states CF's hash index needs the prefix extractor it was built with
+    rocksdb::ColumnFamilyOptions states_cf_opts = cf_opts;
+    states_cf_opts.prefix_extractor.reset(rocksdb::NewFixedPrefixTransform(STATE_KEY_PREFIX));
+
+    read_only_ = true;
+    return open_column_families(options, cf_opts, states_cf_opts, pred_cf_opts, db_path);
+}
+
+bool RetrogradeSolverDB::open_column_families(const rocksdb::Options& options,
+                                              const rocksdb::ColumnFamilyOptions& cf_opts,
+                                              const rocksdb::ColumnFamilyOptions& states_cf_opts,
+                                              const rocksdb::ColumnFamilyOptions& pred_cf_opts,
+                                              const std::string& db_path) {
+    // Databases with the old state records in "states" are converted once
+    // with migrate_states (see retrograde_db.h)
+    std::vector<std::string> existing;
+    if (rocksdb::DB::ListColumnFamilies(rocksdb::DBOptions(options), db_path, &existing).ok() &&
+        std::find(existing.begin(), existing.end(), LEGACY_STATES_CF) != existing.end()) {
+        std::cerr << "Database " << db_path << " stores states in the old layout; "
+                  << "convert it first with: migrate_states --db " << db_path << "\n";
+        return false;
+    }
+
     // Column family descriptors
     std::vector<rocksdb::ColumnFamilyDescriptor> cf_descs;
     cf_descs.push_back(rocksdb::ColumnFamilyDescriptor(
         rocksdb::kDefaultColumnFamilyName, cf_opts));
     cf_descs.push_back(rocksdb::ColumnFamilyDescriptor(
-        "states", cf_opts));
+        STATES_CF, states_cf_opts));
     cf_descs.push_back(rocksdb::ColumnFamilyDescriptor(
         "packed_to_id", cf_opts));
     cf_descs.push_back(rocksdb::ColumnFamilyDescriptor(
-        "predecessors", cf_opts));
+        "predecessors", pred_cf_opts));
     cf_descs.push_back(rocksdb::ColumnFamilyDescriptor(
         "queue", cf_opts));
     cf_descs.push_back(rocksdb::ColumnFamilyDescriptor(
         "metadata", cf_opts));
 
+    rocksdb::Options db_options = options;
+    statistics_.reset();
+    if (collect_statistics_) {
+        statistics_ = rocksdb::CreateDBStatistics();
+        db_options.statistics = statistics_;
+    }
+
     std::vector<rocksdb::ColumnFamilyHandle*> cf_handles;
     rocksdb::DB* db_ptr;
 
-    rocksdb::Status status = rocksdb::DB::Open(options, db_path, cf_descs, &cf_handles, &db_ptr);
+    rocksdb::Status status = read_only_
+        ? rocksdb::DB::OpenForReadOnly(db_options, db_path, cf_descs, &cf_handles, &db_ptr)
+        : rocksdb::DB::Open(db_options, db_path, cf_descs, &cf_handles, &db_ptr);
     if (!status.ok()) {
         std::cerr << "Failed to open database: " << status.ToString() << "\n";
         return false;
     }
 
     db_.reset(db_ptr);
+    db_path_ = db_path;
     // cf_handles order matches cf_descs: default, states, packed_to_id, predecessors, queue, metadata
     cf_states_ = cf_handles[1];
     cf_packed_to_id_ = cf_handles[2];
@@ -107,7 +441,7 @@ bool RetrogradeSolverDB::open(const std::string& db_path) {
 
 void RetrogradeSolverDB::close() {
     if (db_) {
-        save_metadata();
+        if (!read_only_) save_metadata();
 
         // Delete column family handles
         if (cf_states_) { delete cf_states_; cf_states_ = nullptr; }
@@ -118,6 +452,15 @@ void RetrogradeSolverDB::close() {
 
         db_.reset();
     }
+
+    // Cached lookups belong to the database that was open
+    result_cache_.reset(result_cache_.capacity());
+    best_move_cache_.reset(best_move_cache_.capacity());
+}
+
+void RetrogradeSolverDB::set_result_cache_capacity(size_t entries) {
+    result_cache_.reset(entries);
+    best_move_cache_.reset(entries);
 }
 
 void RetrogradeSolverDB::save_metadata() {
@@ -141,6 +484,7 @@ void RetrogradeSolverDB::save_metadata() {
     put_u64("enum_processed", enum_processed_);
     put_u64("queue_head", queue_head_);
     put_u64("queue_tail", queue_tail_);
+    put_u32("enum_levels", enum_levels_ ? 1 : 0);
 
     db_->Write(metadata_write_options_, &batch);
 }
@@ -172,6 +516,19 @@ void RetrogradeSolverDB::load_metadata() {
     get_u64("enum_processed", enum_processed_);
     get_u64("queue_head", queue_head_);
     get_u64("queue_tail", queue_tail_);
+
+    uint32_t enum_levels = 0;
+    get_u32("enum_levels", enum_levels);
+    enum_levels_ = enum_levels != 0;
+
+    // Set once phase 2 was skipped: there are no predecessor lists to read
+    uint32_t unmove_preds = 0;
+    get_u32("unmove_preds", unmove_preds);
+    if (unmove_preds) use_unmoves_ = true;
+
+    uint32_t has_dtw = 0;
+    get_u32("has_dtw", has_dtw);
+    has_dtw_ = has_dtw != 0;
 }
 
 bool RetrogradeSolverDB::solve() {
@@ -179,17 +536,25 @@ bool RetrogradeSolverDB::solve() {
         std::cerr << "Database not open\n";
         return false;
     }
+    if (read_only_) {
+        std::cerr << "Database was opened read-only\n";
+        return false;
+    }
 
     bool use_parallel = (num_threads_ > 1);
     if (use_parallel) {
         std::cerr << "Using " << num_threads_ << " threads for parallel processing\n";
     }
+    metrics_.set_num_threads(num_threads_);
 
     // Resume from current phase or start fresh
     if (phase_ == SolvePhaseDB::NOT_STARTED || phase_ == SolvePhaseDB::ENUMERATING) {
         if (progress_cb_) progress_cb_("Enumerating states", 0, 0);
+        metrics_.begin_phase("enumerate");
         phase_ = SolvePhaseDB::ENUMERATING;
-        if (use_parallel) {
+        if (num_states_ == 0 || enum_levels_) {
+            enumerate_states_levels();
+        } else if (use_parallel) {
             enumerate_states_parallel();
         } else {
             enumerate_states();
@@ -198,16 +563,31 @@ bool RetrogradeSolverDB::solve() {
         save_metadata();
     }
 
+    if (phase_ == SolvePhaseDB::BUILDING_PREDECESSORS && use_unmoves_) {
+        std::cerr << "Skipping predecessor building: propagation uses retro moves\n";
+        uint32_t flag = 1;
+        db_->Put(metadata_write_options_, cf_metadata_, "unmove_preds",
+                 std::string(reinterpret_cast<char*>(&flag), sizeof(flag)));
+        phase_ = SolvePhaseDB::MARKING_TERMINALS;
+        save_metadata();
+    }
+
     if (phase_ == SolvePhaseDB::BUILDING_PREDECESSORS) {
         if (progress_cb_) progress_cb_("Building predecessors", 0, num_states_);
-        // Always use streaming approach - it's much faster due to in-memory cache
-        build_predecessors_streaming();
+        metrics_.begin_phase("predecessors");
+        // Both builders use the in-memory packed_to_id cache
+        if (pred_builder_ == PredecessorBuilder::SORTED) {
+            if (!build_predecessors_sorted()) return false;
+        } else {
+            build_predecessors_streaming();
+        }
         phase_ = SolvePhaseDB::MARKING_TERMINALS;
         save_metadata();
     }
 
     if (phase_ == SolvePhaseDB::MARKING_TERMINALS) {
         if (progress_cb_) progress_cb_("Marking terminals", 0, num_states_);
+        metrics_.begin_phase("terminals");
         if (use_parallel) {
             mark_terminals_parallel();
         } else {
@@ -219,14 +599,46 @@ bool RetrogradeSolverDB::solve() {
 
     if (phase_ == SolvePhaseDB::PROPAGATING) {
         if (progress_cb_) progress_cb_("Propagating", 0, num_states_);
+        metrics_.begin_phase("propagate");
         propagate();
         phase_ = SolvePhaseDB::COMPLETE;
         save_metadata();
     }
 
+    metrics_.end_phase();
     return true;
 }
 
+SolverMetrics::Snapshot RetrogradeSolverDB::metrics_snapshot() {
+    if (db_) {
+        uint64_t v = 0;
+        if (db_->GetAggregatedIntProperty("rocksdb.estimate-pending-compaction-bytes", &v)) {
+            metrics_.set_gauge("compaction_pending_bytes", static_cast<double>(v));
+        }
+        if (db_->GetIntProperty("rocksdb.num-running-compactions", &v)) {
+            metrics_.set_gauge("compactions_running", static_cast<double>(v));
+        }
+        if (db_->GetAggregatedIntProperty("rocksdb.cur-size-all-mem-tables", &v)) {
+            metrics_.set_gauge("memtable_bytes", static_cast<double>(v));
+        }
+        if (db_->GetIntProperty("rocksdb.actual-delayed-write-rate", &v)) {
+            metrics_.set_gauge("delayed_write_rate", static_cast<double>(v));
+        }
+        if (db_->GetIntProperty("rocksdb.is-write-stopped", &v)) {
+            metrics_.set_gauge("write_stopped", static_cast<double>(v));
+        }
+    }
+    if (statistics_) {
+        uint64_t hits = statistics_->getTickerCount(rocksdb::BLOCK_CACHE_HIT);
+        uint64_t misses = statistics_->getTickerCount(rocksdb::BLOCK_CACHE_MISS);
+        metrics_.set_gauge("block_cache_hits", static_cast<double>(hits));
+        metrics_.set_gauge("block_cache_misses", static_cast<double>(misses));
+        metrics_.set_gauge("block_cache_hit_rate", hits + misses ? static_cast<double>(hits) / (hits + misses) : 0.0);
+        metrics_.set_gauge("write_stall_seconds", statistics_->getTickerCount(rocksdb::STALL_MICROS) / 1e6);
+    }
+    return metrics_.snapshot();
+}
+
 uint32_t RetrogradeSolverDB::get_or_create_state(uint64_t packed) {
     // Check if exists
     std::string key(reinterpret_cast<char*>(&packed), sizeof(packed));
@@ -248,11 +660,8 @@ uint32_t RetrogradeSolverDB::get_or_create_state(uint64_t packed) {
     info.winning_succs = 0;
 
     // Store state info
-    std::string id_key(reinterpret_cast<char*>(&id), sizeof(id));
-    std::string info_val(reinterpret_cast<char*>(&info), sizeof(info));
-
     rocksdb::WriteBatch batch;
-    batch.Put(cf_states_, id_key, info_val);
+    batch.Put(cf_states_, state_key(id), encode_state_info(info));
     batch.Put(cf_packed_to_id_, key, std::string(reinterpret_cast<char*>(&id), sizeof(id)));
     db_->Write(fast_write_options_, &batch);
 
@@ -272,68 +681,92 @@ int64_t RetrogradeSolverDB::get_state_id(uint64_t packed) const {
 }
 
 bool RetrogradeSolverDB::get_state_info(uint32_t id, StateInfoCompact& info) const {
-    std::string key(reinterpret_cast<char*>(&id), sizeof(id));
     std::string value;
-
-    if (db_->Get(rocksdb::ReadOptions(), cf_states_, key, &value).ok()) {
-        std::memcpy(&info, value.data(), sizeof(info));
-        return true;
-    }
-    return false;
+    return db_->Get(rocksdb::ReadOptions(), cf_states_, state_key(id), &value).ok() &&
+           decode_state_info(value, info);
 }
 
 bool RetrogradeSolverDB::put_state_info(uint32_t id, const StateInfoCompact& info) {
-    std::string key(reinterpret_cast<char*>(&id), sizeof(id));
-    std::string value(reinterpret_cast<const char*>(&info), sizeof(info));
-    return db_->Put(fast_write_options_, cf_states_, key, value).ok();
+    return db_->Put(fast_write_options_, cf_states_, state_key(id), encode_state_info(info)).ok();
 }
 
 void RetrogradeSolverDB::add_predecessor(uint32_t state_id, uint32_t pred_id) {
     std::string key(reinterpret_cast<char*>(&state_id), sizeof(state_id));
-    std::string value;
-
-    // Get existing predecessors
-    db_->Get(rocksdb::ReadOptions(), cf_predecessors_, key, &value);
-
-    // Append new predecessor
-    value.append(reinterpret_cast<char*>(&pred_id), sizeof(pred_id));
-
-    db_->Put(fast_write_options_, cf_predecessors_, key, value);
+    std::string value(reinterpret_cast<char*>(&pred_id), sizeof(pred_id));
+    db_->Merge(fast_write_options_, cf_predecessors_, key, value);
 }
 
 std::vector<uint32_t> RetrogradeSolverDB::get_predecessors(uint32_t state_id) const {
-    std::vector<uint32_t> preds;
-
-    // Use MultiGet for all 17 possible keys (16 thread shards + legacy)
-    std::vector<rocksdb::Slice> keys;
-    std::vector<std::string> key_storage(17);
+    std::vector<std::vector<uint32_t>> preds;
+    get_predecessors_batch(&state_id, 1, preds);
+    return std::move(preds[0]);
+}
 
-    // Thread shard keys (state_id + thread_id byte)
-    for (int t = 0; t < 16; ++t) {
-        key_storage[t] = std::string(reinterpret_cast<const char*>(&state_id), sizeof(state_id));
-        key_storage[t].push_back(static_cast<char>(t));
-        keys.push_back(key_storage[t]);
+void RetrogradeSolverDB::get_predecessors_batch(const uint32_t* ids, size_t n,
+                                                std::vector<std::vector<uint32_t>>& out) const {
+    // 17 possible keys per state: the merged 4-byte key, plus the 16
+    // per-thread shard keys that databases built before the merge operator
+    // still hold. All of them go out in one MultiGet, so the reads of a
+    // whole batch reach the disk together.
+    constexpr size_t KEYS_PER_STATE = 17;
+    std::vector<std::string> key_storage(n * KEYS_PER_STATE);
+    std::vector<rocksdb::Slice> keys(n * KEYS_PER_STATE);
+
+    for (size_t i = 0; i < n; ++i) {
+        std::string* k = &key_storage[i * KEYS_PER_STATE];
+        for (size_t t = 0; t < KEYS_PER_STATE; ++t) {
+            k[t] = std::string(reinterpret_cast<const char*>(&ids[i]), sizeof(ids[i]));
+            // Thread shard keys (state_id + thread_id byte); the last is the
+            // plain key the merge operator appends to
+            if (t < 16) k[t].push_back(static_cast<char>(t));
+            keys[i * KEYS_PER_STATE + t] = k[t];
+        }
     }
 
-    // Legacy 4-byte key
-    key_storage[16] = std::string(reinterpret_cast<const char*>(&state_id), sizeof(state_id));
-    keys.push_back(key_storage[16]);
-
-    std::vector<std::string> values(17);
-
-    std::vector<rocksdb::ColumnFamilyHandle*> cfs(17, cf_predecessors_);
+    std::vector<std::string> values(keys.size());
+    std::vector<rocksdb::ColumnFamilyHandle*> cfs(keys.size(), cf_predecessors_);
     std::vector<rocksdb::Status> statuses = db_->MultiGet(rocksdb::ReadOptions(), cfs, keys, &values);
 
-    for (size_t i = 0; i < 17; ++i) {
-        if (statuses[i].ok() && !values[i].empty()) {
-            size_t count = values[i].size() / sizeof(uint32_t);
-            size_t old_size = preds.size();
-            preds.resize(old_size + count);
-            std::memcpy(preds.data() + old_size, values[i].data(), values[i].size());
+    out.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+        std::vector<uint32_t>& preds = out[i];
+        preds.clear();
+        for (size_t k = i * KEYS_PER_STATE; k < (i + 1) * KEYS_PER_STATE; ++k) {
+            if (statuses[k].ok() && !values[k].empty()) {
+                size_t count = values[k].size() / sizeof(uint32_t);
+                size_t old_size = preds.size();
+                preds.resize(old_size + count);
+                std::memcpy(preds.data() + old_size, values[k].data(), values[k].size());
+            }
         }
     }
+}
+
+void RetrogradeSolverDB::collect_predecessors(uint32_t id, uint64_t packed,
+                                              std::vector<uint32_t>& preds) const {
+    if (!use_unmoves_) {
+        preds = get_predecessors(id);
+        return;
+    }
 
-    return preds;
+    // One entry per move edge, like the stored lists; parents that were
+    // never enumerated (unreachable from the start) are not in the database
+    thread_local std::vector<uint64_t> parents;
+    generate_canonical_unmoves(packed, parents);
+
+    preds.clear();
+    for (uint64_t parent : parents) {
+        if (cache_loaded_) {
+            PackedIdPair search_key{parent, 0};
+            auto it = std::lower_bound(packed_to_id_cache_.begin(), packed_to_id_cache_.end(), search_key);
+            if (it != packed_to_id_cache_.end() && it->packed == parent) {
+                preds.push_back(it->id);
+            }
+        } else {
+            int64_t pred_id = get_state_id(parent);
+            if (pred_id >= 0) preds.push_back(static_cast<uint32_t>(pred_id));
+        }
+    }
 }
 
 void RetrogradeSolverDB::enumerate_states() {
@@ -341,8 +774,7 @@ void RetrogradeSolverDB::enumerate_states() {
     if (queue_tail_ == 0 && queue_head_ == 0 && num_states_ == 0) {
         // Fresh start
         State start = State::starting_position();
-        auto [canonical_start, _] = canonicalize(start);
-        uint64_t start_packed = pack_state(canonical_start);
+        uint64_t start_packed = canonical_pack(start);
 
         start_id_ = get_or_create_state(start_packed);
 
@@ -395,7 +827,8 @@ void RetrogradeSolverDB::enumerate_states() {
         }
 
         // Generate all moves
-        auto moves = generate_moves(s);
+        MoveList moves;
+        generate_moves(s, moves);
         info.num_successors = moves.size();
         put_state_info(id, info);
 
@@ -407,8 +840,7 @@ void RetrogradeSolverDB::enumerate_states() {
         // Process each successor
         for (const auto& move : moves) {
             State ns = apply_move(s, move);
-            auto [canonical_ns, __] = canonicalize(ns);
-            uint64_t ns_packed = pack_state(canonical_ns);
+            uint64_t ns_packed = canonical_pack(ns);
 
             int64_t existing_id = get_state_id(ns_packed);
             if (existing_id < 0) {
@@ -464,8 +896,7 @@ void RetrogradeSolverDB::enumerate_states_parallel() {
     if (queue_tail_ == 0 && queue_head_ == 0 && num_states_ == 0) {
         // Fresh start
         State start = State::starting_position();
-        auto [canonical_start, _] = canonicalize(start);
-        uint64_t start_packed = pack_state(canonical_start);
+        uint64_t start_packed = canonical_pack(start);
 
         start_id_ = get_or_create_state(start_packed);
 
@@ -481,8 +912,12 @@ void RetrogradeSolverDB::enumerate_states_parallel() {
         bloom_filter_->add(start_packed);
         bloom_loaded_ = true;
     } else if (!bloom_loaded_ && num_states_ > 0) {
-        // DISABLED: Skip bloom filter - 100 min load, ~2.4M/hr without it
-        std::cerr << "Skipping bloom filter (instant start mode)\n";
+        if (std::filesystem::exists(bloom_path())) {
+            load_bloom_filter();
+        } else {
+            // Rebuilding from every key takes ~100 min; do without it
+            std::cerr << "Skipping bloom filter (instant start mode)\n";
+        }
     }
 
     // Log resume status for debugging
@@ -501,7 +936,9 @@ void RetrogradeSolverDB::enumerate_states_parallel() {
 
     // Process queue in batches
     const size_t BATCH_SIZE = 100000;  // Load this many items from disk queue at a time
+    const auto BLOOM_SAVE_INTERVAL = std::chrono::minutes(15);
     uint64_t batch_num = 0;
+    auto last_bloom_save = std::chrono::steady_clock::now();
 
     while (queue_head_ < queue_tail_) {
         auto batch_start = std::chrono::steady_clock::now();
@@ -586,8 +1023,7 @@ void RetrogradeSolverDB::enumerate_states_parallel() {
                     state_keys.reserve(end - start);
 
                     for (size_t i = start; i < end; ++i) {
-                        uint32_t id = work_queue_[i];
-                        state_key_storage[i - start] = std::string(reinterpret_cast<char*>(&id), sizeof(id));
+                        state_key_storage[i - start] = state_key(work_queue_[i]);
                         state_keys.push_back(state_key_storage[i - start]);
                     }
 
@@ -596,8 +1032,8 @@ void RetrogradeSolverDB::enumerate_states_parallel() {
                     std::vector<rocksdb::Status> state_statuses = db_->MultiGet(rocksdb::ReadOptions(), state_cfs, state_keys, &state_values);
 
                     for (size_t i = 0; i < state_keys.size(); ++i) {
-                        if (state_statuses[i].ok() && state_values[i].size() == sizeof(StateInfoCompact)) {
-                            std::memcpy(&work_state_info[start + i], state_values[i].data(), sizeof(StateInfoCompact));
+                        if (state_statuses[i].ok()) {
+                            decode_state_info(state_values[i], work_state_info[start + i]);
                         }
                     }
                 });
@@ -635,6 +1071,7 @@ void RetrogradeSolverDB::enumerate_states_parallel() {
                     if (info.packed == 0) continue;  // Skip if not found
 
                     State s = unpack_state(info.packed);
+                    metrics_.add_work(t, 1);
 
                     // Check if terminal
                     GameResult gr = check_terminal(s);
@@ -646,7 +1083,8 @@ void RetrogradeSolverDB::enumerate_states_parallel() {
                     }
 
                     // Generate all moves
-                    auto moves = generate_moves(s);
+                    MoveList moves;
+                    generate_moves(s, moves);
                     info.num_successors = moves.size();
                     updates.push_back({id, info});
 
@@ -655,11 +1093,16 @@ void RetrogradeSolverDB::enumerate_states_parallel() {
                         continue;
                     }
 
+                    // Canonicalize all successors in one batch
+                    std::array<uint64_t, MAX_MOVES> successors;
+                    for (size_t m = 0; m < moves.size(); ++m) {
+                        successors[m] = pack_state(apply_move(s, moves[m]));
+                    }
+                    canonicalize_packed_batch(successors.data(), successors.data(), moves.size());
+
                     // Process each successor - use bloom filter for fast rejection
-                    for (const auto& move : moves) {
-                        State ns = apply_move(s, move);
-                        auto [canonical_ns, __] = canonicalize(ns);
-                        uint64_t ns_packed = pack_state(canonical_ns);
+                    for (size_t m = 0; m < moves.size(); ++m) {
+                        uint64_t ns_packed = successors[m];
 
                         // Bloom filter check:
                         // - If definitely NOT in DB -> add to definitely_new (skip DB lookup)
@@ -694,10 +1137,7 @@ void RetrogradeSolverDB::enumerate_states_parallel() {
         rocksdb::WriteBatch batch;
         for (const auto& updates : thread_updates) {
             for (const auto& [id, info] : updates) {
-                uint32_t id_copy = id;
-                std::string id_key(reinterpret_cast<char*>(&id_copy), sizeof(id_copy));
-                std::string info_val(reinterpret_cast<const char*>(&info), sizeof(info));
-                batch.Put(cf_states_, id_key, info_val);
+                batch.Put(cf_states_, state_key(id), encode_state_info(info));
             }
         }
 
@@ -740,12 +1180,10 @@ void RetrogradeSolverDB::enumerate_states_parallel() {
             info.num_successors = 0;
             info.winning_succs = 0;
 
-            std::string id_key(reinterpret_cast<char*>(&id), sizeof(id));
-            std::string info_val(reinterpret_cast<char*>(&info), sizeof(info));
             std::string packed_key(reinterpret_cast<char*>(&packed), sizeof(packed));
             std::string id_val(reinterpret_cast<char*>(&id), sizeof(id));
 
-            batch.Put(cf_states_, id_key, info_val);
+            batch.Put(cf_states_, state_key(id), encode_state_info(info));
             batch.Put(cf_packed_to_id_, packed_key, id_val);
 
             // Add to queue for future processing
@@ -806,10 +1244,15 @@ void RetrogradeSolverDB::enumerate_states_parallel() {
         }
 
         // Add all new states found from checking
+        uint64_t bloom_false_positives = 0;
         for (const auto& new_states : thread_new_from_check) {
             for (uint64_t packed : new_states) {
                 add_new_state(packed);
             }
+            bloom_false_positives += new_states.size();
+        }
+        if (bloom_filter_) {
+            metrics_.add_bloom(all_definitely_new.size(), filtered_maybe_exists.size(), bloom_false_positives);
         }
 
         auto t7d = std::chrono::steady_clock::now();
@@ -819,6 +1262,7 @@ void RetrogradeSolverDB::enumerate_states_parallel() {
         // CRITICAL: Advance queue_head_ BEFORE writing to DB
         // This ensures if we crash after write, we don't re-process the same batch
         queue_head_ = batch_end;
+        metrics_.set_queue(queue_head_, queue_tail_);
 
         db_->Write(fast_write_options_, &batch);
 
@@ -868,6 +1312,15 @@ void RetrogradeSolverDB::enumerate_states_parallel() {
             std::cerr << "Checkpoint: " << enum_processed_ << " processed, "
                       << num_states_ << " states, queue " << queue_head_ << "/" << queue_tail_ << "\n";
         }
+
+        // Saving writes the whole filter (2GB), so it is throttled by wall
+        // time; a resume adds the states created since from one range scan
+        auto now = std::chrono::steady_clock::now();
+        if (bloom_filter_ && now - last_bloom_save >= BLOOM_SAVE_INTERVAL) {
+            // Every state below num_states_ is in the filter and written
+            bloom_filter_->save(bloom_path(), num_states_);
+            last_bloom_save = now;
+        }
     }
 
     // Final save and verification
@@ -878,6 +1331,188 @@ void RetrogradeSolverDB::enumerate_states_parallel() {
     // Clean up bloom filter
     bloom_filter_.reset();
     bloom_loaded_ = false;
+    std::remove(bloom_path().c_str());
+
+    if (progress_cb_) {
+        progress_cb_("Enumeration complete", num_states_, num_states_);
+    }
+}
+
+void RetrogradeSolverDB::enumerate_states_levels() {
+    // Visited set: every packed state with an id, sorted
+    std::vector<uint64_t> visited;
+
+    if (num_states_ == 0) {
+        // Fresh start: level 0 is the starting position alone
+        enum_levels_ = true;
+        uint64_t start_packed = canonical_pack(State::starting_position());
+        start_id_ = get_or_create_state(start_packed);
+        queue_head_ = 0;
+        queue_tail_ = num_states_;
+        enum_processed_ = 0;
+        save_metadata();
+        visited.push_back(start_packed);
+    } else {
+        // Resume at the start of the saved level. Ids at or past queue_tail_
+        // belong to a level that was being written when we stopped; it is
+        // regenerated with the same ids, so ignore them here.
+        std::cerr << "Loading visited set for " << queue_tail_ << " states...\n";
+        visited.reserve(queue_tail_);
+        rocksdb::ReadOptions read_opts;
+        read_opts.fill_cache = false;
+        read_opts.readahead_size = 2 * 1024 * 1024;
+        std::unique_ptr<rocksdb::Iterator> it(db_->NewIterator(read_opts, cf_packed_to_id_));
+        for (it->SeekToFirst(); it->Valid(); it->Next()) {
+            uint64_t packed;
+            uint32_t id;
+            std::memcpy(&packed, it->key().data(), sizeof(packed));
+            std::memcpy(&id, it->value().data(), sizeof(id));
+            if (id < queue_tail_) visited.push_back(packed);
+        }
+        std::sort(visited.begin(), visited.end());
+        num_states_ = queue_tail_;
+        enum_processed_ = queue_head_;
+    }
+
+    // Run fn(t, first, last) on num_threads_ contiguous slices of [0, n)
+    auto parallel_for = [this](size_t n, const auto& fn) {
+        size_t per_thread = (n + num_threads_ - 1) / num_threads_;
+        std::vector<std::thread> workers;
+        for (int t = 0; t < num_threads_; ++t) {
+            size_t first = t * per_thread;
+            size_t last = std::min(first + per_thread, n);
+            if (first >= last) break;
+            workers.emplace_back([&fn, t, first, last]() { fn(t, first, last); });
+        }
+        for (auto& w : workers) w.join();
+    };
+
+    const uint64_t CHUNK_SIZE = 1000000;   // Frontier states expanded per round
+    const size_t WRITE_BATCH = 100000;
+    uint32_t level = 0;
+
+    while (queue_head_ < queue_tail_) {
+        auto level_start = std::chrono::steady_clock::now();
+        uint64_t frontier_size = queue_tail_ - queue_head_;
+
+        // New states of the next level; sorted and unique up to next_sorted
+        std::vector<uint64_t> next;
+        size_t next_sorted = 0;
+
+        for (uint64_t chunk = queue_head_; chunk < queue_tail_; chunk += CHUNK_SIZE) {
+            uint64_t chunk_end = std::min(chunk + CHUNK_SIZE, queue_tail_);
+            size_t n = chunk_end - chunk;
+
+            std::vector<std::vector<uint64_t>> thread_new(num_threads_);
+
+            parallel_for(n, [&](int t, size_t first, size_t last) {
+                // Fetch the frontier slice
+                std::vector<uint32_t> ids(last - first);
+                std::vector<std::string> key_storage(ids.size());
+                std::vector<rocksdb::Slice> keys;
+                keys.reserve(ids.size());
+                for (size_t i = 0; i < ids.size(); ++i) {
+                    ids[i] = static_cast<uint32_t>(chunk + first + i);
+                    key_storage[i] = state_key(ids[i]);
+                    keys.push_back(key_storage[i]);
+                }
+                std::vector<std::string> values(ids.size());
+                std::vector<rocksdb::ColumnFamilyHandle*> cfs(ids.size(), cf_states_);
+                std::vector<rocksdb::Status> statuses = db_->MultiGet(rocksdb::ReadOptions(), cfs, keys, &values);
+
+                // Expand into a local buffer, recording successor counts
+                std::vector<uint64_t> local;
+                rocksdb::WriteBatch batch;
+                for (size_t i = 0; i < ids.size(); ++i) {
+                    StateInfoCompact info;
+                    if (!statuses[i].ok() || !decode_state_info(values[i], info)) continue;
+
+                    State s = unpack_state(info.packed);
+                    MoveList moves;
+                    if (check_terminal(s) == GameResult::ONGOING) generate_moves(s, moves);
+                    info.num_successors = moves.size();
+                    batch.Put(cf_states_, keys[i], encode_state_info(info));
+
+                    size_t base = local.size();
+                    local.resize(base + moves.size());
+                    for (size_t m = 0; m < moves.size(); ++m) {
+                        local[base + m] = pack_state(apply_move(s, moves[m]));
+                    }
+                    canonicalize_packed_batch(local.data() + base, local.data() + base, moves.size());
+                }
+                db_->Write(fast_write_options_, &batch);
+                metrics_.add_work(t, ids.size());
+
+                std::sort(local.begin(), local.end());
+                local.erase(std::unique(local.begin(), local.end()), local.end());
+
+                // Merge-join against the visited set (both sorted)
+                auto& fresh = thread_new[t];
+                auto vit = visited.begin();
+                for (uint64_t packed : local) {
+                    vit = std::lower_bound(vit, visited.end(), packed);
+                    if (vit == visited.end() || *vit != packed) fresh.push_back(packed);
+                }
+            });
+
+            for (const auto& fresh : thread_new) {
+                next.insert(next.end(), fresh.begin(), fresh.end());
+            }
+            // Re-dedup once the unsorted tail outgrows the sorted part
+            if (next.size() - next_sorted > next_sorted) {
+                std::sort(next.begin(), next.end());
+                next.erase(std::unique(next.begin(), next.end()), next.end());
+                next_sorted = next.size();
+            }
+
+            enum_processed_ = chunk_end;
+            metrics_.set_queue(chunk_end, queue_tail_);
+            if (progress_cb_) progress_cb_("Level enumeration", enum_processed_, num_states_ + next.size());
+        }
+
+        std::sort(next.begin(), next.end());
+        next.erase(std::unique(next.begin(), next.end()), next.end());
+
+        // Assign the next level's ids in bulk, in packed order
+        uint64_t first_id = queue_tail_;
+        parallel_for(next.size(), [&](int, size_t first, size_t last) {
+            rocksdb::WriteBatch batch;
+            for (size_t i = first; i < last; ++i) {
+                uint32_t id = static_cast<uint32_t>(first_id + i);
+                StateInfoCompact info;
+                info.packed = next[i];
+                info.result = static_cast<uint8_t>(Result::UNKNOWN);
+                info.num_successors = 0;
+                info.winning_succs = 0;
+
+                batch.Put(cf_states_, state_key(id), encode_state_info(info));
+                batch.Put(cf_packed_to_id_, rocksdb::Slice(reinterpret_cast<const char*>(&next[i]), sizeof(uint64_t)),
+                          rocksdb::Slice(reinterpret_cast<const char*>(&id), sizeof(id)));
+                if (batch.Count() >= static_cast<int>(2 * WRITE_BATCH)) {
+                    db_->Write(fast_write_options_, &batch);
+                    batch.Clear();
+                }
+            }
+            db_->Write(fast_write_options_, &batch);
+        });
+
+        size_t old_size = visited.size();
+        visited.insert(visited.end(), next.begin(), next.end());
+        std::inplace_merge(visited.begin(), visited.begin() + old_size, visited.end());
+
+        queue_head_ = queue_tail_;
+        queue_tail_ += next.size();
+        num_states_ = queue_tail_;
+        enum_processed_ = queue_head_;
+        save_metadata();
+
+        auto level_sec = std::chrono::duration_cast<std::chrono::seconds>(
+            std::chrono::steady_clock::now() - level_start).count();
+        std::cerr << "\nLevel " << level++ << ": expanded " << frontier_size << " states, "
+                  << next.size() << " new (" << num_states_ << " total) in " << level_sec << "s\n";
+    }
+
+    std::cerr << "Enumeration complete: " << num_states_ << " states\n";
 
     if (progress_cb_) {
         progress_cb_("Enumeration complete", num_states_, num_states_);
@@ -900,22 +1535,20 @@ void RetrogradeSolverDB::build_predecessors() {
             continue;
         }
 
-        auto moves = generate_moves(s);
+        MoveList moves;
+        generate_moves(s, moves);
         if (moves.empty()) continue;
 
         for (const auto& move : moves) {
             State ns = apply_move(s, move);
-            auto [canonical_ns, _] = canonicalize(ns);
-            uint64_t ns_packed = pack_state(canonical_ns);
+            uint64_t ns_packed = canonical_pack(ns);
 
             int64_t succ_id = get_state_id(ns_packed);
             if (succ_id >= 0) {
-                // Add predecessor using batch
+                // Append predecessor using batch
                 std::string key(reinterpret_cast<char*>(&succ_id), sizeof(uint32_t));
-                std::string existing;
-                db_->Get(rocksdb::ReadOptions(), cf_predecessors_, key, &existing);
-                existing.append(reinterpret_cast<char*>(&id), sizeof(id));
-                batch.Put(cf_predecessors_, key, existing);
+                std::string value(reinterpret_cast<char*>(&id), sizeof(id));
+                batch.Merge(cf_predecessors_, key, value);
                 batch_count++;
             }
         }
@@ -973,13 +1606,13 @@ void RetrogradeSolverDB::build_predecessors_parallel() {
                         continue;
                     }
 
-                    auto moves = generate_moves(s);
+                    MoveList moves;
+                    generate_moves(s, moves);
                     if (moves.empty()) continue;
 
                     for (const auto& move : moves) {
                         State ns = apply_move(s, move);
-                        auto [canonical_ns, _] = canonicalize(ns);
-                        uint64_t ns_packed = pack_state(canonical_ns);
+                        uint64_t ns_packed = canonical_pack(ns);
 
                         // RocksDB reads are thread-safe
                         int64_t succ_id = get_state_id(ns_packed);
@@ -993,16 +1626,12 @@ void RetrogradeSolverDB::build_predecessors_parallel() {
 
                 // Periodically flush to DB if local storage gets large (every ~500k relations)
                 if (local_relations > 500000) {
-                    std::lock_guard<std::mutex> lock(db_mutex_);
                     rocksdb::WriteBatch batch;
                     for (auto& [succ_id, pred_ids] : local_preds) {
                         std::string key(reinterpret_cast<const char*>(&succ_id), sizeof(uint32_t));
-                        std::string existing;
-                        db_->Get(rocksdb::ReadOptions(), cf_predecessors_, key, &existing);
-                        for (uint32_t pred_id : pred_ids) {
-                            existing.append(reinterpret_cast<const char*>(&pred_id), sizeof(pred_id));
-                        }
-                        batch.Put(cf_predecessors_, key, existing);
+                        std::string value(reinterpret_cast<const char*>(pred_ids.data()),
+                                          pred_ids.size() * sizeof(uint32_t));
+                        batch.Merge(cf_predecessors_, key, value);
                     }
                     db_->Write(fast_write_options_, &batch);
                     total_relations += local_relations;
@@ -1013,16 +1642,12 @@ void RetrogradeSolverDB::build_predecessors_parallel() {
 
             // Final flush of remaining local data
             if (!local_preds.empty()) {
-                std::lock_guard<std::mutex> lock(db_mutex_);
                 rocksdb::WriteBatch batch;
                 for (auto& [succ_id, pred_ids] : local_preds) {
                     std::string key(reinterpret_cast<const char*>(&succ_id), sizeof(uint32_t));
-                    std::string existing;
-                    db_->Get(rocksdb::ReadOptions(), cf_predecessors_, key, &existing);
-                    for (uint32_t pred_id : pred_ids) {
-                        existing.append(reinterpret_cast<const char*>(&pred_id), sizeof(pred_id));
-                    }
-                    batch.Put(cf_predecessors_, key, existing);
+                    std::string value(reinterpret_cast<const char*>(pred_ids.data()),
+                                      pred_ids.size() * sizeof(uint32_t));
+                    batch.Merge(cf_predecessors_, key, value);
                 }
                 db_->Write(fast_write_options_, &batch);
                 total_relations += local_relations;
@@ -1117,33 +1742,53 @@ void RetrogradeSolverDB::load_packed_to_id_cache() {
 void RetrogradeSolverDB::load_bloom_filter() {
     if (bloom_loaded_) return;
 
-    std::cerr << "Loading bloom filter for " << num_states_ << " states (2GB)...\n";
     auto start_time = std::chrono::steady_clock::now();
 
     // Allocate 2GB bloom filter
     bloom_filter_ = std::make_unique<BloomFilter>(2ULL * 1024 * 1024 * 1024);
 
-    // Scan all packed states and add to bloom filter
-    rocksdb::ReadOptions read_opts;
-    read_opts.fill_cache = false;
+    uint64_t saved_entries = 0;
+    if (bloom_filter_->load(bloom_path(), saved_entries) && saved_entries <= num_states_) {
+        // Ids are dense, so the states created since the save are exactly
+        // the ids from saved_entries up to num_states_
+        std::cerr << "Loaded bloom filter covering " << saved_entries << " states, adding "
+                  << (num_states_ - saved_entries) << " newer states...\n";
+        // Keys follow id order, so that is one range scan
+        rocksdb::ReadOptions read_opts;
+        read_opts.fill_cache = false;
+        read_opts.total_order_seek = true;
+        std::unique_ptr<rocksdb::Iterator> it(db_->NewIterator(read_opts, cf_states_));
+        for (it->Seek(state_key(static_cast<uint32_t>(saved_entries))); it->Valid(); it->Next()) {
+            StateInfoCompact info;
+            if (decode_state_info(it->value(), info)) bloom_filter_->add(info.packed);
+        }
+    } else {
+        std::cerr << "Rebuilding bloom filter for " << num_states_ << " states (2GB)...\n";
+        bloom_filter_->clear();
 
-    std::unique_ptr<rocksdb::Iterator> it(db_->NewIterator(read_opts, cf_packed_to_id_));
+        // Scan all packed states and add to bloom filter
+        rocksdb::ReadOptions read_opts;
+        read_opts.fill_cache = false;
 
-    uint64_t count = 0;
-    for (it->SeekToFirst(); it->Valid(); it->Next()) {
-        uint64_t packed;
-        std::memcpy(&packed, it->key().data(), sizeof(packed));
-        bloom_filter_->add(packed);
+        std::unique_ptr<rocksdb::Iterator> it(db_->NewIterator(read_opts, cf_packed_to_id_));
 
-        if (++count % 10000000 == 0) {
-            std::cerr << "  Bloom filter: loaded " << count << " / " << num_states_ << "\n";
+        uint64_t count = 0;
+        for (it->SeekToFirst(); it->Valid(); it->Next()) {
+            uint64_t packed;
+            std::memcpy(&packed, it->key().data(), sizeof(packed));
+            bloom_filter_->add(packed);
+
+            if (++count % 10000000 == 0) {
+                std::cerr << "  Bloom filter: loaded " << count << " / " << num_states_ << "\n";
+            }
         }
     }
 
     auto end_time = std::chrono::steady_clock::now();
     auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(end_time - start_time).count();
 
-    std::cerr << "Bloom filter ready: " << count << " entries, " << elapsed << "s\n";
+    std::cerr << "Bloom filter ready in " << elapsed << "s\n";
+    bloom_filter_->save(bloom_path(), num_states_);
     bloom_loaded_ = true;
 }
 
@@ -1196,8 +1841,6 @@ void RetrogradeSolverDB::build_predecessors_streaming() {
     // Plus 5GB for cache = ~5.1GB total, well under 29GB RAM
     const size_t MAX_BUFFER_ENTRIES = 1000000;
 
-    std::mutex db_write_mutex;
-
     // Work queue
     struct WorkItem {
         uint32_t id;
@@ -1214,30 +1857,24 @@ void RetrogradeSolverDB::build_predecessors_streaming() {
     std::vector<std::thread> workers;
     for (int t = 0; t < num_threads_; ++t) {
         workers.emplace_back([this, t, &work_queue, &queue_write, &queue_read, &producer_done,
-                              &total_relations, QUEUE_SIZE, &db_write_mutex, MAX_BUFFER_ENTRIES]() {
+                              &total_relations, QUEUE_SIZE, MAX_BUFFER_ENTRIES]() {
             std::unordered_map<uint32_t, std::vector<uint32_t>> local_preds;
             size_t local_pred_count = 0;  // Count of predecessor ENTRIES (not states)
 
             auto flush_buffer = [&]() {
                 if (local_preds.empty()) return;
 
-                // Write-only approach: no reads, just append
-                // Use compound key: (succ_id << 4) | thread_id to avoid conflicts
-                // Later reading will merge all thread entries for same succ_id
-                std::lock_guard<std::mutex> lock(db_write_mutex);
+                // Write-only approach: no reads, just append with Merge().
+                // The merge operator concatenates, so threads never contend
+                // on a lock or overwrite each other's earlier flushes.
                 rocksdb::WriteBatch batch;
                 uint64_t flushed = 0;
                 for (auto& [succ_id, pred_ids] : local_preds) {
-                    // Compound key: succ_id (4 bytes) + thread_id (1 byte)
                     std::string key(reinterpret_cast<const char*>(&succ_id), sizeof(succ_id));
-                    key.push_back(static_cast<char>(t));  // Thread ID suffix
-
-                    std::string value;
-                    for (uint32_t pred_id : pred_ids) {
-                        value.append(reinterpret_cast<const char*>(&pred_id), sizeof(pred_id));
-                        ++flushed;
-                    }
-                    batch.Put(cf_predecessors_, key, value);
+                    std::string value(reinterpret_cast<const char*>(pred_ids.data()),
+                                      pred_ids.size() * sizeof(uint32_t));
+                    flushed += pred_ids.size();
+                    batch.Merge(cf_predecessors_, key, value);
                 }
                 db_->Write(fast_write_options_, &batch);
                 total_relations += flushed;
@@ -1268,11 +1905,11 @@ void RetrogradeSolverDB::build_predecessors_streaming() {
                 State s = unpack_state(item.packed);
 
                 if (check_terminal(s) == GameResult::ONGOING) {
-                    auto moves = generate_moves(s);
+                    MoveList moves;
+                    generate_moves(s, moves);
                     for (const auto& move : moves) {
                         State ns = apply_move(s, move);
-                        auto [canonical_ns, _] = canonicalize(ns);
-                        uint64_t ns_packed = pack_state(canonical_ns);
+                        uint64_t ns_packed = canonical_pack(ns);
 
                         PackedIdPair search_key{ns_packed, 0};
                         auto cache_it = std::lower_bound(packed_to_id_cache_.begin(),
@@ -1285,6 +1922,7 @@ void RetrogradeSolverDB::build_predecessors_streaming() {
                 }
 
                 ++atomic_enum_processed_;
+                metrics_.add_work(t, 1);
 
                 // Flush when buffer gets too large (SIZE-based, not count-based)
                 if (local_pred_count >= MAX_BUFFER_ENTRIES) {
@@ -1301,15 +1939,15 @@ void RetrogradeSolverDB::build_predecessors_streaming() {
     std::thread producer([this, &work_queue, &queue_write, &queue_read, &producer_done, QUEUE_SIZE]() {
         rocksdb::ReadOptions read_opts;
         read_opts.fill_cache = false;
+        read_opts.total_order_seek = true;
 
         std::unique_ptr<rocksdb::Iterator> it(db_->NewIterator(read_opts, cf_states_));
 
         for (it->SeekToFirst(); it->Valid(); it->Next()) {
             StateInfoCompact info;
-            std::memcpy(&info, it->value().data(), sizeof(info));
+            if (!decode_state_info(it->value(), info)) continue;
 
-            uint32_t id;
-            std::memcpy(&id, it->key().data(), sizeof(id));
+            uint32_t id = state_key_id(it->key());
 
             size_t write_pos;
             while (true) {
@@ -1337,6 +1975,7 @@ void RetrogradeSolverDB::build_predecessors_streaming() {
         auto now = std::chrono::steady_clock::now();
         auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(now - start_time).count();
 
+        metrics_.set_queue(queue_read.load(), queue_write.load());
         if (progress_cb_) {
             progress_cb_("Building predecessors", processed, num_states_);
         }
@@ -1378,37 +2017,289 @@ void RetrogradeSolverDB::build_predecessors_streaming() {
     }
 }
 
-void RetrogradeSolverDB::mark_terminals() {
-    for (uint32_t id = 0; id < num_states_; ++id) {
-        StateInfoCompact info;
-        if (!get_state_info(id, info)) continue;
+bool RetrogradeSolverDB::build_predecessors_sorted() {
+    load_packed_to_id_cache();
 
-        State s = unpack_state(info.packed);
-        GameResult gr = check_terminal(s);
+    namespace fs = std::filesystem;
+    const fs::path run_dir = fs::path(db_path_) / "pred_sort";
+    std::error_code ec;
+    fs::remove_all(run_dir, ec);
+    fs::create_directories(run_dir, ec);
+    if (ec) {
+        std::cerr << "Failed to create " << run_dir << ": " << ec.message() << "\n";
+        return false;
+    }
 
-        bool changed = false;
+    // Each worker fills a run of RUN_EDGES edges (8 bytes each, plus the
+    // same again as radix scratch) before sorting and spilling it
+    const size_t RUN_EDGES = 32 * 1024 * 1024;
+    const size_t MAX_FAN_IN = 256;
+    const uint64_t SST_FILE_BYTES = 256ULL * 1024 * 1024;
 
-        if (gr == GameResult::WHITE_WINS) {
-            if (s.white_to_move) {
-                info.result = static_cast<uint8_t>(Result::WIN);
-                ++num_wins_;
-            } else {
-                info.result = static_cast<uint8_t>(Result::LOSS);
-                ++num_losses_;
-            }
-            changed = true;
-        } else if (gr == GameResult::BLACK_WINS) {
-            if (!s.white_to_move) {
-                info.result = static_cast<uint8_t>(Result::WIN);
-                ++num_wins_;
-            } else {
-                info.result = static_cast<uint8_t>(Result::LOSS);
-                ++num_losses_;
-            }
-            changed = true;
-        } else if (info.num_successors == 0) {
+    std::cerr << "Building predecessors (external sort, " << num_threads_ << " threads)...\n";
+    auto start_time = std::chrono::steady_clock::now();
+
+    atomic_enum_processed_ = 0;
+    std::atomic<uint64_t> total_relations{0};
+    std::atomic<uint32_t> next_run{0};
+    std::atomic<int> next_partition{0};
+    std::atomic<int> workers_done{0};
+    std::atomic<bool> failed{false};
+    std::mutex runs_mutex;
+    std::vector<std::string> runs;
+
+    auto run_path = [&](uint32_t n) {
+        return (run_dir / ("run_" + std::to_string(n) + ".bin")).string();
+    };
+
+    auto spill = [&](std::vector<uint64_t>& edges, std::vector<uint64_t>& scratch) {
+        if (edges.empty()) return;
+        radix_sort_edges(edges, scratch);
+        std::string path = run_path(next_run.fetch_add(1));
+        if (!write_run(path, edges)) {
+            std::cerr << "Failed to write sort run " << path << "\n";
+            failed = true;
+        }
+        total_relations += edges.size();
+        edges.clear();
+        std::lock_guard<std::mutex> lock(runs_mutex);
+        runs.push_back(path);
+    };
+
+    // Step 1: scan states and spill sorted runs. Keys follow id order, so
+    // 256 id ranges split the states CF into evenly sized key ranges that
+    // workers scan sequentially.
+    std::vector<std::thread> workers;
+    for (int t = 0; t < num_threads_; ++t) {
+        workers.emplace_back([&, t]() {
+            std::vector<uint64_t> edges;
+            std::vector<uint64_t> scratch;
+            edges.reserve(RUN_EDGES);
+
+            rocksdb::ReadOptions read_opts;
+            read_opts.fill_cache = false;
+            read_opts.readahead_size = 2 * 1024 * 1024;
+            read_opts.total_order_seek = true;
+            std::unique_ptr<rocksdb::Iterator> it(db_->NewIterator(read_opts, cf_states_));
+
+            int partition;
+            while ((partition = next_partition.fetch_add(1)) < 256 && !failed) {
+                uint64_t first = num_states_ * partition / 256;
+                uint64_t last = num_states_ * (partition + 1) / 256;
+                for (it->Seek(state_key(static_cast<uint32_t>(first)));
+                     it->Valid() && state_key_id(it->key()) < last; it->Next()) {
+                    StateInfoCompact info;
+                    if (!decode_state_info(it->value(), info)) continue;
+                    uint32_t id = state_key_id(it->key());
+
+                    State s = unpack_state(info.packed);
+                    if (check_terminal(s) == GameResult::ONGOING) {
+                        MoveList moves;
+                        generate_moves(s, moves);
+                        for (const auto& move : moves) {
+                            uint64_t ns_packed = canonical_pack(apply_move(s, move));
+                            PackedIdPair search_key{ns_packed, 0};
+                            auto cache_it = std::lower_bound(packed_to_id_cache_.begin(),
+                                                             packed_to_id_cache_.end(), search_key);
+                            if (cache_it != packed_to_id_cache_.end() && cache_it->packed == ns_packed) {
+                                edges.push_back(make_sort_edge(cache_it->id, id));
+                            }
+                        }
+                        if (edges.size() + MAX_MOVES > RUN_EDGES) spill(edges, scratch);
+                    }
+                    ++atomic_enum_processed_;
+                    metrics_.add_work(t, 1);
+                }
+            }
+            spill(edges, scratch);
+            workers_done.fetch_add(1);
+        });
+    }
+
+    // Workers stop early when a spill fails, so wait for them rather than
+    // for the scan to reach every state
+    while (workers_done.load() < num_threads_) {
+        if (progress_cb_) progress_cb_("Building predecessors", atomic_enum_processed_, num_states_);
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+    }
+    for (auto& w : workers) {
+        w.join();
+    }
+
+    auto scan_sec = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::steady_clock::now() - start_time).count();
+    std::cerr << "\n  Scanned " << atomic_enum_processed_ << " states into " << runs.size()
+              << " sorted runs (" << total_relations << " relations) in " << scan_sec << "s\n";
+
+    // Step 2: merge passes until the runs fit into one k-way merge
+    while (!failed && runs.size() > MAX_FAN_IN) {
+        std::vector<std::string> merged;
+        for (size_t i = 0; i < runs.size() && !failed; i += MAX_FAN_IN) {
+            std::vector<std::string> group(runs.begin() + i,
+                                           runs.begin() + std::min(i + MAX_FAN_IN, runs.size()));
+            std::string path = run_path(next_run.fetch_add(1));
+            FILE* out = std::fopen(path.c_str(), "wb");
+            if (!out) {
+                failed = true;
+                break;
+            }
+            std::vector<uint64_t> buf;
+            buf.reserve(1 << 16);
+            bool ok = merge_runs(group, [&](uint64_t edge) {
+                buf.push_back(edge);
+                if (buf.size() == buf.capacity()) {
+                    if (std::fwrite(buf.data(), sizeof(uint64_t), buf.size(), out) != buf.size()) return false;
+                    buf.clear();
+                }
+                return true;
+            });
+            ok = ok && std::fwrite(buf.data(), sizeof(uint64_t), buf.size(), out) == buf.size();
+            if (std::fclose(out) != 0 || !ok) {
+                std::cerr << "Failed to write merged run " << path << "\n";
+                failed = true;
+            }
+            for (const auto& g : group) fs::remove(g, ec);
+            merged.push_back(path);
+        }
+        runs.swap(merged);
+    }
+
+    // Step 3: final merge into SST files, one Put per successor list
+    std::vector<std::string> sst_files;
+    if (!failed) {
+        if (progress_cb_) progress_cb_("Writing predecessor SST files", 0, total_relations);
+
+        rocksdb::Options sst_options;
+        std::unique_ptr<rocksdb::SstFileWriter> writer;
+        uint64_t written = 0;
+
+        auto finish_file = [&]() {
+            if (!writer) return true;
+            rocksdb::Status st = writer->Finish();
+            writer.reset();
+            if (!st.ok()) {
+                std::cerr << "Failed to finish SST file: " << st.ToString() << "\n";
+                return false;
+            }
+            return true;
+        };
+
+        auto put_list = [&](uint32_t succ_id, const std::string& value) {
+            if (writer && writer->FileSize() >= SST_FILE_BYTES && !finish_file()) return false;
+            if (!writer) {
+                std::string path = (run_dir / ("preds_" + std::to_string(sst_files.size()) + ".sst")).string();
+                writer = std::make_unique<rocksdb::SstFileWriter>(rocksdb::EnvOptions(), sst_options, cf_predecessors_);
+                rocksdb::Status st = writer->Open(path);
+                if (!st.ok()) {
+                    std::cerr << "Failed to create SST file " << path << ": " << st.ToString() << "\n";
+                    return false;
+                }
+                sst_files.push_back(path);
+            }
+            std::string key(reinterpret_cast<const char*>(&succ_id), sizeof(succ_id));
+            return writer->Put(key, value).ok();
+        };
+
+        bool have_list = false;
+        uint32_t current_succ = 0;
+        std::string value;
+        bool ok = merge_runs(runs, [&](uint64_t edge) {
+            uint32_t succ_id = sort_edge_succ(edge);
+            if (have_list && succ_id != current_succ) {
+                if (!put_list(current_succ, value)) return false;
+                value.clear();
+            }
+            have_list = true;
+            current_succ = succ_id;
+            uint32_t pred_id = static_cast<uint32_t>(edge);
+            value.append(reinterpret_cast<const char*>(&pred_id), sizeof(pred_id));
+            if (progress_cb_ && ++written % 100000000 == 0) {
+                progress_cb_("Writing predecessor SST files", written, total_relations);
+            }
+            return true;
+        });
+        if (ok && have_list) ok = put_list(current_succ, value);
+        ok = finish_file() && ok;
+        if (!ok) failed = true;
+    }
+
+    // Step 4: bulk-load the files. An interrupted earlier attempt may have
+    // left lists under the plain keys and under the per-thread shard keys,
+    // which get_predecessors_batch() would add to the ingested ones, so the
+    // whole CF is cleared first (the ingested keys are newer than the
+    // tombstone). The largest key is id 0xFFFFFFFF plus a shard byte.
+    if (!failed) {
+        rocksdb::Status st = db_->DeleteRange(rocksdb::WriteOptions(), cf_predecessors_,
+                                              rocksdb::Slice(), std::string(5, '\xFF'));
+        if (!st.ok()) {
+            std::cerr << "Failed to clear old predecessor lists: " << st.ToString() << "\n";
+            failed = true;
+        }
+    }
+    if (!failed && !sst_files.empty()) {
+        rocksdb::IngestExternalFileOptions ingest_opts;
+        ingest_opts.move_files = true;
+        rocksdb::Status st = db_->IngestExternalFile(cf_predecessors_, sst_files, ingest_opts);
+        if (!st.ok()) {
+            std::cerr << "Failed to ingest predecessor SST files: " << st.ToString() << "\n";
+            failed = true;
+        }
+    }
+
+    fs::remove_all(run_dir, ec);
+    packed_to_id_cache_.clear();
+    cache_loaded_ = false;
+
+    if (failed) {
+        std::cerr << "External sort predecessor building failed\n";
+        return false;
+    }
+
+    auto total_sec = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::steady_clock::now() - start_time).count();
+    std::cerr << "\nPredecessors complete!\n";
+    std::cerr << "  Total relations: " << total_relations << "\n";
+    std::cerr << "  SST files ingested: " << sst_files.size() << "\n";
+    std::cerr << "  Time: " << total_sec << " seconds\n";
+
+    if (progress_cb_) {
+        progress_cb_("Predecessors complete", num_states_, num_states_);
+    }
+    return true;
+}
+
+void RetrogradeSolverDB::mark_terminals() {
+    for (uint32_t id = 0; id < num_states_; ++id) {
+        StateInfoCompact info;
+        if (!get_state_info(id, info)) continue;
+
+        State s = unpack_state(info.packed);
+        GameResult gr = check_terminal(s);
+
+        bool changed = false;
+
+        if (gr == GameResult::WHITE_WINS) {
+            if (s.white_to_move) {
+                info.result = static_cast<uint8_t>(Result::WIN);
+                ++num_wins_;
+            } else {
+                info.result = static_cast<uint8_t>(Result::LOSS);
+                ++num_losses_;
+            }
+            changed = true;
+        } else if (gr == GameResult::BLACK_WINS) {
+            if (!s.white_to_move) {
+                info.result = static_cast<uint8_t>(Result::WIN);
+                ++num_wins_;
+            } else {
+                info.result = static_cast<uint8_t>(Result::LOSS);
+                ++num_losses_;
+            }
+            changed = true;
+        } else if (info.num_successors == 0) {
             // num_successors wasn't set during enumeration (resume bug) - fix it now
-            auto moves = generate_moves(s);
+            MoveList moves;
+            generate_moves(s, moves);
             if (moves.empty()) {
                 info.result = static_cast<uint8_t>(Result::LOSS);
                 ++num_losses_;
@@ -1422,6 +2313,7 @@ void RetrogradeSolverDB::mark_terminals() {
         if (changed) {
             put_state_info(id, info);
         }
+        metrics_.add_work(0, 1);
 
         if (progress_cb_ && id % 100000 == 0) {
             progress_cb_("Marking terminals", id, num_states_);
@@ -1434,12 +2326,15 @@ void RetrogradeSolverDB::mark_terminals() {
 }
 
 void RetrogradeSolverDB::mark_terminals_parallel() {
-    // Optimized: Use sequential iterator scan instead of random reads
-    // Single-threaded scan is faster than parallel random I/O
-    // Plus checkpointing every 1M states
+    // Pipelined: this thread scans the states CF in key (= id) order with
+    // async readahead and hands windows of raw records to the workers,
+    // which decode and check them and write back what changed. The scan
+    // keeps the disk busy while the workers compute. The checkpoint is the
+    // first id of the oldest window not written yet, every 1M states or
+    // every 60 seconds.
 
     const uint64_t CHECKPOINT_INTERVAL = 1000000;
-    const uint64_t BATCH_SIZE = 10000;
+    const size_t WINDOW_STATES = 4096;
 
     // Load checkpoint if exists
     uint64_t start_id = 0;
@@ -1450,145 +2345,477 @@ void RetrogradeSolverDB::mark_terminals_parallel() {
         std::cerr << "Resuming terminal marking from checkpoint: " << start_id << std::endl;
     }
 
-    uint64_t local_wins = 0;
-    uint64_t local_losses = 0;
-    uint64_t processed = start_id;
+    // Records as stored (big-endian words), keyed by id
+    struct TerminalWindow : PipelineWindow {
+        std::vector<std::pair<uint32_t, uint64_t>> records;
+    };
+
+    int num_workers = std::max(1, num_threads_);
+    WindowPipeline<TerminalWindow> pipeline(num_workers);
+    std::atomic<uint64_t> atomic_wins(0);
+    std::atomic<uint64_t> atomic_losses(0);
+    std::atomic<uint64_t> processed(start_id);
+
+    auto worker = [&](int thread_id) {
+        rocksdb::WriteBatch batch;
+        uint64_t wins = 0;
+        uint64_t losses = 0;
+        MoveList moves;
+
+        while (TerminalWindow* w = pipeline.next(thread_id)) {
+            for (const auto& [id, record] : w->records) {
+                StateInfoCompact info;
+                decode_state_info(rocksdb::Slice(reinterpret_cast<const char*>(&record), sizeof(record)), info);
+
+                // Check terminal status
+                State s = unpack_state(info.packed);
+                GameResult gr = check_terminal(s);
+                bool changed = false;
+
+                if (gr != GameResult::ONGOING) {
+                    if ((gr == GameResult::WHITE_WINS) == s.white_to_move) {
+                        info.result = static_cast<uint8_t>(Result::WIN);
+                        wins++;
+                    } else {
+                        info.result = static_cast<uint8_t>(Result::LOSS);
+                        losses++;
+                    }
+                    changed = true;
+                } else if (info.num_successors == 0) {
+                    // num_successors wasn't set during enumeration (resume bug) - fix it now
+                    generate_moves(s, moves);
+                    if (moves.empty()) {
+                        info.result = static_cast<uint8_t>(Result::LOSS);
+                        losses++;
+                    } else {
+                        // Set the missing num_successors count
+                        info.num_successors = moves.size();
+                    }
+                    changed = true;
+                }
+
+                if (changed) {
+                    batch.Put(cf_states_, state_key(id), encode_state_info(info));
+                }
+            }
+
+            // Written before the window counts as done, so a checkpoint
+            // never moves past changes still sitting in the batch
+            if (batch.Count() > 0) {
+                db_->Write(fast_write_options_, &batch);
+                batch.Clear();
+            }
+            processed.fetch_add(w->records.size(), std::memory_order_relaxed);
+            metrics_.add_work(thread_id, w->records.size());
+            w->done.store(true, std::memory_order_release);
+        }
+
+        atomic_wins.fetch_add(wins);
+        atomic_losses.fetch_add(losses);
+    };
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < num_workers; ++t) {
+        threads.emplace_back(worker, t);
+    }
 
     // Use iterator for sequential scan - MUCH faster than random reads
     rocksdb::ReadOptions read_opts;
     read_opts.fill_cache = false;  // Don't pollute cache with sequential scan
     read_opts.readahead_size = 2 * 1024 * 1024;  // 2MB readahead
+    read_opts.async_io = true;  // Read ahead while the window is handed out
+    read_opts.total_order_seek = true;
 
     std::unique_ptr<rocksdb::Iterator> it(db_->NewIterator(read_opts, cf_states_));
 
-    // Seek to start position
-    uint32_t start_key = static_cast<uint32_t>(start_id);
-    it->Seek(rocksdb::Slice(reinterpret_cast<char*>(&start_key), sizeof(start_key)));
+    // Seek to start position (keys follow id order, so the ids before it
+    // are exactly the ones already processed)
+    it->Seek(state_key(static_cast<uint32_t>(start_id)));
 
-    rocksdb::WriteBatch batch;
-    uint64_t batch_count = 0;
+    uint64_t next_id = start_id;
+    uint64_t scanned = start_id;
+    uint64_t next_checkpoint = start_id + CHECKPOINT_INTERVAL;
     auto last_checkpoint = std::chrono::steady_clock::now();
 
+    auto save_checkpoint = [&](uint64_t id) {
+        std::string ckpt_val(reinterpret_cast<char*>(&id), sizeof(id));
+        db_->Put(metadata_write_options_, cf_metadata_, ckpt_key, ckpt_val);
+    };
+
     while (it->Valid()) {
-        // Extract state ID from key
-        if (it->key().size() != sizeof(uint32_t)) {
-            it->Next();
-            continue;
+        auto w = std::make_unique<TerminalWindow>();
+        w->first = next_id;
+        w->records.reserve(WINDOW_STATES);
+        for (; it->Valid() && w->records.size() < WINDOW_STATES; it->Next()) {
+            if (it->key().size() != STATE_KEY_SIZE || it->value().size() != STATE_VALUE_SIZE) continue;
+            uint32_t id = state_key_id(it->key());
+            uint64_t record;
+            std::memcpy(&record, it->value().data(), sizeof(record));
+            w->records.emplace_back(id, record);
+            next_id = static_cast<uint64_t>(id) + 1;
         }
-        uint32_t id;
-        std::memcpy(&id, it->key().data(), sizeof(id));
+        w->last = next_id;
+        scanned += w->records.size();
+        pipeline.dispatch(std::move(w));
 
-        // Extract state info from value
-        if (it->value().size() != sizeof(StateInfoCompact)) {
-            it->Next();
-            continue;
+        // Checkpoint every CHECKPOINT_INTERVAL states or every 60 seconds
+        auto now = std::chrono::steady_clock::now();
+        bool time_for_checkpoint = std::chrono::duration_cast<std::chrono::seconds>(now - last_checkpoint).count() >= 60;
+
+        if (scanned >= next_checkpoint || time_for_checkpoint) {
+            save_checkpoint(pipeline.first_open(next_id));
+            next_checkpoint = scanned + CHECKPOINT_INTERVAL;
+            last_checkpoint = now;
+
+            if (progress_cb_) {
+                progress_cb_("Marking terminals", processed.load(), num_states_);
+            }
         }
-        StateInfoCompact info;
-        std::memcpy(&info, it->value().data(), sizeof(info));
+    }
 
-        // Check terminal status
-        State s = unpack_state(info.packed);
-        GameResult gr = check_terminal(s);
+    pipeline.finish();
+    for (auto& t : threads) {
+        t.join();
+    }
 
-        bool changed = false;
+    // Clear checkpoint (phase complete)
+    db_->Delete(metadata_write_options_, cf_metadata_, ckpt_key);
 
-        if (gr == GameResult::WHITE_WINS) {
-            if (s.white_to_move) {
-                info.result = static_cast<uint8_t>(Result::WIN);
-                local_wins++;
-            } else {
-                info.result = static_cast<uint8_t>(Result::LOSS);
-                local_losses++;
+    num_wins_ = atomic_wins.load();
+    num_losses_ = atomic_losses.load();
+
+    std::cerr << "Terminal marking complete: " << num_wins_ << " wins, " << num_losses_ << " losses" << std::endl;
+
+    if (progress_cb_) {
+        progress_cb_("Terminals marked", num_states_, num_states_);
+    }
+}
+
+void RetrogradeSolverDB::propagate() {
+    // A run interrupted under the disk queue keeps its partially applied
+    // counters in the states CF; only the queue path can pick that up
+    std::string ckpt_value;
+    if (db_->Get(rocksdb::ReadOptions(), cf_metadata_, "prop_checkpoint", &ckpt_value).ok()) {
+        propagate_queue();
+    } else {
+        propagate_in_memory();
+    }
+}
+
+void RetrogradeSolverDB::propagate_in_memory() {
+    // Result, DTW and remaining-successor counter of every state live in
+    // flat arrays indexed by id. Solved states are processed in ply
+    // layers: layer k holds the states whose game ends in k plies, and
+    // everything its predecessors learn from it lands in layer k + 1.
+    // Within a layer, threads claim chunks of the frontier; the next
+    // layer starts once all of them are done. Because layers are taken in
+    // order, a parent becomes a WIN through its shortest winning child
+    // and a LOSS through its longest-lasting one, so the layer number is
+    // the exact DTW.
+    //
+    // A thread's share of the next layer is capped at SPILL_BATCH states;
+    // beyond that it spills to cf_queue_, and the layer reads the spilled
+    // states back in batches of the same size once its in-memory part is
+    // done. Order within a layer does not matter for the DTW.
+    //
+    // Only results and DTW are written back (at the end, with the draws),
+    // and winning_succs keeps its pre-propagation value. If the run or
+    // the write-back is interrupted, rerunning seeds every solved state
+    // at its stored DTW and recounts from those unchanged counters, which
+    // gives the same fixpoint.
+    const size_t CHUNK_SIZE = 4096;
+    const size_t SPILL_BATCH = 1 << 22;
+
+    if (use_unmoves_) load_packed_to_id_cache();
+
+    std::vector<uint8_t> results(num_states_, static_cast<uint8_t>(Result::UNKNOWN));
+    std::vector<uint8_t> dtw(num_states_, 0);
+    std::vector<uint16_t> remaining(num_states_, 0);
+    std::vector<uint64_t> packed_by_id(use_unmoves_ ? num_states_ : 0);
+
+    // Solved states by the layer they are processed in
+    std::vector<std::vector<uint32_t>> seeds(DTW_MAX + 1);
+    uint64_t num_seeds = 0;
+
+    // Without stored DTW, the seeds are only known to be at layer 0 if
+    // they came straight from terminal marking
+    bool exact_dtw = true;
+
+    // Load counters and collect the already solved states
+    {
+        if (progress_cb_) progress_cb_("Loading propagation state", 0, num_states_);
+        rocksdb::ReadOptions read_opts;
+        read_opts.fill_cache = false;
+        read_opts.readahead_size = 2 * 1024 * 1024;
+        read_opts.total_order_seek = true;
+        std::unique_ptr<rocksdb::Iterator> it(db_->NewIterator(read_opts, cf_states_));
+
+        uint64_t scanned = 0;
+        for (it->SeekToFirst(); it->Valid(); it->Next()) {
+            StateInfoCompact info;
+            if (!decode_state_info(it->value(), info)) continue;
+            uint32_t id = state_key_id(it->key());
+            if (id >= num_states_) continue;
+
+            results[id] = info.result;
+            remaining[id] = info.num_successors > info.winning_succs
+                          ? info.num_successors - info.winning_succs : 0;
+            if (use_unmoves_) packed_by_id[id] = info.packed;
+
+            Result r = static_cast<Result>(info.result);
+            if (r != Result::UNKNOWN) {
+                uint8_t layer = 0;
+                if (has_dtw_) {
+                    layer = info.dtw;
+                } else if (r != Result::DRAW && info.num_successors != 0 &&
+                           check_terminal(unpack_state(info.packed)) == GameResult::ONGOING) {
+                    exact_dtw = false;
+                }
+                dtw[id] = layer;
+                seeds[layer].push_back(id);
+                ++num_seeds;
             }
-            changed = true;
-        } else if (gr == GameResult::BLACK_WINS) {
-            if (!s.white_to_move) {
-                info.result = static_cast<uint8_t>(Result::WIN);
-                local_wins++;
-            } else {
-                info.result = static_cast<uint8_t>(Result::LOSS);
-                local_losses++;
+
+            if (progress_cb_ && ++scanned % 10000000 == 0) {
+                progress_cb_("Loading propagation state", scanned, num_states_);
             }
-            changed = true;
-        } else if (info.num_successors == 0) {
-            // num_successors wasn't set during enumeration (resume bug) - fix it now
-            auto moves = generate_moves(s);
-            if (moves.empty()) {
-                info.result = static_cast<uint8_t>(Result::LOSS);
-                local_losses++;
+        }
+    }
+    std::cerr << "Propagation: " << num_seeds << " solved states to process\n";
+    if (!exact_dtw) {
+        std::cerr << "Propagation: database was partly propagated without DTW, not storing DTW\n";
+    }
+
+    std::atomic<uint64_t> processed(0);
+    std::atomic<uint64_t> new_wins(0);
+    std::atomic<uint64_t> new_losses(0);
+
+    std::vector<uint32_t> frontier;
+    std::vector<std::vector<uint32_t>> next(num_threads_);
+    std::atomic<size_t> frontier_head(0);
+
+    // Spilled states in cf_queue_, keyed by a running uint64 index. The
+    // threads append for the next layer while the current one reads its
+    // own range back between runs, so the two never overlap.
+    std::mutex spill_mutex;
+    uint64_t spill_head = 0;
+    uint64_t spill_tail = 0;
+
+    auto spill = [&](std::vector<uint32_t>& items) {
+        std::lock_guard<std::mutex> lock(spill_mutex);
+        rocksdb::WriteBatch batch;
+        for (uint32_t id : items) {
+            batch.Put(cf_queue_, rocksdb::Slice(reinterpret_cast<const char*>(&spill_tail), sizeof(spill_tail)),
+                      rocksdb::Slice(reinterpret_cast<const char*>(&id), sizeof(id)));
+            ++spill_tail;
+        }
+        db_->Write(fast_write_options_, &batch);
+        items.clear();
+    };
+
+    // Read up to SPILL_BATCH spilled states below `end` into `items` and
+    // drop them from cf_queue_; false once there are none left
+    auto reload = [&](std::vector<uint32_t>& items, uint64_t end) {
+        uint64_t last = std::min<uint64_t>(spill_head + SPILL_BATCH, end);
+        if (spill_head == last) return false;
+
+        std::vector<uint64_t> indices;
+        std::vector<rocksdb::Slice> keys;
+        indices.reserve(last - spill_head);
+        keys.reserve(last - spill_head);
+        for (uint64_t i = spill_head; i < last; ++i) indices.push_back(i);
+        for (const uint64_t& i : indices) keys.emplace_back(reinterpret_cast<const char*>(&i), sizeof(i));
+
+        std::vector<std::string> values(keys.size());
+        std::vector<rocksdb::ColumnFamilyHandle*> cfs(keys.size(), cf_queue_);
+        std::vector<rocksdb::Status> statuses = db_->MultiGet(rocksdb::ReadOptions(), cfs, keys, &values);
+        rocksdb::WriteBatch batch;
+        for (size_t i = 0; i < keys.size(); ++i) {
+            uint32_t id;
+            if (statuses[i].ok() && values[i].size() == sizeof(id)) {
+                std::memcpy(&id, values[i].data(), sizeof(id));
+                items.push_back(id);
             } else {
-                // Set the missing num_successors count
-                info.num_successors = moves.size();
+                std::cerr << "Propagation: spilled entry " << indices[i] << " is missing: "
+                          << statuses[i].ToString() << "\n";
             }
-            changed = true;
+            batch.Delete(cf_queue_, keys[i]);
         }
+        db_->Write(fast_write_options_, &batch);
+        spill_head = last;
+        return true;
+    };
 
-        if (changed) {
-            std::string key(reinterpret_cast<char*>(&id), sizeof(id));
-            std::string value(reinterpret_cast<char*>(&info), sizeof(info));
-            batch.Put(cf_states_, key, value);
-            batch_count++;
-        }
+    auto worker = [&](int t, uint8_t next_dtw) {
+        auto& out = next[t];
+        std::vector<uint32_t> unmove_preds;
+        std::vector<std::vector<uint32_t>> stored_preds;
 
-        processed++;
+        while (true) {
+            size_t first = frontier_head.fetch_add(CHUNK_SIZE);
+            if (first >= frontier.size()) break;
+            size_t last = std::min(first + CHUNK_SIZE, frontier.size());
+
+            // Stored lists for the whole chunk in one MultiGet, so the disk
+            // sees the chunk's reads at once instead of one state at a time
+            if (!use_unmoves_) get_predecessors_batch(&frontier[first], last - first, stored_preds);
+
+            for (size_t i = first; i < last; ++i) {
+                uint32_t id = frontier[i];
+                Result child_result = static_cast<Result>(results[id]);
+                if (child_result != Result::WIN && child_result != Result::LOSS) continue;
+                if (use_unmoves_) collect_predecessors(id, packed_by_id[id], unmove_preds);
+                const std::vector<uint32_t>& preds = use_unmoves_ ? unmove_preds : stored_preds[i - first];
+
+                for (uint32_t pred_id : preds) {
+                    std::atomic_ref<uint8_t> pred_result(results[pred_id]);
+                    if (pred_result.load(std::memory_order_relaxed) != static_cast<uint8_t>(Result::UNKNOWN)) {
+                        continue;
+                    }
 
-        // Write batch when full
-        if (batch_count >= BATCH_SIZE) {
-            db_->Write(fast_write_options_, &batch);
-            batch.Clear();
-            batch_count = 0;
+                    uint8_t expected = static_cast<uint8_t>(Result::UNKNOWN);
+                    if (child_result == Result::LOSS) {
+                        // Child is LOSS = WIN for us
+                        if (pred_result.compare_exchange_strong(expected, static_cast<uint8_t>(Result::WIN),
+                                                                std::memory_order_relaxed)) {
+                            dtw[pred_id] = next_dtw;
+                            new_wins.fetch_add(1, std::memory_order_relaxed);
+                            out.push_back(pred_id);
+                            if (out.size() >= SPILL_BATCH) spill(out);
+                        }
+                    } else {
+                        // Every successor wins for the opponent = LOSS for us
+                        uint16_t before = std::atomic_ref<uint16_t>(remaining[pred_id]).fetch_sub(1, std::memory_order_relaxed);
+                        if (before == 1 &&
+                            pred_result.compare_exchange_strong(expected, static_cast<uint8_t>(Result::LOSS),
+                                                                std::memory_order_relaxed)) {
+                            dtw[pred_id] = next_dtw;
+                            new_losses.fetch_add(1, std::memory_order_relaxed);
+                            out.push_back(pred_id);
+                            if (out.size() >= SPILL_BATCH) spill(out);
+                        }
+                    }
+                }
+            }
+            processed.fetch_add(last - first, std::memory_order_relaxed);
+            metrics_.add_work(t, last - first);
+            metrics_.set_queue(last, frontier.size());
         }
+    };
 
-        // Checkpoint every CHECKPOINT_INTERVAL states or every 60 seconds
-        auto now = std::chrono::steady_clock::now();
-        bool time_for_checkpoint = std::chrono::duration_cast<std::chrono::seconds>(now - last_checkpoint).count() >= 60;
+    auto start_time = std::chrono::steady_clock::now();
+    uint32_t layer = 0;
+    for (;; ++layer) {
+        // Results of this layer were all written before the previous
+        // layer's threads were joined. Its states are what the threads
+        // kept in memory, then its seeds, then what they spilled.
+        frontier.clear();
+        for (auto& v : next) {
+            frontier.insert(frontier.end(), v.begin(), v.end());
+            v.clear();
+        }
+        std::vector<uint32_t> layer_seeds;
+        if (layer <= DTW_MAX) layer_seeds.swap(seeds[layer]);
+        const uint64_t layer_spill_end = spill_tail;
+        if (frontier.empty() && layer_seeds.empty() && spill_head == layer_spill_end) {
+            if (layer >= DTW_MAX) break;
+            continue;
+        }
 
-        if ((processed % CHECKPOINT_INTERVAL == 0) || time_for_checkpoint) {
-            // Flush any pending batch
-            if (batch_count > 0) {
-                db_->Write(fast_write_options_, &batch);
-                batch.Clear();
-                batch_count = 0;
+        uint8_t next_dtw = static_cast<uint8_t>(std::min<uint32_t>(layer + 1, DTW_MAX));
+        for (;;) {
+            if (frontier.empty() && !layer_seeds.empty()) {
+                frontier.swap(layer_seeds);
             }
+            if (frontier.empty() && !reload(frontier, layer_spill_end)) break;
+            if (frontier.empty()) continue;
 
-            // Save checkpoint
-            std::string ckpt_val(reinterpret_cast<char*>(&processed), sizeof(processed));
-            db_->Put(metadata_write_options_, cf_metadata_, ckpt_key, ckpt_val);
+            if (progress_cb_) progress_cb_("Propagating", processed.load(), num_seeds + new_wins.load() + new_losses.load());
 
-            last_checkpoint = now;
-
-            if (progress_cb_) {
-                progress_cb_("Marking terminals", processed, num_states_);
+            frontier_head.store(0);
+            std::vector<std::thread> threads;
+            for (int t = 0; t < num_threads_; ++t) {
+                threads.emplace_back(worker, t, next_dtw);
             }
+            for (auto& t : threads) {
+                t.join();
+            }
+            frontier.clear();
         }
+    }
 
-        // Progress update every 10k
-        if (processed % 10000 == 0 && progress_cb_) {
-            progress_cb_("Marking terminals", processed, num_states_);
-        }
+    auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::steady_clock::now() - start_time).count();
+    std::cerr << "Propagation complete: processed " << processed.load() << " states in "
+              << elapsed << "s (" << layer << " ply layers, " << spill_tail << " spilled to disk)\n";
 
-        it->Next();
+    num_wins_ += new_wins.load();
+    num_losses_ += new_losses.load();
+    if (use_unmoves_) {
+        packed_to_id_cache_.clear();
+        cache_loaded_ = false;
     }
 
-    // Write any remaining batch
-    if (batch_count > 0) {
-        db_->Write(fast_write_options_, &batch);
+    // Recorded before the write-back so an interrupted one resumes with
+    // the DTW values it already wrote
+    if (exact_dtw && !has_dtw_) {
+        uint32_t one = 1;
+        db_->Put(metadata_write_options_, cf_metadata_, "has_dtw",
+                 rocksdb::Slice(reinterpret_cast<const char*>(&one), sizeof(one)));
+        has_dtw_ = true;
     }
 
-    // Clear checkpoint (phase complete)
-    db_->Delete(metadata_write_options_, cf_metadata_, ckpt_key);
+    // Write back new results; every state still unknown is a draw
+    if (progress_cb_) progress_cb_("Writing results", 0, num_states_);
+
+    rocksdb::ReadOptions read_opts;
+    read_opts.fill_cache = false;
+    read_opts.readahead_size = 2 * 1024 * 1024;
+    read_opts.total_order_seek = true;
+    std::unique_ptr<rocksdb::Iterator> it(db_->NewIterator(read_opts, cf_states_));
+
+    rocksdb::WriteBatch batch;
+    uint64_t draws_marked = 0;
+    uint64_t scanned = 0;
 
-    num_wins_ = local_wins;
-    num_losses_ = local_losses;
+    for (it->SeekToFirst(); it->Valid(); it->Next()) {
+        StateInfoCompact info;
+        if (!decode_state_info(it->value(), info)) continue;
+        uint32_t id = state_key_id(it->key());
+        if (id >= num_states_) continue;
+
+        uint8_t result = results[id];
+        uint8_t depth = has_dtw_ ? dtw[id] : info.dtw;
+        if (static_cast<Result>(result) == Result::UNKNOWN) {
+            result = static_cast<uint8_t>(Result::DRAW);
+            depth = has_dtw_ ? 0 : info.dtw;
+            ++draws_marked;
+            ++num_draws_;
+        }
+        if (result != info.result || depth != info.dtw) {
+            info.result = result;
+            info.dtw = depth;
+            batch.Put(cf_states_, it->key(), encode_state_info(info));
+            if (batch.Count() >= 10000) {
+                db_->Write(fast_write_options_, &batch);
+                batch.Clear();
+            }
+        }
 
-    std::cerr << "Terminal marking complete: " << local_wins << " wins, " << local_losses << " losses" << std::endl;
+        if (progress_cb_ && ++scanned % 1000000 == 0) {
+            progress_cb_("Writing results", scanned, num_states_);
+        }
+    }
+    db_->Write(fast_write_options_, &batch);
+
+    std::cerr << "Marked " << draws_marked << " states as draws\n";
 
     if (progress_cb_) {
-        progress_cb_("Terminals marked", num_states_, num_states_);
+        progress_cb_("Propagation complete", num_states_, num_states_);
     }
 }
 
-void RetrogradeSolverDB::propagate() {
+void RetrogradeSolverDB::propagate_queue() {
     // Optimized propagation with iterator-based initialization and batching
 
     uint64_t prop_head = 0;
@@ -1615,6 +2842,7 @@ void RetrogradeSolverDB::propagate() {
         rocksdb::ReadOptions read_opts;
         read_opts.fill_cache = false;
         read_opts.readahead_size = 2 * 1024 * 1024;
+        read_opts.total_order_seek = true;
 
         std::unique_ptr<rocksdb::Iterator> it(db_->NewIterator(read_opts, cf_states_));
 
@@ -1624,15 +2852,12 @@ void RetrogradeSolverDB::propagate() {
         uint64_t scanned = 0;
 
         for (it->SeekToFirst(); it->Valid(); it->Next()) {
-            if (it->value().size() != sizeof(StateInfoCompact)) continue;
-
             StateInfoCompact info;
-            std::memcpy(&info, it->value().data(), sizeof(info));
+            if (!decode_state_info(it->value(), info)) continue;
 
             if (static_cast<Result>(info.result) != Result::UNKNOWN) {
                 // Add to queue
-                uint32_t id;
-                std::memcpy(&id, it->key().data(), sizeof(id));
+                uint32_t id = state_key_id(it->key());
 
                 std::string queue_key(reinterpret_cast<char*>(&prop_tail), sizeof(prop_tail));
                 std::string queue_val(reinterpret_cast<char*>(&id), sizeof(id));
@@ -1661,208 +2886,253 @@ void RetrogradeSolverDB::propagate() {
         std::cerr << "Propagation queue built: " << prop_tail << " solved states to process" << std::endl;
     }
 
-    // Phase 2: Propagate results - parallel approach
-    std::atomic<uint64_t> atomic_prop_head(prop_head);
-    std::atomic<uint64_t> atomic_prop_tail(prop_tail);
+    // Retro moves resolve parents through packed_to_id; keep it in memory
+    if (use_unmoves_) {
+        load_packed_to_id_cache();
+    }
+
+    // Phase 2: Propagate results - pipelined. This thread reads windows of
+    // queue entries with MultiGet, then the records they name and (unless
+    // retro moves are used) their predecessor lists, and hands each window
+    // to a worker; the reads for the next windows are in flight while the
+    // workers compute. A worker derives retro-move predecessors itself,
+    // reads every predecessor record of its window in one MultiGet to warm
+    // the block cache, then updates each predecessor under its stripe lock.
+    //
+    // A predecessor update is written before its lock is released, so the
+    // next thread to lock it reads the new counter. The entries a window
+    // queues are written in one batch when it is done, and only then does
+    // the committed tail move past them, so the reader never asks for an
+    // entry that is not written yet.
+    const size_t WINDOW_ENTRIES = 1024;
+
+    struct PropagationWindow : PipelineWindow {
+        std::vector<uint32_t> ids;
+        std::vector<uint64_t> records;             // As stored (big-endian words)
+        std::vector<std::vector<uint32_t>> preds;  // Per id; filled by the worker with retro moves
+    };
+
+    std::atomic<uint64_t> committed_tail(prop_tail);
     std::atomic<uint64_t> atomic_propagated(0);
     std::atomic<uint64_t> atomic_wins(0);
     std::atomic<uint64_t> atomic_losses(0);
-
-    auto start_time = std::chrono::steady_clock::now();
-    std::atomic<uint64_t> last_checkpoint_time(0);
-    std::mutex checkpoint_mutex;
+    std::mutex queue_mutex;
 
     // Per-state locks to handle concurrent updates to the same predecessor
     const size_t NUM_LOCKS = 65536;
     std::vector<std::mutex> state_locks(NUM_LOCKS);
 
-    auto worker = [&](int thread_id) {
-        rocksdb::WriteBatch local_batch;
-        uint64_t local_batch_count = 0;
-        const uint64_t LOCAL_BATCH_SIZE = 1000;
+    int num_workers = std::max(1, num_threads_);
+    WindowPipeline<PropagationWindow> pipeline(num_workers);
+
+    auto load_window = [&](PropagationWindow& w) {
+        size_t n = w.last - w.first;
+        std::vector<std::string> key_storage(n);
+        std::vector<rocksdb::Slice> keys(n);
+        for (size_t i = 0; i < n; ++i) {
+            uint64_t pos = w.first + i;
+            key_storage[i] = std::string(reinterpret_cast<const char*>(&pos), sizeof(pos));
+            keys[i] = key_storage[i];
+        }
+        std::vector<std::string> values(n);
+        std::vector<rocksdb::Status> statuses = db_->MultiGet(
+            rocksdb::ReadOptions(), std::vector<rocksdb::ColumnFamilyHandle*>(n, cf_queue_), keys, &values);
+
+        std::vector<uint32_t> ids;
+        ids.reserve(n);
+        for (size_t i = 0; i < n; ++i) {
+            if (!statuses[i].ok() || values[i].size() != sizeof(uint32_t)) continue;
+            uint32_t id;
+            std::memcpy(&id, values[i].data(), sizeof(id));
+            ids.push_back(id);
+        }
 
-        while (true) {
-            // Get next queue position atomically
-            uint64_t my_pos = atomic_prop_head.fetch_add(1);
-            uint64_t current_tail = atomic_prop_tail.load();
-
-            if (my_pos >= current_tail) {
-                // Check again in case tail grew
-                current_tail = atomic_prop_tail.load();
-                if (my_pos >= current_tail) {
-                    // Flush remaining batch
-                    if (local_batch_count > 0) {
-                        db_->Write(fast_write_options_, &local_batch);
-                    }
-                    break;
-                }
-            }
+        key_storage.resize(ids.size());
+        keys.resize(ids.size());
+        for (size_t i = 0; i < ids.size(); ++i) {
+            key_storage[i] = state_key(ids[i]);
+            keys[i] = key_storage[i];
+        }
+        values.assign(ids.size(), std::string());
+        statuses = db_->MultiGet(rocksdb::ReadOptions(),
+                                 std::vector<rocksdb::ColumnFamilyHandle*>(ids.size(), cf_states_), keys, &values);
+
+        for (size_t i = 0; i < ids.size(); ++i) {
+            if (!statuses[i].ok() || values[i].size() != STATE_VALUE_SIZE) continue;
+            uint64_t record;
+            std::memcpy(&record, values[i].data(), sizeof(record));
+            w.ids.push_back(ids[i]);
+            w.records.push_back(record);
+        }
 
-            // Read queue item
-            std::string queue_key(reinterpret_cast<char*>(&my_pos), sizeof(my_pos));
-            std::string queue_value;
-            auto status = db_->Get(rocksdb::ReadOptions(), cf_queue_, queue_key, &queue_value);
+        // Entries without a readable record are skipped, as before
+        atomic_propagated.fetch_add(n - w.ids.size());
+        if (!use_unmoves_) get_predecessors_batch(w.ids.data(), w.ids.size(), w.preds);
+    };
 
-            if (!status.ok() || queue_value.size() != sizeof(uint32_t)) {
-                atomic_propagated.fetch_add(1);
-                continue;
+    auto worker = [&](int thread_id) {
+        std::vector<uint32_t> solved;  // Predecessors this window solved, to queue
+        std::vector<std::string> warm_keys;
+        std::vector<rocksdb::Slice> warm_slices;
+        std::vector<std::string> warm_values;
+
+        while (PropagationWindow* w = pipeline.next(thread_id)) {
+            size_t n = w->ids.size();
+            std::vector<StateInfoCompact> infos(n);
+            for (size_t i = 0; i < n; ++i) {
+                decode_state_info(rocksdb::Slice(reinterpret_cast<const char*>(&w->records[i]),
+                                                 sizeof(w->records[i])), infos[i]);
             }
-
-            uint32_t id;
-            std::memcpy(&id, queue_value.data(), sizeof(id));
-
-            // Read state info
-            std::string state_key(reinterpret_cast<char*>(&id), sizeof(id));
-            std::string state_value;
-            status = db_->Get(rocksdb::ReadOptions(), cf_states_, state_key, &state_value);
-
-            if (!status.ok() || state_value.size() != sizeof(StateInfoCompact)) {
-                atomic_propagated.fetch_add(1);
-                continue;
+            if (use_unmoves_) {
+                w->preds.resize(n);
+                for (size_t i = 0; i < n; ++i) collect_predecessors(w->ids[i], infos[i].packed, w->preds[i]);
             }
 
-            StateInfoCompact info;
-            std::memcpy(&info, state_value.data(), sizeof(info));
-            Result child_result = static_cast<Result>(info.result);
-
-            // Get predecessors
-            auto preds = get_predecessors(id);
+            // One batched read of every predecessor record, so the locked
+            // reads below find them in the block cache
+            warm_keys.clear();
+            for (const auto& preds : w->preds) {
+                for (uint32_t pred_id : preds) warm_keys.push_back(state_key(pred_id));
+            }
+            warm_slices.assign(warm_keys.begin(), warm_keys.end());
+            warm_values.assign(warm_keys.size(), std::string());
+            db_->MultiGet(rocksdb::ReadOptions(),
+                          std::vector<rocksdb::ColumnFamilyHandle*>(warm_slices.size(), cf_states_),
+                          warm_slices, &warm_values);
+
+            for (size_t i = 0; i < n; ++i) {
+                Result child_result = static_cast<Result>(infos[i].result);
+
+                for (uint32_t pred_id : w->preds[i]) {
+                    // Lock this predecessor's slot
+                    size_t lock_idx = pred_id % NUM_LOCKS;
+                    std::lock_guard<std::mutex> lock(state_locks[lock_idx]);
+
+                    // Read predecessor state info (while holding lock)
+                    std::string pred_key = state_key(pred_id);
+                    std::string pred_value;
+                    auto status = db_->Get(rocksdb::ReadOptions(), cf_states_, pred_key, &pred_value);
+
+                    StateInfoCompact pred_info;
+                    if (!status.ok() || !decode_state_info(pred_value, pred_info)) {
+                        continue;
+                    }
 
-            for (uint32_t pred_id : preds) {
-                // Lock this predecessor's slot
-                size_t lock_idx = pred_id % NUM_LOCKS;
-                std::lock_guard<std::mutex> lock(state_locks[lock_idx]);
+                    // Skip if already solved
+                    if (static_cast<Result>(pred_info.result) != Result::UNKNOWN) {
+                        continue;
+                    }
 
-                // Read predecessor state info (while holding lock)
-                std::string pred_key(reinterpret_cast<char*>(&pred_id), sizeof(pred_id));
-                std::string pred_value;
-                status = db_->Get(rocksdb::ReadOptions(), cf_states_, pred_key, &pred_value);
+                    if (child_result == Result::LOSS) {
+                        // Child is LOSS = WIN for us
+                        pred_info.result = static_cast<uint8_t>(Result::WIN);
+                        atomic_wins.fetch_add(1);
+                        solved.push_back(pred_id);
+                    } else if (child_result == Result::WIN) {
+                        pred_info.winning_succs++;
+
+                        if (pred_info.winning_succs >= pred_info.num_successors) {
+                            pred_info.result = static_cast<uint8_t>(Result::LOSS);
+                            atomic_losses.fetch_add(1);
+                            solved.push_back(pred_id);
+                        }
+                    } else {
+                        continue;
+                    }
 
-                if (!status.ok() || pred_value.size() != sizeof(StateInfoCompact)) {
-                    continue;
+                    db_->Put(fast_write_options_, cf_states_, pred_key, encode_state_info(pred_info));
                 }
+            }
 
-                StateInfoCompact pred_info;
-                std::memcpy(&pred_info, pred_value.data(), sizeof(pred_info));
-
-                // Skip if already solved
-                if (static_cast<Result>(pred_info.result) != Result::UNKNOWN) {
-                    continue;
+            // Queue what this window solved, then publish the new tail
+            if (!solved.empty()) {
+                std::lock_guard<std::mutex> lock(queue_mutex);
+                uint64_t base = committed_tail.load(std::memory_order_relaxed);
+                rocksdb::WriteBatch batch;
+                for (size_t k = 0; k < solved.size(); ++k) {
+                    uint64_t pos = base + k;
+                    batch.Put(cf_queue_,
+                              rocksdb::Slice(reinterpret_cast<const char*>(&pos), sizeof(pos)),
+                              rocksdb::Slice(reinterpret_cast<const char*>(&solved[k]), sizeof(solved[k])));
                 }
+                db_->Write(fast_write_options_, &batch);
+                committed_tail.store(base + solved.size(), std::memory_order_release);
+                solved.clear();
+            }
 
-                bool changed = false;
-
-                if (child_result == Result::LOSS) {
-                    // Child is LOSS = WIN for us
-                    pred_info.result = static_cast<uint8_t>(Result::WIN);
-                    atomic_wins.fetch_add(1);
-                    changed = true;
+            atomic_propagated.fetch_add(n);
+            metrics_.add_work(thread_id, n);
+            w->done.store(true, std::memory_order_release);
+        }
+    };
 
-                    // Add to queue
-                    uint64_t new_tail = atomic_prop_tail.fetch_add(1);
-                    std::string new_queue_key(reinterpret_cast<char*>(&new_tail), sizeof(new_tail));
-                    std::string new_queue_val(reinterpret_cast<char*>(&pred_id), sizeof(pred_id));
-                    local_batch.Put(cf_queue_, new_queue_key, new_queue_val);
-                    local_batch_count++;
-                } else if (child_result == Result::WIN) {
-                    pred_info.winning_succs++;
-
-                    if (pred_info.winning_succs >= pred_info.num_successors) {
-                        pred_info.result = static_cast<uint8_t>(Result::LOSS);
-                        atomic_losses.fetch_add(1);
-                        changed = true;
-
-                        // Add to queue
-                        uint64_t new_tail = atomic_prop_tail.fetch_add(1);
-                        std::string new_queue_key(reinterpret_cast<char*>(&new_tail), sizeof(new_tail));
-                        std::string new_queue_val(reinterpret_cast<char*>(&pred_id), sizeof(pred_id));
-                        local_batch.Put(cf_queue_, new_queue_key, new_queue_val);
-                        local_batch_count++;
-                    }
-                }
+    std::vector<std::thread> threads;
+    for (int t = 0; t < num_workers; ++t) {
+        threads.emplace_back(worker, t);
+    }
 
-                if (changed || pred_info.winning_succs > 0) {
-                    std::string key(reinterpret_cast<char*>(&pred_id), sizeof(pred_id));
-                    std::string value(reinterpret_cast<char*>(&pred_info), sizeof(pred_info));
-                    local_batch.Put(cf_states_, key, value);
-                    local_batch_count++;
-                }
-            }
+    auto save_checkpoint = [&](uint64_t head, uint64_t tail, uint64_t propagated) {
+        std::string ckpt_val(24, '\0');
+        std::memcpy(&ckpt_val[0], &head, sizeof(head));
+        std::memcpy(&ckpt_val[8], &tail, sizeof(tail));
+        std::memcpy(&ckpt_val[16], &propagated, sizeof(propagated));
+        db_->Put(metadata_write_options_, cf_metadata_, ckpt_key, ckpt_val);
+    };
 
-            atomic_propagated.fetch_add(1);
+    auto last_report = std::chrono::steady_clock::now();
+    auto last_checkpoint = last_report;
+    uint64_t next_pos = prop_head;
 
-            // Flush local batch periodically
-            if (local_batch_count >= LOCAL_BATCH_SIZE) {
-                db_->Write(fast_write_options_, &local_batch);
-                local_batch.Clear();
-                local_batch_count = 0;
-            }
+    while (true) {
+        uint64_t tail = committed_tail.load(std::memory_order_acquire);
+        if (next_pos < tail) {
+            auto w = std::make_unique<PropagationWindow>();
+            w->first = next_pos;
+            w->last = std::min<uint64_t>(tail, next_pos + WINDOW_ENTRIES);
+            load_window(*w);
+            next_pos = w->last;
+            pipeline.dispatch(std::move(w));
+        } else if (pipeline.first_open(next_pos) == next_pos &&
+                   committed_tail.load(std::memory_order_acquire) == next_pos) {
+            // Nothing left to read and no window in flight that could queue more
+            break;
+        } else {
+            std::this_thread::yield();
         }
-    };
-
-    // Progress reporting thread
-    std::atomic<bool> done(false);
-    std::thread progress_thread([&]() {
-        while (!done.load()) {
-            std::this_thread::sleep_for(std::chrono::seconds(5));
 
+        // Progress every 5 seconds, checkpoint every 60; the checkpoint
+        // head is the first entry of the oldest window not done yet
+        auto now = std::chrono::steady_clock::now();
+        if (now - last_report >= std::chrono::seconds(5)) {
+            uint64_t head = pipeline.first_open(next_pos);
+            uint64_t current_tail = committed_tail.load();
             uint64_t current_propagated = atomic_propagated.load();
-            uint64_t current_tail = atomic_prop_tail.load();
-
+            metrics_.set_queue(head, current_tail);
             if (progress_cb_) {
                 progress_cb_("Propagating", current_propagated, current_tail);
             }
-
-            // Checkpoint every 60 seconds
-            auto now = std::chrono::steady_clock::now();
-            uint64_t elapsed = std::chrono::duration_cast<std::chrono::seconds>(now - start_time).count();
-            uint64_t last_ckpt = last_checkpoint_time.load();
-
-            if (elapsed >= last_ckpt + 60) {
-                std::lock_guard<std::mutex> lock(checkpoint_mutex);
-                // Double-check after acquiring lock
-                if (elapsed >= last_checkpoint_time.load() + 60) {
-                    uint64_t current_head = atomic_prop_head.load();
-                    std::string ckpt_val(24, '\0');
-                    std::memcpy(&ckpt_val[0], &current_head, sizeof(current_head));
-                    std::memcpy(&ckpt_val[8], &current_tail, sizeof(current_tail));
-                    std::memcpy(&ckpt_val[16], &current_propagated, sizeof(current_propagated));
-                    db_->Put(metadata_write_options_, cf_metadata_, ckpt_key, ckpt_val);
-                    last_checkpoint_time.store(elapsed);
-                }
+            if (now - last_checkpoint >= std::chrono::seconds(60)) {
+                save_checkpoint(head, current_tail, current_propagated);
+                last_checkpoint = now;
             }
+            last_report = now;
         }
-    });
-
-    // Launch worker threads
-    std::vector<std::thread> threads;
-    for (int t = 0; t < num_threads_; ++t) {
-        threads.emplace_back(worker, t);
     }
 
-    // Wait for all workers to complete
+    pipeline.finish();
     for (auto& t : threads) {
         t.join();
     }
 
-    done.store(true);
-    progress_thread.join();
-
     // Update counters
     num_wins_ += atomic_wins.load();
     num_losses_ += atomic_losses.load();
-    prop_head = atomic_prop_head.load();
-    prop_tail = atomic_prop_tail.load();
+    prop_head = next_pos;
+    prop_tail = committed_tail.load();
     uint64_t propagated = atomic_propagated.load();
 
     // Final checkpoint
-    {
-        std::string ckpt_val(24, '\0');
-        std::memcpy(&ckpt_val[0], &prop_head, sizeof(prop_head));
-        std::memcpy(&ckpt_val[8], &prop_tail, sizeof(prop_tail));
-        std::memcpy(&ckpt_val[16], &propagated, sizeof(propagated));
-        db_->Put(metadata_write_options_, cf_metadata_, ckpt_key, ckpt_val);
-    }
+    save_checkpoint(prop_head, prop_tail, propagated);
 
     std::cerr << "Propagation complete: processed " << propagated << " states" << std::endl;
 
@@ -1872,6 +3142,7 @@ void RetrogradeSolverDB::propagate() {
     rocksdb::ReadOptions read_opts;
     read_opts.fill_cache = false;
     read_opts.readahead_size = 2 * 1024 * 1024;
+    read_opts.total_order_seek = true;
 
     std::unique_ptr<rocksdb::Iterator> it(db_->NewIterator(read_opts, cf_states_));
 
@@ -1881,17 +3152,13 @@ void RetrogradeSolverDB::propagate() {
     uint64_t scanned = 0;
 
     for (it->SeekToFirst(); it->Valid(); it->Next()) {
-        if (it->value().size() != sizeof(StateInfoCompact)) continue;
-
         StateInfoCompact info;
-        std::memcpy(&info, it->value().data(), sizeof(info));
+        if (!decode_state_info(it->value(), info)) continue;
 
         if (static_cast<Result>(info.result) == Result::UNKNOWN) {
             info.result = static_cast<uint8_t>(Result::DRAW);
 
-            std::string key(it->key().data(), it->key().size());
-            std::string value(reinterpret_cast<char*>(&info), sizeof(info));
-            batch.Put(cf_states_, key, value);
+            batch.Put(cf_states_, it->key(), encode_state_info(info));
             batch_count++;
             draws_marked++;
             ++num_draws_;
@@ -1924,43 +3191,183 @@ void RetrogradeSolverDB::propagate() {
 }
 
 Result RetrogradeSolverDB::get_result(const State& s) const {
-    auto [canonical, _] = canonicalize(s);
-    uint64_t packed = pack_state(canonical);
+    uint8_t dtw;
+    return get_result(s, dtw);
+}
+
+Result RetrogradeSolverDB::get_result(const State& s, uint8_t& dtw) const {
+    dtw = 0;
+    uint64_t packed = canonical_pack(s);
+    bool use_cache = read_only_ && result_cache_.enabled();
+    CachedResult cached;
+    if (use_cache && result_cache_.find(packed, cached)) {
+        dtw = cached.dtw;
+        return cached.result;
+    }
+
     int64_t id = get_state_id(packed);
     if (id >= 0) {
         StateInfoCompact info;
         if (get_state_info(id, info)) {
-            return static_cast<Result>(info.result);
+            cached.result = static_cast<Result>(info.result);
+            if (has_dtw_ && (cached.result == Result::WIN || cached.result == Result::LOSS)) {
+                cached.dtw = info.dtw;
+            }
         }
     }
-    return Result::UNKNOWN;
+    if (use_cache) result_cache_.insert(packed, cached);
+    dtw = cached.dtw;
+    return cached.result;
+}
+
+std::vector<Result> RetrogradeSolverDB::get_results(std::span<const State> states,
+                                                    std::vector<uint8_t>* dtw) const {
+    std::vector<Result> results(states.size(), Result::UNKNOWN);
+    if (dtw) dtw->assign(states.size(), 0);
+    if (states.empty()) return results;
+
+    // Cached states are answered directly; only the rest go to the database
+    bool use_cache = read_only_ && result_cache_.enabled();
+    std::vector<size_t> missing;
+    std::vector<uint64_t> packed;
+    missing.reserve(states.size());
+    packed.reserve(states.size());
+    for (size_t i = 0; i < states.size(); ++i) {
+        uint64_t p = canonical_pack(states[i]);
+        CachedResult cached;
+        if (use_cache && result_cache_.find(p, cached)) {
+            results[i] = cached.result;
+            if (dtw) (*dtw)[i] = cached.dtw;
+            continue;
+        }
+        missing.push_back(i);
+        packed.push_back(p);
+    }
+    if (missing.empty()) return results;
+
+    std::vector<int64_t> ids = batch_get_state_ids(packed);
+
+    // Only the states that have an id are looked up
+    std::vector<size_t> found;
+    std::vector<uint32_t> found_ids;
+    for (size_t m = 0; m < ids.size(); ++m) {
+        if (ids[m] < 0) continue;
+        found.push_back(missing[m]);
+        found_ids.push_back(static_cast<uint32_t>(ids[m]));
+    }
+    if (found.empty()) {
+        if (use_cache) {
+            for (uint64_t p : packed) result_cache_.insert(p, CachedResult{});
+        }
+        return results;
+    }
+
+    std::vector<std::string> key_storage;
+    std::vector<rocksdb::Slice> keys;
+    key_storage.reserve(found_ids.size());
+    keys.reserve(found_ids.size());
+    for (uint32_t id : found_ids) {
+        key_storage.push_back(state_key(id));
+        keys.emplace_back(key_storage.back());
+    }
+    std::vector<std::string> values(keys.size());
+    std::vector<rocksdb::ColumnFamilyHandle*> cfs(keys.size(), cf_states_);
+    std::vector<rocksdb::Status> statuses = db_->MultiGet(rocksdb::ReadOptions(), cfs, keys, &values);
+
+    std::vector<uint8_t> found_dtw(states.size(), 0);
+    for (size_t k = 0; k < found.size(); ++k) {
+        StateInfoCompact info;
+        if (!statuses[k].ok() || !decode_state_info(values[k], info)) continue;
+        Result r = static_cast<Result>(info.result);
+        results[found[k]] = r;
+        if (has_dtw_ && (r == Result::WIN || r == Result::LOSS)) found_dtw[found[k]] = info.dtw;
+    }
+
+    for (size_t m = 0; m < missing.size(); ++m) {
+        size_t i = missing[m];
+        if (dtw) (*dtw)[i] = found_dtw[i];
+        if (use_cache) result_cache_.insert(packed[m], CachedResult{results[i], found_dtw[i]});
+    }
+    return results;
 }
 
 Move RetrogradeSolverDB::get_best_move(const State& s) const {
+    if (!read_only_ || !best_move_cache_.enabled()) return find_best_move(s);
+
+    uint64_t packed = pack_state(s);
+    Move best;
+    if (!best_move_cache_.find(packed, best)) {
+        best = find_best_move(s);
+        best_move_cache_.insert(packed, best);
+    }
+    return best;
+}
+
+Move RetrogradeSolverDB::find_best_move(const State& s) const {
     Result my_result = get_result(s);
 
-    auto moves = generate_moves(s);
+    MoveList moves;
+    generate_moves(s, moves);
     if (moves.empty()) {
         return Move{};
     }
 
+    std::vector<State> children;
+    children.reserve(moves.size());
     for (const auto& move : moves) {
-        State ns = apply_move(s, move);
-        Result opp_result = get_result(ns);
+        children.push_back(apply_move(s, move));
+    }
+    std::vector<uint8_t> child_dtw;
+    std::vector<Result> child_results = get_results(children, &child_dtw);
+
+    // Win as fast as possible; when lost, hold out as long as possible.
+    // Without DTW every candidate ties and the first one is kept.
+    Move best = moves[0];
+    bool found = false;
+    uint8_t best_dtw = 0;
+
+    for (size_t i = 0; i < moves.size(); ++i) {
+        const Move& move = moves[i];
+        Result opp_result = child_results[i];
+        uint8_t opp_dtw = child_dtw[i];
 
         if (my_result == Result::WIN && opp_result == Result::LOSS) {
-            return move;
+            if (!found || opp_dtw < best_dtw) {
+                best = move;
+                best_dtw = opp_dtw;
+                found = true;
+            }
         }
         if (my_result == Result::DRAW && opp_result == Result::DRAW) {
             return move;
         }
         if (my_result == Result::LOSS) {
             if (opp_result == Result::DRAW) return move;
-            if (opp_result == Result::WIN) return move;
+            if (opp_result == Result::WIN && (!found || opp_dtw > best_dtw)) {
+                best = move;
+                best_dtw = opp_dtw;
+                found = true;
+            }
         }
     }
 
-    return moves[0];
+    return best;
+}
+
+void RetrogradeSolverDB::for_each_state(
+        const std::function<void(uint64_t packed, Result r, uint8_t dtw)>& fn) const {
+    rocksdb::ReadOptions read_opts;
+    read_opts.fill_cache = false;
+    read_opts.readahead_size = 2 * 1024 * 1024;
+    read_opts.total_order_seek = true;
+    std::unique_ptr<rocksdb::Iterator> it(db_->NewIterator(read_opts, cf_states_));
+
+    for (it->SeekToFirst(); it->Valid(); it->Next()) {
+        StateInfoCompact info;
+        if (!decode_state_info(it->value(), info)) continue;
+        Result r = static_cast<Result>(info.result);
+        fn(info.packed, r, has_dtw_ && (r == Result::WIN || r == Result::LOSS) ? info.dtw : 0);
+    }
 }
 
 Result RetrogradeSolverDB::starting_result() const {
@@ -1971,6 +3378,137 @@ Result RetrogradeSolverDB::starting_result() const {
     return Result::UNKNOWN;
 }
 
+bool RetrogradeSolverDB::migrate_states(const std::string& db_path, const ProgressCallback& progress) {
+    std::vector<std::string> names;
+    rocksdb::Status status = rocksdb::DB::ListColumnFamilies(rocksdb::DBOptions(), db_path, &names);
+    if (!status.ok()) {
+        std::cerr << "Failed to open database: " << status.ToString() << "\n";
+        return false;
+    }
+    if (std::find(names.begin(), names.end(), LEGACY_STATES_CF) == names.end()) {
+        std::cerr << "States are already in the current layout\n";
+        return true;
+    }
+
+    rocksdb::BlockBasedTableOptions table_options;
+    table_options.block_cache = rocksdb::NewLRUCache(512ULL * 1024 * 1024);
+    table_options.block_size = 32 * 1024;
+    rocksdb::ColumnFamilyOptions cf_opts;
+    cf_opts.table_factory.reset(rocksdb::NewBlockBasedTableFactory(table_options));
+
+    // Open every column family there is, plus the new states CF. A run
+    // that was interrupted left part of the new CF written; rewriting it
+    // from the start puts the same records again.
+    if (std::find(names.begin(), names.end(), STATES_CF) == names.end()) names.push_back(STATES_CF);
+    std::vector<rocksdb::ColumnFamilyDescriptor> cf_descs;
+    for (const auto& name : names) {
+        rocksdb::ColumnFamilyOptions opts = cf_opts;
+        if (name == STATES_CF) {
+            opts = states_cf_options(cf_opts, table_options);
+        } else if (name == "predecessors") {
+            opts.merge_operator = std::make_shared<PredecessorListMerge>();
+        }
+        cf_descs.emplace_back(name, opts);
+    }
+
+    rocksdb::DBOptions options;
+    options.create_missing_column_families = true;
+    options.IncreaseParallelism(std::max(2u, std::thread::hardware_concurrency()));
+
+    std::vector<rocksdb::ColumnFamilyHandle*> handles;
+    rocksdb::DB* db_ptr;
+    status = rocksdb::DB::Open(options, db_path, cf_descs, &handles, &db_ptr);
+    if (!status.ok()) {
+        std::cerr << "Failed to open database: " << status.ToString() << "\n";
+        return false;
+    }
+    std::unique_ptr<rocksdb::DB> db(db_ptr);
+    rocksdb::ColumnFamilyHandle* legacy = nullptr;
+    rocksdb::ColumnFamilyHandle* states = nullptr;
+    for (size_t i = 0; i < names.size(); ++i) {
+        if (names[i] == LEGACY_STATES_CF) legacy = handles[i];
+        if (names[i] == STATES_CF) states = handles[i];
+    }
+    auto close_db = [&]() {
+        for (auto* h : handles) db->DestroyColumnFamilyHandle(h);
+        handles.clear();
+        db.reset();
+    };
+
+    uint64_t num_states = 0;
+    {
+        std::string value;
+        for (size_t i = 0; i < names.size(); ++i) {
+            if (names[i] == "metadata" &&
+                db->Get(rocksdb::ReadOptions(), handles[i], "num_states", &value).ok() &&
+                value.size() == sizeof(num_states)) {
+                std::memcpy(&num_states, value.data(), sizeof(num_states));
+            }
+        }
+    }
+
+    // The old keys are host-endian ids, so the scan comes in no useful
+    // order; compaction sorts the new records by id afterwards
+    rocksdb::ReadOptions read_opts;
+    read_opts.fill_cache = false;
+    read_opts.readahead_size = 2 * 1024 * 1024;
+    std::unique_ptr<rocksdb::Iterator> it(db->NewIterator(read_opts, legacy));
+
+    rocksdb::WriteOptions write_opts;
+    write_opts.disableWAL = true;
+    rocksdb::WriteBatch batch;
+    uint64_t converted = 0;
+    uint64_t skipped = 0;
+
+    for (it->SeekToFirst(); it->Valid(); it->Next()) {
+        StateInfoCompact info;
+        if (it->key().size() != sizeof(uint32_t) || it->value().size() != sizeof(info)) {
+            ++skipped;
+            continue;
+        }
+        uint32_t id;
+        std::memcpy(&id, it->key().data(), sizeof(id));
+        std::memcpy(&info, it->value().data(), sizeof(info));
+        if (!is_canonical(unpack_state(info.packed))) {
+            std::cerr << "State " << id << " is not canonical; leaving the database as it was\n";
+            it.reset();
+            db->DropColumnFamily(states);
+            close_db();
+            return false;
+        }
+
+        batch.Put(states, state_key(id), encode_state_info(info));
+        if (batch.Count() >= 10000) {
+            status = db->Write(write_opts, &batch);
+            if (!status.ok()) break;
+            batch.Clear();
+        }
+        ++converted;
+        if (progress && converted % 1000000 == 0) progress("Converting states", converted, num_states);
+    }
+    if (status.ok()) status = it->status();
+    if (status.ok()) status = db->Write(write_opts, &batch);
+    it.reset();
+
+    // Make the new records durable and sorted before the old ones go
+    if (status.ok()) status = db->Flush(rocksdb::FlushOptions(), states);
+    if (status.ok()) {
+        if (progress) progress("Compacting states", 0, 0);
+        status = db->CompactRange(rocksdb::CompactRangeOptions(), states, nullptr, nullptr);
+    }
+    if (status.ok()) status = db->DropColumnFamily(legacy);
+    close_db();
+
+    if (!status.ok()) {
+        std::cerr << "Migration failed: " << status.ToString() << "\n";
+        return false;
+    }
+    std::cerr << "Converted " << converted << " states";
+    if (skipped) std::cerr << " (skipped " << skipped << " malformed records)";
+    std::cerr << "\n";
+    return true;
+}
+
 bool RetrogradeSolverDB::import_checkpoint(const std::string& checkpoint_file) {
     std::ifstream in(checkpoint_file, std::ios::binary);
     if (!in) {
@@ -2034,12 +3572,10 @@ bool RetrogradeSolverDB::import_checkpoint(const std::string& checkpoint_file) {
 
         uint32_t id = i;
 
-        std::string id_key(reinterpret_cast<char*>(&id), sizeof(id));
-        std::string info_val(reinterpret_cast<char*>(&info), sizeof(info));
         std::string packed_key(reinterpret_cast<char*>(&packed), sizeof(packed));
         std::string id_val(reinterpret_cast<char*>(&id), sizeof(id));
 
-        batch.Put(cf_states_, id_key, info_val);
+        batch.Put(cf_states_, state_key(id), encode_state_info(info));
         batch.Put(cf_packed_to_id_, packed_key, id_val);
 
         if ((i + 1) % BATCH_SIZE == 0) {
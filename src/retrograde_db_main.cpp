@@ -3,9 +3,14 @@
 #include "hash.h"
 #include "symmetry.h"
 #include "retrograde_db.h"
+#include "retrograde_bitmap.h"
+#include "retrograde_slices.h"
+#include "slice_cluster.h"
 #include <iostream>
+#include <charconv>
 #include <chrono>
 #include <iomanip>
+#include <memory>
 #include <string>
 #include <cstring>
 
@@ -16,16 +21,136 @@ void print_usage(const char* prog) {
               << "  --import FILE       Import from old checkpoint file\n"
               << "  --interval N        Save checkpoint every N states (default: 1000000)\n"
               << "  --threads N         Number of threads for parallel processing (default: 1)\n"
+              << "  --engine NAME       Storage engine: rocksdb (default), bitmap or slices\n"
+              << "                      (bitmap keeps 2-bit results for the whole rank space\n"
+              << "                      in a memory-mapped file inside --db, ~3.7GB; slices\n"
+              << "                      solves one Bobail row at a time in ~1.1GB and exchanges\n"
+              << "                      updates between rows through sorted runs on disk)\n"
+              << "  --pred-builder NAME Predecessor builder: streaming (default) or sort\n"
+              << "                      (sort spills sorted runs below --db and ingests SST files)\n"
+              << "  --unmoves           Skip building predecessors; propagate with retro moves\n"
+              << "  --cluster LIST      Slices engine: solve on several machines, LIST being every\n"
+              << "                      node's host:port in node order (at most 5; node 0\n"
+              << "                      coordinates and assembles the results)\n"
+              << "  --node N            This machine's index in --cluster (default: 0)\n"
+              << "  --metrics FILE      Append solver metrics as JSON lines to FILE (- for stderr)\n"
+              << "  --metrics-prom FILE Keep Prometheus text metrics in FILE\n"
+              << "  --metrics-interval SECS\n"
+              << "                      Seconds between metrics snapshots (default: 10)\n"
               << "  --official          Use Official rules (pawns must move max distance) [default]\n"
               << "  --flexible          Use Flexible rules (pawns can stop anywhere)\n"
               << "  --help              Show this help\n";
 }
 
+// Print solve statistics and the optimal line from the start
+template <typename Solver>
+void print_solution(const Solver& solver, long long ms) {
+    auto start = bobail::State::starting_position();
+    std::cout << "\n\n";
+    std::cout << "========================================\n";
+    std::cout << "SOLUTION COMPLETE\n";
+    std::cout << "========================================\n\n";
+
+    std::cout << "Time: " << ms / 1000.0 << " seconds\n";
+    std::cout << "Total states: " << solver.num_states() << "\n";
+    std::cout << "Wins:   " << solver.num_wins() << "\n";
+    std::cout << "Losses: " << solver.num_losses() << "\n";
+    std::cout << "Draws:  " << solver.num_draws() << "\n\n";
+
+    // Show result
+    bobail::Result result = solver.starting_result();
+    std::cout << "STARTING POSITION RESULT: ";
+    switch (result) {
+        case bobail::Result::WIN:
+            std::cout << "WHITE WINS with perfect play!\n";
+            break;
+        case bobail::Result::LOSS:
+            std::cout << "BLACK WINS with perfect play!\n";
+            break;
+        case bobail::Result::DRAW:
+            std::cout << "DRAW with perfect play!\n";
+            break;
+        default:
+            std::cout << "UNKNOWN\n";
+            break;
+    }
+
+    // Show optimal opening moves
+    std::cout << "\nOptimal play from start:\n";
+    auto state = start;
+    for (int ply = 0; ply < 20; ++ply) {
+        bobail::Result r = solver.get_result(state);
+        bobail::Move best = solver.get_best_move(state);
+
+        std::cout << (ply + 1) << ". ";
+        if (state.white_to_move) std::cout << "White: ";
+        else std::cout << "Black: ";
+
+        std::cout << best.to_string();
+        std::cout << " (";
+        switch (r) {
+            case bobail::Result::WIN: std::cout << "WIN"; break;
+            case bobail::Result::LOSS: std::cout << "LOSS"; break;
+            case bobail::Result::DRAW: std::cout << "DRAW"; break;
+            default: std::cout << "?"; break;
+        }
+        if constexpr (requires { solver.has_dtw(); }) {
+            uint8_t dtw;
+            solver.get_result(state, dtw);
+            if (solver.has_dtw() && (r == bobail::Result::WIN || r == bobail::Result::LOSS)) {
+                std::cout << " in " << static_cast<int>(dtw);
+            }
+        }
+        std::cout << ")\n";
+
+        state = bobail::apply_move(state, best);
+
+        // Check if game over
+        if (bobail::check_terminal(state) != bobail::GameResult::ONGOING) {
+            std::cout << "\nGame over!\n";
+            std::cout << state.to_string();
+            break;
+        }
+
+        auto moves = bobail::generate_moves(state);
+        if (moves.empty()) {
+            std::cout << "\nNo moves - game over!\n";
+            break;
+        }
+    }
+}
+
+// Same progress display for both engines
+void print_progress(const char* phase, uint64_t current, uint64_t total) {
+    if (total > 0) {
+        double pct = 100.0 * current / total;
+        std::cout << "\r" << phase << ": " << current << " / " << total
+                  << " (" << std::fixed << std::setprecision(1) << pct << "%)" << std::flush;
+    } else {
+        std::cout << "\r" << phase << ": " << current << " states" << std::flush;
+    }
+}
+
+// Whole argument as a non-negative number; false on anything else
+bool parse_count(const char* arg, int& value) {
+    const char* end = arg + std::strlen(arg);
+    auto [ptr, ec] = std::from_chars(arg, end, value);
+    return ec == std::errc() && ptr == end && ptr != arg && value >= 0;
+}
+
 int main(int argc, char* argv[]) {
     std::string db_path;
     std::string import_file;
     uint64_t checkpoint_interval = 1000000;
     int num_threads = 1;
+    std::string engine = "rocksdb";
+    bool use_unmoves = false;
+    std::string pred_builder;  // Empty: streaming
+    std::string metrics_json;
+    std::string metrics_prom;
+    double metrics_interval = 10;
+    std::string cluster;
+    int node = 0;
 
     // Parse arguments
     for (int i = 1; i < argc; ++i) {
@@ -61,6 +186,68 @@ int main(int argc, char* argv[]) {
                 std::cerr << "Error: --threads requires a number\n";
                 return 1;
             }
+        } else if (std::strcmp(argv[i], "--engine") == 0 || std::strncmp(argv[i], "--engine=", 9) == 0) {
+            if (argv[i][8] == '=') {
+                engine = argv[i] + 9;
+            } else if (i + 1 < argc) {
+                engine = argv[++i];
+            } else {
+                std::cerr << "Error: --engine requires a name\n";
+                return 1;
+            }
+            if (engine != "rocksdb" && engine != "bitmap" && engine != "slices") {
+                std::cerr << "Error: unknown engine '" << engine << "' (expected rocksdb, bitmap or slices)\n";
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--pred-builder") == 0 || std::strncmp(argv[i], "--pred-builder=", 15) == 0) {
+            if (argv[i][14] == '=') {
+                pred_builder = argv[i] + 15;
+            } else if (i + 1 < argc) {
+                pred_builder = argv[++i];
+            } else {
+                std::cerr << "Error: --pred-builder requires a name\n";
+                return 1;
+            }
+            if (pred_builder != "streaming" && pred_builder != "sort") {
+                std::cerr << "Error: unknown predecessor builder '" << pred_builder
+                          << "' (expected streaming or sort)\n";
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--metrics") == 0) {
+            if (i + 1 < argc) {
+                metrics_json = argv[++i];
+            } else {
+                std::cerr << "Error: --metrics requires a file\n";
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--metrics-prom") == 0) {
+            if (i + 1 < argc) {
+                metrics_prom = argv[++i];
+            } else {
+                std::cerr << "Error: --metrics-prom requires a file\n";
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--metrics-interval") == 0) {
+            if (i + 1 < argc) {
+                metrics_interval = std::stod(argv[++i]);
+            } else {
+                std::cerr << "Error: --metrics-interval requires a value\n";
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--cluster") == 0) {
+            if (i + 1 < argc) {
+                cluster = argv[++i];
+            } else {
+                std::cerr << "Error: --cluster requires a list of host:port\n";
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--node") == 0) {
+            if (i + 1 >= argc || !parse_count(argv[++i], node)) {
+                std::cerr << "Error: --node requires a number\n";
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--unmoves") == 0) {
+            use_unmoves = true;
         } else if (std::strcmp(argv[i], "--official") == 0) {
             bobail::g_rules_variant = bobail::RulesVariant::OFFICIAL;
         } else if (std::strcmp(argv[i], "--flexible") == 0) {
@@ -96,8 +283,101 @@ int main(int argc, char* argv[]) {
     std::cout << "Starting position:\n";
     std::cout << start.to_string() << "\n";
 
+    if (engine != "rocksdb") {
+        if (!import_file.empty()) {
+            std::cerr << "Error: --import is not supported with the " << engine << " engine\n";
+            return 1;
+        }
+        if (!metrics_json.empty() || !metrics_prom.empty()) {
+            std::cerr << "Error: metrics are only collected by the rocksdb engine\n";
+            return 1;
+        }
+        if (use_unmoves || !pred_builder.empty()) {
+            std::cerr << "Error: --unmoves and --pred-builder only apply to the rocksdb engine\n";
+            return 1;
+        }
+    }
+
+    if (!cluster.empty() && engine != "slices") {
+        std::cerr << "Error: --cluster needs the slices engine\n";
+        return 1;
+    }
+    if (node != 0 && cluster.empty()) {
+        std::cerr << "Error: --node needs --cluster\n";
+        return 1;
+    }
+
+    if (engine == "slices") {
+        std::unique_ptr<bobail::SliceCluster> exchange;
+        if (!cluster.empty()) {
+            std::vector<std::string> peers;
+            if (!bobail::parse_cluster_peers(cluster, peers)) {
+                std::cerr << "Error: --cluster expects 1 to " << bobail::NUM_SLICES
+                          << " distinct host:port entries separated by commas\n";
+                return 1;
+            }
+            if (node >= static_cast<int>(peers.size())) {
+                std::cerr << "Error: --node must be below the " << peers.size() << " nodes of --cluster\n";
+                return 1;
+            }
+            exchange = std::make_unique<bobail::SliceCluster>(node, peers, db_path);
+        }
+
+        bobail::RetrogradeSolverSlices solver;
+        solver.set_exchange(exchange.get());
+        std::cout << "Opening slice solver in: " << db_path << "\n";
+        if (!solver.open(db_path)) {
+            std::cerr << "Failed to open slice solver\n";
+            return 1;
+        }
+        if (exchange && !exchange->start()) return 1;
+
+        std::cout << "Threads: " << num_threads << "\n\n";
+        solver.set_num_threads(num_threads);
+        solver.set_progress_callback(print_progress);
+
+        std::cout << "Starting retrograde analysis (slice engine)...\n\n";
+        auto t0 = std::chrono::high_resolution_clock::now();
+        if (!solver.solve()) return 1;
+        auto t1 = std::chrono::high_resolution_clock::now();
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count();
+
+        if (exchange && !exchange->assembles()) {
+            std::cout << "\nSlices handed to node 0 after " << ms / 1000 << "s; the results are assembled there\n";
+        } else {
+            print_solution(solver, ms);
+        }
+        solver.close();
+        return 0;
+    }
+
+    if (engine == "bitmap") {
+        bobail::RetrogradeSolverBitmap solver;
+        std::cout << "Opening result bitmap in: " << db_path << "\n";
+        if (!solver.open(db_path)) {
+            std::cerr << "Failed to open result bitmap\n";
+            return 1;
+        }
+
+        std::cout << "Threads: " << num_threads << "\n\n";
+        solver.set_num_threads(num_threads);
+        solver.set_progress_callback(print_progress);
+
+        std::cout << "Starting retrograde analysis (bitmap engine)...\n\n";
+        auto t0 = std::chrono::high_resolution_clock::now();
+        solver.solve();
+        auto t1 = std::chrono::high_resolution_clock::now();
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count();
+
+        print_solution(solver, ms);
+        solver.close();
+        return 0;
+    }
+
     // Create solver
     bobail::RetrogradeSolverDB solver;
+    bool metrics = !metrics_json.empty() || !metrics_prom.empty();
+    solver.set_collect_statistics(metrics);
 
     std::cout << "Opening database: " << db_path << "\n";
     if (!solver.open(db_path)) {
@@ -121,91 +401,29 @@ int main(int argc, char* argv[]) {
 
     solver.set_checkpoint_interval(checkpoint_interval);
     solver.set_num_threads(num_threads);
+    if (use_unmoves) solver.set_use_unmoves(true);
+    if (pred_builder == "sort") solver.set_predecessor_builder(bobail::PredecessorBuilder::SORTED);
 
     // Progress callback
-    solver.set_progress_callback([](const char* phase, uint64_t current, uint64_t total) {
-        if (total > 0) {
-            double pct = 100.0 * current / total;
-            std::cout << "\r" << phase << ": " << current << " / " << total
-                      << " (" << std::fixed << std::setprecision(1) << pct << "%)" << std::flush;
-        } else {
-            std::cout << "\r" << phase << ": " << current << " states" << std::flush;
-        }
-    });
+    solver.set_progress_callback(print_progress);
+
+    std::unique_ptr<bobail::MetricsReporter> reporter;
+    if (metrics) {
+        reporter = std::make_unique<bobail::MetricsReporter>(
+            [&solver] { return solver.metrics_snapshot(); },
+            metrics_json, metrics_prom, "bobail_retrograde", metrics_interval);
+    }
 
     std::cout << "Starting retrograde analysis...\n\n";
     auto t0 = std::chrono::high_resolution_clock::now();
 
     solver.solve();
+    reporter.reset();
 
     auto t1 = std::chrono::high_resolution_clock::now();
     auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count();
 
-    std::cout << "\n\n";
-    std::cout << "========================================\n";
-    std::cout << "SOLUTION COMPLETE\n";
-    std::cout << "========================================\n\n";
-
-    std::cout << "Time: " << ms / 1000.0 << " seconds\n";
-    std::cout << "Total states: " << solver.num_states() << "\n";
-    std::cout << "Wins:   " << solver.num_wins() << "\n";
-    std::cout << "Losses: " << solver.num_losses() << "\n";
-    std::cout << "Draws:  " << solver.num_draws() << "\n\n";
-
-    // Show result
-    bobail::Result result = solver.starting_result();
-    std::cout << "STARTING POSITION RESULT: ";
-    switch (result) {
-        case bobail::Result::WIN:
-            std::cout << "WHITE WINS with perfect play!\n";
-            break;
-        case bobail::Result::LOSS:
-            std::cout << "BLACK WINS with perfect play!\n";
-            break;
-        case bobail::Result::DRAW:
-            std::cout << "DRAW with perfect play!\n";
-            break;
-        default:
-            std::cout << "UNKNOWN\n";
-            break;
-    }
-
-    // Show optimal opening moves
-    std::cout << "\nOptimal play from start:\n";
-    auto state = start;
-    for (int ply = 0; ply < 20; ++ply) {
-        bobail::Result r = solver.get_result(state);
-        bobail::Move best = solver.get_best_move(state);
-
-        std::cout << (ply + 1) << ". ";
-        if (state.white_to_move) std::cout << "White: ";
-        else std::cout << "Black: ";
-
-        std::cout << best.to_string();
-        std::cout << " (";
-        switch (r) {
-            case bobail::Result::WIN: std::cout << "WIN"; break;
-            case bobail::Result::LOSS: std::cout << "LOSS"; break;
-            case bobail::Result::DRAW: std::cout << "DRAW"; break;
-            default: std::cout << "?"; break;
-        }
-        std::cout << ")\n";
-
-        state = bobail::apply_move(state, best);
-
-        // Check if game over
-        if (bobail::check_terminal(state) != bobail::GameResult::ONGOING) {
-            std::cout << "\nGame over!\n";
-            std::cout << state.to_string();
-            break;
-        }
-
-        auto moves = bobail::generate_moves(state);
-        if (moves.empty()) {
-            std::cout << "\nNo moves - game over!\n";
-            break;
-        }
-    }
+    print_solution(solver, ms);
 
     solver.close();
     return 0;
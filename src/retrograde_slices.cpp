@@ -0,0 +1,889 @@
+#include "retrograde_slices.h"
+#include "symmetry.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <queue>
+#include <thread>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace bobail {
+
+size_t count_external_moves(const State& s) {
+    MoveList moves;
+    generate_moves(s, moves);
+    int row = State::row(s.bobail_sq);
+    size_t n = 0;
+    for (const Move& m : moves) {
+        if (State::row(m.bobail_to) != row) ++n;
+    }
+    return n;
+}
+
+void external_parent_ranks(uint64_t canonical, std::vector<uint64_t>& out, const RankSpace& space) {
+    out.clear();
+    thread_local std::vector<uint64_t> parents;
+    generate_canonical_unmoves(canonical, parents);
+
+    int row = State::row(unpack_state(canonical).bobail_sq);
+    for (uint64_t p : parents) {
+        State parent = unpack_state(p);
+        if (State::row(parent.bobail_sq) != row) out.push_back(space.rank_canonical(parent));
+    }
+}
+
+std::string update_run_name(int dest, uint64_t visit) {
+    return std::to_string(dest) + "_" + std::to_string(visit) + ".run";
+}
+
+bool parse_update_run_name(const std::string& name, int& dest, uint64_t& visit) {
+    unsigned long long v;
+    int consumed = 0;
+    if (std::sscanf(name.c_str(), "%d_%llu.run%n", &dest, &v, &consumed) != 2 ||
+        consumed != static_cast<int>(name.size()) || dest < 0 || dest >= NUM_SLICES || v == 0) {
+        return false;
+    }
+    visit = v;
+    return true;
+}
+
+namespace {
+    constexpr uint64_t SWEEP_CHUNK = 1ULL << 20;
+    constexpr size_t CHECK_BATCH = 1 << 20;
+    constexpr const char* HEADER_FILE = "/slices.state";
+    constexpr const char* RESULT_FILE = "/results.bitmap";
+    constexpr const char* UPDATE_DIR = "/updates";
+
+    uint8_t get_cell(uint64_t* words, uint64_t i) {
+        uint64_t w = std::atomic_ref<uint64_t>(words[i >> 5]).load(std::memory_order_relaxed);
+        return static_cast<uint8_t>((w >> ((i & 31) * 2)) & 3);
+    }
+
+    // Same compare-and-swap as ResultBitmap::set
+    bool set_cell(uint64_t* words, uint64_t i, uint8_t code) {
+        int shift = static_cast<int>(i & 31) * 2;
+        std::atomic_ref<uint64_t> word(words[i >> 5]);
+        uint64_t w = word.load(std::memory_order_relaxed);
+        do {
+            if ((w >> shift) & 3) return false;
+        } while (!word.compare_exchange_weak(w, w | (static_cast<uint64_t>(code) << shift),
+                                             std::memory_order_relaxed));
+        return true;
+    }
+
+    bool write_all(int fd, const void* data, size_t bytes) {
+        const char* p = static_cast<const char*>(data);
+        while (bytes > 0) {
+            ssize_t n = ::write(fd, p, bytes);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                return false;
+            }
+            p += n;
+            bytes -= static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    // Write `bytes` to `path` and flush them to disk
+    bool write_file(const std::string& path, const void* data, size_t bytes) {
+        int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        bool ok = fd >= 0 && write_all(fd, data, bytes);
+        ok = ok && ::fdatasync(fd) == 0;
+        if (fd >= 0) ok = ::close(fd) == 0 && ok;
+        if (!ok) std::cerr << "Failed to write " << path << ": " << std::strerror(errno) << "\n";
+        return ok;
+    }
+
+    // Buffered sequential writer of one update run
+    class RunWriter {
+    public:
+        explicit RunWriter(const std::string& path) : path_(path), file_(std::fopen(path.c_str(), "wb")) {
+            buf_.reserve(1 << 16);
+        }
+        ~RunWriter() { if (file_) std::fclose(file_); }
+
+        RunWriter(const RunWriter&) = delete;
+        RunWriter& operator=(const RunWriter&) = delete;
+
+        bool ok() const { return file_ != nullptr && ok_; }
+        uint64_t count() const { return count_; }
+
+        void push(uint64_t update) {
+            buf_.push_back(update);
+            ++count_;
+            if (buf_.size() == buf_.capacity()) flush();
+        }
+
+        bool finish() {
+            flush();
+            if (!file_) return false;
+            ok_ = ok_ && std::fflush(file_) == 0 && ::fdatasync(fileno(file_)) == 0;
+            ok_ = std::fclose(file_) == 0 && ok_;
+            file_ = nullptr;
+            if (!ok_) std::cerr << "Failed to write update run " << path_ << "\n";
+            return ok_;
+        }
+
+    private:
+        void flush() {
+            if (file_ && !buf_.empty()) {
+                ok_ = ok_ && std::fwrite(buf_.data(), sizeof(uint64_t), buf_.size(), file_) == buf_.size();
+            }
+            buf_.clear();
+        }
+
+        std::string path_;
+        FILE* file_;
+        std::vector<uint64_t> buf_;
+        uint64_t count_ = 0;
+        bool ok_ = true;
+    };
+
+    // Buffered sequential reader over one update run
+    class RunReader {
+    public:
+        explicit RunReader(const std::string& path) : file_(std::fopen(path.c_str(), "rb")), buf_(1 << 14) {}
+        ~RunReader() { if (file_) std::fclose(file_); }
+
+        RunReader(const RunReader&) = delete;
+        RunReader& operator=(const RunReader&) = delete;
+
+        bool ok() const { return file_ != nullptr; }
+
+        bool next(uint64_t& update) {
+            if (pos_ == len_) {
+                len_ = std::fread(buf_.data(), sizeof(uint64_t), buf_.size(), file_);
+                pos_ = 0;
+                if (len_ == 0) return false;
+            }
+            update = buf_[pos_++];
+            return true;
+        }
+
+    private:
+        FILE* file_;
+        std::vector<uint64_t> buf_;
+        size_t pos_ = 0;
+        size_t len_ = 0;
+    };
+
+    // k-way merge of update runs sorted by rank; calls sink(update) once
+    // per position, with all of its updates combined
+    template <typename Sink>
+    bool merge_update_runs(const std::vector<std::string>& paths, Sink&& sink) {
+        std::vector<std::unique_ptr<RunReader>> readers;
+        std::vector<uint64_t> heads;
+        using HeapItem = std::pair<uint64_t, size_t>;
+        std::priority_queue<HeapItem, std::vector<HeapItem>, std::greater<HeapItem>> heap;
+
+        for (const auto& path : paths) {
+            readers.push_back(std::make_unique<RunReader>(path));
+            if (!readers.back()->ok()) {
+                std::cerr << "Failed to open update run " << path << "\n";
+                return false;
+            }
+            heads.push_back(0);
+            if (readers.back()->next(heads.back())) heap.emplace(update_rank(heads.back()), readers.size() - 1);
+        }
+
+        bool have = false;
+        uint64_t current = 0;
+        while (!heap.empty()) {
+            auto [rank, src] = heap.top();
+            heap.pop();
+            uint64_t u = heads[src];
+            if (readers[src]->next(heads[src])) heap.emplace(update_rank(heads[src]), src);
+
+            if (have && update_rank(current) == rank) {
+                current = combine_updates(current, u);
+                continue;
+            }
+            if (have && !sink(current)) return false;
+            current = u;
+            have = true;
+        }
+        return !have || sink(current);
+    }
+
+    // Sort by rank, combine, and write a run
+    bool write_update_run(const std::string& path, std::vector<uint64_t>& updates) {
+        std::sort(updates.begin(), updates.end(), [](uint64_t a, uint64_t b) {
+            return update_rank(a) < update_rank(b);
+        });
+        RunWriter out(path);
+        if (!out.ok()) return false;
+        for (size_t i = 0; i < updates.size();) {
+            uint64_t u = updates[i++];
+            while (i < updates.size() && update_rank(updates[i]) == update_rank(u)) {
+                u = combine_updates(u, updates[i++]);
+            }
+            out.push(u);
+        }
+        return out.finish();
+    }
+}
+
+RetrogradeSolverSlices::~RetrogradeSolverSlices() {
+    close();
+}
+
+std::string RetrogradeSolverSlices::slice_path(int slice, uint64_t version) const {
+    return path_ + "/slice_" + std::to_string(slice) + "_" + std::to_string(version) + ".bits";
+}
+
+std::string RetrogradeSolverSlices::update_dir() const {
+    return path_ + UPDATE_DIR;
+}
+
+std::string RetrogradeSolverSlices::run_path(int dest, uint64_t visit) const {
+    return update_dir() + "/" + update_run_name(dest, visit);
+}
+
+std::vector<std::pair<uint64_t, std::string>> RetrogradeSolverSlices::runs_for(int dest) {
+    // Runs from other machines arrive out of visit order, so what has
+    // been applied is tracked per source slice
+    std::vector<std::pair<uint64_t, std::string>> runs;
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator(update_dir(), ec)) {
+        int d;
+        uint64_t visit;
+        if (!parse_update_run_name(entry.path().filename().string(), d, visit) || d != dest) continue;
+        if (visit > header_.consumed[dest][visit_slice(visit)]) {
+            runs.emplace_back(visit, entry.path().string());
+        } else {
+            std::filesystem::remove(entry.path(), ec);  // A copy delivered twice
+        }
+    }
+    std::sort(runs.begin(), runs.end());
+    return runs;
+}
+
+bool RetrogradeSolverSlices::open(const std::string& path) {
+    close();
+    path_ = path;
+
+    std::error_code ec;
+    std::filesystem::create_directories(path_ + UPDATE_DIR, ec);
+    if (ec) {
+        std::cerr << "Failed to create directory " << path_ << UPDATE_DIR << ": " << ec.message() << "\n";
+        return false;
+    }
+
+    const uint32_t node = exchange_ ? static_cast<uint32_t>(exchange_->node()) : 0;
+    const uint32_t num_nodes = exchange_ ? static_cast<uint32_t>(exchange_->num_nodes()) : 1;
+
+    std::string header_path = path_ + HEADER_FILE;
+    FILE* f = std::fopen(header_path.c_str(), "rb");
+    if (f) {
+        bool ok = std::fread(&header_, sizeof(header_), 1, f) == 1;
+        std::fclose(f);
+        if (!ok || header_.magic != MAGIC || header_.version != VERSION) {
+            std::cerr << "Slice state " << header_path << " has an unrecognized header\n";
+            return false;
+        }
+        if (header_.rules_variant != static_cast<uint32_t>(g_rules_variant)) {
+            std::cerr << "Slices were solved with "
+                      << (header_.rules_variant == static_cast<uint32_t>(RulesVariant::OFFICIAL) ? "official" : "flexible")
+                      << " rules; pass the matching rules flag\n";
+            return false;
+        }
+        if (header_.pawns != static_cast<uint32_t>(space_.pawns())) {
+            std::cerr << "Slices hold a rank space of " << header_.pawns << " pawns per side, not "
+                      << space_.pawns() << "\n";
+            return false;
+        }
+        // Another node's directory holds other slices, and another cluster
+        // size splits them differently
+        if (header_.node != node || header_.num_nodes != num_nodes) {
+            std::cerr << "Slice state belongs to node " << header_.node << " of " << header_.num_nodes
+                      << ", not node " << node << " of " << num_nodes << "\n";
+            return false;
+        }
+    } else {
+        header_ = SliceSolveHeader{};
+        header_.magic = MAGIC;
+        header_.version = VERSION;
+        header_.rules_variant = static_cast<uint32_t>(g_rules_variant);
+        header_.pawns = static_cast<uint32_t>(space_.pawns());
+        header_.node = node;
+        header_.num_nodes = num_nodes;
+        header_.phase = static_cast<uint32_t>(SolvePhase::NOT_STARTED);
+        if (!save_header()) return false;
+    }
+
+    open_ = true;
+    remove_stale_files();
+
+    if (current_phase() == SolvePhase::COMPLETE && std::filesystem::exists(path_ + RESULT_FILE) &&
+        !results_.open(path_ + RESULT_FILE, space_.size())) {
+        open_ = false;
+        return false;
+    }
+
+    std::cout << "Opened slice solver: " << NUM_SLICES << " slices of " << slice_cells_ << " positions, "
+              << (slice_cells_ / 8 * 3) / (1024 * 1024) << " MB per slice in memory\n";
+    std::cout << "  Phase: " << header_.phase << ", rounds completed: " << header_.round
+              << ", next slice: " << header_.next_slice << "\n";
+    return true;
+}
+
+void RetrogradeSolverSlices::close() {
+    results_.close();
+    open_ = false;
+    slice_ = -1;
+    cells_ = {};
+    complete_ = {};
+    outbox_.clear();
+}
+
+bool RetrogradeSolverSlices::save_header() {
+    std::string final_path = path_ + HEADER_FILE;
+    std::string tmp_path = final_path + ".tmp";
+    if (!write_file(tmp_path, &header_, sizeof(header_))) return false;
+    if (std::rename(tmp_path.c_str(), final_path.c_str()) != 0) {
+        std::cerr << "Failed to commit " << final_path << ": " << std::strerror(errno) << "\n";
+        return false;
+    }
+    return true;
+}
+
+void RetrogradeSolverSlices::remove_stale_files() {
+    // Anything a visit wrote before it was committed, and runs already applied
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator(update_dir(), ec)) {
+        int dest;
+        uint64_t visit;
+        bool committed = parse_update_run_name(entry.path().filename().string(), dest, visit) &&
+                         visit <= header_.visits && visit > header_.consumed[dest][visit_slice(visit)];
+        if (!committed) std::filesystem::remove(entry.path(), ec);
+    }
+    for (const auto& entry : std::filesystem::directory_iterator(path_, ec)) {
+        std::string name = entry.path().filename().string();
+        int slice;
+        unsigned long long version;
+        char tail;
+        if (std::sscanf(name.c_str(), "slice_%d_%llu.bit%c", &slice, &version, &tail) == 3 &&
+            (slice < 0 || slice >= NUM_SLICES || version != header_.slice_version[slice])) {
+            std::filesystem::remove(entry.path(), ec);
+        }
+    }
+}
+
+uint64_t RetrogradeSolverSlices::parallel_sweep(
+        const char* phase, const std::function<uint64_t(int, uint64_t, uint64_t)>& fn) {
+    const uint64_t num_chunks = (slice_cells_ + SWEEP_CHUNK - 1) / SWEEP_CHUNK;
+    std::atomic<uint64_t> next_chunk{0};
+    std::atomic<uint64_t> chunks_done{0};
+    std::atomic<uint64_t> total{0};
+    std::atomic<int> workers_done{0};
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < num_threads_; ++t) {
+        workers.emplace_back([&, t]() {
+            uint64_t local = 0;
+            for (;;) {
+                uint64_t chunk = next_chunk.fetch_add(1);
+                if (chunk >= num_chunks) break;
+                uint64_t first = chunk * SWEEP_CHUNK;
+                uint64_t last = std::min(first + SWEEP_CHUNK, slice_cells_);
+                local += fn(t, first, last);
+                chunks_done.fetch_add(1);
+            }
+            total.fetch_add(local);
+            workers_done.fetch_add(1);
+        });
+    }
+
+    auto last_report = std::chrono::steady_clock::now();
+    while (workers_done.load() < num_threads_) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        auto now = std::chrono::steady_clock::now();
+        if (progress_cb_ && now - last_report >= std::chrono::seconds(1)) {
+            progress_cb_(phase, std::min(chunks_done.load() * SWEEP_CHUNK, slice_cells_), slice_cells_);
+            last_report = now;
+        }
+    }
+    for (auto& w : workers) {
+        w.join();
+    }
+    if (progress_cb_) {
+        progress_cb_(phase, slice_cells_, slice_cells_);
+    }
+    return total.load();
+}
+
+bool RetrogradeSolverSlices::load_slice(int slice) {
+    slice_ = slice;
+    cells_.assign(slice_words_, 0);
+
+    uint64_t version = header_.slice_version[slice];
+    if (version == 0) return true;  // Never visited: all unknown
+
+    std::string p = slice_path(slice, version);
+    int fd = ::open(p.c_str(), O_RDONLY);
+    bool ok = fd >= 0;
+    char* dst = reinterpret_cast<char*>(cells_.data());
+    size_t left = slice_words_ * sizeof(uint64_t);
+    while (ok && left > 0) {
+        ssize_t n = ::read(fd, dst, left);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            ok = false;
+            break;
+        }
+        dst += n;
+        left -= static_cast<size_t>(n);
+    }
+    if (fd >= 0) ::close(fd);
+    if (!ok) std::cerr << "Failed to read slice results " << p << "\n";
+    return ok;
+}
+
+bool RetrogradeSolverSlices::save_slice() {
+    return write_file(slice_path(slice_, visit_), cells_.data(), slice_words_ * sizeof(uint64_t));
+}
+
+void RetrogradeSolverSlices::resolved(int worker, const State& s, uint8_t code) {
+    if (code != BITMAP_WIN && code != BITMAP_LOSS) return;
+
+    // Parents in this slice see the result in the next sweep; the others
+    // are told through update runs
+    thread_local std::vector<uint64_t> parents;
+    external_parent_ranks(pack_state(s), parents, space_);
+
+    uint64_t update = code == BITMAP_LOSS ? UPDATE_LOST_SUCCESSOR : 1ULL << UPDATE_COUNT_SHIFT;
+    for (uint64_t rank : parents) {
+        int dest = slice_of(rank);
+        auto& box = outbox_[worker][dest];
+        box.push_back(rank | update);
+        if (box.size() >= spill_updates_) spill(worker, dest);
+    }
+}
+
+bool RetrogradeSolverSlices::spill(int worker, int dest) {
+    auto& box = outbox_[worker][dest];
+    if (box.empty()) return true;
+
+    std::string p = path_ + UPDATE_DIR + "/spill_" + std::to_string(dest) + "_" +
+                    std::to_string(spill_seq_.fetch_add(1)) + ".run";
+    bool ok = write_update_run(p, box);
+    box.clear();
+    if (!ok) {
+        io_failed_ = true;
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(spill_mutex_);
+    spills_[dest].push_back(p);
+    return true;
+}
+
+bool RetrogradeSolverSlices::merge_spills() {
+    for (int w = 0; w < num_threads_; ++w) {
+        for (int dest = 0; dest < NUM_SLICES; ++dest) {
+            if (!spill(w, dest)) return false;
+        }
+    }
+
+    for (int dest = 0; dest < NUM_SLICES; ++dest) {
+        if (spills_[dest].empty()) continue;
+        RunWriter out(run_path(dest, visit_));
+        bool ok = out.ok() && merge_update_runs(spills_[dest], [&](uint64_t u) {
+            out.push(u);
+            return true;
+        });
+        ok = out.finish() && ok;
+        if (!ok) return false;
+        std::cout << "  " << out.count() << " updates for slice " << dest << "\n";
+
+        for (const auto& p : spills_[dest]) std::remove(p.c_str());
+        spills_[dest].clear();
+    }
+    return true;
+}
+
+bool RetrogradeSolverSlices::apply_updates(const std::string& pending_path) {
+    std::vector<std::string> inputs;
+    for (const auto& [visit, p] : runs_for(slice_)) inputs.push_back(p);
+    if (inputs.empty()) return true;
+
+    const uint64_t base = static_cast<uint64_t>(slice_) * slice_cells_;
+    RunWriter pending(pending_path);
+    if (!pending.ok()) return false;
+
+    // Won-successor counts are checked against the number of external
+    // moves in parallel batches; all of them stay pending until the
+    // position is resolved, since counts keep adding up over the visits
+    std::vector<uint64_t> batch;
+    batch.reserve(CHECK_BATCH);
+    uint64_t won = 0, applied = 0;
+
+    auto check_batch = [&]() {
+        std::vector<std::thread> threads;
+        for (int t = 0; t < num_threads_; ++t) {
+            threads.emplace_back([&, t]() {
+                for (size_t i = t; i < batch.size(); i += num_threads_) {
+                    uint64_t rank = update_rank(batch[i]);
+                    if (count_external_moves(space_.unrank(rank)) == update_won_successors(batch[i])) {
+                        uint64_t cell = rank - base;
+                        std::atomic_ref<uint64_t>(complete_[cell >> 6]).fetch_or(1ULL << (cell & 63),
+                                                                                 std::memory_order_relaxed);
+                    }
+                }
+            });
+        }
+        for (auto& th : threads) th.join();
+        for (uint64_t u : batch) pending.push(u);
+        batch.clear();
+    };
+
+    bool ok = merge_update_runs(inputs, [&](uint64_t u) {
+        uint64_t cell = update_rank(u) - base;
+        if (get_cell(cells_.data(), cell) != BITMAP_UNKNOWN) return true;
+        ++applied;
+        if (u & UPDATE_LOST_SUCCESSOR) {
+            // A move reaches a position lost for the opponent
+            set_cell(cells_.data(), cell, BITMAP_WIN);
+            resolved(0, space_.unrank(update_rank(u)), BITMAP_WIN);
+            ++won;
+            return true;
+        }
+        batch.push_back(u);
+        if (batch.size() == CHECK_BATCH) check_batch();
+        return true;
+    });
+    check_batch();
+    ok = pending.finish() && ok;
+
+    resolved_ += won;
+    std::cout << "  Applied updates to " << applied << " positions from " << inputs.size()
+              << " runs, " << won << " won\n";
+    return ok;
+}
+
+bool RetrogradeSolverSlices::resolve(int worker, uint64_t cell, const State& s, bool terminals) {
+    uint8_t code = BITMAP_UNKNOWN;
+
+    if (terminals) {
+        GameResult gr = check_terminal(s);
+        if (gr == GameResult::WHITE_WINS) {
+            code = s.white_to_move ? BITMAP_WIN : BITMAP_LOSS;
+        } else if (gr == GameResult::BLACK_WINS) {
+            code = s.white_to_move ? BITMAP_LOSS : BITMAP_WIN;
+        } else if (count_moves(s) == 0) {
+            code = BITMAP_LOSS;  // No legal moves - side to move loses
+        }
+    }
+
+    if (code == BITMAP_UNKNOWN) {
+        MoveList moves;
+        generate_moves(s, moves);
+        if (moves.empty()) return false;
+
+        // Only successors in this slice are looked at; the external ones
+        // count through the won-successor updates
+        const int row = State::row(s.bobail_sq);
+        std::array<uint64_t, MAX_MOVES> successors;
+        size_t n = 0;
+        bool external = false;
+        for (const Move& m : moves) {
+            if (State::row(m.bobail_to) == row) {
+                successors[n++] = pack_state(apply_move(s, m));
+            } else {
+                external = true;
+            }
+        }
+        canonicalize_packed_batch(successors.data(), successors.data(), n);
+
+        const uint64_t base = static_cast<uint64_t>(slice_) * slice_cells_;
+        bool all_win = !external || ((complete_[cell >> 6] >> (cell & 63)) & 1);
+        for (size_t i = 0; i < n && code == BITMAP_UNKNOWN; ++i) {
+            uint8_t succ = get_cell(cells_.data(), space_.rank_canonical(unpack_state(successors[i])) - base);
+            if (succ == BITMAP_LOSS) code = BITMAP_WIN;
+            if (succ != BITMAP_WIN) all_win = false;
+        }
+        if (code == BITMAP_UNKNOWN && all_win) code = BITMAP_LOSS;
+    }
+
+    if (code == BITMAP_UNKNOWN || !set_cell(cells_.data(), cell, code)) return false;
+    resolved(worker, s, code);
+    return true;
+}
+
+bool RetrogradeSolverSlices::visit(int slice) {
+    visit_ = slice_visit(header_.round, slice);
+    bool first_visit = header_.round == 0;
+    uint64_t old_version = 0;
+    std::vector<std::pair<uint64_t, std::string>> inputs;
+
+    if (owns(slice)) {
+        inputs = runs_for(slice);
+
+        // Nothing but its own carried counts: nothing changed around the
+        // slice since it reached its fixpoint
+        bool idle = !first_visit &&
+                    (inputs.empty() || (inputs.size() == 1 && inputs[0].first == header_.slice_version[slice]));
+
+        std::cout << "\n--- Round " << header_.round + 1 << ", slice " << slice
+                  << " (Bobail in row " << slice << ") ---\n";
+
+        if (idle) {
+            std::cout << "  No updates, skipped\n";
+            inputs.clear();
+        } else {
+            auto t0 = std::chrono::steady_clock::now();
+            if (!load_slice(slice)) return false;
+            complete_.assign((slice_cells_ + 63) / 64, 0);
+            outbox_.assign(num_threads_, {});
+            resolved_ = 0;
+            io_failed_ = false;
+
+            std::string pending_path = update_dir() + "/pending.tmp";
+            if (!apply_updates(pending_path)) return false;
+
+            const uint64_t base = static_cast<uint64_t>(slice) * slice_cells_;
+            bool terminals = first_visit;
+            for (int sweep = 1;; ++sweep) {
+                uint64_t changed = parallel_sweep(terminals ? "Marking terminals" : "Sweeping slice",
+                                                  [&](int worker, uint64_t first, uint64_t last) {
+                    uint64_t local = 0;
+                    for (uint64_t i = first; i < last; ++i) {
+                        if (get_cell(cells_.data(), i) != BITMAP_UNKNOWN) continue;
+                        State s = space_.unrank(base + i);
+                        if (!is_canonical(s)) continue;
+                        if (resolve(worker, i, s, terminals)) ++local;
+                    }
+                    return local;
+                });
+                resolved_ += changed;
+                std::cout << "\n  Sweep " << sweep << ": resolved " << changed << " positions\n";
+                if (io_failed_) return false;
+                if (changed == 0 && !terminals) break;
+                terminals = false;
+            }
+
+            if (!merge_spills()) return false;
+
+            // Won-successor counts of positions still open carry over to
+            // the next visit as this slice's own run
+            if (std::filesystem::exists(pending_path)) {
+                RunWriter carry(run_path(slice, visit_));
+                bool ok = carry.ok() && merge_update_runs({pending_path}, [&](uint64_t u) {
+                    if (get_cell(cells_.data(), update_rank(u) - base) == BITMAP_UNKNOWN) carry.push(u);
+                    return true;
+                });
+                if (!carry.finish() || !ok) return false;
+                std::remove(pending_path.c_str());
+            }
+
+            if (!save_slice()) return false;
+
+            old_version = header_.slice_version[slice];
+            header_.slice_version[slice] = visit_;
+            header_.round_resolved += resolved_.load();
+            for (const auto& [visit, p] : inputs) {
+                uint64_t& consumed = header_.consumed[slice][visit_slice(visit)];
+                consumed = std::max(consumed, visit);
+            }
+
+            auto secs = std::chrono::duration_cast<std::chrono::seconds>(
+                std::chrono::steady_clock::now() - t0).count();
+            std::cout << "  Slice " << slice << ": resolved " << resolved_.load() << " positions in "
+                      << secs << "s\n";
+        }
+    }
+
+    // Commit the visit; its inputs are applied and can go
+    header_.visits = visit_;
+    if (++header_.next_slice == NUM_SLICES) {
+        header_.next_slice = 0;
+        ++header_.round;
+        std::cout << "\nRound " << header_.round << ": resolved " << header_.round_resolved << " positions\n";
+        header_.last_round_resolved = header_.round_resolved;
+        header_.round_resolved = 0;
+        header_.barrier_pending = 1;
+    }
+    if (!save_header()) return false;
+
+    for (const auto& [visit, p] : inputs) std::remove(p.c_str());
+    if (old_version != 0) std::remove(slice_path(slice, old_version).c_str());
+    return true;
+}
+
+bool RetrogradeSolverSlices::end_round() {
+    uint32_t round = header_.round - 1;
+    bool converged = header_.last_round_resolved == 0;
+    if (exchange_ && !exchange_->end_round(round, header_.last_round_resolved, converged)) {
+        return false;
+    }
+    header_.barrier_pending = 0;
+    header_.converged = converged ? 1 : 0;
+    return save_header();
+}
+
+bool RetrogradeSolverSlices::assemble() {
+    bool assembling = !exchange_ || exchange_->assembles();
+    if (assembling && !results_.open(path_ + RESULT_FILE, space_.size())) return false;
+
+    uint64_t totals[3] = {0, 0, 0};
+    for (int slice = 0; slice < NUM_SLICES; ++slice) {
+        uint64_t counts[3] = {0, 0, 0};
+
+        if (owns(slice)) {
+            if (!load_slice(slice)) return false;
+            const uint64_t base = static_cast<uint64_t>(slice) * slice_cells_;
+
+            std::atomic<uint64_t> w{0}, l{0}, d{0};
+            parallel_sweep("Marking draws", [&](int, uint64_t first, uint64_t last) {
+                uint64_t lw = 0, ll = 0, ld = 0;
+                for (uint64_t i = first; i < last; ++i) {
+                    uint8_t code = get_cell(cells_.data(), i);
+                    if (code == BITMAP_UNKNOWN) {
+                        if (!is_canonical(space_.unrank(base + i))) continue;
+                        set_cell(cells_.data(), i, BITMAP_DRAW);
+                        code = BITMAP_DRAW;
+                    }
+                    if (code == BITMAP_WIN) ++lw;
+                    else if (code == BITMAP_LOSS) ++ll;
+                    else ++ld;
+                }
+                w += lw;
+                l += ll;
+                d += ld;
+                return static_cast<uint64_t>(0);
+            });
+            counts[0] = w;
+            counts[1] = l;
+            counts[2] = d;
+
+            if (!assembling && !exchange_->publish_slice(slice, cells_, counts)) return false;
+        } else if (!assembling) {
+            continue;
+        } else if (!exchange_->fetch_slice(slice, cells_, counts) || cells_.size() != slice_words_) {
+            std::cerr << "Slice " << slice << " from the cluster is not a whole slice\n";
+            return false;
+        }
+
+        for (int i = 0; i < 3; ++i) totals[i] += counts[i];
+        if (assembling) {
+            const uint64_t base = static_cast<uint64_t>(slice) * slice_cells_;
+            if (base % 32 == 0 && slice_cells_ % 32 == 0) {
+                std::memcpy(results_.words() + base / 32, cells_.data(), slice_words_ * sizeof(uint64_t));
+            } else {
+                // Smaller rank spaces: slices do not start on a word
+                for (uint64_t i = 0; i < slice_cells_; ++i) {
+                    uint8_t code = get_cell(cells_.data(), i);
+                    if (code != BITMAP_UNKNOWN) results_.set(base + i, code);
+                }
+            }
+            if (!results_.sync()) return false;
+        }
+    }
+
+    if (assembling) {
+        BitmapHeader& h = results_.header();
+        h.rules_variant = header_.rules_variant;
+        h.phase = static_cast<uint32_t>(SolvePhase::COMPLETE);
+        h.sweep = header_.round;
+        h.num_wins = totals[0];
+        h.num_losses = totals[1];
+        h.num_draws = totals[2];
+        if (!results_.sync()) return false;
+    }
+
+    header_.phase = static_cast<uint32_t>(SolvePhase::COMPLETE);
+    header_.num_wins = totals[0];
+    header_.num_losses = totals[1];
+    header_.num_draws = totals[2];
+    if (!save_header()) return false;
+
+    // The slices live on in results.bitmap
+    for (int slice = 0; slice < NUM_SLICES; ++slice) {
+        if (header_.slice_version[slice] != 0) {
+            std::remove(slice_path(slice, header_.slice_version[slice]).c_str());
+        }
+    }
+    std::error_code ec;
+    std::filesystem::remove_all(update_dir(), ec);
+    if (exchange_) exchange_->finished();
+    cells_ = {};
+    complete_ = {};
+    return true;
+}
+
+bool RetrogradeSolverSlices::solve() {
+    if (!open_) {
+        std::cerr << "Slice solver not open\n";
+        return false;
+    }
+
+    if (current_phase() != SolvePhase::COMPLETE) {
+        if (current_phase() != SolvePhase::PROPAGATING) {
+            header_.phase = static_cast<uint32_t>(SolvePhase::PROPAGATING);
+            if (!save_header()) return false;
+        }
+
+        if (!header_.converged) {
+            std::cout << "\n=== Solving slices ===\n";
+            while (!header_.converged) {
+                bool ok = header_.barrier_pending ? end_round() : visit(static_cast<int>(header_.next_slice));
+                if (!ok) {
+                    std::cerr << "Slice solve failed; rerun to resume from the last committed visit\n";
+                    return false;
+                }
+            }
+        }
+
+        std::cout << "\n=== Marking draws and assembling results ===\n";
+        if (!assemble()) return false;
+    }
+
+    std::cout << "\nSolve complete: " << num_wins() << " wins, " << num_losses()
+              << " losses, " << num_draws() << " draws\n";
+    return true;
+}
+
+Result RetrogradeSolverSlices::get_result(const State& s) const {
+    if (!results_.is_open()) return Result::UNKNOWN;
+    return decode_bitmap_result(results_.get(space_.rank(s)));
+}
+
+Move RetrogradeSolverSlices::get_best_move(const State& s) const {
+    Result my_result = get_result(s);
+
+    MoveList moves;
+    generate_moves(s, moves);
+    if (moves.empty()) {
+        return Move{};
+    }
+
+    for (const auto& move : moves) {
+        Result opp_result = get_result(apply_move(s, move));
+
+        if (my_result == Result::WIN && opp_result == Result::LOSS) {
+            return move;
+        }
+        if (my_result == Result::DRAW && opp_result == Result::DRAW) {
+            return move;
+        }
+        if (my_result == Result::LOSS) {
+            if (opp_result == Result::DRAW) return move;
+            if (opp_result == Result::WIN) return move;
+        }
+    }
+
+    return moves[0];
+}
+
+Result RetrogradeSolverSlices::starting_result() const {
+    return get_result(State::starting_position());
+}
+
+} // namespace bobail
@@ -0,0 +1,98 @@
+#include "search_tt.h"
+#include <algorithm>
+#include <atomic>
+
+namespace bobail {
+
+uint64_t SearchTT::pack(const SearchTTEntry& e) {
+    return static_cast<uint32_t>(e.score) | static_cast<uint64_t>(static_cast<uint8_t>(e.depth)) << 32 |
+           static_cast<uint64_t>(e.bound_age) << 40 | static_cast<uint64_t>(e.move) << 48;
+}
+
+SearchTTEntry SearchTT::unpack(uint64_t key, uint64_t data) {
+    SearchTTEntry e;
+    e.key = key;
+    e.score = static_cast<int32_t>(static_cast<uint32_t>(data));
+    e.depth = static_cast<int8_t>(data >> 32);
+    e.bound_age = static_cast<uint8_t>(data >> 40);
+    e.move = static_cast<uint16_t>(data >> 48);
+    return e;
+}
+
+bool SearchTT::load(const Slot& slot, SearchTTEntry& out) {
+    auto& s = const_cast<Slot&>(slot);
+    uint64_t check = std::atomic_ref<uint64_t>(s.check).load(std::memory_order_relaxed);
+    uint64_t data = std::atomic_ref<uint64_t>(s.data).load(std::memory_order_relaxed);
+    out = unpack(check ^ data, data);
+    return out.bound() != Bound::NONE;
+}
+
+void SearchTT::save(Slot& slot, const SearchTTEntry& e) {
+    uint64_t data = pack(e);
+    std::atomic_ref<uint64_t>(slot.data).store(data, std::memory_order_relaxed);
+    std::atomic_ref<uint64_t>(slot.check).store(e.key ^ data, std::memory_order_relaxed);
+}
+
+void SearchTT::resize(size_t megabytes) {
+    size_t count = std::max<size_t>(1, (megabytes << 20) / (2 * sizeof(Slot)));
+    size_t buckets = 1;
+    while (buckets * 2 <= count) buckets *= 2;
+    slots_.reset();
+    slots_ = std::make_unique<Slot[]>(2 * buckets);
+    mask_ = buckets - 1;
+    generation_ = 0;
+}
+
+void SearchTT::clear() {
+    std::fill_n(slots_.get(), 2 * num_buckets(), Slot{});
+    generation_ = 0;
+}
+
+bool SearchTT::probe(uint64_t key, SearchTTEntry& out) const {
+    const Slot* bucket = &slots_[2 * (key & mask_)];
+    for (int i = 0; i < 2; ++i) {
+        if (load(bucket[i], out) && out.key == key) return true;
+    }
+    return false;
+}
+
+void SearchTT::store(uint64_t key, int score, int depth, Bound bound, const Move* move) {
+    Slot* bucket = &slots_[2 * (key & mask_)];
+    SearchTTEntry deep;
+    bool have_deep = load(bucket[0], deep);
+
+    // The deep slot takes the same position, anything from an older
+    // search, or a search at least as deep; the rest go to the other slot
+    Slot* slot = &bucket[1];
+    SearchTTEntry old;
+    if (!have_deep || deep.key == key || deep.age() != generation_ || depth >= deep.depth) {
+        slot = &bucket[0];
+        old = deep;
+    } else {
+        load(*slot, old);
+    }
+
+    SearchTTEntry e;
+    e.key = key;
+    e.score = score;
+    e.depth = static_cast<int8_t>(std::clamp(depth, 0, 127));
+    e.bound_age = static_cast<uint8_t>(static_cast<uint8_t>(bound) | (generation_ << 2));
+    if (move) {
+        e.move = SearchTTEntry::pack_move(*move);
+    } else if (old.key == key) {
+        e.move = old.move;
+    }
+    save(*slot, e);
+}
+
+int SearchTT::hashfull() const {
+    size_t sample = std::min<size_t>(1000, num_buckets());
+    size_t used = 0;
+    for (size_t i = 0; i < sample; ++i) {
+        SearchTTEntry e;
+        if (load(slots_[2 * i], e) && e.age() == generation_) ++used;
+    }
+    return static_cast<int>(used * 1000 / sample);
+}
+
+} // namespace bobail
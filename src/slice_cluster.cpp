@@ -0,0 +1,599 @@
+#include "slice_cluster.h"
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+namespace bobail {
+
+uint32_t cluster_slices(int node, int num_nodes) {
+    uint32_t mask = 0;
+    for (int slice = 0; slice < NUM_SLICES; ++slice) {
+        if (slice % num_nodes == node) mask |= 1u << slice;
+    }
+    return mask;
+}
+
+namespace {
+    bool split_peer(const std::string& peer, std::string& host, std::string& port) {
+        size_t colon = peer.rfind(':');
+        if (colon == std::string::npos || colon == 0 || colon + 1 == peer.size()) return false;
+        host = peer.substr(0, colon);
+        port = peer.substr(colon + 1);
+        unsigned number = 0;
+        auto [ptr, ec] = std::from_chars(port.data(), port.data() + port.size(), number);
+        return ec == std::errc() && ptr == port.data() + port.size() && number >= 1 && number <= 65535;
+    }
+}
+
+bool parse_cluster_peers(const std::string& list, std::vector<std::string>& peers) {
+    peers.clear();
+    std::stringstream ss(list);
+    std::string peer;
+    while (std::getline(ss, peer, ',')) {
+        std::string host, port;
+        if (!split_peer(peer, host, port)) return false;
+        if (std::find(peers.begin(), peers.end(), peer) != peers.end()) return false;
+        peers.push_back(peer);
+    }
+    // getline drops an empty last entry
+    if (!list.empty() && list.back() == ',') return false;
+    return !peers.empty() && peers.size() <= static_cast<size_t>(NUM_SLICES);
+}
+
+namespace {
+    constexpr uint64_t RUNZ_MAGIC = 0x315A4E5552424F42ULL;  // "BOBRUNZ1"
+    constexpr uint32_t MESSAGE_MAGIC = 0x53424F42;          // "BOBS"
+    constexpr uint32_t REPLY_ACK = 1;
+    constexpr size_t IO_CHUNK = 1 << 20;
+
+    enum MessageType : uint32_t {
+        MSG_RUN = 1,     // A compressed update run for a slice the receiver owns
+        MSG_REPORT = 2,  // End of round; node 0 replies with a Verdict
+        MSG_SLICE = 3,   // Finished slice for node 0: win, loss, draw counts, then the cells
+    };
+
+    struct MessageHeader {
+        uint32_t magic;
+        uint32_t type;
+        uint32_t node;      // Sender
+        uint32_t slice;     // RUN: destination slice; SLICE: the slice
+        uint64_t value;     // RUN: visit that wrote it; REPORT: round
+        uint64_t resolved;  // REPORT: positions the sender resolved in the round
+        uint64_t bytes;     // Payload that follows
+    };
+
+    void put_varint(std::vector<uint8_t>& out, uint64_t v) {
+        while (v >= 0x80) {
+            out.push_back(static_cast<uint8_t>(v | 0x80));
+            v >>= 7;
+        }
+        out.push_back(static_cast<uint8_t>(v));
+    }
+
+    // Buffered varint reader over a FILE
+    class VarintReader {
+    public:
+        explicit VarintReader(FILE* f) : file_(f), buf_(1 << 16) {}
+
+        bool next(uint64_t& v) {
+            v = 0;
+            for (int shift = 0; shift < 64; shift += 7) {
+                if (pos_ == len_) {
+                    len_ = std::fread(buf_.data(), 1, buf_.size(), file_);
+                    pos_ = 0;
+                    if (len_ == 0) return false;
+                }
+                uint8_t b = buf_[pos_++];
+                v |= static_cast<uint64_t>(b & 0x7f) << shift;
+                if (!(b & 0x80)) return true;
+            }
+            return false;
+        }
+
+    private:
+        FILE* file_;
+        std::vector<uint8_t> buf_;
+        size_t pos_ = 0;
+        size_t len_ = 0;
+    };
+
+    bool send_all(int fd, const void* data, size_t bytes) {
+        const char* p = static_cast<const char*>(data);
+        while (bytes > 0) {
+            ssize_t n = ::send(fd, p, bytes, MSG_NOSIGNAL);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            p += n;
+            bytes -= static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    bool recv_all(int fd, void* data, size_t bytes) {
+        char* p = static_cast<char*>(data);
+        while (bytes > 0) {
+            ssize_t n = ::recv(fd, p, bytes, 0);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            p += n;
+            bytes -= static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    bool write_all(int fd, const char* p, size_t bytes) {
+        while (bytes > 0) {
+            ssize_t n = ::write(fd, p, bytes);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            p += n;
+            bytes -= static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    void set_timeout(int fd, int seconds) {
+        timeval tv{};
+        tv.tv_sec = seconds;
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    }
+
+    int connect_to(const std::string& peer) {
+        std::string host, port;
+        if (!split_peer(peer, host, port)) return -1;
+
+        addrinfo hints{};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        addrinfo* res = nullptr;
+        if (getaddrinfo(host.c_str(), port.c_str(), &hints, &res) != 0) return -1;
+
+        int fd = -1;
+        for (addrinfo* ai = res; ai && fd < 0; ai = ai->ai_next) {
+            fd = ::socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+            if (fd < 0) continue;
+            if (::connect(fd, ai->ai_addr, ai->ai_addrlen) != 0) {
+                ::close(fd);
+                fd = -1;
+            }
+        }
+        freeaddrinfo(res);
+        if (fd >= 0) {
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            set_timeout(fd, 300);
+        }
+        return fd;
+    }
+
+    // One request: header, body(fd) for the payload, then a 4-byte reply.
+    // False if the peer could not be reached or hung up.
+    bool exchange_message(const std::string& peer, const MessageHeader& header,
+                          const std::function<bool(int)>& body, uint32_t& reply) {
+        int fd = connect_to(peer);
+        if (fd < 0) return false;
+        bool ok = send_all(fd, &header, sizeof(header)) && (!body || body(fd)) &&
+                  recv_all(fd, &reply, sizeof(reply));
+        ::close(fd);
+        return ok;
+    }
+
+    // Stream `bytes` from the socket into `path` (via a temporary file) and
+    // flush it to disk
+    bool receive_file(int fd, uint64_t bytes, const std::string& path) {
+        std::string tmp = path + ".tmp";
+        int out = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (out < 0) return false;
+        std::vector<char> buf(IO_CHUNK);
+        bool ok = true;
+        while (ok && bytes > 0) {
+            size_t n = static_cast<size_t>(std::min<uint64_t>(bytes, buf.size()));
+            ok = recv_all(fd, buf.data(), n) && write_all(out, buf.data(), n);
+            bytes -= n;
+        }
+        ok = ok && ::fdatasync(out) == 0;
+        ok = ::close(out) == 0 && ok;
+        ok = ok && std::rename(tmp.c_str(), path.c_str()) == 0;
+        if (!ok) std::remove(tmp.c_str());
+        return ok;
+    }
+}
+
+bool compress_update_run(const std::string& run_path, const std::string& out_path) {
+    FILE* in = std::fopen(run_path.c_str(), "rb");
+    FILE* out = in ? std::fopen(out_path.c_str(), "wb") : nullptr;
+    bool ok = out != nullptr;
+
+    std::vector<uint64_t> updates(1 << 14);
+    std::vector<uint8_t> bytes;
+    bytes.reserve(updates.size() * 10);
+    if (ok) {
+        bytes.resize(sizeof(RUNZ_MAGIC));
+        std::memcpy(bytes.data(), &RUNZ_MAGIC, sizeof(RUNZ_MAGIC));
+    }
+
+    uint64_t prev = 0;
+    while (ok) {
+        size_t n = std::fread(updates.data(), sizeof(uint64_t), updates.size(), in);
+        if (n == 0) break;
+        for (size_t i = 0; i < n; ++i) {
+            uint64_t u = updates[i];
+            put_varint(bytes, update_rank(u) - prev);
+            put_varint(bytes, (static_cast<uint64_t>(update_won_successors(u)) << 1) |
+                              ((u & UPDATE_LOST_SUCCESSOR) ? 1 : 0));
+            prev = update_rank(u);
+        }
+        ok = std::fwrite(bytes.data(), 1, bytes.size(), out) == bytes.size();
+        bytes.clear();
+    }
+
+    ok = ok && std::ferror(in) == 0 && std::fflush(out) == 0;
+    if (out) ok = std::fclose(out) == 0 && ok;
+    if (in) std::fclose(in);
+    if (!ok) std::cerr << "Failed to compress update run " << run_path << "\n";
+    return ok;
+}
+
+bool decompress_update_run(const std::string& in_path, const std::string& run_path) {
+    FILE* in = std::fopen(in_path.c_str(), "rb");
+    FILE* out = in ? std::fopen(run_path.c_str(), "wb") : nullptr;
+    uint64_t magic = 0;
+    bool ok = out != nullptr && std::fread(&magic, sizeof(magic), 1, in) == 1 && magic == RUNZ_MAGIC;
+
+    VarintReader reader(in);
+    std::vector<uint64_t> updates;
+    updates.reserve(1 << 14);
+    uint64_t rank = 0, delta, count;
+    while (ok && reader.next(delta)) {
+        rank += delta;
+        ok = reader.next(count) && rank <= UPDATE_RANK_MASK &&
+             (count >> 1) <= (UPDATE_COUNT_MASK >> UPDATE_COUNT_SHIFT);
+        if (!ok) break;
+        updates.push_back(rank | ((count >> 1) << UPDATE_COUNT_SHIFT) | ((count & 1) ? UPDATE_LOST_SUCCESSOR : 0));
+        if (updates.size() == updates.capacity()) {
+            ok = std::fwrite(updates.data(), sizeof(uint64_t), updates.size(), out) == updates.size();
+            updates.clear();
+        }
+    }
+    if (ok && !updates.empty()) {
+        ok = std::fwrite(updates.data(), sizeof(uint64_t), updates.size(), out) == updates.size();
+    }
+
+    ok = ok && std::ferror(in) == 0 && std::fflush(out) == 0 && ::fdatasync(fileno(out)) == 0;
+    if (out) ok = std::fclose(out) == 0 && ok;
+    if (in) std::fclose(in);
+    if (!ok) std::cerr << "Failed to decompress update run " << in_path << "\n";
+    return ok;
+}
+
+SliceCluster::SliceCluster(int node, std::vector<std::string> peers, std::string solver_dir)
+    : node_(node), peers_(std::move(peers)), dir_(std::move(solver_dir)) {}
+
+SliceCluster::~SliceCluster() {
+    stop();
+}
+
+std::string SliceCluster::slice_file(int slice) const {
+    return inbox_dir() + "/slice_" + std::to_string(slice) + ".bits";
+}
+
+bool SliceCluster::start() {
+    if (node_ < 0 || node_ >= num_nodes()) {
+        std::cerr << "Node " << node_ << " is not in a cluster of " << num_nodes() << "\n";
+        return false;
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(inbox_dir(), ec);
+    std::filesystem::create_directories(outbox_dir(), ec);
+    if (ec) {
+        std::cerr << "Failed to create " << inbox_dir() << ": " << ec.message() << "\n";
+        return false;
+    }
+
+    if (assembles()) load_verdicts();
+
+    std::string host, port;
+    split_peer(peers_[node_], host, port);
+    listen_fd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_fd_ < 0) {
+        std::cerr << "Failed to create socket: " << std::strerror(errno) << "\n";
+        return false;
+    }
+    int one = 1;
+    setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(static_cast<uint16_t>(std::stoul(port)));
+    if (::bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+        ::listen(listen_fd_, SOMAXCONN) != 0) {
+        std::cerr << "Failed to listen on port " << port << ": " << std::strerror(errno) << "\n";
+        ::close(listen_fd_);
+        listen_fd_ = -1;
+        return false;
+    }
+
+    stop_ = false;
+    listener_ = std::thread(&SliceCluster::listen_loop, this);
+    std::cout << "Cluster node " << node_ << " of " << num_nodes() << " listening on port " << port
+              << ", owns slices";
+    for (int slice = 0; slice < NUM_SLICES; ++slice) {
+        if ((owned_slices() >> slice) & 1) std::cout << " " << slice;
+    }
+    std::cout << "\n";
+    return true;
+}
+
+void SliceCluster::stop() {
+    stop_ = true;
+    if (listener_.joinable()) listener_.join();
+    if (listen_fd_ >= 0) {
+        ::close(listen_fd_);
+        listen_fd_ = -1;
+    }
+}
+
+void SliceCluster::listen_loop() {
+    while (!stop_.load()) {
+        pollfd pfd{listen_fd_, POLLIN, 0};
+        if (::poll(&pfd, 1, 200) <= 0) continue;
+        int fd = ::accept(listen_fd_, nullptr, nullptr);
+        if (fd < 0) continue;
+        set_timeout(fd, 300);
+        handle(fd);
+        ::close(fd);
+    }
+}
+
+void SliceCluster::handle(int fd) {
+    MessageHeader h;
+    if (!recv_all(fd, &h, sizeof(h)) || h.magic != MESSAGE_MAGIC || h.slice >= NUM_SLICES) return;
+
+    uint32_t reply = 0;
+    switch (h.type) {
+    case MSG_RUN:
+        if (h.value == 0 || !((owned_slices() >> h.slice) & 1)) return;
+        if (!receive_file(fd, h.bytes, inbox_dir() + "/" + update_run_name(h.slice, h.value) + "z")) return;
+        reply = REPLY_ACK;
+        break;
+    case MSG_SLICE:
+        if (!assembles() || !receive_file(fd, h.bytes, slice_file(h.slice))) return;
+        reply = REPLY_ACK;
+        break;
+    case MSG_REPORT:
+        if (!assembles() || h.node >= static_cast<uint32_t>(num_nodes())) return;
+        reply = static_cast<uint32_t>(report(static_cast<uint32_t>(h.value), h.node, h.resolved));
+        break;
+    default:
+        return;
+    }
+    send_all(fd, &reply, sizeof(reply));
+}
+
+SliceCluster::Verdict SliceCluster::report(uint32_t round, int node, uint64_t resolved) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& round_reports = reports_[round];
+    round_reports[node] = resolved;
+
+    auto it = verdicts_.find(round);
+    if (it != verdicts_.end()) return it->second;
+
+    if (round_reports.size() == peers_.size()) {
+        uint64_t total = 0;
+        for (const auto& [n, r] : round_reports) total += r;
+        Verdict v = total == 0 ? Verdict::CONVERGED : Verdict::CONTINUE;
+        // Nodes act on the verdict, so it must survive a restart of node 0
+        if (!save_verdict(round, v)) return Verdict::PENDING;
+        verdicts_[round] = v;
+        return v;
+    }
+
+    // After a restart of node 0 the reports of an undecided round are
+    // lost, so the nodes report again; a node already past the round
+    // tells how it ended
+    if (reports_.rbegin()->first > round) return Verdict::CONTINUE;
+    for (int slice = 0; slice < NUM_SLICES; ++slice) {
+        if (std::filesystem::exists(slice_file(slice))) return Verdict::CONVERGED;
+    }
+    return Verdict::PENDING;
+}
+
+std::string SliceCluster::verdicts_file() const {
+    return dir_ + "/verdicts.bin";
+}
+
+void SliceCluster::load_verdicts() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    FILE* f = std::fopen(verdicts_file().c_str(), "rb");
+    if (!f) return;
+    uint32_t record[2];
+    // A record cut short by a crash was never answered, so it is ignored
+    while (std::fread(record, sizeof(record), 1, f) == 1) {
+        verdicts_[record[0]] = static_cast<Verdict>(record[1]);
+    }
+    std::fclose(f);
+}
+
+bool SliceCluster::save_verdict(uint32_t round, Verdict v) {
+    int fd = ::open(verdicts_file().c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    uint32_t record[2] = {round, static_cast<uint32_t>(v)};
+    bool ok = fd >= 0 && write_all(fd, reinterpret_cast<const char*>(record), sizeof(record)) && ::fdatasync(fd) == 0;
+    if (fd >= 0) ok = ::close(fd) == 0 && ok;
+    if (!ok) std::cerr << "Failed to record the verdict of round " << round + 1 << " in " << verdicts_file() << "\n";
+    return ok;
+}
+
+bool SliceCluster::send_file(int peer, uint32_t type, uint32_t slice, uint64_t visit, const std::string& path) {
+    for (bool first = true;; first = false) {
+        FILE* f = std::fopen(path.c_str(), "rb");
+        if (!f) {
+            std::cerr << "Failed to open " << path << "\n";
+            return false;
+        }
+        MessageHeader h{MESSAGE_MAGIC, type, static_cast<uint32_t>(node_), slice, visit, 0,
+                        std::filesystem::file_size(path)};
+        uint32_t reply = 0;
+        bool ok = exchange_message(peers_[peer], h, [&](int fd) {
+            std::vector<char> buf(IO_CHUNK);
+            size_t n;
+            while ((n = std::fread(buf.data(), 1, buf.size(), f)) > 0) {
+                if (!send_all(fd, buf.data(), n)) return false;
+            }
+            return std::ferror(f) == 0;
+        }, reply);
+        std::fclose(f);
+        if (ok && reply == REPLY_ACK) return true;
+
+        if (first) std::cout << "  Node " << peer << " (" << peers_[peer] << ") not answering; retrying\n";
+        std::this_thread::sleep_for(std::chrono::milliseconds(retry_ms_));
+    }
+}
+
+bool SliceCluster::deliver_runs() {
+    std::vector<std::pair<std::string, std::pair<int, uint64_t>>> runs;
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator(dir_ + "/updates", ec)) {
+        int dest;
+        uint64_t visit;
+        std::string name = entry.path().filename().string();
+        if (parse_update_run_name(name, dest, visit) && !((owned_slices() >> dest) & 1)) {
+            runs.push_back({name, {dest, visit}});
+        }
+    }
+    std::sort(runs.begin(), runs.end());
+
+    uint64_t raw = 0, sent = 0;
+    for (const auto& [name, run] : runs) {
+        std::string path = dir_ + "/updates/" + name;
+        std::string packed = outbox_dir() + "/" + name + "z";
+        if (!compress_update_run(path, packed)) return false;
+        uint64_t raw_bytes = std::filesystem::file_size(path);
+        uint64_t packed_bytes = std::filesystem::file_size(packed);
+        if (!send_file(run.first % num_nodes(), MSG_RUN, run.first, run.second, packed)) return false;
+
+        // The owner has it on disk now
+        std::remove(packed.c_str());
+        std::remove(path.c_str());
+        raw += raw_bytes;
+        sent += packed_bytes;
+    }
+    if (!runs.empty()) {
+        std::cout << "  Sent " << runs.size() << " update runs, " << raw / 1024 << " KB as "
+                  << sent / 1024 << " KB\n";
+    }
+    return true;
+}
+
+bool SliceCluster::import_runs() {
+    std::error_code ec;
+    size_t n = 0;
+    for (const auto& entry : std::filesystem::directory_iterator(inbox_dir(), ec)) {
+        std::string name = entry.path().filename().string();
+        if (name.size() < 2 || name.back() != 'z') continue;
+        name.pop_back();
+        int dest;
+        uint64_t visit;
+        if (!parse_update_run_name(name, dest, visit)) continue;
+
+        std::string path = dir_ + "/updates/" + name;
+        std::string tmp = path + ".tmp";
+        if (!decompress_update_run(entry.path().string(), tmp) || std::rename(tmp.c_str(), path.c_str()) != 0) {
+            std::remove(tmp.c_str());
+            return false;
+        }
+        std::filesystem::remove(entry.path(), ec);
+        ++n;
+    }
+    if (n > 0) std::cout << "  Received " << n << " update runs\n";
+    return true;
+}
+
+bool SliceCluster::end_round(uint32_t round, uint64_t resolved, bool& converged) {
+    // Every node delivers before it reports, so once all have reported
+    // the runs of this round are in the owners' inboxes
+    if (!deliver_runs()) return false;
+
+    std::cout << "  Waiting for the other nodes to finish round " << round + 1 << "\n";
+    for (;;) {
+        Verdict v = Verdict::PENDING;
+        if (node_ == 0) {
+            v = report(round, 0, resolved);
+        } else {
+            MessageHeader h{MESSAGE_MAGIC, MSG_REPORT, static_cast<uint32_t>(node_), 0, round, resolved, 0};
+            uint32_t reply = 0;
+            if (exchange_message(peers_[0], h, nullptr, reply)) v = static_cast<Verdict>(reply);
+        }
+        if (v == Verdict::CONTINUE || v == Verdict::CONVERGED) {
+            converged = v == Verdict::CONVERGED;
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(retry_ms_));
+    }
+
+    return import_runs();
+}
+
+bool SliceCluster::publish_slice(int slice, const std::vector<uint64_t>& cells, const uint64_t counts[3]) {
+    MessageHeader h{MESSAGE_MAGIC, MSG_SLICE, static_cast<uint32_t>(node_), static_cast<uint32_t>(slice), 0, 0,
+                    3 * sizeof(uint64_t) + cells.size() * sizeof(uint64_t)};
+    std::cout << "  Sending slice " << slice << " to node 0\n";
+    for (bool first = true;; first = false) {
+        uint32_t reply = 0;
+        bool ok = exchange_message(peers_[0], h, [&](int fd) {
+            return send_all(fd, counts, 3 * sizeof(uint64_t)) &&
+                   send_all(fd, cells.data(), cells.size() * sizeof(uint64_t));
+        }, reply);
+        if (ok && reply == REPLY_ACK) return true;
+        if (first) std::cout << "  Node 0 (" << peers_[0] << ") not answering; retrying\n";
+        std::this_thread::sleep_for(std::chrono::milliseconds(retry_ms_));
+    }
+}
+
+bool SliceCluster::fetch_slice(int slice, std::vector<uint64_t>& cells, uint64_t counts[3]) {
+    std::string path = slice_file(slice);
+    if (!std::filesystem::exists(path)) {
+        std::cout << "  Waiting for slice " << slice << " from node " << slice % num_nodes() << "\n";
+        while (!std::filesystem::exists(path)) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(retry_ms_));
+        }
+    }
+
+    uint64_t bytes = std::filesystem::file_size(path);
+    FILE* f = std::fopen(path.c_str(), "rb");
+    bool ok = f && bytes >= 3 * sizeof(uint64_t) && bytes % sizeof(uint64_t) == 0;
+    if (ok) {
+        cells.resize(bytes / sizeof(uint64_t) - 3);
+        ok = std::fread(counts, sizeof(uint64_t), 3, f) == 3 &&
+             std::fread(cells.data(), sizeof(uint64_t), cells.size(), f) == cells.size();
+    }
+    if (f) std::fclose(f);
+    if (!ok) std::cerr << "Failed to read slice " << slice << " from " << path << "\n";
+    return ok;
+}
+
+void SliceCluster::finished() {
+    std::error_code ec;
+    std::filesystem::remove(verdicts_file(), ec);
+    std::filesystem::remove_all(inbox_dir(), ec);
+    std::filesystem::remove_all(outbox_dir(), ec);
+}
+
+} // namespace bobail
@@ -0,0 +1,263 @@
+#include "solver_metrics.h"
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace bobail {
+
+namespace {
+
+std::string json_string(const std::string& s) {
+    std::string out = "\"";
+    for (char c : s) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            out += ' ';
+        } else {
+            out += c;
+        }
+    }
+    return out + "\"";
+}
+
+// Metric names allow [a-zA-Z0-9_:]
+std::string prometheus_name(const std::string& s) {
+    std::string out = s;
+    for (char& c : out) {
+        bool ok = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c == ':';
+        if (!ok) c = '_';
+    }
+    return out;
+}
+
+std::string prometheus_label(const std::string& s) {
+    std::string out;
+    for (char c : s) {
+        if (c == '"' || c == '\\') out += '\\';
+        if (c == '\n') continue;
+        out += c;
+    }
+    return out;
+}
+
+void set_named(SolverMetrics::Gauges& gauges, const std::string& name, double value) {
+    for (auto& g : gauges) {
+        if (g.first == name) {
+            g.second = value;
+            return;
+        }
+    }
+    gauges.emplace_back(name, value);
+}
+
+} // namespace
+
+SolverMetrics::SolverMetrics()
+    : threads_(std::make_unique<ThreadCounter[]>(MAX_THREADS)),
+      start_(Clock::now()),
+      last_snapshot_(start_) {}
+
+void SolverMetrics::begin_phase(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto now = Clock::now();
+    if (!phase_.empty()) {
+        phase_times_.emplace_back(phase_, std::chrono::duration<double>(now - phase_start_).count());
+    }
+    phase_ = name;
+    phase_start_ = now;
+}
+
+void SolverMetrics::end_phase() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (phase_.empty()) return;
+    phase_times_.emplace_back(phase_, std::chrono::duration<double>(Clock::now() - phase_start_).count());
+    phase_.clear();
+}
+
+void SolverMetrics::set_progress(const char* what, uint64_t current, uint64_t total) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    progress_ = what;
+    progress_current_ = current;
+    progress_total_ = total;
+}
+
+void SolverMetrics::set_gauge(const std::string& name, double value) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    set_named(gauges_, name, value);
+}
+
+SolverMetrics::Snapshot SolverMetrics::snapshot() {
+    Snapshot s;
+    int n = num_threads_.load(std::memory_order_relaxed);
+    s.thread_items.resize(n);
+    for (int i = 0; i < n; ++i) s.thread_items[i] = threads_[i].items.load(std::memory_order_relaxed);
+    s.queue_head = queue_head_.load(std::memory_order_relaxed);
+    s.queue_tail = queue_tail_.load(std::memory_order_relaxed);
+    s.bloom_negatives = bloom_negatives_.load(std::memory_order_relaxed);
+    s.bloom_positives = bloom_positives_.load(std::memory_order_relaxed);
+    s.bloom_false_positives = bloom_false_positives_.load(std::memory_order_relaxed);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto now = Clock::now();
+    s.uptime_sec = std::chrono::duration<double>(now - start_).count();
+    s.phase = phase_;
+    if (!phase_.empty()) s.phase_sec = std::chrono::duration<double>(now - phase_start_).count();
+    s.phase_times = phase_times_;
+    s.progress = progress_;
+    s.progress_current = progress_current_;
+    s.progress_total = progress_total_;
+    s.gauges = gauges_;
+
+    double dt = std::chrono::duration<double>(now - last_snapshot_).count();
+    last_items_.resize(n, 0);
+    s.thread_rates.resize(n);
+    for (int i = 0; i < n; ++i) {
+        uint64_t delta = s.thread_items[i] >= last_items_[i] ? s.thread_items[i] - last_items_[i] : 0;
+        s.thread_rates[i] = dt > 0 ? delta / dt : 0.0;
+        last_items_[i] = s.thread_items[i];
+    }
+    last_snapshot_ = now;
+    return s;
+}
+
+std::string SolverMetrics::to_json(const Snapshot& s) {
+    std::ostringstream out;
+    out.precision(6);
+    out << "{\"time\":" << std::time(nullptr)
+        << ",\"uptime_s\":" << s.uptime_sec
+        << ",\"phase\":" << json_string(s.phase)
+        << ",\"phase_s\":" << s.phase_sec
+        << ",\"phases\":{";
+    for (size_t i = 0; i < s.phase_times.size(); ++i) {
+        out << (i ? "," : "") << json_string(s.phase_times[i].first) << ":" << s.phase_times[i].second;
+    }
+    out << "},\"progress\":{\"what\":" << json_string(s.progress)
+        << ",\"current\":" << s.progress_current
+        << ",\"total\":" << s.progress_total << "}";
+
+    out << ",\"thread_items\":[";
+    for (size_t i = 0; i < s.thread_items.size(); ++i) out << (i ? "," : "") << s.thread_items[i];
+    out << "],\"thread_rates\":[";
+    for (size_t i = 0; i < s.thread_rates.size(); ++i) out << (i ? "," : "") << s.thread_rates[i];
+    out << "]";
+
+    uint64_t depth = s.queue_tail > s.queue_head ? s.queue_tail - s.queue_head : 0;
+    out << ",\"queue\":{\"head\":" << s.queue_head << ",\"tail\":" << s.queue_tail << ",\"depth\":" << depth << "}";
+
+    out << ",\"bloom\":{\"negatives\":" << s.bloom_negatives
+        << ",\"positives\":" << s.bloom_positives
+        << ",\"false_positives\":" << s.bloom_false_positives
+        << ",\"fp_rate\":" << s.bloom_fp_rate() << "}";
+
+    out << ",\"gauges\":{";
+    for (size_t i = 0; i < s.gauges.size(); ++i) {
+        out << (i ? "," : "") << json_string(s.gauges[i].first) << ":" << s.gauges[i].second;
+    }
+    out << "}}";
+    return out.str();
+}
+
+std::string SolverMetrics::to_prometheus(const Snapshot& s, const std::string& prefix) {
+    std::ostringstream out;
+    out.precision(10);
+    auto metric = [&](const std::string& name, const char* type) {
+        std::string full = prometheus_name(prefix + "_" + name);
+        out << "# TYPE " << full << " " << type << "\n";
+        return full;
+    };
+
+    out << metric("uptime_seconds", "gauge") << " " << s.uptime_sec << "\n";
+
+    std::string name = metric("phase_seconds", "gauge");
+    for (const auto& [phase, sec] : s.phase_times) {
+        out << name << "{phase=\"" << prometheus_label(phase) << "\"} " << sec << "\n";
+    }
+    if (!s.phase.empty()) {
+        out << name << "{phase=\"" << prometheus_label(s.phase) << "\"} " << s.phase_sec << "\n";
+        out << metric("current_phase", "gauge") << "{phase=\"" << prometheus_label(s.phase) << "\"} 1\n";
+    }
+
+    std::string label = "{what=\"" + prometheus_label(s.progress) + "\"}";
+    out << metric("progress_current", "gauge") << label << " " << s.progress_current << "\n";
+    out << metric("progress_total", "gauge") << label << " " << s.progress_total << "\n";
+
+    name = metric("thread_items_total", "counter");
+    for (size_t i = 0; i < s.thread_items.size(); ++i) {
+        out << name << "{thread=\"" << i << "\"} " << s.thread_items[i] << "\n";
+    }
+    name = metric("thread_items_per_second", "gauge");
+    for (size_t i = 0; i < s.thread_rates.size(); ++i) {
+        out << name << "{thread=\"" << i << "\"} " << s.thread_rates[i] << "\n";
+    }
+
+    out << metric("queue_head", "gauge") << " " << s.queue_head << "\n";
+    out << metric("queue_tail", "gauge") << " " << s.queue_tail << "\n";
+    out << metric("queue_depth", "gauge") << " "
+        << (s.queue_tail > s.queue_head ? s.queue_tail - s.queue_head : 0) << "\n";
+
+    out << metric("bloom_negatives_total", "counter") << " " << s.bloom_negatives << "\n";
+    out << metric("bloom_positives_total", "counter") << " " << s.bloom_positives << "\n";
+    out << metric("bloom_false_positives_total", "counter") << " " << s.bloom_false_positives << "\n";
+    out << metric("bloom_false_positive_rate", "gauge") << " " << s.bloom_fp_rate() << "\n";
+
+    for (const auto& [gauge, value] : s.gauges) {
+        out << metric(gauge, "gauge") << " " << value << "\n";
+    }
+    return out.str();
+}
+
+MetricsReporter::MetricsReporter(Source source, std::string json_path, std::string prom_path,
+                                 std::string prefix, double interval_sec)
+    : source_(std::move(source)),
+      json_path_(std::move(json_path)),
+      prom_path_(std::move(prom_path)),
+      prefix_(std::move(prefix)),
+      interval_(std::max(interval_sec, 0.1)) {
+    thread_ = std::thread([this] {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!cv_.wait_for(lock, interval_, [this] { return stopping_; })) {
+            lock.unlock();
+            write(source_());
+            lock.lock();
+        }
+    });
+}
+
+void MetricsReporter::stop() {
+    if (!thread_.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    thread_.join();
+    write(source_());
+}
+
+void MetricsReporter::write(const SolverMetrics::Snapshot& s) {
+    if (!json_path_.empty()) {
+        std::string line = SolverMetrics::to_json(s) + "\n";
+        if (json_path_ == "-") {
+            std::cerr << line << std::flush;
+        } else {
+            std::ofstream out(json_path_, std::ios::app);
+            out << line;
+        }
+    }
+    if (!prom_path_.empty()) {
+        // Scrapers must never see a half-written file
+        std::string tmp = prom_path_ + ".tmp";
+        {
+            std::ofstream out(tmp, std::ios::trunc);
+            out << SolverMetrics::to_prometheus(s, prefix_);
+            if (!out) return;
+        }
+        std::rename(tmp.c_str(), prom_path_.c_str());
+    }
+}
+
+} // namespace bobail
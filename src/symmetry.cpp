@@ -1,6 +1,11 @@
 #include "symmetry.h"
 #include "hash.h"
 
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define BOBAIL_HAVE_AVX2_KERNEL 1
+#endif
+
 namespace bobail {
 
 std::array<std::array<int, NUM_SQUARES>, NUM_SYMMETRIES> symmetry_map;
@@ -65,34 +70,86 @@ State apply_symmetry(const State& s, int sym) {
 }
 
 std::pair<State, int> canonicalize(const State& s) {
-    State best = s;
-    int best_sym = 0;
-    uint64_t best_packed = pack_state(s);
-
     // Only use symmetries that preserve the goal rows (0 and 4).
     // In Bobail, row 0 is White's goal and row 4 is Black's goal.
     // Only horizontal flip (symmetry 4) preserves these rows.
     // Rotations and vertical flips would swap the goal semantics.
-    constexpr int valid_symmetries[] = {0, 4};  // identity and horizontal flip only
+    uint64_t packed = pack_state(s);
+    uint64_t mirrored = mirror_packed(packed);
 
-    for (int sym : valid_symmetries) {
-        if (sym == 0) continue;  // Already have identity as initial best
-        State transformed = apply_symmetry(s, sym);
-        uint64_t packed = pack_state(transformed);
+    if (mirrored < packed) {
+        return {unpack_state(mirrored), 4};
+    }
+    return {s, 0};
+}
 
-        if (packed < best_packed) {
-            best = transformed;
-            best_sym = sym;
-            best_packed = packed;
+uint64_t canonical_hash(const State& s) {
+    uint64_t canonical = canonical_pack(s);
+    if (g_hash_mode == HashMode::PACKED) return mix_key(canonical);
+    return compute_hash(unpack_state(canonical));
+}
+
+namespace {
+    void canonicalize_packed_scalar(const uint64_t* in, uint64_t* out, size_t n) {
+        for (size_t i = 0; i < n; ++i) {
+            out[i] = canonical_packed(in[i]);
         }
     }
 
-    return {best, best_sym};
+#ifdef BOBAIL_HAVE_AVX2_KERNEL
+    // Four packed states per iteration; same arithmetic as mirror_packed.
+    // All packed values are below 2^56, so the signed 64-bit compare is safe.
+    __attribute__((target("avx2")))
+    void canonicalize_packed_avx2(const uint64_t* in, uint64_t* out, size_t n) {
+        using namespace detail;
+        const __m256i col0 = _mm256_set1_epi64x(static_cast<long long>(PACKED_COL0));
+        const __m256i col1 = _mm256_set1_epi64x(static_cast<long long>(PACKED_COL1));
+        const __m256i col2 = _mm256_set1_epi64x(static_cast<long long>(PACKED_COL2));
+        const __m256i col3 = _mm256_set1_epi64x(static_cast<long long>(PACKED_COL3));
+        const __m256i col4 = _mm256_set1_epi64x(static_cast<long long>(PACKED_COL4));
+        const __m256i side = _mm256_set1_epi64x(static_cast<long long>(PACKED_SIDE_BIT));
+        const __m256i five_bits = _mm256_set1_epi64x(0x1F);
+        const __m256i thirteen = _mm256_set1_epi64x(13);
+        const __m256i four = _mm256_set1_epi64x(4);
+
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            __m256i p = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+
+            __m256i pawns = _mm256_or_si256(
+                _mm256_or_si256(_mm256_slli_epi64(_mm256_and_si256(p, col0), 4),
+                                _mm256_slli_epi64(_mm256_and_si256(p, col1), 2)),
+                _mm256_or_si256(_mm256_and_si256(p, col2),
+                                _mm256_or_si256(_mm256_srli_epi64(_mm256_and_si256(p, col3), 2),
+                                                _mm256_srli_epi64(_mm256_and_si256(p, col4), 4))));
+
+            __m256i b = _mm256_and_si256(_mm256_srli_epi64(p, 50), five_bits);
+            __m256i q = _mm256_srli_epi64(_mm256_mul_epu32(b, thirteen), 6);
+            __m256i c = _mm256_sub_epi64(b, _mm256_add_epi64(_mm256_slli_epi64(q, 2), q));
+            __m256i mb = _mm256_and_si256(
+                _mm256_sub_epi64(_mm256_add_epi64(b, four), _mm256_slli_epi64(c, 1)), five_bits);
+
+            __m256i m = _mm256_or_si256(_mm256_or_si256(pawns, _mm256_slli_epi64(mb, 50)),
+                                        _mm256_and_si256(p, side));
+
+            __m256i take_mirror = _mm256_cmpgt_epi64(p, m);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i),
+                                _mm256_blendv_epi8(p, m, take_mirror));
+        }
+        canonicalize_packed_scalar(in + i, out + i, n - i);
+    }
+#endif
 }
 
-uint64_t canonical_hash(const State& s) {
-    auto [canonical, _] = canonicalize(s);
-    return compute_hash(canonical);
+void canonicalize_packed_batch(const uint64_t* in, uint64_t* out, size_t n) {
+#ifdef BOBAIL_HAVE_AVX2_KERNEL
+    static const bool has_avx2 = __builtin_cpu_supports("avx2");
+    if (has_avx2) {
+        canonicalize_packed_avx2(in, out, n);
+        return;
+    }
+#endif
+    canonicalize_packed_scalar(in, out, n);
 }
 
 } // namespace bobail
@@ -0,0 +1,318 @@
+#include "tablebase.h"
+#include "rank.h"
+#include "retrograde_bitmap.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace bobail {
+
+Tablebase::~Tablebase() {
+    close();
+}
+
+bool Tablebase::open(const std::string& path) {
+    close();
+
+    fd_ = ::open(path.c_str(), O_RDONLY);
+    if (fd_ < 0) {
+        std::cerr << "Failed to open " << path << ": " << std::strerror(errno) << "\n";
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd_, &st) != 0) {
+        std::cerr << "Failed to stat " << path << ": " << std::strerror(errno) << "\n";
+        close();
+        return false;
+    }
+    if (static_cast<uint64_t>(st.st_size) < HEADER_BYTES) {
+        std::cerr << "Tablebase " << path << " is too small\n";
+        close();
+        return false;
+    }
+
+    mapping_bytes_ = static_cast<size_t>(st.st_size);
+    mapping_ = mmap(nullptr, mapping_bytes_, PROT_READ, MAP_SHARED, fd_, 0);
+    if (mapping_ == MAP_FAILED) {
+        mapping_ = nullptr;
+        std::cerr << "Failed to map " << path << ": " << std::strerror(errno) << "\n";
+        close();
+        return false;
+    }
+
+    // Probes jump around the file; readahead would only waste page cache
+    madvise(mapping_, mapping_bytes_, MADV_RANDOM);
+
+    if (!attach(mapping_, mapping_bytes_, path)) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool Tablebase::open_buffer(const void* data, size_t size) {
+    close();
+    if (size < HEADER_BYTES) {
+        std::cerr << "Tablebase buffer is too small\n";
+        return false;
+    }
+    if (!attach(data, size, "buffer")) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool Tablebase::attach(const void* data, size_t size, const std::string& name) {
+    const auto* h = static_cast<const TablebaseHeader*>(data);
+    if (h->magic != MAGIC || h->version != VERSION) {
+        std::cerr << "Tablebase " << name << " has an unrecognized header\n";
+        return false;
+    }
+    if (h->rules_variant != static_cast<uint32_t>(g_rules_variant)) {
+        std::cerr << "Tablebase " << name << " was solved with "
+                  << (h->rules_variant == static_cast<uint32_t>(RulesVariant::OFFICIAL) ? "official" : "flexible")
+                  << " rules; pass the matching rules flag\n";
+        return false;
+    }
+
+    uint64_t data_bytes = 0;
+    if (h->kind == static_cast<uint32_t>(TablebaseKind::SORTED)) {
+        uint64_t fences = (h->num_entries + FENCE_STRIDE - 1) / FENCE_STRIDE;
+        if (h->num_fences != fences ||
+            h->fence_offset < h->data_offset + h->num_entries * sizeof(uint64_t) ||
+            h->fence_offset + h->num_fences * sizeof(uint64_t) > size) {
+            std::cerr << "Tablebase " << name << " is truncated or corrupt\n";
+            return false;
+        }
+        data_bytes = h->num_entries * sizeof(uint64_t);
+    } else if (h->kind == static_cast<uint32_t>(TablebaseKind::RANK_BITMAP)) {
+        if (h->num_entries != RANK_SPACE_SIZE) {
+            std::cerr << "Tablebase " << name << " does not cover the rank space\n";
+            return false;
+        }
+        data_bytes = ((h->num_entries + 31) / 32) * sizeof(uint64_t);
+    } else {
+        std::cerr << "Tablebase " << name << " has unknown kind " << h->kind << "\n";
+        return false;
+    }
+    if (h->data_offset % sizeof(uint64_t) != 0 || h->data_offset + data_bytes > size) {
+        std::cerr << "Tablebase " << name << " is truncated or corrupt\n";
+        return false;
+    }
+
+    const char* base = static_cast<const char*>(data);
+    header_ = h;
+    data_ = reinterpret_cast<const uint64_t*>(base + h->data_offset);
+    fences_ = h->kind == static_cast<uint32_t>(TablebaseKind::SORTED)
+            ? reinterpret_cast<const uint64_t*>(base + h->fence_offset) : nullptr;
+    return true;
+}
+
+void Tablebase::close() {
+    if (mapping_) {
+        munmap(mapping_, mapping_bytes_);
+        mapping_ = nullptr;
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+    mapping_bytes_ = 0;
+    header_ = nullptr;
+    data_ = nullptr;
+    fences_ = nullptr;
+}
+
+Result Tablebase::probe(const State& s) const {
+    uint8_t dtw;
+    return probe(s, dtw);
+}
+
+Result Tablebase::probe(const State& s, uint8_t& dtw) const {
+    dtw = 0;
+    if (!header_) return Result::UNKNOWN;
+
+    uint64_t rank = rank_state(s);
+
+    if (kind() == TablebaseKind::RANK_BITMAP) {
+        uint64_t w = data_[rank >> 5];
+        return decode_bitmap_result(static_cast<uint8_t>((w >> ((rank & 31) * 2)) & 3));
+    }
+
+    // First fence past the rank; the entry, if any, is in the page before it
+    const uint64_t* fence = std::upper_bound(fences_, fences_ + header_->num_fences, rank);
+    if (fence == fences_) return Result::UNKNOWN;
+    uint64_t first = static_cast<uint64_t>(fence - fences_ - 1) * FENCE_STRIDE;
+    uint64_t last = std::min(first + FENCE_STRIDE, header_->num_entries);
+
+    const uint64_t* entry = std::lower_bound(data_ + first, data_ + last, rank << 16);
+    if (entry == data_ + last || (*entry >> 16) != rank) return Result::UNKNOWN;
+
+    Result r = decode_bitmap_result(static_cast<uint8_t>(*entry & 3));
+    if (has_dtw() && (r == Result::WIN || r == Result::LOSS)) {
+        dtw = static_cast<uint8_t>(*entry >> 8);
+    }
+    return r;
+}
+
+Move Tablebase::best_move(const State& s) const {
+    Result my_result = probe(s);
+
+    MoveList moves;
+    generate_moves(s, moves);
+    if (moves.empty()) {
+        return Move{};
+    }
+
+    Move best = moves[0];
+    bool found = false;
+    uint8_t best_dtw = 0;
+
+    for (const auto& move : moves) {
+        uint8_t opp_dtw;
+        Result opp_result = probe(apply_move(s, move), opp_dtw);
+
+        if (my_result == Result::WIN && opp_result == Result::LOSS) {
+            if (!found || opp_dtw < best_dtw) {
+                best = move;
+                best_dtw = opp_dtw;
+                found = true;
+            }
+        }
+        if (my_result == Result::DRAW && opp_result == Result::DRAW) {
+            return move;
+        }
+        if (my_result == Result::LOSS) {
+            if (opp_result == Result::DRAW) return move;
+            if (opp_result == Result::WIN && (!found || opp_dtw > best_dtw)) {
+                best = move;
+                best_dtw = opp_dtw;
+                found = true;
+            }
+        }
+    }
+
+    return best;
+}
+
+// ============================================================================
+// Writers
+// ============================================================================
+
+namespace {
+    TablebaseHeader make_header(TablebaseKind kind, uint64_t num_entries) {
+        TablebaseHeader h;
+        std::memset(&h, 0, sizeof(h));
+        h.magic = Tablebase::MAGIC;
+        h.version = Tablebase::VERSION;
+        h.kind = static_cast<uint32_t>(kind);
+        h.rules_variant = static_cast<uint32_t>(g_rules_variant);
+        h.num_entries = num_entries;
+        h.data_offset = Tablebase::HEADER_BYTES;
+        return h;
+    }
+
+    void count_result(TablebaseHeader& h, uint8_t code, uint64_t n = 1) {
+        switch (code) {
+            case BITMAP_WIN: h.num_wins += n; break;
+            case BITMAP_LOSS: h.num_losses += n; break;
+            case BITMAP_DRAW: h.num_draws += n; break;
+            default: break;
+        }
+    }
+
+    // Write header page plus data to a temporary file, then rename it
+    // into place so readers never map a half-written tablebase
+    bool write_file(const std::string& path, const TablebaseHeader& h,
+                    const void* data, uint64_t data_bytes,
+                    const std::vector<uint64_t>& fences) {
+        std::string tmp_path = path + ".tmp";
+        std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            std::cerr << "Failed to create " << tmp_path << "\n";
+            return false;
+        }
+
+        std::vector<char> page(Tablebase::HEADER_BYTES, 0);
+        std::memcpy(page.data(), &h, sizeof(h));
+        out.write(page.data(), page.size());
+
+        // Large tables go out in pieces to keep single writes reasonable
+        const char* p = static_cast<const char*>(data);
+        const uint64_t PIECE = 64ULL * 1024 * 1024;
+        for (uint64_t done = 0; done < data_bytes && out; done += PIECE) {
+            out.write(p + done, static_cast<std::streamsize>(std::min(PIECE, data_bytes - done)));
+        }
+        out.write(reinterpret_cast<const char*>(fences.data()),
+                  static_cast<std::streamsize>(fences.size() * sizeof(uint64_t)));
+        out.close();
+
+        if (!out) {
+            std::cerr << "Failed to write " << tmp_path << "\n";
+            std::remove(tmp_path.c_str());
+            return false;
+        }
+        if (std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+            std::cerr << "Failed to rename " << tmp_path << " to " << path << ": "
+                      << std::strerror(errno) << "\n";
+            std::remove(tmp_path.c_str());
+            return false;
+        }
+        return true;
+    }
+}
+
+bool write_tablebase_sorted(const std::string& path, std::vector<uint64_t>& entries, bool has_dtw) {
+    std::sort(entries.begin(), entries.end());
+    for (size_t i = 1; i < entries.size(); ++i) {
+        if ((entries[i] >> 16) == (entries[i - 1] >> 16)) {
+            std::cerr << "Duplicate rank " << (entries[i] >> 16) << " in tablebase entries\n";
+            return false;
+        }
+    }
+
+    TablebaseHeader h = make_header(TablebaseKind::SORTED, entries.size());
+    if (has_dtw) h.flags |= TABLEBASE_HAS_DTW;
+
+    std::vector<uint64_t> fences;
+    fences.reserve((entries.size() + Tablebase::FENCE_STRIDE - 1) / Tablebase::FENCE_STRIDE);
+    for (size_t i = 0; i < entries.size(); ++i) {
+        if (i % Tablebase::FENCE_STRIDE == 0) fences.push_back(entries[i] >> 16);
+        count_result(h, static_cast<uint8_t>(entries[i] & 3));
+    }
+    h.num_fences = fences.size();
+    h.fence_offset = h.data_offset + entries.size() * sizeof(uint64_t);
+
+    return write_file(path, h, entries.data(), entries.size() * sizeof(uint64_t), fences);
+}
+
+bool write_tablebase_bitmap(const std::string& path, const uint64_t* words, uint64_t num_cells) {
+    if (num_cells != RANK_SPACE_SIZE) {
+        std::cerr << "A bitmap tablebase needs one cell per rank index\n";
+        return false;
+    }
+
+    TablebaseHeader h = make_header(TablebaseKind::RANK_BITMAP, num_cells);
+    uint64_t num_words = (num_cells + 31) / 32;
+    for (uint64_t i = 0; i < num_words; ++i) {
+        uint64_t w = words[i];
+        if (!w) continue;
+        for (int c = 0; c < 32; ++c) {
+            count_result(h, static_cast<uint8_t>((w >> (c * 2)) & 3));
+        }
+    }
+    h.fence_offset = h.data_offset + num_words * sizeof(uint64_t);
+
+    return write_file(path, h, words, num_words * sizeof(uint64_t), {});
+}
+
+} // namespace bobail
@@ -4,22 +4,10 @@
 #include "movegen.h"
 #include "hash.h"
 #include "symmetry.h"
+#include "pns_table.h"
 #include <iostream>
-#include <fstream>
-#include <unordered_map>
 
-namespace bobail {
-
-struct PNSTTEntry {
-    uint64_t hash;
-    uint32_t proof;
-    uint32_t disproof;
-    uint8_t result;  // 0=unknown, 1=win, 2=loss, 3=draw
-};
-
-}  // namespace bobail
-
-std::unordered_map<uint64_t, bobail::PNSTTEntry> pns_table;
+bobail::PNSTableFile pns_table;
 
 void print_board(const bobail::State& state) {
     std::cout << "  01234\n";
@@ -50,8 +38,8 @@ bobail::Move find_best_move(const bobail::State& state) {
         bobail::State child = bobail::apply_move(state, move);
         uint64_t child_hash = bobail::canonical_hash(child);
 
-        auto it = pns_table.find(child_hash);
-        if (it != pns_table.end() && it->second.result == 2) {
+        const bobail::PNSSlot* entry = pns_table.find(child_hash);
+        if (entry && entry->result() == 2) {
             return move;
         }
     }
@@ -64,11 +52,11 @@ bobail::Move find_best_move(const bobail::State& state) {
         bobail::State child = bobail::apply_move(state, move);
         uint64_t child_hash = bobail::canonical_hash(child);
 
-        auto it = pns_table.find(child_hash);
-        if (it != pns_table.end()) {
+        const bobail::PNSSlot* entry = pns_table.find(child_hash);
+        if (entry) {
             // Use PN as score - we want low PN (opponent needs more work to win)
-            if (it->second.proof < best_score) {
-                best_score = it->second.proof;
+            if (entry->proof() < best_score) {
+                best_score = entry->proof();
                 best = move;
             }
         }
@@ -88,28 +76,11 @@ int main(int argc, char* argv[]) {
     }
 
     // Load checkpoint
-    std::ifstream in(checkpoint, std::ios::binary);
-    if (!in) {
-        std::cerr << "Cannot open checkpoint: " << checkpoint << "\n";
+    if (!pns_table.open(checkpoint)) {
+        std::cerr << "Cannot load checkpoint: " << checkpoint << "\n";
         return 1;
     }
 
-    uint64_t magic, version, num_entries;
-    uint64_t stats[4];
-
-    in.read(reinterpret_cast<char*>(&magic), sizeof(magic));
-    in.read(reinterpret_cast<char*>(&version), sizeof(version));
-    in.read(reinterpret_cast<char*>(&num_entries), sizeof(num_entries));
-    in.read(reinterpret_cast<char*>(stats), sizeof(stats));
-
-    std::cout << "Loading " << num_entries << " entries...\n";
-
-    for (uint64_t i = 0; i < num_entries; ++i) {
-        bobail::PNSTTEntry entry;
-        in.read(reinterpret_cast<char*>(&entry), sizeof(entry));
-        pns_table[entry.hash] = entry;
-    }
-
     std::cout << "Loaded " << pns_table.size() << " entries\n\n";
 
     // Start from root and make the alternate first move
@@ -159,9 +130,9 @@ int main(int argc, char* argv[]) {
 
         bobail::State child = bobail::apply_move(state, best);
         uint64_t child_hash = bobail::canonical_hash(child);
-        auto it = pns_table.find(child_hash);
-        if (it != pns_table.end()) {
-            std::cout << " (result=" << (int)it->second.result << ")";
+        const bobail::PNSSlot* entry = pns_table.find(child_hash);
+        if (entry) {
+            std::cout << " (result=" << (int)entry->result() << ")";
         }
         std::cout << "\n";
 
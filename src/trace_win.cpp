@@ -5,22 +5,10 @@
 #include "movegen.h"
 #include "hash.h"
 #include "symmetry.h"
+#include "pns_table.h"
 #include <iostream>
-#include <fstream>
-#include <unordered_map>
 
-namespace bobail {
-
-struct PNSTTEntry {
-    uint64_t hash;
-    uint32_t proof;
-    uint32_t disproof;
-    uint8_t result;  // 0=unknown, 1=win, 2=loss, 3=draw
-};
-
-}  // namespace bobail
-
-std::unordered_map<uint64_t, bobail::PNSTTEntry> pns_table;
+bobail::PNSTableFile pns_table;
 
 void print_board(const bobail::State& state) {
     std::cout << "  01234\n";
@@ -54,18 +42,18 @@ bobail::Move find_best_move(const bobail::State& state, bool maximizing) {
         bobail::State child = bobail::apply_move(state, move);
         uint64_t child_hash = bobail::canonical_hash(child);
 
-        auto it = pns_table.find(child_hash);
-        if (it == pns_table.end()) continue;
+        const bobail::PNSSlot* entry = pns_table.find(child_hash);
+        if (!entry) continue;
 
         int score = 0;
         // result is from child's perspective (opponent after our move)
-        if (it->second.result == 2) {  // Opponent loses = we win
+        if (entry->result() == 2) {  // Opponent loses = we win
             score = maximizing ? 100000 : -100000;
-        } else if (it->second.result == 1) {  // Opponent wins = we lose
+        } else if (entry->result() == 1) {  // Opponent wins = we lose
             score = maximizing ? -100000 : 100000;
         } else {
             // Use DN/(PN+DN) as heuristic
-            double ratio = (double)it->second.disproof / (it->second.proof + it->second.disproof + 1);
+            double ratio = (double)entry->disproof() / (entry->proof() + entry->disproof() + 1);
             score = (int)((ratio - 0.5) * 1000);
             if (!maximizing) score = -score;
         }
@@ -90,31 +78,11 @@ int main(int argc, char* argv[]) {
     }
 
     // Load checkpoint
-    std::ifstream in(checkpoint, std::ios::binary);
-    if (!in) {
-        std::cerr << "Cannot open checkpoint: " << checkpoint << "\n";
+    if (!pns_table.open(checkpoint)) {
+        std::cerr << "Cannot load checkpoint: " << checkpoint << "\n";
         return 1;
     }
 
-    uint64_t magic, version, num_entries;
-    uint64_t nodes_searched, nodes_proved, nodes_disproved, retro_hits;
-
-    in.read(reinterpret_cast<char*>(&magic), sizeof(magic));
-    in.read(reinterpret_cast<char*>(&version), sizeof(version));
-    in.read(reinterpret_cast<char*>(&num_entries), sizeof(num_entries));
-    in.read(reinterpret_cast<char*>(&nodes_searched), sizeof(nodes_searched));
-    in.read(reinterpret_cast<char*>(&nodes_proved), sizeof(nodes_proved));
-    in.read(reinterpret_cast<char*>(&nodes_disproved), sizeof(nodes_disproved));
-    in.read(reinterpret_cast<char*>(&retro_hits), sizeof(retro_hits));
-
-    std::cout << "Loading " << num_entries << " PNS entries...\n";
-
-    for (uint64_t i = 0; i < num_entries; ++i) {
-        bobail::PNSTTEntry entry;
-        in.read(reinterpret_cast<char*>(&entry), sizeof(entry));
-        pns_table[entry.hash] = entry;
-    }
-
     std::cout << "Loaded " << pns_table.size() << " entries\n\n";
 
     // Start from root and trace winning line
@@ -150,8 +118,8 @@ int main(int argc, char* argv[]) {
             bobail::State child = bobail::apply_move(state, move);
             uint64_t child_hash = bobail::canonical_hash(child);
 
-            auto it = pns_table.find(child_hash);
-            if (it != pns_table.end() && it->second.result == 2) {
+            const bobail::PNSSlot* entry = pns_table.find(child_hash);
+            if (entry && entry->result() == 2) {
                 // This move forces opponent into a lost position
                 best = move;
                 found_proved = true;
@@ -173,9 +141,9 @@ int main(int argc, char* argv[]) {
 
         bobail::State child = bobail::apply_move(state, best);
         uint64_t child_hash = bobail::canonical_hash(child);
-        auto it = pns_table.find(child_hash);
-        if (it != pns_table.end()) {
-            std::cout << " (result=" << (int)it->second.result << ")";
+        const bobail::PNSSlot* entry = pns_table.find(child_hash);
+        if (entry) {
+            std::cout << " (result=" << (int)entry->result() << ")";
         }
         std::cout << "\n";
 
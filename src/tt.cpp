@@ -1,6 +1,13 @@
 #include "tt.h"
 #include <bit>
 #include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
 
 namespace bobail {
 
@@ -44,4 +51,195 @@ double TranspositionTable::fill_rate() const {
     return static_cast<double>(filled) / entries_.size();
 }
 
+// ============================================================================
+// PNSTable
+// ============================================================================
+
+PNSSlot* PNSTable::allocate(size_t capacity) {
+    // Anonymous mapping: zeroed (all slots empty) and page aligned
+    size_t bytes = capacity * sizeof(PNSSlot);
+    void* mem = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) {
+        std::cerr << "Failed to allocate " << bytes << " byte PNS table: " << std::strerror(errno) << "\n";
+        return nullptr;
+    }
+#ifdef MADV_HUGEPAGE
+    madvise(mem, bytes, MADV_HUGEPAGE);
+#endif
+    return static_cast<PNSSlot*>(mem);
+}
+
+void PNSTable::release(PNSSlot* slots, size_t capacity) {
+    if (slots) munmap(slots, capacity * sizeof(PNSSlot));
+}
+
+PNSTable::PNSTable(size_t capacity) {
+    capacity = std::bit_ceil(std::max<size_t>(capacity, 16));
+    slots_ = allocate(capacity);
+    if (!slots_) throw std::bad_alloc();
+    mask_ = capacity - 1;
+}
+
+PNSTable::~PNSTable() {
+    release(slots_, capacity());
+}
+
+PNSSlot* PNSTable::insert(uint64_t key) {
+    if (PNSSlot* slot = find(key)) return slot;
+
+    // Keep one slot empty so probe loops always terminate
+    if (size_ + 1 >= capacity() && !grow()) throw std::bad_alloc();
+
+    PNSSlot* slot = &slots_[free_slot(key)];
+    slot->set(1, 1, 0);
+    // Published like insert_shared() for a concurrent checkpoint writer
+    std::atomic_ref<uint64_t>(slot->key).store(key, std::memory_order_release);
+    ++size_;
+    mark_dirty(slot);
+    return slot;
+}
+
+PNSSlot* PNSTable::insert_shared(uint64_t key) {
+    for (size_t i = key & mask_;; i = (i + 1) & mask_) {
+        std::atomic_ref<uint64_t> slot_key(slots_[i].key);
+        uint64_t k = slot_key.load(std::memory_order_acquire);
+        if (k == key) return &slots_[i];
+        if (k != 0) continue;
+
+        // Keep one slot empty so probe loops always terminate
+        if (size_.fetch_add(1, std::memory_order_relaxed) + 2 > capacity()) {
+            size_.fetch_sub(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        // Numbers are still zero, which reads as PN = DN = 1
+        if (slot_key.compare_exchange_strong(k, key, std::memory_order_acq_rel)) {
+            mark_dirty(&slots_[i]);
+            return &slots_[i];
+        }
+        size_.fetch_sub(1, std::memory_order_relaxed);
+        if (k == key) return &slots_[i];
+    }
+}
+
+void PNSTable::clear() {
+    std::memset(slots_, 0, memory_bytes());
+    size_ = 0;
+    marks_.clear();
+    layout_changed();
+}
+
+bool PNSTable::grow() {
+    size_t old_capacity = capacity();
+    PNSSlot* fresh = allocate(old_capacity * 2);
+    if (!fresh) return false;
+
+    PNSSlot* old = slots_;
+    slots_ = fresh;
+    mask_ = old_capacity * 2 - 1;
+    for (size_t i = 0; i < old_capacity; ++i) {
+        if (old[i].key != 0) slots_[free_slot(old[i].key)] = old[i];
+    }
+    release(old, old_capacity);
+    marks_.clear();
+    layout_changed();
+    return true;
+}
+
+bool PNSTable::reserve(size_t n) {
+    while (static_cast<double>(n) > capacity() * MAX_LOAD) {
+        if (!grow()) return false;
+    }
+    return true;
+}
+
+void PNSTable::clear_marks() {
+    marks_.assign((capacity() + 63) / 64, 0);
+}
+
+bool PNSTable::mark(const PNSSlot* slot) {
+    size_t i = static_cast<size_t>(slot - slots_);
+    uint64_t bit = 1ULL << (i & 63);
+    if (marks_[i >> 6] & bit) return false;
+    marks_[i >> 6] |= bit;
+    return true;
+}
+
+size_t PNSTable::sweep() {
+    // Start re-packing just past a slot that was already empty: no probe
+    // sequence runs across it, so every cluster is handled in one pass
+    size_t start = 0;
+    while (slots_[start].key != 0) ++start;
+
+    size_t removed = 0;
+    for (size_t i = 0; i <= mask_; ++i) {
+        if (slots_[i].key != 0 && !(marks_[i >> 6] & (1ULL << (i & 63)))) {
+            slots_[i] = PNSSlot{};
+            ++removed;
+        }
+    }
+    size_ -= removed;
+    marks_.clear();
+
+    // Re-insert every survivor: each lands at or before its old slot, so
+    // the scan never sees an entry twice
+    for (size_t n = 1; n <= mask_; ++n) {
+        size_t i = (start + n) & mask_;
+        if (slots_[i].key == 0) continue;
+        PNSSlot slot = slots_[i];
+        slots_[i] = PNSSlot{};
+        slots_[free_slot(slot.key)] = slot;
+    }
+    layout_changed();
+    return removed;
+}
+
+void PNSTable::track_dirty(bool enabled) {
+    track_dirty_ = enabled;
+    dirty_.clear();
+    if (enabled) dirty_.assign((capacity() + 63) / 64, 0);
+}
+
+std::vector<uint64_t> PNSTable::take_dirty() {
+    std::vector<uint64_t> taken;
+    taken.swap(dirty_);
+    if (track_dirty_) dirty_.assign((capacity() + 63) / 64, 0);
+    return taken;
+}
+
+void PNSTable::layout_changed() {
+    ++layout_version_;
+    // Slot indices recorded so far no longer mean anything
+    if (track_dirty_) dirty_.assign((capacity() + 63) / 64, 0);
+}
+
+bool PNSTable::map_file(const std::string& path, uint64_t offset, size_t capacity, size_t size) {
+    if (capacity < 16 || !std::has_single_bit(capacity) || size >= capacity) {
+        std::cerr << path << ": bad table capacity " << capacity << "\n";
+        return false;
+    }
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Failed to open " << path << ": " << std::strerror(errno) << "\n";
+        return false;
+    }
+    // Private mapping: written pages become anonymous copies
+    size_t bytes = capacity * sizeof(PNSSlot);
+    void* mem = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, static_cast<off_t>(offset));
+    ::close(fd);
+    if (mem == MAP_FAILED) {
+        std::cerr << "Failed to map " << path << ": " << std::strerror(errno) << "\n";
+        return false;
+    }
+    // Start reading the file in the background
+    madvise(mem, bytes, MADV_WILLNEED);
+
+    release(slots_, this->capacity());
+    slots_ = static_cast<PNSSlot*>(mem);
+    mask_ = capacity - 1;
+    size_ = size;
+    marks_.clear();
+    layout_changed();
+    return true;
+}
+
 } // namespace bobail
@@ -5,22 +5,10 @@
 #include "movegen.h"
 #include "hash.h"
 #include "symmetry.h"
+#include "pns_table.h"
 #include <iostream>
-#include <fstream>
-#include <unordered_map>
 
-namespace bobail {
-
-struct PNSTTEntry {
-    uint64_t hash;
-    uint32_t proof;
-    uint32_t disproof;
-    uint8_t result;  // 0=unknown, 1=win, 2=loss, 3=draw
-};
-
-}  // namespace bobail
-
-std::unordered_map<uint64_t, bobail::PNSTTEntry> pns_table;
+bobail::PNSTableFile pns_table;
 
 void print_board(const bobail::State& state) {
     std::cout << "  01234\n";
@@ -52,28 +40,12 @@ int main(int argc, char* argv[]) {
         checkpoint = argv[1];
     }
 
-    std::ifstream in(checkpoint, std::ios::binary);
-    if (!in) {
-        std::cerr << "Cannot open checkpoint\n";
+    // Load checkpoint
+    if (!pns_table.open(checkpoint)) {
+        std::cerr << "Cannot load checkpoint: " << checkpoint << "\n";
         return 1;
     }
 
-    uint64_t magic, version, num_entries;
-    uint64_t stats[4];
-
-    in.read(reinterpret_cast<char*>(&magic), sizeof(magic));
-    in.read(reinterpret_cast<char*>(&version), sizeof(version));
-    in.read(reinterpret_cast<char*>(&num_entries), sizeof(num_entries));
-    in.read(reinterpret_cast<char*>(stats), sizeof(stats));
-
-    std::cout << "Loading " << num_entries << " entries...\n";
-
-    for (uint64_t i = 0; i < num_entries; ++i) {
-        bobail::PNSTTEntry entry;
-        in.read(reinterpret_cast<char*>(&entry), sizeof(entry));
-        pns_table[entry.hash] = entry;
-    }
-
     std::cout << "Loaded.\n\n";
 
     // Starting position
@@ -97,11 +69,11 @@ int main(int argc, char* argv[]) {
     std::cout << "Black to move\n\n";
 
     uint64_t after_hash = bobail::canonical_hash(after_white);
-    auto it = pns_table.find(after_hash);
-    if (it != pns_table.end()) {
-        std::cout << "This position: PN=" << it->second.proof
-                  << " DN=" << it->second.disproof
-                  << " result=" << (int)it->second.result << "\n\n";
+    const bobail::PNSSlot* entry = pns_table.find(after_hash);
+    if (entry) {
+        std::cout << "This position: PN=" << entry->proof()
+                  << " DN=" << entry->disproof()
+                  << " result=" << (int)entry->result() << "\n\n";
     }
 
     // Check all of Black's responses
@@ -119,18 +91,18 @@ int main(int argc, char* argv[]) {
 
         std::cout << "  " << move.to_string() << ": ";
 
-        auto child_it = pns_table.find(child_hash);
-        if (child_it != pns_table.end()) {
-            std::cout << "PN=" << child_it->second.proof
-                      << " DN=" << child_it->second.disproof
-                      << " result=" << (int)child_it->second.result;
+        const bobail::PNSSlot* child_entry = pns_table.find(child_hash);
+        if (child_entry) {
+            std::cout << "PN=" << child_entry->proof()
+                      << " DN=" << child_entry->disproof()
+                      << " result=" << (int)child_entry->result();
 
             // Now it's White's turn in this position
             // result=1 means WIN for white, result=2 means LOSS for white
-            if (child_it->second.result == 1) {
+            if (child_entry->result() == 1) {
                 std::cout << " -> WHITE HAS FORCED WIN";
                 ++white_wins;
-            } else if (child_it->second.result == 2) {
+            } else if (child_entry->result() == 2) {
                 std::cout << " -> Black has forced win";
                 ++black_wins;
             } else {
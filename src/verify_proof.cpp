@@ -0,0 +1,143 @@
+// Verify the proof tree a PNS checkpoint holds for the starting position
+// (or, if the root is unproved, for each proved move from it), in parallel
+// and short-circuited by a tablebase (see proof_verifier.h)
+
+#include "board.h"
+#include "movegen.h"
+#include "hash.h"
+#include "symmetry.h"
+#include "pns_table.h"
+#include "proof_verifier.h"
+#include "tablebase.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+
+using namespace bobail;
+
+void print_usage(const char* prog) {
+    std::cerr << "Usage: " << prog << " CHECKPOINT [options]\n"
+              << "CHECKPOINT is a PNS checkpoint or table file (pns_export --write-table)\n"
+              << "Options:\n"
+              << "  --tablebase FILE    Trust this tablebase instead of expanding the positions it knows\n"
+              << "  --threads N         Verification threads [default: all cores]\n"
+              << "  --max-failures N    Stop after N failures [default: 20]\n"
+              << "  --official          Use official rules [default]\n"
+              << "  --flexible          Use flexible rules\n";
+}
+
+Result stored_result(const PNSTableFile& pns, const State& s) {
+    const PNSSlot* entry = pns.find(canonical_hash(s));
+    if (!entry) return Result::UNKNOWN;
+    switch (entry->result()) {
+        case 1: return Result::WIN;
+        case 2: return Result::LOSS;
+        default: return Result::UNKNOWN;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    std::string checkpoint;
+    std::string tablebase_path;
+    int num_threads = std::max(1u, std::thread::hardware_concurrency());
+    size_t max_failures = 20;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--tablebase") == 0 && i + 1 < argc) {
+            tablebase_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            num_threads = std::max(1, std::stoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--max-failures") == 0 && i + 1 < argc) {
+            max_failures = std::max(1ULL, std::stoull(argv[++i]));
+        } else if (std::strcmp(argv[i], "--official") == 0) {
+            g_rules_variant = RulesVariant::OFFICIAL;
+        } else if (std::strcmp(argv[i], "--flexible") == 0) {
+            g_rules_variant = RulesVariant::FLEXIBLE;
+        } else if (std::strcmp(argv[i], "--help") == 0 || std::strcmp(argv[i], "-h") == 0) {
+            print_usage(argv[0]);
+            return 0;
+        } else if (argv[i][0] != '-' && checkpoint.empty()) {
+            checkpoint = argv[i];
+        } else {
+            std::cerr << "Unknown option: " << argv[i] << "\n";
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (checkpoint.empty()) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    init_move_tables();
+    init_zobrist();
+    init_symmetry();
+
+    PNSTableFile pns_table;
+    if (!pns_table.open(checkpoint)) {
+        std::cerr << "Cannot load checkpoint: " << checkpoint << "\n";
+        return 1;
+    }
+    std::cout << "Loaded " << pns_table.size() << " entries\n";
+
+    Tablebase tablebase;
+    if (!tablebase_path.empty()) {
+        if (!tablebase.open(tablebase_path)) {
+            std::cerr << "Cannot open tablebase: " << tablebase_path << "\n";
+            return 1;
+        }
+        std::cout << "Tablebase: " << tablebase_path << "\n";
+    }
+
+    ProofVerifier verifier(pns_table, tablebase.is_open() ? &tablebase : nullptr);
+    verifier.set_num_threads(num_threads);
+    verifier.set_max_failures(max_failures);
+    verifier.set_progress_callback([](const char* phase, uint64_t current, uint64_t) {
+        std::cerr << "\r" << phase << ": " << current << " positions" << std::flush;
+    });
+
+    // The root's own proof if it has one, otherwise those of its moves
+    State root = State::starting_position();
+    std::vector<std::pair<std::string, State>> claims;
+    if (stored_result(pns_table, root) != Result::UNKNOWN) {
+        claims.emplace_back("start", root);
+    } else {
+        for (const auto& move : generate_moves(root)) {
+            State child = apply_move(root, move);
+            if (stored_result(pns_table, child) != Result::UNKNOWN) claims.emplace_back(move.to_string(), child);
+        }
+    }
+    if (claims.empty()) {
+        std::cout << "Nothing to verify: neither the start nor any move from it is proved\n";
+        return 0;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    bool all_ok = true;
+    for (const auto& [name, s] : claims) {
+        Result claim = stored_result(pns_table, s);
+        bool ok = verifier.verify(s, claim);
+        std::cerr << "\r";
+        std::cout << name << ": " << (claim == Result::WIN ? "WIN" : "LOSS") << " for the side to move "
+                  << (ok ? "verified" : "FAILED") << "\n";
+        all_ok = all_ok && ok;
+    }
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    const auto& stats = verifier.stats();
+    std::cout << "\nPositions expanded: " << stats.positions << "\n"
+              << "Terminal positions: " << stats.terminals << "\n"
+              << "Tablebase hits:     " << stats.tablebase_hits << "\n"
+              << "Time: " << secs << "s with " << num_threads << " threads\n";
+
+    if (!verifier.failures().empty()) {
+        std::cout << "\nFailures:\n";
+        for (const auto& f : verifier.failures()) {
+            std::cout << "  " << std::hex << f.packed << std::dec << ": " << f.reason << "\n";
+        }
+    }
+    return all_ok ? 0 : 1;
+}
@@ -5,20 +5,8 @@
 #include "movegen.h"
 #include "hash.h"
 #include "symmetry.h"
+#include "pns_table.h"
 #include <iostream>
-#include <fstream>
-#include <unordered_map>
-
-namespace bobail {
-
-struct PNSTTEntry {
-    uint64_t hash;
-    uint32_t proof;
-    uint32_t disproof;
-    uint8_t result;  // 0=unknown, 1=win, 2=loss, 3=draw
-};
-
-}  // namespace bobail
 
 int main(int argc, char* argv[]) {
     bobail::init_move_tables();
@@ -31,39 +19,13 @@ int main(int argc, char* argv[]) {
     }
 
     // Load checkpoint
-    std::ifstream in(checkpoint, std::ios::binary);
-    if (!in) {
-        std::cerr << "Cannot open checkpoint: " << checkpoint << "\n";
-        return 1;
-    }
-
-    uint64_t magic, version, num_entries;
-    uint64_t nodes_searched, nodes_proved, nodes_disproved, retro_hits;
-
-    in.read(reinterpret_cast<char*>(&magic), sizeof(magic));
-    if (magic != 0x504E5343484B5054ULL) {
-        std::cerr << "Invalid checkpoint magic\n";
+    bobail::PNSTableFile pns_table;
+    if (!pns_table.open(checkpoint)) {
+        std::cerr << "Cannot load checkpoint: " << checkpoint << "\n";
         return 1;
     }
-
-    in.read(reinterpret_cast<char*>(&version), sizeof(version));
-    in.read(reinterpret_cast<char*>(&num_entries), sizeof(num_entries));
-    in.read(reinterpret_cast<char*>(&nodes_searched), sizeof(nodes_searched));
-    in.read(reinterpret_cast<char*>(&nodes_proved), sizeof(nodes_proved));
-    in.read(reinterpret_cast<char*>(&nodes_disproved), sizeof(nodes_disproved));
-    in.read(reinterpret_cast<char*>(&retro_hits), sizeof(retro_hits));
-
-    std::cout << "Loading " << num_entries << " PNS entries...\n";
-    std::cout << "Stats: proved=" << nodes_proved << " disproved=" << nodes_disproved << "\n\n";
-
-    std::unordered_map<uint64_t, bobail::PNSTTEntry> pns_table;
-    pns_table.reserve(num_entries);
-
-    for (uint64_t i = 0; i < num_entries; ++i) {
-        bobail::PNSTTEntry entry;
-        in.read(reinterpret_cast<char*>(&entry), sizeof(entry));
-        pns_table[entry.hash] = entry;
-    }
+    std::cout << "Stats: proved=" << pns_table.counters()[1]
+              << " disproved=" << pns_table.counters()[2] << "\n\n";
 
     std::cout << "Loaded " << pns_table.size() << " entries\n\n";
 
@@ -75,11 +37,11 @@ int main(int argc, char* argv[]) {
     std::cout << "Side to move: " << (root.white_to_move ? "White" : "Black") << "\n";
     std::cout << "Root hash: " << std::hex << root_hash << std::dec << "\n";
 
-    auto root_it = pns_table.find(root_hash);
-    if (root_it != pns_table.end()) {
-        std::cout << "Root in TT: PN=" << root_it->second.proof
-                  << " DN=" << root_it->second.disproof
-                  << " result=" << (int)root_it->second.result << "\n";
+    const bobail::PNSSlot* root_entry = pns_table.find(root_hash);
+    if (root_entry) {
+        std::cout << "Root in TT: PN=" << root_entry->proof()
+                  << " DN=" << root_entry->disproof()
+                  << " result=" << (int)root_entry->result() << "\n";
     } else {
         std::cout << "Root NOT in TT!\n";
     }
@@ -98,26 +60,26 @@ int main(int argc, char* argv[]) {
         bobail::State child = bobail::apply_move(root, move);
         uint64_t child_hash = bobail::canonical_hash(child);
 
-        auto it = pns_table.find(child_hash);
-        if (it != pns_table.end()) {
+        const bobail::PNSSlot* entry = pns_table.find(child_hash);
+        if (entry) {
             std::cout << move.to_string() << ": ";
-            std::cout << "PN=" << it->second.proof;
-            std::cout << " DN=" << it->second.disproof;
-            std::cout << " result=" << (int)it->second.result;
+            std::cout << "PN=" << entry->proof();
+            std::cout << " DN=" << entry->disproof();
+            std::cout << " result=" << (int)entry->result();
 
-            if (it->second.result == 1) {
+            if (entry->result() == 1) {
                 std::cout << " [WIN for player-to-move = Black wins = BAD for us]";
                 ++losses_found;
-            } else if (it->second.result == 2) {
+            } else if (entry->result() == 2) {
                 std::cout << " [LOSS for player-to-move = Black loses = GOOD for us!]";
                 ++wins_found;
                 // Extra verification
-                if (it->second.proof == 0xFFFFFFFF && it->second.disproof == 0) {
+                if (entry->proof() == 0xFFFFFFFF && entry->disproof() == 0) {
                     std::cout << " (VERIFIED: proof=INF, disproof=0)";
                 } else {
                     std::cout << " (WARNING: proof/disproof don't match result!)";
                 }
-            } else if (it->second.result == 0) {
+            } else if (entry->result() == 0) {
                 ++unknown_found;
             }
             std::cout << "\n";
@@ -0,0 +1,91 @@
+#include "bloom_filter.h"
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+using namespace bobail;
+
+namespace {
+
+uint64_t test_key(uint64_t i) {
+    return i * 0x9E3779B97F4A7C15ULL + 12345;
+}
+
+} // namespace
+
+TEST(BloomFilterTest, SizeIsPowerOfTwo) {
+    BloomFilter filter(3 * 1024 * 1024);
+    EXPECT_EQ(filter.memory_bytes(), 2u * 1024 * 1024);
+
+    BloomFilter tiny(1);
+    EXPECT_EQ(tiny.memory_bytes(), 2 * BloomFilter::BLOCK_BYTES);
+}
+
+TEST(BloomFilterTest, NoFalseNegatives) {
+    BloomFilter filter(1 << 20);
+    for (uint64_t i = 0; i < 100000; ++i) filter.add(test_key(i));
+    for (uint64_t i = 0; i < 100000; ++i) {
+        ASSERT_TRUE(filter.maybe_contains(test_key(i))) << i;
+    }
+}
+
+TEST(BloomFilterTest, FalsePositiveRateIsLow) {
+    // 8 bits per key, as in the 2GB / ~2 billion key configuration
+    BloomFilter filter(1 << 20);
+    const uint64_t n = (1 << 20);
+    for (uint64_t i = 0; i < n; ++i) filter.add(test_key(i));
+
+    uint64_t false_positives = 0;
+    const uint64_t probes = 200000;
+    for (uint64_t i = 0; i < probes; ++i) {
+        if (filter.maybe_contains(test_key(n + i))) ++false_positives;
+    }
+    EXPECT_LT(static_cast<double>(false_positives) / probes, 0.05);
+
+    filter.clear();
+    EXPECT_FALSE(filter.maybe_contains(test_key(0)));
+}
+
+TEST(BloomFilterTest, ConcurrentAdds) {
+    BloomFilter filter(1 << 20);
+    const int num_threads = 4;
+    const uint64_t per_thread = 20000;
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < num_threads; ++t) {
+        threads.emplace_back([&, t]() {
+            for (uint64_t i = 0; i < per_thread; ++i) filter.add(test_key(t * per_thread + i));
+        });
+    }
+    for (auto& th : threads) th.join();
+
+    for (uint64_t i = 0; i < num_threads * per_thread; ++i) {
+        ASSERT_TRUE(filter.maybe_contains(test_key(i))) << i;
+    }
+}
+
+TEST(BloomFilterTest, SaveAndLoad) {
+    std::string path = "/tmp/bobail_bloom_test_" + std::to_string(getpid()) + ".bin";
+
+    BloomFilter filter(1 << 16);
+    for (uint64_t i = 0; i < 1000; ++i) filter.add(test_key(i));
+    ASSERT_TRUE(filter.save(path, 1000));
+
+    BloomFilter loaded(1 << 16);
+    uint64_t entries = 0;
+    ASSERT_TRUE(loaded.load(path, entries));
+    EXPECT_EQ(entries, 1000u);
+    for (uint64_t i = 0; i < 1000; ++i) {
+        ASSERT_TRUE(loaded.maybe_contains(test_key(i))) << i;
+    }
+
+    // A filter of a different size refuses the file
+    BloomFilter other(1 << 17);
+    EXPECT_FALSE(other.load(path, entries));
+
+    std::remove(path.c_str());
+    EXPECT_FALSE(loaded.load(path, entries));
+}
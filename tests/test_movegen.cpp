@@ -1,4 +1,5 @@
 #include "movegen.h"
+#include "symmetry.h"
 #include <gtest/gtest.h>
 #include <algorithm>
 
@@ -92,3 +93,190 @@ TEST_F(MoveGenTest, MoveEquality) {
     EXPECT_EQ(m1, m2);
     EXPECT_FALSE(m1 == m3);
 }
+
+namespace {
+
+// Straightforward ray walk used as a reference for the table-driven generator
+std::vector<Move> reference_moves(const State& s) {
+    std::vector<Move> moves;
+    uint32_t our_pawns = s.white_to_move ? s.white_pawns : s.black_pawns;
+
+    auto add_pawn_moves = [&](int bobail_to, uint32_t occupied) {
+        for (int sq = 0; sq < NUM_SQUARES; ++sq) {
+            if (!(our_pawns & (1u << sq))) continue;
+            for (int di = 0; di < 8; ++di) {
+                int furthest = -1;
+                for (int dest : rays[sq][di]) {
+                    if (occupied & (1u << dest)) break;
+                    if (g_rules_variant == RulesVariant::FLEXIBLE) {
+                        moves.push_back({static_cast<uint8_t>(bobail_to),
+                                         static_cast<uint8_t>(sq),
+                                         static_cast<uint8_t>(dest)});
+                    }
+                    furthest = dest;
+                }
+                if (g_rules_variant == RulesVariant::OFFICIAL && furthest >= 0) {
+                    moves.push_back({static_cast<uint8_t>(bobail_to),
+                                     static_cast<uint8_t>(sq),
+                                     static_cast<uint8_t>(furthest)});
+                }
+            }
+        }
+    };
+
+    if (is_starting_position(s)) {
+        add_pawn_moves(s.bobail_sq, s.occupied());
+        return moves;
+    }
+
+    for (int dest : neighbors[s.bobail_sq]) {
+        if (s.occupied() & (1u << dest)) continue;
+        int row = State::row(dest);
+        if (row == 0 || row == BOARD_SIZE - 1) {
+            uint8_t first = static_cast<uint8_t>(__builtin_ctz(our_pawns));
+            moves.push_back({static_cast<uint8_t>(dest), first, first});
+        } else {
+            add_pawn_moves(dest, s.white_pawns | s.black_pawns | (1u << dest));
+        }
+    }
+    return moves;
+}
+
+} // namespace
+
+TEST_F(MoveGenTest, MoveListMatchesReference) {
+    RulesVariant saved = g_rules_variant;
+
+    for (RulesVariant variant : {RulesVariant::FLEXIBLE, RulesVariant::OFFICIAL}) {
+        g_rules_variant = variant;
+        uint32_t seed = 12345;
+
+        for (int game = 0; game < 50; ++game) {
+            State s = State::starting_position();
+            for (int ply = 0; ply < 40; ++ply) {
+                MoveList list;
+                generate_moves(s, list);
+
+                auto expected = reference_moves(s);
+                ASSERT_EQ(list.size(), expected.size()) << s.to_string();
+                for (size_t i = 0; i < expected.size(); ++i) {
+                    ASSERT_EQ(list[i], expected[i]) << "move " << i << " of " << s.to_string();
+                }
+                EXPECT_EQ(generate_moves(s), expected);
+                EXPECT_EQ(count_moves(s), expected.size());
+
+                MoveList direct;
+                if (variant == RulesVariant::FLEXIBLE) {
+                    generate_moves<RulesVariant::FLEXIBLE>(s, direct);
+                } else {
+                    generate_moves<RulesVariant::OFFICIAL>(s, direct);
+                }
+                ASSERT_TRUE(std::equal(direct.begin(), direct.end(), list.begin(), list.end()));
+
+                if (list.empty() || check_terminal(s) != GameResult::ONGOING) break;
+                seed = seed * 1103515245 + 12345;
+                s = apply_move(s, list[(seed >> 16) % list.size()]);
+                if (check_terminal(s) != GameResult::ONGOING) break;
+            }
+        }
+    }
+
+    g_rules_variant = saved;
+}
+
+TEST_F(MoveGenTest, RayMasksMatchRays) {
+    for (int sq = 0; sq < NUM_SQUARES; ++sq) {
+        uint32_t all_neighbors = 0;
+        for (int dest : neighbors[sq]) all_neighbors |= 1u << dest;
+        EXPECT_EQ(neighbor_masks[sq], all_neighbors);
+
+        for (int di = 0; di < 8; ++di) {
+            ASSERT_EQ(ray_lengths[sq][di], rays[sq][di].size());
+            uint32_t mask = 0;
+            for (size_t i = 0; i < rays[sq][di].size(); ++i) {
+                EXPECT_EQ(ray_squares[sq][di][i], rays[sq][di][i]);
+                mask |= 1u << rays[sq][di][i];
+            }
+            EXPECT_EQ(ray_masks[sq][di], mask);
+        }
+    }
+}
+
+TEST_F(MoveGenTest, UnmovesInvertMoves) {
+    RulesVariant saved = g_rules_variant;
+
+    auto moves_into = [](const State& parent, const State& child) {
+        MoveList list;
+        generate_moves(parent, list);
+        return std::count_if(list.begin(), list.end(), [&](const Move& m) {
+            return apply_move(parent, m) == child;
+        });
+    };
+
+    for (RulesVariant variant : {RulesVariant::FLEXIBLE, RulesVariant::OFFICIAL}) {
+        g_rules_variant = variant;
+        uint32_t seed = 777;
+
+        for (int game = 0; game < 20; ++game) {
+            State s = State::starting_position();
+            for (int ply = 0; ply < 30; ++ply) {
+                MoveList list;
+                generate_moves(s, list);
+                if (list.empty()) break;
+
+                for (const auto& m : list) {
+                    State child = apply_move(s, m);
+                    auto parents = generate_unmoves(child);
+
+                    // Every move into the child shows up as one parent entry
+                    EXPECT_EQ(std::count(parents.begin(), parents.end(), s), moves_into(s, child))
+                        << s.to_string() << " -> " << child.to_string();
+
+                    // And every parent entry is backed by a move
+                    for (const State& p : parents) {
+                        ASSERT_EQ(check_terminal(p), GameResult::ONGOING) << p.to_string();
+                        ASSERT_EQ(std::count(parents.begin(), parents.end(), p), moves_into(p, child))
+                            << p.to_string() << " -> " << child.to_string();
+                    }
+                }
+
+                seed = seed * 1103515245 + 12345;
+                s = apply_move(s, list[(seed >> 16) % list.size()]);
+                if (check_terminal(s) != GameResult::ONGOING) break;
+            }
+        }
+    }
+
+    g_rules_variant = saved;
+}
+
+TEST_F(MoveGenTest, CanonicalUnmovesMatchPredecessorEdges) {
+    uint32_t seed = 4242;
+    std::vector<uint64_t> parents;
+
+    for (int game = 0; game < 20; ++game) {
+        State s = State::starting_position();
+        for (int ply = 0; ply < 30; ++ply) {
+            uint64_t packed = canonical_pack(s);
+            State canon = unpack_state(packed);
+            MoveList list;
+            generate_moves(canon, list);
+            if (list.empty()) break;
+
+            // Forward edges from the canonical parent, grouped by canonical child
+            std::vector<uint64_t> children;
+            for (const auto& m : list) children.push_back(canonical_pack(apply_move(canon, m)));
+
+            for (uint64_t child : children) {
+                generate_canonical_unmoves(child, parents);
+                EXPECT_EQ(std::count(parents.begin(), parents.end(), packed),
+                          std::count(children.begin(), children.end(), child))
+                    << canon.to_string() << " -> " << unpack_state(child).to_string();
+            }
+
+            seed = seed * 1103515245 + 12345;
+            s = apply_move(canon, list[(seed >> 16) % list.size()]);
+            if (check_terminal(s) != GameResult::ONGOING) break;
+        }
+    }
+}
@@ -0,0 +1,172 @@
+#include "opening_book.h"
+#include "symmetry.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <set>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+using namespace bobail;
+
+class OpeningBookTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        init_move_tables();
+        init_symmetry();
+        path_ = "/tmp/bobail_book_test_" + std::to_string(getpid()) + ".book";
+        std::remove(path_.c_str());
+    }
+
+    void TearDown() override {
+        std::remove(path_.c_str());
+    }
+
+    // Made-up results that only depend on the canonical position
+    static std::vector<Result> fake_lookup(std::span<const State> states, std::vector<uint8_t>& dtw) {
+        const Result results[] = {Result::WIN, Result::LOSS, Result::DRAW, Result::UNKNOWN};
+        std::vector<Result> out;
+        dtw.clear();
+        for (const State& s : states) {
+            uint64_t key = canonical_pack(s);
+            Result r = results[(key * 0x9E3779B97F4A7C15ULL) >> 62];
+            out.push_back(r);
+            dtw.push_back(r == Result::WIN || r == Result::LOSS ? static_cast<uint8_t>(key % 250) : 0);
+        }
+        return out;
+    }
+
+    std::string path_;
+};
+
+TEST_F(OpeningBookTest, CollectsEveryPositionOnce) {
+    std::vector<BookEntry> entries = collect_opening_book(fake_lookup, 2, 1);
+
+    // Breadth-first reference over canonical positions
+    std::set<uint64_t> expected;
+    std::vector<State> level = {State::starting_position()};
+    expected.insert(canonical_pack(level[0]));
+    for (int depth = 0; depth < 2; ++depth) {
+        std::vector<State> next;
+        for (const State& s : level) {
+            if (check_terminal(s) != GameResult::ONGOING) continue;
+            for (const Move& m : generate_moves(s)) {
+                State c = apply_move(s, m);
+                if (expected.insert(canonical_pack(c)).second) next.push_back(c);
+            }
+        }
+        level = std::move(next);
+    }
+
+    ASSERT_EQ(entries.size(), expected.size());
+    std::set<uint64_t> keys;
+    for (const BookEntry& e : entries) keys.insert(e.key);
+    EXPECT_EQ(keys, expected);
+
+    // Threads split the levels but find the same book
+    std::vector<BookEntry> parallel = collect_opening_book(fake_lookup, 2, 4);
+    auto by_key = [](const BookEntry& a, const BookEntry& b) { return a.key < b.key; };
+    std::sort(entries.begin(), entries.end(), by_key);
+    std::sort(parallel.begin(), parallel.end(), by_key);
+    ASSERT_EQ(parallel.size(), entries.size());
+    for (size_t i = 0; i < entries.size(); ++i) {
+        EXPECT_EQ(parallel[i].key, entries[i].key);
+        EXPECT_EQ(parallel[i].result, entries[i].result);
+        EXPECT_EQ(parallel[i].best, entries[i].best);
+    }
+}
+
+TEST_F(OpeningBookTest, BestMoveIsFastestWinOrSlowestLoss) {
+    std::vector<BookEntry> entries = collect_opening_book(fake_lookup, 2, 2);
+    for (const BookEntry& e : entries) {
+        if (!e.has_move || (e.result != Result::WIN && e.result != Result::LOSS)) continue;
+
+        State s = unpack_state(e.key);
+        std::vector<State> children;
+        for (const Move& m : generate_moves(s)) children.push_back(apply_move(s, m));
+        std::vector<uint8_t> dtw;
+        std::vector<Result> results = fake_lookup(children, dtw);
+
+        State chosen = apply_move(s, e.best);
+        std::vector<uint8_t> chosen_dtw;
+        Result chosen_result = fake_lookup(std::span<const State>(&chosen, 1), chosen_dtw)[0];
+
+        if (e.result == Result::WIN) {
+            int fastest = -1;
+            for (size_t i = 0; i < results.size(); ++i) {
+                if (results[i] == Result::LOSS && (fastest < 0 || dtw[i] < fastest)) fastest = dtw[i];
+            }
+            if (fastest < 0) continue;
+            EXPECT_EQ(chosen_result, Result::LOSS);
+            EXPECT_EQ(chosen_dtw[0], fastest);
+        } else if (std::find(results.begin(), results.end(), Result::DRAW) != results.end()) {
+            EXPECT_EQ(chosen_result, Result::DRAW);
+        }
+    }
+}
+
+TEST_F(OpeningBookTest, RoundTripWithMirroredPositions) {
+    std::vector<BookEntry> entries = collect_opening_book(fake_lookup, 2, 2);
+    ASSERT_GT(entries.size(), OpeningBook::BLOCK_ENTRIES);
+    ASSERT_TRUE(write_opening_book(path_, entries, true));
+
+    OpeningBook book;
+    ASSERT_TRUE(book.open(path_));
+    EXPECT_TRUE(book.has_dtw());
+    EXPECT_EQ(book.size(), entries.size());
+
+    for (const BookEntry& e : entries) {
+        State s = unpack_state(e.key);
+        uint8_t dtw;
+        Move best;
+        ASSERT_EQ(book.probe(s, dtw, &best), e.result);
+        if (e.result == Result::WIN || e.result == Result::LOSS) {
+            EXPECT_EQ(dtw, e.dtw);
+        }
+        EXPECT_EQ(best, e.has_move ? e.best : Move{});
+
+        // The mirror image gets the mirrored move, which must reach the
+        // mirrored position. (A Bobail move onto a home row carries a
+        // placeholder pawn that need not match the generated one.)
+        State m = unpack_state(mirror_packed(e.key));
+        ASSERT_EQ(book.probe(m, dtw, &best), e.result);
+        if (e.has_move) {
+            uint64_t reached = pack_state(apply_move(m, best));
+            MoveList moves;
+            generate_moves(m, moves);
+            EXPECT_TRUE(std::any_of(moves.begin(), moves.end(),
+                                    [&](const Move& mv) { return pack_state(apply_move(m, mv)) == reached; }));
+            EXPECT_EQ(canonical_packed(reached), canonical_pack(apply_move(s, e.best)));
+        }
+    }
+
+    // A position past the book's depth
+    State far = State::starting_position();
+    for (int ply = 0; ply < 6; ++ply) {
+        MoveList moves;
+        generate_moves(far, moves);
+        far = apply_move(far, moves[moves.size() / 2]);
+    }
+    uint8_t dtw;
+    EXPECT_EQ(book.probe(far, dtw), Result::UNKNOWN);
+}
+
+TEST_F(OpeningBookTest, RejectsOtherRulesAndCorruptFiles) {
+    std::vector<BookEntry> entries = collect_opening_book(fake_lookup, 1, 1);
+    ASSERT_TRUE(write_opening_book(path_, entries, false));
+
+    RulesVariant saved = g_rules_variant;
+    g_rules_variant = saved == RulesVariant::OFFICIAL ? RulesVariant::FLEXIBLE : RulesVariant::OFFICIAL;
+    OpeningBook book;
+    EXPECT_FALSE(book.open(path_));
+    g_rules_variant = saved;
+    ASSERT_TRUE(book.open(path_));
+    EXPECT_FALSE(book.has_dtw());
+
+    std::ifstream in(path_, std::ios::binary);
+    std::vector<char> image((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    EXPECT_FALSE(book.open_buffer(image.data(), image.size() - 1));
+    EXPECT_FALSE(book.is_open());
+}
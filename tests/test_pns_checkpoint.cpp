@@ -0,0 +1,203 @@
+#include "pns_checkpoint.h"
+#include "hash.h"
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <unistd.h>
+
+using namespace bobail;
+
+namespace {
+
+std::string temp_path(const char* name) {
+    return ::testing::TempDir() + name + std::to_string(getpid());
+}
+
+void remove_checkpoint(const std::string& path) {
+    std::remove(path.c_str());
+    std::remove((path + ".delta").c_str());
+}
+
+void expect_same(PNSTable& expected, PNSTable& actual) {
+    EXPECT_EQ(actual.size(), expected.size());
+    expected.for_each([&](const PNSSlot& slot) {
+        const PNSSlot* other = actual.find(slot.key);
+        ASSERT_NE(other, nullptr) << slot.key;
+        EXPECT_EQ(other->proof(), slot.proof());
+        EXPECT_EQ(other->disproof(), slot.disproof());
+        EXPECT_EQ(other->result(), slot.result());
+    });
+}
+
+} // namespace
+
+TEST(PNSCheckpointTest, SnapshotThenDeltasRoundTrip) {
+    std::string path = temp_path("pns_ckpt_roundtrip");
+    remove_checkpoint(path);
+
+    PNSTable table(1024);
+    for (uint64_t key = 1; key <= 300; ++key) table.insert(key * 7919)->set(static_cast<uint32_t>(key), 2, 0);
+
+    PNSCheckpointer writer(path);
+    ASSERT_TRUE(writer.start(table, 2, {10, 1, 2, 3}));
+    ASSERT_TRUE(writer.wait());
+    EXPECT_TRUE(writer.last_report().full);
+    EXPECT_EQ(writer.last_report().entries, 300u);
+
+    // Changes and new entries only go into the delta
+    for (uint64_t key = 1; key <= 20; ++key) {
+        PNSSlot* slot = table.find(key * 7919);
+        slot->set(0, PN_INFINITY, 1);
+        table.mark_dirty(slot);
+    }
+    for (uint64_t key = 301; key <= 340; ++key) table.insert(key * 7919);
+    ASSERT_TRUE(writer.start(table, 2, {20, 4, 5, 6}));
+    ASSERT_TRUE(writer.wait());
+    EXPECT_FALSE(writer.last_report().full);
+    EXPECT_EQ(writer.last_report().entries, 60u);
+
+    PNSTable loaded(16);
+    PNSCheckpointer reader(path);
+    PNSCheckpointer::Counters counters{};
+    ASSERT_TRUE(reader.load(loaded, 2, counters));
+    EXPECT_EQ(reader.loaded_deltas(), 1u);
+    EXPECT_EQ(counters[0], 20u);
+    EXPECT_EQ(loaded.capacity(), table.capacity());
+    expect_same(table, loaded);
+
+    // A checkpoint of one mode does not resume in another
+    PNSTable other(16);
+    EXPECT_FALSE(PNSCheckpointer(path).load(other, 1, counters));
+    EXPECT_EQ(other.size(), 0u);
+    remove_checkpoint(path);
+}
+
+TEST(PNSCheckpointTest, TornDeltaIsDropped) {
+    std::string path = temp_path("pns_ckpt_torn");
+    remove_checkpoint(path);
+
+    PNSTable table(256);
+    for (uint64_t key = 1; key <= 50; ++key) table.insert(key);
+    PNSCheckpointer writer(path);
+    ASSERT_TRUE(writer.start(table, 1, {}));
+    ASSERT_TRUE(writer.wait());
+    table.insert(1000);
+    ASSERT_TRUE(writer.start(table, 1, {}));
+    ASSERT_TRUE(writer.wait());
+    table.insert(2000);
+    ASSERT_TRUE(writer.start(table, 1, {}));
+    ASSERT_TRUE(writer.wait());
+
+    // Cut the second delta short, as a crash while appending would
+    std::string delta = path + ".delta";
+    std::ifstream in(delta, std::ios::binary | std::ios::ate);
+    auto bytes = static_cast<off_t>(in.tellg());
+    in.close();
+    ASSERT_EQ(::truncate(delta.c_str(), bytes - 4), 0);
+
+    PNSTable loaded(16);
+    PNSCheckpointer reader(path);
+    PNSCheckpointer::Counters counters{};
+    ASSERT_TRUE(reader.load(loaded, 1, counters));
+    EXPECT_EQ(reader.loaded_deltas(), 1u);
+    EXPECT_TRUE(loaded.contains(1000));
+    EXPECT_FALSE(loaded.contains(2000));
+    EXPECT_EQ(loaded.size(), 51u);
+
+    // The torn tail is gone and new deltas append after the good one
+    loaded.insert(3000);
+    ASSERT_TRUE(reader.start(loaded, 1, {}));
+    ASSERT_TRUE(reader.wait());
+    EXPECT_FALSE(reader.last_report().full);
+
+    PNSTable reloaded(16);
+    ASSERT_TRUE(PNSCheckpointer::read(path, reloaded, counters));
+    expect_same(loaded, reloaded);
+    remove_checkpoint(path);
+}
+
+TEST(PNSCheckpointTest, GrownTableGetsNewSnapshot) {
+    std::string path = temp_path("pns_ckpt_grow");
+    remove_checkpoint(path);
+
+    PNSTable table(64);
+    for (uint64_t key = 1; key <= 30; ++key) table.insert(key);
+    PNSCheckpointer writer(path);
+    ASSERT_TRUE(writer.start(table, 1, {}));
+    ASSERT_TRUE(writer.wait());
+
+    ASSERT_TRUE(table.grow());
+    table.insert(99);
+    ASSERT_TRUE(writer.start(table, 1, {}));
+    ASSERT_TRUE(writer.wait());
+    EXPECT_TRUE(writer.last_report().full);
+
+    PNSTable loaded(16);
+    PNSCheckpointer::Counters counters{};
+    ASSERT_TRUE(PNSCheckpointer::read(path, loaded, counters));
+    EXPECT_EQ(loaded.capacity(), 128u);
+    expect_same(table, loaded);
+    remove_checkpoint(path);
+}
+
+TEST(PNSCheckpointTest, LoadsStreamFormat) {
+    std::string path = temp_path("pns_ckpt_legacy");
+    remove_checkpoint(path);
+
+    // Header and 24-byte records of the original format
+    struct Entry {
+        uint64_t hash;
+        uint32_t proof;
+        uint32_t disproof;
+        uint8_t result;
+    };
+    {
+        std::ofstream out(path, std::ios::binary);
+        uint64_t header[7] = {PNSCheckpointer::MAGIC, 2, 2, 100, 1, 1, 0};
+        out.write(reinterpret_cast<const char*>(header), sizeof(header));
+        Entry entries[2] = {{11, 0, PN_INFINITY, 1}, {12, 5, 6, 0}};
+        out.write(reinterpret_cast<const char*>(entries), sizeof(entries));
+    }
+
+    PNSTable table(16);
+    PNSCheckpointer reader(path);
+    PNSCheckpointer::Counters counters{};
+    ASSERT_TRUE(reader.load(table, 2, counters));
+    EXPECT_EQ(counters[0], 100u);
+    EXPECT_EQ(table.size(), 2u);
+    EXPECT_EQ(table.find(11)->result(), 1);
+    EXPECT_EQ(table.find(12)->disproof(), 6u);
+
+    // The next checkpoint rewrites it as a snapshot
+    ASSERT_TRUE(reader.start(table, 2, counters));
+    ASSERT_TRUE(reader.wait());
+    EXPECT_TRUE(reader.last_report().full);
+    PNSTable reloaded(16);
+    ASSERT_TRUE(PNSCheckpointer::read(path, reloaded, counters));
+    expect_same(table, reloaded);
+    remove_checkpoint(path);
+}
+
+TEST(PNSCheckpointTest, LoadingSwitchesToTheFileKeyMode) {
+    std::string path = temp_path("pns_ckpt_keys");
+    remove_checkpoint(path);
+    HashMode saved = g_hash_mode;
+
+    PNSTable table(64);
+    table.insert(mix_key(12345))->set(0, PN_INFINITY, 1);
+    g_hash_mode = HashMode::PACKED;
+    PNSCheckpointer writer(path);
+    ASSERT_TRUE(writer.start(table, 2, {}));
+    ASSERT_TRUE(writer.wait());
+
+    g_hash_mode = HashMode::ZOBRIST;
+    PNSTable loaded(16);
+    PNSCheckpointer::Counters counters{};
+    ASSERT_TRUE(PNSCheckpointer::read(path, loaded, counters));
+    EXPECT_EQ(g_hash_mode, HashMode::PACKED);
+    EXPECT_NE(loaded.find(mix_key(12345)), nullptr);
+
+    g_hash_mode = saved;
+    remove_checkpoint(path);
+}
@@ -0,0 +1,70 @@
+#include "pns.h"
+#include "hash.h"
+#include "symmetry.h"
+#include <gtest/gtest.h>
+
+using namespace bobail;
+
+class PNSSolverTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        init_move_tables();
+        init_zobrist();
+        init_symmetry();
+    }
+};
+
+TEST(PNSNodeArenaTest, RangesStayInsideOneChunk) {
+    PNSNodeArena arena;
+    uint32_t first = arena.allocate(PNSNodeArena::CHUNK_NODES - 10);
+    EXPECT_EQ(first, 0u);
+    arena[first].proof = 7;
+
+    // Does not fit in what is left of the first chunk
+    uint32_t next = arena.allocate(20);
+    EXPECT_EQ(next, PNSNodeArena::CHUNK_NODES);
+    EXPECT_EQ(arena[first].proof, 7u);
+    EXPECT_EQ(arena[next + 19].proof, 1u);
+    EXPECT_EQ(arena.size(), PNSNodeArena::CHUNK_NODES + 10u);
+
+    arena.clear();
+    EXPECT_EQ(arena.size(), 0u);
+    EXPECT_EQ(arena.allocate(1), 0u);
+    EXPECT_EQ(arena[0].proof, 1u);
+}
+
+// The side to move can step the Bobail onto its home row
+TEST_F(PNSSolverTest, ImmediateWinForEitherSide) {
+    State white{};
+    white.white_pawns = 0x1F << 15;  // Row 3
+    white.black_pawns = 0x1F << 20;  // Row 4
+    white.bobail_sq = 7;
+    white.white_to_move = true;
+
+    PNSSolver solver(1 << 12);
+    EXPECT_EQ(solver.solve(white), Result::WIN);
+    ASSERT_FALSE(solver.get_pv().empty());
+    EXPECT_EQ(State::row(solver.get_pv()[0].bobail_to), 0);
+
+    State black{};
+    black.white_pawns = 0x1F;       // Row 0
+    black.black_pawns = 0x1F << 5;  // Row 1
+    black.bobail_sq = 17;
+    black.white_to_move = false;
+    EXPECT_EQ(solver.solve(black), Result::WIN);
+    EXPECT_EQ(State::row(solver.get_pv()[0].bobail_to), 4);
+}
+
+TEST_F(PNSSolverTest, NodeLimitStopsSearch) {
+    PNSSolver solver(1 << 16);
+    solver.set_node_limit(2000);
+    EXPECT_EQ(solver.solve(State::starting_position()), Result::UNKNOWN);
+    EXPECT_GE(solver.nodes_searched(), 2000u);
+    EXPECT_GT(solver.tree_nodes(), solver.nodes_searched());
+    EXPECT_FALSE(solver.get_pv().empty());
+
+    // A second solve starts from an empty tree
+    solver.set_node_limit(100);
+    solver.solve(State::starting_position());
+    EXPECT_LT(solver.tree_nodes(), 100u * MAX_MOVES);
+}
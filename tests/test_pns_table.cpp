@@ -0,0 +1,129 @@
+#include "tt.h"
+#include <gtest/gtest.h>
+#include <random>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using namespace bobail;
+
+TEST(PNSTableTest, SlotPacksNumbersAndResult) {
+    PNSSlot slot{};
+    slot.set(12345, PN_INFINITY, 3);
+    EXPECT_EQ(slot.proof(), 12345u);
+    EXPECT_EQ(slot.disproof(), PN_INFINITY);
+    EXPECT_EQ(slot.result(), 3);
+
+    slot.set_numbers(0, 7);
+    EXPECT_EQ(slot.proof(), 0u);
+    EXPECT_EQ(slot.disproof(), 7u);
+    EXPECT_EQ(slot.result(), 3);
+
+    // Numbers past 31 bits saturate to infinity
+    slot.set(0x80000000u, 2, 1);
+    EXPECT_EQ(slot.proof(), PN_INFINITY);
+    EXPECT_EQ(slot.result(), 1);
+}
+
+TEST(PNSTableTest, InsertFindAndGrow) {
+    PNSTable table(16);
+    std::mt19937_64 rng(1);
+    std::unordered_map<uint64_t, uint32_t> expected;
+    for (uint32_t i = 0; i < 5000; ++i) {
+        uint64_t key = rng() | 1;
+        table.insert(key)->set(i, i + 1, 0);
+        expected[key] = i;
+        if (table.load() >= PNSTable::MAX_LOAD) {
+            ASSERT_TRUE(table.grow());
+        }
+    }
+    EXPECT_EQ(table.size(), expected.size());
+    for (const auto& [key, pn] : expected) {
+        const PNSSlot* slot = table.find(key);
+        ASSERT_NE(slot, nullptr);
+        EXPECT_EQ(slot->proof(), pn);
+        EXPECT_EQ(slot->disproof(), pn + 1);
+    }
+    EXPECT_EQ(table.find(2), nullptr);
+
+    // Inserting an existing key returns its slot unchanged
+    uint64_t some_key = expected.begin()->first;
+    EXPECT_EQ(table.insert(some_key)->proof(), expected.begin()->second);
+    EXPECT_EQ(table.size(), expected.size());
+}
+
+TEST(PNSTableTest, FullTableGrowsOnInsert) {
+    PNSTable table(16);
+    for (uint64_t key = 1; key <= 100; ++key) table.insert(key);
+    EXPECT_EQ(table.size(), 100u);
+    EXPECT_GE(table.capacity(), 128u);
+    for (uint64_t key = 1; key <= 100; ++key) EXPECT_TRUE(table.contains(key));
+}
+
+TEST(PNSTableTest, SweepKeepsMarkedAcrossWrappedClusters) {
+    // Keys crowd the last home slots so clusters wrap around the end
+    PNSTable table(256);
+    std::vector<uint64_t> keys;
+    for (uint64_t i = 0; i < 180; ++i) {
+        uint64_t home = 200 + (i * 7) % 56;
+        keys.push_back((i + 1) << 8 | home);
+    }
+    for (uint64_t key : keys) table.insert(key)->set(static_cast<uint32_t>(key >> 8), 1, 0);
+
+    table.clear_marks();
+    for (size_t i = 0; i < keys.size(); ++i) {
+        if (i % 3 == 0) {
+            EXPECT_TRUE(table.mark(table.find(keys[i])));
+        }
+    }
+    EXPECT_FALSE(table.mark(table.find(keys[0])));
+    EXPECT_EQ(table.sweep(), 120u);
+    EXPECT_EQ(table.size(), 60u);
+
+    for (size_t i = 0; i < keys.size(); ++i) {
+        const PNSSlot* slot = table.find(keys[i]);
+        if (i % 3 == 0) {
+            ASSERT_NE(slot, nullptr) << i;
+            EXPECT_EQ(slot->proof(), keys[i] >> 8);
+        } else {
+            EXPECT_EQ(slot, nullptr) << i;
+        }
+    }
+}
+
+TEST(PNSTableTest, ConcurrentInsertsShareSlots) {
+    PNSTable table(1 << 14);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&table, t]() {
+            for (uint64_t i = 0; i < 8000; ++i) {
+                uint64_t key = (i * 0x9E3779B97F4A7C15ULL) | 1;
+                PNSSlot* slot = table.insert_shared(key);
+                ASSERT_NE(slot, nullptr);
+                if (i % 4 == static_cast<uint64_t>(t)) slot->update_unsolved(0, PN_INFINITY, 1);
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+
+    EXPECT_EQ(table.size(), 8000u);
+    for (uint64_t i = 0; i < 8000; ++i) {
+        const PNSSlot* slot = table.find((i * 0x9E3779B97F4A7C15ULL) | 1);
+        ASSERT_NE(slot, nullptr);
+        EXPECT_EQ(slot->result(), 1);
+    }
+
+    // A solved slot keeps its result
+    PNSSlot* slot = table.insert_shared(3);
+    EXPECT_TRUE(slot->update_unsolved(0, PN_INFINITY, 1));
+    EXPECT_FALSE(slot->update_unsolved(4, 5, 0));
+    EXPECT_EQ(slot->proof(), 0u);
+
+    // A full table refuses new keys instead of growing
+    PNSTable small(16);
+    size_t stored = 0;
+    for (uint64_t key = 1; key <= 32; ++key) {
+        if (small.insert_shared(key)) ++stored;
+    }
+    EXPECT_EQ(stored, 15u);
+}
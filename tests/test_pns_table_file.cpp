@@ -0,0 +1,112 @@
+#include "pns_table.h"
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <unistd.h>
+
+using namespace bobail;
+
+namespace {
+
+std::string temp_path(const char* name) {
+    return ::testing::TempDir() + name + std::to_string(getpid());
+}
+
+// Random keys, spread like the Zobrist hashes of a real search
+void fill(PNSTable& table, std::vector<uint64_t>& keys, size_t count) {
+    std::mt19937_64 rng(42);
+    while (keys.size() < count) {
+        uint64_t key = rng();
+        if (key == 0 || table.contains(key)) continue;
+        table.insert(key)->set(static_cast<uint32_t>(keys.size() % 1000), 7, keys.size() % 4);
+        keys.push_back(key);
+    }
+}
+
+void expect_all_found(const PNSTableFile& file, PNSTable& table, const std::vector<uint64_t>& keys) {
+    ASSERT_EQ(file.size(), keys.size());
+    for (uint64_t key : keys) {
+        const PNSSlot* entry = file.find(key);
+        ASSERT_NE(entry, nullptr) << key;
+        EXPECT_EQ(entry->proof(), table.find(key)->proof());
+        EXPECT_EQ(entry->disproof(), table.find(key)->disproof());
+        EXPECT_EQ(entry->result(), table.find(key)->result());
+    }
+}
+
+} // namespace
+
+TEST(PNSTableFileTest, WrittenTableIsMappedAndSorted) {
+    std::string path = temp_path("pns_table_file");
+    PNSTable table(1 << 14);
+    std::vector<uint64_t> keys;
+    fill(table, keys, 5000);
+
+    ASSERT_TRUE(PNSTableFile::write(path, table, {100, 20, 30, 4}));
+    PNSTableFile file;
+    ASSERT_TRUE(file.open(path));
+    EXPECT_TRUE(file.is_mapped());
+    EXPECT_EQ(file.counters()[1], 20u);
+    expect_all_found(file, table, keys);
+
+    for (const PNSSlot* entry = file.begin(); entry + 1 < file.end(); ++entry) {
+        ASSERT_LT(entry->key, (entry + 1)->key);
+    }
+
+    // Misses below, above and between the stored keys
+    EXPECT_EQ(file.find(1), nullptr);
+    EXPECT_EQ(file.find(UINT64_MAX), nullptr);
+    std::mt19937_64 rng(7);
+    for (int i = 0; i < 1000; ++i) {
+        uint64_t key = rng();
+        if (!table.contains(key)) {
+            EXPECT_FALSE(file.contains(key));
+        }
+    }
+    std::remove(path.c_str());
+}
+
+TEST(PNSTableFileTest, SmallAndEmptyTables) {
+    std::string path = temp_path("pns_table_small");
+    PNSTable table(16);
+    PNSTableFile file;
+    ASSERT_TRUE(PNSTableFile::write(path, table, {}));
+    ASSERT_TRUE(file.open(path));
+    EXPECT_TRUE(file.empty());
+    EXPECT_EQ(file.find(5), nullptr);
+
+    table.insert(5)->set(0, PN_INFINITY, 1);
+    table.insert(9);
+    ASSERT_TRUE(PNSTableFile::write(path, table, {}));
+    ASSERT_TRUE(file.open(path));
+    ASSERT_NE(file.find(5), nullptr);
+    EXPECT_EQ(file.find(5)->result(), 1);
+    EXPECT_TRUE(file.contains(9));
+    EXPECT_FALSE(file.contains(7));
+    std::remove(path.c_str());
+}
+
+TEST(PNSTableFileTest, OpensCheckpoint) {
+    std::string path = temp_path("pns_table_ckpt");
+    std::remove(path.c_str());
+    std::remove((path + ".delta").c_str());
+
+    PNSTable table(4096);
+    std::vector<uint64_t> keys;
+    fill(table, keys, 1000);
+    PNSCheckpointer writer(path);
+    ASSERT_TRUE(writer.start(table, 1, {10, 11, 12, 13}));
+    ASSERT_TRUE(writer.wait());
+
+    PNSTableFile file;
+    ASSERT_TRUE(file.open(path));
+    EXPECT_FALSE(file.is_mapped());
+    EXPECT_EQ(file.counters()[2], 12u);
+    expect_all_found(file, table, keys);
+
+    EXPECT_FALSE(file.open(path + ".missing"));
+    EXPECT_FALSE(file.is_open());
+    std::remove(path.c_str());
+    std::remove((path + ".delta").c_str());
+}
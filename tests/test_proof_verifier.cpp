@@ -0,0 +1,264 @@
+#include "proof_verifier.h"
+#include "hash.h"
+#include "movegen.h"
+#include "rank.h"
+#include "retrograde_bitmap.h"
+#include "symmetry.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <optional>
+#include <set>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+using namespace bobail;
+
+class ProofVerifierTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        init_move_tables();
+        init_zobrist();
+        init_symmetry();
+        saved_rules_ = g_rules_variant;
+        path_ = ::testing::TempDir() + "proof_verifier_" + std::to_string(getpid());
+        tb_path_ = path_ + ".tb";
+    }
+
+    void TearDown() override {
+        g_rules_variant = saved_rules_;
+        std::remove(path_.c_str());
+        std::remove(tb_path_.c_str());
+    }
+
+    void store(const State& s, Result r) {
+        uint8_t code = r == Result::WIN ? 1 : 2;
+        table_.insert(canonical_hash(s))->set(r == Result::WIN ? 0 : PN_INFINITY,
+                                              r == Result::WIN ? PN_INFINITY : 0, code);
+    }
+
+    // Write the stored results and map them
+    void open_table() {
+        ASSERT_TRUE(PNSTableFile::write(path_, table_, {}));
+        ASSERT_TRUE(file_.open(path_));
+    }
+
+    // White to move can step the Bobail onto row 0
+    static State white_wins_now() {
+        State s{};
+        s.white_pawns = 0x1F << 15;  // Row 3
+        s.black_pawns = 0x1F << 20;  // Row 4
+        s.bobail_sq = 7;
+        s.white_to_move = true;
+        return s;
+    }
+
+    // Black to move, the Bobail on row 1 with white pawns below it: it can
+    // only step onto row 0 or next to it, where White steps it onto row 0
+    static State black_loses() {
+        State s{};
+        s.white_pawns = 0x1F << 10;  // Row 2
+        s.black_pawns = 0x1F << 20;  // Row 4
+        s.bobail_sq = 5;
+        s.white_to_move = false;
+        return s;
+    }
+
+    // Store every move of black_loses() that does not end the game as won
+    // for White; returns how many distinct positions that is
+    size_t store_black_loses(size_t skip = SIZE_MAX) {
+        State s = black_loses();
+        store(s, Result::LOSS);
+        std::set<uint64_t> children;
+        MoveList moves;
+        generate_moves(s, moves);
+        for (size_t i = 0; i < moves.size(); ++i) {
+            State child = apply_move(s, moves[i]);
+            if (check_terminal(child) != GameResult::ONGOING) continue;
+            if (children.insert(canonical_hash(child)).second && children.size() - 1 != skip) {
+                store(child, Result::WIN);
+            }
+        }
+        return children.size();
+    }
+
+    RulesVariant saved_rules_;
+    std::string path_;
+    std::string tb_path_;
+    PNSTable table_{1 << 12};
+    PNSTableFile file_;
+};
+
+TEST_F(ProofVerifierTest, ImmediateWin) {
+    store(white_wins_now(), Result::WIN);
+    open_table();
+
+    ProofVerifier verifier(file_);
+    EXPECT_TRUE(verifier.verify(white_wins_now(), Result::WIN));
+    EXPECT_TRUE(verifier.failures().empty());
+    EXPECT_EQ(verifier.stats().positions, 1u);
+    EXPECT_GE(verifier.stats().terminals, 1u);
+}
+
+TEST_F(ProofVerifierTest, WrongClaimFails) {
+    // Stored as lost, but moves end the game in the mover's favour
+    store(white_wins_now(), Result::LOSS);
+    open_table();
+
+    ProofVerifier verifier(file_);
+    verifier.set_max_failures(MAX_MOVES);
+    EXPECT_FALSE(verifier.verify(white_wins_now(), Result::LOSS));
+    const auto& failures = verifier.failures();
+    EXPECT_TRUE(std::any_of(failures.begin(), failures.end(), [](const ProofVerifier::Failure& f) {
+        return f.reason.find("game is over") != std::string::npos;
+    }));
+
+    // And the claim must match what the checkpoint holds
+    EXPECT_FALSE(verifier.verify(white_wins_now(), Result::WIN));
+}
+
+TEST_F(ProofVerifierTest, LossExpandsEveryMoveInParallel) {
+    size_t children = store_black_loses();
+    ASSERT_GT(children, 1u);
+    open_table();
+
+    ProofVerifier verifier(file_);
+    verifier.set_num_threads(4);
+    EXPECT_TRUE(verifier.verify(black_loses(), Result::LOSS));
+    EXPECT_TRUE(verifier.failures().empty());
+    EXPECT_EQ(verifier.stats().positions, 1 + children);
+}
+
+TEST_F(ProofVerifierTest, UnprovedMoveOfALossFails) {
+    store_black_loses(0);
+    open_table();
+
+    ProofVerifier verifier(file_);
+    verifier.set_num_threads(4);
+    EXPECT_FALSE(verifier.verify(black_loses(), Result::LOSS));
+    ASSERT_EQ(verifier.failures().size(), 1u);
+    EXPECT_NE(verifier.failures()[0].reason.find("not proved"), std::string::npos);
+}
+
+TEST_F(ProofVerifierTest, MaxFailuresStopsEarly) {
+    // No move is proved won, so every one that does not end the game fails
+    store(black_loses(), Result::LOSS);
+    open_table();
+
+    ProofVerifier verifier(file_);
+    verifier.set_max_failures(2);
+    EXPECT_FALSE(verifier.verify(black_loses(), Result::LOSS));
+    EXPECT_EQ(verifier.failures().size(), 2u);
+
+    // The cut-off call must not leave the root marked as checked
+    verifier.set_max_failures(MAX_MOVES);
+    EXPECT_FALSE(verifier.verify(black_loses(), Result::LOSS));
+    EXPECT_GT(verifier.failures().size(), 2u);
+}
+
+TEST_F(ProofVerifierTest, TablebaseDecidesPositions) {
+    State root = State::starting_position();
+    store(root, Result::WIN);
+    open_table();
+
+    // Nothing proves a move from the start lost for Black
+    ProofVerifier without(file_);
+    EXPECT_FALSE(without.verify(root, Result::WIN));
+
+    MoveList moves;
+    generate_moves(root, moves);
+    std::vector<uint64_t> entries = {
+        make_tablebase_entry(rank_state(apply_move(root, moves[0])), BITMAP_LOSS, 6),
+    };
+    ASSERT_TRUE(write_tablebase_sorted(tb_path_, entries, true));
+    Tablebase tb;
+    ASSERT_TRUE(tb.open(tb_path_));
+
+    ProofVerifier with(file_, &tb);
+    EXPECT_TRUE(with.verify(root, Result::WIN));
+    EXPECT_GE(with.stats().tablebase_hits, 1u);
+}
+
+// White to move, Black to move, White again, Black again, and back to the
+// start: each stored claim is proved by the next, the losses' other moves
+// by the tablebase, so only the cycle holds the proof up
+TEST_F(ProofVerifierTest, CyclicProofFails) {
+    g_rules_variant = RulesVariant::FLEXIBLE;  // Pawns can slide back
+    // Past the opening move, which leaves the Bobail where it is
+    State w1{};
+    w1.white_pawns = 0x1E | (1 << 5);  // Row 0, one pawn up on row 1
+    w1.black_pawns = 0x1F << 20;       // Row 4
+    w1.bobail_sq = 12;
+    w1.white_to_move = true;
+    const uint64_t w1_key = canonical_hash(w1);
+
+    auto find_move = [](const State& s, auto&& accept) -> std::optional<Move> {
+        MoveList moves;
+        generate_moves(s, moves);
+        for (const Move& m : moves) {
+            if (accept(m)) return m;
+        }
+        return std::nullopt;
+    };
+
+    // The Bobail only steps sideways and back, so nothing reaches a home row
+    std::optional<std::array<State, 4>> cycle;
+    MoveList first_moves;
+    generate_moves(w1, first_moves);
+    for (const Move& m1 : first_moves) {
+        if (State::row(m1.bobail_to) != State::row(w1.bobail_sq)) continue;
+        State l1 = apply_move(w1, m1);
+        MoveList black_moves;
+        generate_moves(l1, black_moves);
+        for (const Move& m2 : black_moves) {
+            if (m2.bobail_to != w1.bobail_sq) continue;
+            State w2 = apply_move(l1, m2);
+            auto m3 = find_move(w2, [&](const Move& m) {
+                return m.bobail_to == m1.bobail_to && m.pawn_from == m1.pawn_to && m.pawn_to == m1.pawn_from;
+            });
+            if (!m3) continue;
+            State l2 = apply_move(w2, *m3);
+            auto m4 = find_move(l2, [&](const Move& m) {
+                return m.bobail_to == w1.bobail_sq && m.pawn_from == m2.pawn_to && m.pawn_to == m2.pawn_from;
+            });
+            if (m4 && canonical_hash(apply_move(l2, *m4)) == w1_key) {
+                cycle = std::array<State, 4>{w1, l1, w2, l2};
+                break;
+            }
+        }
+        if (cycle) break;
+    }
+    ASSERT_TRUE(cycle.has_value());
+
+    std::set<uint64_t> stored;
+    for (int i = 0; i < 4; ++i) {
+        store((*cycle)[i], i % 2 == 0 ? Result::WIN : Result::LOSS);
+        stored.insert(canonical_hash((*cycle)[i]));
+    }
+    std::set<uint64_t> ranks;
+    for (int i : {1, 3}) {
+        MoveList moves;
+        generate_moves((*cycle)[i], moves);
+        for (const Move& m : moves) {
+            State child = apply_move((*cycle)[i], m);
+            ASSERT_EQ(check_terminal(child), GameResult::ONGOING);
+            if (!stored.count(canonical_hash(child))) ranks.insert(rank_state(child));
+        }
+    }
+    std::vector<uint64_t> entries;
+    for (uint64_t rank : ranks) entries.push_back(make_tablebase_entry(rank, BITMAP_WIN, 9));
+    ASSERT_TRUE(write_tablebase_sorted(tb_path_, entries, true));
+    Tablebase tb;
+    ASSERT_TRUE(tb.open(tb_path_));
+    open_table();
+
+    ProofVerifier verifier(file_, &tb);
+    verifier.set_num_threads(2);
+    EXPECT_FALSE(verifier.verify(w1, Result::WIN));
+    ASSERT_FALSE(verifier.failures().empty());
+    for (const auto& f : verifier.failures()) {
+        EXPECT_NE(f.reason.find("cycle"), std::string::npos) << f.reason;
+    }
+}
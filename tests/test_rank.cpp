@@ -0,0 +1,114 @@
+#include "rank.h"
+#include "movegen.h"
+#include "symmetry.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <bit>
+#include <unordered_set>
+
+using namespace bobail;
+
+class RankTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        init_move_tables();
+        init_symmetry();
+    }
+
+    // Canonical positions reached by random playouts from the start
+    std::vector<State> sample_positions(int games, uint32_t seed) {
+        std::vector<State> positions;
+        for (int g = 0; g < games; ++g) {
+            State s = State::starting_position();
+            for (int ply = 0; ply < 60; ++ply) {
+                positions.push_back(unpack_state(canonical_pack(s)));
+                if (check_terminal(s) != GameResult::ONGOING) break;
+                MoveList moves;
+                generate_moves(s, moves);
+                if (moves.empty()) break;
+                seed = seed * 1103515245 + 12345;
+                s = apply_move(s, moves[(seed >> 16) % moves.size()]);
+            }
+        }
+        return positions;
+    }
+};
+
+TEST_F(RankTest, SpaceSize) {
+    EXPECT_EQ(RANK_SPACE_SIZE, 15ULL * 2 * 42504 * 11628);
+    EXPECT_EQ(RANK_SLICE_SIZE * RANK_BOBAIL_SQUARES, RANK_SPACE_SIZE);
+}
+
+TEST_F(RankTest, BobailIndexRoundTrip) {
+    for (int i = 0; i < RANK_BOBAIL_SQUARES; ++i) {
+        int sq = rank_bobail_square(i);
+        EXPECT_LE(State::col(sq), 2);
+        EXPECT_EQ(rank_bobail_index(sq), i);
+    }
+}
+
+TEST_F(RankTest, StartingPositionRoundTrip) {
+    State start = State::starting_position();
+    uint64_t r = rank_state(start);
+    EXPECT_LT(r, RANK_SPACE_SIZE);
+    EXPECT_EQ(unrank_state(r), start);
+}
+
+TEST_F(RankTest, RoundTripOnPlayouts) {
+    std::unordered_set<uint64_t> packed_seen;
+    std::unordered_set<uint64_t> ranks_seen;
+
+    for (const State& s : sample_positions(200, 42)) {
+        uint64_t r = rank_canonical(s);
+        ASSERT_LT(r, RANK_SPACE_SIZE);
+        ASSERT_EQ(unrank_state(r), s) << s.to_string();
+        EXPECT_EQ(rank_state(s), r);
+
+        // Injective on distinct positions
+        if (packed_seen.insert(pack_state(s)).second) {
+            EXPECT_TRUE(ranks_seen.insert(r).second) << s.to_string();
+        }
+    }
+}
+
+TEST_F(RankTest, MirrorImagesShareRank) {
+    for (const State& s : sample_positions(50, 7)) {
+        State mirrored = apply_symmetry(s, 4);
+        EXPECT_EQ(rank_state(mirrored), rank_state(s));
+    }
+}
+
+TEST_F(RankTest, UnrankRoundTripAcrossSpace) {
+    // Stride through the whole index space, including slice boundaries
+    uint64_t step = RANK_SPACE_SIZE / 100003;
+    for (uint64_t r = 0; r < RANK_SPACE_SIZE; r += step) {
+        State s = unrank_state(r);
+        ASSERT_TRUE(s.is_valid()) << "index " << r;
+        ASSERT_EQ(rank_canonical(s), r) << "index " << r;
+        if (is_canonical(s)) {
+            EXPECT_EQ(rank_state(s), r);
+        }
+    }
+    State last = unrank_state(RANK_SPACE_SIZE - 1);
+    EXPECT_EQ(rank_canonical(last), RANK_SPACE_SIZE - 1);
+}
+
+TEST_F(RankTest, SmallerSpacesRoundTrip) {
+    EXPECT_EQ(RankSpace().size(), RANK_SPACE_SIZE);
+    EXPECT_EQ(RankSpace(1).size(), 15u * 2 * 24 * 23);
+
+    for (int pawns = 1; pawns < PAWNS_PER_SIDE; ++pawns) {
+        RankSpace space(pawns);
+        uint64_t step = std::max<uint64_t>(space.size() / 10007, 1);
+        for (uint64_t r = 0; r < space.size(); r += step) {
+            State s = space.unrank(r);
+            ASSERT_EQ(std::popcount(s.white_pawns), pawns) << "index " << r;
+            ASSERT_EQ(std::popcount(s.black_pawns), pawns) << "index " << r;
+            ASSERT_EQ(s.white_pawns & s.black_pawns, 0u);
+            ASSERT_EQ(space.rank_canonical(s), r) << "index " << r;
+            if (is_canonical(s)) {
+                EXPECT_EQ(space.rank(apply_symmetry(s, 4)), r);
+            }
+        }
+    }
+}
@@ -0,0 +1,76 @@
+#include "result_cache.h"
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+
+using namespace bobail;
+
+TEST(ResultCacheTest, FindsInsertedAndCounts) {
+    ResultCache cache(64);
+    CachedResult r;
+    EXPECT_FALSE(cache.find(42, r));
+
+    cache.insert(42, {Result::WIN, 7});
+    ASSERT_TRUE(cache.find(42, r));
+    EXPECT_EQ(r.result, Result::WIN);
+    EXPECT_EQ(r.dtw, 7);
+
+    // Overwrite keeps one entry
+    cache.insert(42, {Result::LOSS, 3});
+    ASSERT_TRUE(cache.find(42, r));
+    EXPECT_EQ(r.result, Result::LOSS);
+
+    ResultCache::Stats s = cache.stats();
+    EXPECT_EQ(s.hits, 2u);
+    EXPECT_EQ(s.misses, 1u);
+    EXPECT_EQ(s.size, 1u);
+    EXPECT_EQ(s.capacity, 64u);
+}
+
+TEST(ResultCacheTest, EvictsLeastRecentlyUsed) {
+    // One shard so the eviction order is exact
+    ResultCache cache(4, 1);
+    for (uint64_t k = 1; k <= 4; ++k) cache.insert(k, {Result::DRAW, 0});
+
+    CachedResult r;
+    ASSERT_TRUE(cache.find(1, r));  // 2 is now the oldest
+    cache.insert(5, {Result::WIN, 1});
+
+    EXPECT_FALSE(cache.find(2, r));
+    EXPECT_TRUE(cache.find(1, r));
+    EXPECT_TRUE(cache.find(5, r));
+    EXPECT_EQ(cache.stats().evictions, 1u);
+    EXPECT_EQ(cache.stats().size, 4u);
+}
+
+TEST(ResultCacheTest, ZeroCapacityDisables) {
+    ResultCache cache;
+    EXPECT_FALSE(cache.enabled());
+    cache.insert(1, {Result::WIN, 1});
+    CachedResult r;
+    EXPECT_FALSE(cache.find(1, r));
+    EXPECT_EQ(cache.stats().size, 0u);
+}
+
+TEST(ResultCacheTest, StaysBoundedUnderConcurrentUse) {
+    ResultCache cache(1000);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&cache, t]() {
+            CachedResult r;
+            for (uint64_t i = 0; i < 20000; ++i) {
+                uint64_t key = (i * 31 + t) % 3000;
+                if (cache.find(key, r)) {
+                    EXPECT_EQ(r.dtw, key % 200);
+                } else {
+                    cache.insert(key, {Result::WIN, static_cast<uint8_t>(key % 200)});
+                }
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+
+    ResultCache::Stats s = cache.stats();
+    EXPECT_LE(s.size, 1000u);
+    EXPECT_EQ(s.hits + s.misses, 80000u);
+}
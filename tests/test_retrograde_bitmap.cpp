@@ -0,0 +1,207 @@
+#include "retrograde_bitmap.h"
+#include "symmetry.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstdio>
+#include <deque>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+using namespace bobail;
+
+class ResultBitmapTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        path_ = "/tmp/bobail_bitmap_test_" + std::to_string(getpid()) + ".bin";
+        std::remove(path_.c_str());
+    }
+
+    void TearDown() override {
+        std::remove(path_.c_str());
+    }
+
+    std::string path_;
+};
+
+TEST_F(ResultBitmapTest, CodesRoundTrip) {
+    for (Result r : {Result::UNKNOWN, Result::WIN, Result::LOSS, Result::DRAW}) {
+        EXPECT_EQ(decode_bitmap_result(encode_bitmap_result(r)), r);
+    }
+}
+
+TEST_F(ResultBitmapTest, FreshFileIsUnknown) {
+    ResultBitmap bitmap;
+    ASSERT_TRUE(bitmap.open(path_, 1000));
+    EXPECT_EQ(bitmap.size(), 1000u);
+    for (uint64_t i = 0; i < bitmap.size(); ++i) {
+        ASSERT_EQ(bitmap.get(i), BITMAP_UNKNOWN);
+    }
+}
+
+TEST_F(ResultBitmapTest, SetOnlyOnce) {
+    ResultBitmap bitmap;
+    ASSERT_TRUE(bitmap.open(path_, 64));
+    EXPECT_TRUE(bitmap.set(5, BITMAP_WIN));
+    EXPECT_FALSE(bitmap.set(5, BITMAP_LOSS));
+    EXPECT_EQ(bitmap.get(5), BITMAP_WIN);
+    EXPECT_EQ(bitmap.get(4), BITMAP_UNKNOWN);
+    EXPECT_EQ(bitmap.get(6), BITMAP_UNKNOWN);
+}
+
+TEST_F(ResultBitmapTest, PersistsAcrossReopen) {
+    {
+        ResultBitmap bitmap;
+        ASSERT_TRUE(bitmap.open(path_, 100000));
+        for (uint64_t i = 0; i < bitmap.size(); i += 7) {
+            bitmap.set(i, static_cast<uint8_t>(1 + i % 3));
+        }
+        bitmap.header().phase = 4;
+    }
+
+    ResultBitmap bitmap;
+    ASSERT_TRUE(bitmap.open(path_, 100000));
+    EXPECT_EQ(bitmap.header().phase, 4u);
+    for (uint64_t i = 0; i < bitmap.size(); ++i) {
+        uint8_t expected = (i % 7 == 0) ? static_cast<uint8_t>(1 + i % 3) : BITMAP_UNKNOWN;
+        ASSERT_EQ(bitmap.get(i), expected) << "cell " << i;
+    }
+
+    // A different cell count is rejected rather than misread
+    ResultBitmap other;
+    EXPECT_FALSE(other.open(path_, 1234));
+}
+
+TEST_F(ResultBitmapTest, ConcurrentWritersShareWords) {
+    ResultBitmap bitmap;
+    ASSERT_TRUE(bitmap.open(path_, 1 << 16));
+
+    // Interleaved cells so every 64-bit word is written by all threads
+    constexpr int THREADS = 4;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < THREADS; ++t) {
+        threads.emplace_back([&, t]() {
+            for (uint64_t i = t; i < bitmap.size(); i += THREADS) {
+                bitmap.set(i, static_cast<uint8_t>(1 + t % 3));
+            }
+        });
+    }
+    for (auto& th : threads) th.join();
+
+    for (uint64_t i = 0; i < bitmap.size(); ++i) {
+        ASSERT_EQ(bitmap.get(i), 1 + (i % THREADS) % 3) << "cell " << i;
+    }
+}
+
+// Textbook retrograde analysis of a whole rank space: count down each
+// position's moves as its successors are found won, and work outwards
+// from the terminals with a queue. Independent of the solvers' sweeps.
+std::vector<uint8_t> reference_solve(const RankSpace& space) {
+    std::vector<uint8_t> results(space.size(), BITMAP_UNKNOWN);
+    std::vector<std::vector<uint64_t>> parents(space.size());
+    std::vector<uint32_t> open_moves(space.size(), 0);
+    std::deque<uint64_t> queue;
+
+    for (uint64_t i = 0; i < space.size(); ++i) {
+        State s = space.unrank(i);
+        if (!is_canonical(s)) continue;
+
+        GameResult gr = check_terminal(s);
+        if (gr != GameResult::ONGOING) {
+            bool mover_won = (gr == GameResult::WHITE_WINS) == s.white_to_move;
+            results[i] = mover_won ? BITMAP_WIN : BITMAP_LOSS;
+            queue.push_back(i);
+            continue;
+        }
+
+        MoveList moves;
+        generate_moves(s, moves);
+        if (moves.empty()) {
+            results[i] = BITMAP_LOSS;
+            queue.push_back(i);
+            continue;
+        }
+        open_moves[i] = static_cast<uint32_t>(moves.size());
+        for (const Move& m : moves) {
+            parents[space.rank(apply_move(s, m))].push_back(i);
+        }
+    }
+
+    while (!queue.empty()) {
+        uint64_t child = queue.front();
+        queue.pop_front();
+        for (uint64_t p : parents[child]) {
+            if (results[p] != BITMAP_UNKNOWN) continue;
+            if (results[child] == BITMAP_LOSS) {
+                results[p] = BITMAP_WIN;
+                queue.push_back(p);
+            } else if (--open_moves[p] == 0) {
+                results[p] = BITMAP_LOSS;
+                queue.push_back(p);
+            }
+        }
+    }
+
+    for (uint64_t i = 0; i < space.size(); ++i) {
+        if (results[i] == BITMAP_UNKNOWN && is_canonical(space.unrank(i))) results[i] = BITMAP_DRAW;
+    }
+    return results;
+}
+
+class BitmapSolverTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        init_move_tables();
+        init_symmetry();
+        saved_rules_ = g_rules_variant;
+        dir_ = ::testing::TempDir() + "bobail_bitmap_solver_" + std::to_string(getpid());
+    }
+
+    void TearDown() override {
+        g_rules_variant = saved_rules_;
+        remove_dir();
+    }
+
+    void remove_dir() {
+        std::remove((dir_ + "/results.bitmap").c_str());
+        rmdir(dir_.c_str());
+    }
+
+    std::string dir_;
+    RulesVariant saved_rules_;
+};
+
+TEST_F(BitmapSolverTest, MatchesReferenceOnSmallSpace) {
+    const RankSpace space(1);
+    for (RulesVariant rules : {RulesVariant::OFFICIAL, RulesVariant::FLEXIBLE}) {
+        g_rules_variant = rules;
+        std::vector<uint8_t> expected = reference_solve(space);
+
+        {
+            RetrogradeSolverBitmap solver(space);
+            solver.set_num_threads(4);
+            ASSERT_TRUE(solver.open(dir_));
+            ASSERT_TRUE(solver.solve());
+            EXPECT_EQ(solver.num_states(), space.size());
+            EXPECT_GT(solver.num_wins(), 0u);
+            EXPECT_GT(solver.num_losses(), 0u);
+            EXPECT_EQ(solver.num_wins() + solver.num_losses() + solver.num_draws(),
+                      static_cast<uint64_t>(std::count_if(expected.begin(), expected.end(),
+                                                          [](uint8_t c) { return c != BITMAP_UNKNOWN; })));
+        }
+
+        // Reopening the finished solve reads the same results
+        RetrogradeSolverBitmap solver(space);
+        ASSERT_TRUE(solver.open(dir_));
+        EXPECT_EQ(solver.current_phase(), SolvePhase::COMPLETE);
+        for (uint64_t i = 0; i < space.size(); ++i) {
+            if (expected[i] == BITMAP_UNKNOWN) continue;
+            State s = space.unrank(i);
+            ASSERT_EQ(encode_bitmap_result(solver.get_result(s)), expected[i]) << s.to_string();
+            ASSERT_EQ(solver.get_result(apply_symmetry(s, 4)), solver.get_result(s));
+        }
+        solver.close();
+        remove_dir();
+    }
+}
@@ -0,0 +1,231 @@
+#include "retrograde_slices.h"
+#include "symmetry.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <filesystem>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+using namespace bobail;
+
+class SliceTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        init_move_tables();
+        init_symmetry();
+        saved_rules_ = g_rules_variant;
+    }
+
+    void TearDown() override {
+        g_rules_variant = saved_rules_;
+    }
+
+    // Canonical ongoing positions reached by random playouts from the start
+    std::vector<State> sample_positions(int games, uint32_t seed) {
+        std::vector<State> positions;
+        for (int g = 0; g < games; ++g) {
+            State s = State::starting_position();
+            for (int ply = 0; ply < 40; ++ply) {
+                if (check_terminal(s) != GameResult::ONGOING) break;
+                positions.push_back(unpack_state(canonical_pack(s)));
+                MoveList moves;
+                generate_moves(s, moves);
+                if (moves.empty()) break;
+                seed = seed * 1103515245 + 12345;
+                s = apply_move(s, moves[(seed >> 16) % moves.size()]);
+            }
+        }
+        return positions;
+    }
+
+    RulesVariant saved_rules_;
+};
+
+TEST_F(SliceTest, SlicesAreBobailRows) {
+    EXPECT_EQ(slice_of_rank(0), 0);
+    EXPECT_EQ(slice_of_rank(RANK_SPACE_SIZE - 1), NUM_SLICES - 1);
+
+    for (const State& s : sample_positions(20, 7)) {
+        int slice = slice_of_rank(rank_canonical(s));
+        ASSERT_EQ(slice, State::row(s.bobail_sq));
+
+        // Every successor is in this slice or the next one over
+        MoveList moves;
+        generate_moves(s, moves);
+        for (const Move& m : moves) {
+            int succ = slice_of_rank(rank_state(apply_move(s, m)));
+            EXPECT_LE(std::abs(succ - slice), 1);
+        }
+    }
+}
+
+TEST_F(SliceTest, CombineUpdates) {
+    uint64_t rank = SLICE_CELLS + 12345;
+    uint64_t won = rank | (1ULL << UPDATE_COUNT_SHIFT);
+    uint64_t u = combine_updates(won, combine_updates(won, won));
+    EXPECT_EQ(update_rank(u), rank);
+    EXPECT_EQ(update_won_successors(u), 3u);
+    EXPECT_FALSE(u & UPDATE_LOST_SUCCESSOR);
+
+    u = combine_updates(u, rank | UPDATE_LOST_SUCCESSOR);
+    EXPECT_EQ(update_rank(u), rank);
+    EXPECT_EQ(update_won_successors(u), 3u);
+    EXPECT_TRUE(u & UPDATE_LOST_SUCCESSOR);
+}
+
+// The updates a position receives from its external successors must add
+// up to exactly its external move count, or it is never found lost
+TEST_F(SliceTest, ExternalParentsMatchExternalMoves) {
+    for (RulesVariant rules : {RulesVariant::OFFICIAL, RulesVariant::FLEXIBLE}) {
+        g_rules_variant = rules;
+        for (const State& s : sample_positions(10, 11)) {
+            uint64_t rank = rank_canonical(s);
+            int row = State::row(s.bobail_sq);
+
+            std::set<uint64_t> children;
+            MoveList moves;
+            generate_moves(s, moves);
+            for (const Move& m : moves) {
+                if (State::row(m.bobail_to) != row) children.insert(canonical_pack(apply_move(s, m)));
+            }
+
+            size_t received = 0;
+            std::vector<uint64_t> parents;
+            for (uint64_t child : children) {
+                external_parent_ranks(child, parents);
+                for (uint64_t p : parents) {
+                    EXPECT_NE(slice_of_rank(p), State::row(unpack_state(child).bobail_sq));
+                }
+                received += std::count(parents.begin(), parents.end(), rank);
+            }
+            ASSERT_EQ(received, count_external_moves(s)) << s.to_string();
+        }
+    }
+}
+
+class SliceSolverTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        init_move_tables();
+        init_symmetry();
+        saved_rules_ = g_rules_variant;
+        dir_ = ::testing::TempDir() + "bobail_slice_solver_" + std::to_string(getpid());
+        std::filesystem::remove_all(dir_);
+        std::filesystem::create_directories(dir_);
+    }
+
+    void TearDown() override {
+        g_rules_variant = saved_rules_;
+        std::filesystem::remove_all(dir_);
+    }
+
+    // Results of the bitmap solver on the same space, by rank
+    std::vector<uint8_t> bitmap_results(const RankSpace& space) {
+        std::string dir = dir_ + "/bitmap";
+        RetrogradeSolverBitmap solver(space);
+        solver.set_num_threads(2);
+        EXPECT_TRUE(solver.open(dir));
+        EXPECT_TRUE(solver.solve());
+        std::vector<uint8_t> codes(space.size(), BITMAP_UNKNOWN);
+        for (uint64_t i = 0; i < space.size(); ++i) {
+            State s = space.unrank(i);
+            if (is_canonical(s)) codes[i] = encode_bitmap_result(solver.get_result(s));
+        }
+        solver.close();
+        std::filesystem::remove_all(dir);
+        return codes;
+    }
+
+    void expect_results(const RetrogradeSolverSlices& solver, const RankSpace& space,
+                        const std::vector<uint8_t>& expected) {
+        uint64_t counts[4] = {0, 0, 0, 0};
+        for (uint64_t i = 0; i < space.size(); ++i) {
+            if (expected[i] == BITMAP_UNKNOWN) continue;
+            State s = space.unrank(i);
+            ASSERT_EQ(encode_bitmap_result(solver.get_result(s)), expected[i]) << s.to_string();
+            ++counts[expected[i]];
+        }
+        EXPECT_EQ(solver.num_wins(), counts[BITMAP_WIN]);
+        EXPECT_EQ(solver.num_losses(), counts[BITMAP_LOSS]);
+        EXPECT_EQ(solver.num_draws(), counts[BITMAP_DRAW]);
+    }
+
+    std::string dir_;
+    RulesVariant saved_rules_;
+};
+
+TEST_F(SliceSolverTest, MatchesBitmapOnSmallSpace) {
+    const RankSpace space(1);
+    for (RulesVariant rules : {RulesVariant::OFFICIAL, RulesVariant::FLEXIBLE}) {
+        g_rules_variant = rules;
+        std::vector<uint8_t> expected = bitmap_results(space);
+
+        std::string dir = dir_ + "/slices";
+        {
+            RetrogradeSolverSlices solver(space);
+            solver.set_num_threads(2);
+            solver.set_spill_updates(64);  // Many small runs to merge
+            ASSERT_TRUE(solver.open(dir));
+            ASSERT_TRUE(solver.solve());
+            EXPECT_EQ(solver.num_states(), space.size());
+            EXPECT_GT(solver.num_wins(), 0u);
+            EXPECT_GT(solver.num_losses(), 0u);
+            expect_results(solver, space, expected);
+        }
+
+        // Reopening reads the assembled results; another space is refused
+        RetrogradeSolverSlices solver(space);
+        ASSERT_TRUE(solver.open(dir));
+        EXPECT_EQ(solver.current_phase(), SolvePhase::COMPLETE);
+        expect_results(solver, space, expected);
+        RetrogradeSolverSlices other(RankSpace(2));
+        EXPECT_FALSE(other.open(dir));
+        solver.close();
+        std::filesystem::remove_all(dir);
+    }
+}
+
+// Stopping the process between sweeps leaves the visit uncommitted; the
+// next run redoes it from the saved header and reaches the same results
+TEST_F(SliceSolverTest, ResumesAfterInterruptedVisits) {
+    const RankSpace space(1);
+    g_rules_variant = RulesVariant::OFFICIAL;
+    std::vector<uint8_t> expected = bitmap_results(space);
+
+    struct Interrupted : std::runtime_error {
+        Interrupted() : std::runtime_error("interrupted") {}
+    };
+
+    std::string dir = dir_ + "/slices";
+    int interruptions = 0;
+    bool done = false;
+    while (!done) {
+        ASSERT_LT(interruptions, 1000);
+        RetrogradeSolverSlices solver(space);
+        solver.set_num_threads(2);
+        solver.set_spill_updates(64);
+        ASSERT_TRUE(solver.open(dir));
+
+        // Every sweep reports its end once the workers are joined; each
+        // run stops a sweep later than the last, so the solve gets through
+        int sweeps = 0;
+        solver.set_progress_callback([&](const char*, uint64_t current, uint64_t total) {
+            if (current == total && ++sweeps == interruptions + 2) throw Interrupted();
+        });
+        try {
+            done = solver.solve();
+            ASSERT_TRUE(done);
+        } catch (const Interrupted&) {
+            ++interruptions;
+        }
+    }
+    EXPECT_GT(interruptions, 1);
+
+    RetrogradeSolverSlices solver(space);
+    ASSERT_TRUE(solver.open(dir));
+    EXPECT_EQ(solver.current_phase(), SolvePhase::COMPLETE);
+    expect_results(solver, space, expected);
+}
@@ -0,0 +1,93 @@
+#include "search_tt.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace bobail;
+
+TEST(SearchTTTest, StoreAndProbe) {
+    SearchTT tt(1);
+    SearchTTEntry e;
+    EXPECT_FALSE(tt.probe(12345, e));
+
+    Move m{7, 21, 11};
+    tt.store(12345, -250, 4, Bound::LOWER, &m);
+    ASSERT_TRUE(tt.probe(12345, e));
+    EXPECT_EQ(e.score, -250);
+    EXPECT_EQ(e.depth, 4);
+    EXPECT_EQ(e.bound(), Bound::LOWER);
+    ASSERT_TRUE(e.has_move());
+    EXPECT_EQ(e.best_move(), m);
+
+    // A result without a move keeps the stored one
+    tt.store(12345, -300, 5, Bound::UPPER, nullptr);
+    ASSERT_TRUE(tt.probe(12345, e));
+    EXPECT_EQ(e.score, -300);
+    EXPECT_EQ(e.best_move(), m);
+}
+
+TEST(SearchTTTest, DeepEntrySurvivesShallowOnes) {
+    SearchTT tt(1);
+    uint64_t buckets = tt.num_buckets();
+    uint64_t deep = 5;
+    uint64_t shallow1 = 5 + buckets;
+    uint64_t shallow2 = 5 + 2 * buckets;
+
+    tt.store(deep, 100, 8, Bound::EXACT, nullptr);
+    tt.store(shallow1, 1, 2, Bound::EXACT, nullptr);
+    tt.store(shallow2, 2, 3, Bound::EXACT, nullptr);
+
+    SearchTTEntry e;
+    ASSERT_TRUE(tt.probe(deep, e));
+    EXPECT_EQ(e.score, 100);
+    EXPECT_FALSE(tt.probe(shallow1, e));  // Replaced in the always slot
+    ASSERT_TRUE(tt.probe(shallow2, e));
+    EXPECT_EQ(e.score, 2);
+
+    // In the next search the old deep entry gives way
+    tt.new_search();
+    tt.store(shallow1, 1, 2, Bound::EXACT, nullptr);
+    EXPECT_FALSE(tt.probe(deep, e));
+    EXPECT_TRUE(tt.probe(shallow1, e));
+}
+
+TEST(SearchTTTest, MovesPackIntoSixteenBits) {
+    for (uint8_t b = 0; b < NUM_SQUARES; b += 3) {
+        for (uint8_t from = 0; from < NUM_SQUARES; from += 2) {
+            Move m{b, from, static_cast<uint8_t>(NUM_SQUARES - 1 - from)};
+            uint16_t packed = SearchTTEntry::pack_move(m);
+            EXPECT_NE(packed, SearchTTEntry::NO_MOVE);
+            EXPECT_EQ(SearchTTEntry::unpack_move(packed), m);
+        }
+    }
+    EXPECT_EQ(sizeof(SearchTTEntry), 16u);
+}
+
+TEST(SearchTTTest, ConcurrentWritersNeverYieldTornEntries) {
+    SearchTT tt(1);
+    uint64_t buckets = tt.num_buckets();
+
+    // Every entry's score and move follow from its key, so a hit mixing
+    // two writes would show
+    std::vector<std::thread> threads;
+    std::atomic<int> bad{0};
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&, t] {
+            for (uint64_t i = 0; i < 200000; ++i) {
+                uint64_t key = 3 + ((i * 7 + t) % 64) * buckets;  // All in bucket 3
+                Move m{static_cast<uint8_t>(key % 25), 1, 2};
+                tt.store(key, static_cast<int>(key % 100000), static_cast<int>(key % 30), Bound::EXACT, &m);
+
+                SearchTTEntry e;
+                uint64_t other = 3 + ((i * 13 + t) % 64) * buckets;
+                if (tt.probe(other, e) &&
+                    (e.score != static_cast<int>(other % 100000) || e.best_move().bobail_to != other % 25)) {
+                    ++bad;
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    EXPECT_EQ(bad.load(), 0);
+}
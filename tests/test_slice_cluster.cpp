@@ -0,0 +1,228 @@
+#include "slice_cluster.h"
+#include "symmetry.h"
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+using namespace bobail;
+
+class SliceClusterTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        dir_ = "/tmp/bobail_cluster_test_" + std::to_string(getpid());
+        std::filesystem::remove_all(dir_);
+        std::filesystem::create_directories(dir_);
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(dir_);
+    }
+
+    static void write_run(const std::string& path, const std::vector<uint64_t>& updates) {
+        std::ofstream out(path, std::ios::binary);
+        out.write(reinterpret_cast<const char*>(updates.data()), updates.size() * sizeof(uint64_t));
+    }
+
+    static std::vector<uint64_t> read_run(const std::string& path) {
+        std::ifstream in(path, std::ios::binary);
+        std::vector<uint64_t> updates(std::filesystem::file_size(path) / sizeof(uint64_t));
+        in.read(reinterpret_cast<char*>(updates.data()), updates.size() * sizeof(uint64_t));
+        return updates;
+    }
+
+    // Sorted updates spread over a slice, with assorted counts and flags
+    static std::vector<uint64_t> sample_run(int slice, int n) {
+        std::vector<uint64_t> updates;
+        uint64_t rank = slice * SLICE_CELLS;
+        for (int i = 0; i < n; ++i) {
+            rank += 1 + (i * 7919u) % 5000;
+            uint64_t u = rank | (static_cast<uint64_t>(i % 5) << UPDATE_COUNT_SHIFT);
+            if (i % 3 == 0) u |= UPDATE_LOST_SUCCESSOR;
+            updates.push_back(u);
+        }
+        return updates;
+    }
+
+    std::string dir_;
+};
+
+TEST_F(SliceClusterTest, PeersAndOwnership) {
+    std::vector<std::string> peers;
+    ASSERT_TRUE(parse_cluster_peers("10.0.0.1:7000,localhost:7001", peers));
+    EXPECT_EQ(peers, (std::vector<std::string>{"10.0.0.1:7000", "localhost:7001"}));
+    EXPECT_FALSE(parse_cluster_peers("10.0.0.1", peers));
+    EXPECT_FALSE(parse_cluster_peers("a:1,b:2,c:3,d:4,e:5,f:6", peers));
+    EXPECT_FALSE(parse_cluster_peers("a:1,", peers));
+    EXPECT_FALSE(parse_cluster_peers("a:1,,b:2", peers));
+    EXPECT_FALSE(parse_cluster_peers("a:1,a:1", peers));
+    EXPECT_FALSE(parse_cluster_peers("a:7000x", peers));
+    EXPECT_FALSE(parse_cluster_peers("a:0", peers));
+    EXPECT_FALSE(parse_cluster_peers("a:99999999999999999999", peers));
+
+    for (int nodes = 1; nodes <= NUM_SLICES; ++nodes) {
+        uint32_t all = 0;
+        for (int n = 0; n < nodes; ++n) {
+            EXPECT_NE(cluster_slices(n, nodes), 0u);
+            EXPECT_EQ(all & cluster_slices(n, nodes), 0u);
+            all |= cluster_slices(n, nodes);
+        }
+        EXPECT_EQ(all, (1u << NUM_SLICES) - 1);
+    }
+}
+
+TEST_F(SliceClusterTest, CompressedRunRoundTrip) {
+    std::vector<uint64_t> updates = sample_run(3, 20000);
+    updates.back() |= UPDATE_COUNT_MASK;
+    write_run(dir_ + "/a.run", updates);
+
+    ASSERT_TRUE(compress_update_run(dir_ + "/a.run", dir_ + "/a.runz"));
+    EXPECT_LT(std::filesystem::file_size(dir_ + "/a.runz"), updates.size() * sizeof(uint64_t) / 2);
+    ASSERT_TRUE(decompress_update_run(dir_ + "/a.runz", dir_ + "/b.run"));
+    EXPECT_EQ(read_run(dir_ + "/b.run"), updates);
+
+    // Truncated in the middle of an update
+    std::filesystem::resize_file(dir_ + "/a.runz", std::filesystem::file_size(dir_ + "/a.runz") - 1);
+    EXPECT_FALSE(decompress_update_run(dir_ + "/a.runz", dir_ + "/b.run"));
+}
+
+TEST_F(SliceClusterTest, RoundsExchangeRunsAndConverge) {
+    const int port = 20000 + getpid() % 20000;
+    std::vector<std::string> peers = {"127.0.0.1:" + std::to_string(port), "127.0.0.1:" + std::to_string(port + 1)};
+
+    std::vector<std::unique_ptr<SliceCluster>> nodes;
+    for (int n = 0; n < 2; ++n) {
+        std::string d = dir_ + "/node" + std::to_string(n);
+        std::filesystem::create_directories(d + "/updates");
+        nodes.push_back(std::make_unique<SliceCluster>(n, peers, d));
+        nodes.back()->set_retry_ms(20);
+        ASSERT_TRUE(nodes.back()->start());
+    }
+    EXPECT_EQ(nodes[0]->owned_slices(), 0b10101u);
+    EXPECT_EQ(nodes[1]->owned_slices(), 0b01010u);
+
+    // Slice 2 (node 0) wrote a run for slice 1 in its visit of round 0,
+    // slice 1 (node 1) one for slice 0, and a carry for itself
+    std::vector<uint64_t> to1 = sample_run(1, 1000), to0 = sample_run(0, 500), carry = sample_run(1, 10);
+    write_run(dir_ + "/node0/updates/" + update_run_name(1, slice_visit(0, 2)), to1);
+    write_run(dir_ + "/node1/updates/" + update_run_name(0, slice_visit(0, 1)), to0);
+    write_run(dir_ + "/node1/updates/" + update_run_name(1, slice_visit(0, 1)), carry);
+
+    auto end_round = [&](uint32_t round, uint64_t resolved0, uint64_t resolved1, bool converged[2]) {
+        bool ok1 = false;
+        std::thread other([&] { ok1 = nodes[1]->end_round(round, resolved1, converged[1]); });
+        EXPECT_TRUE(nodes[0]->end_round(round, resolved0, converged[0]));
+        other.join();
+        EXPECT_TRUE(ok1);
+    };
+
+    bool converged[2] = {true, true};
+    end_round(0, 1500, 0, converged);
+    EXPECT_FALSE(converged[0]);
+    EXPECT_FALSE(converged[1]);
+
+    // Delivered runs move to the owner; the carry stays put
+    EXPECT_FALSE(std::filesystem::exists(dir_ + "/node0/updates/" + update_run_name(1, slice_visit(0, 2))));
+    EXPECT_EQ(read_run(dir_ + "/node1/updates/" + update_run_name(1, slice_visit(0, 2))), to1);
+    EXPECT_EQ(read_run(dir_ + "/node0/updates/" + update_run_name(0, slice_visit(0, 1))), to0);
+    EXPECT_EQ(read_run(dir_ + "/node1/updates/" + update_run_name(1, slice_visit(0, 1))), carry);
+
+    // Nothing resolved anywhere
+    end_round(1, 0, 0, converged);
+    EXPECT_TRUE(converged[0]);
+    EXPECT_TRUE(converged[1]);
+
+    // Node 0 restarts straight into assembling and never reports round 1
+    // again; node 1 asking about it once more still gets its answer
+    nodes[0] = std::make_unique<SliceCluster>(0, peers, dir_ + "/node0");
+    nodes[0]->set_retry_ms(20);
+    ASSERT_TRUE(nodes[0]->start());
+    converged[1] = false;
+    ASSERT_TRUE(nodes[1]->end_round(1, 0, converged[1]));
+    EXPECT_TRUE(converged[1]);
+
+    // Node 1 hands its slices to node 0
+    std::vector<uint64_t> cells = {1, 2, 3, 0xFFFFFFFFFFFFFFFFULL};
+    const uint64_t counts[3] = {10, 20, 30};
+    ASSERT_TRUE(nodes[1]->publish_slice(3, cells, counts));
+
+    std::vector<uint64_t> got;
+    uint64_t got_counts[3];
+    ASSERT_TRUE(nodes[0]->fetch_slice(3, got, got_counts));
+    EXPECT_EQ(got, cells);
+    EXPECT_EQ(got_counts[0], 10u);
+    EXPECT_EQ(got_counts[1], 20u);
+    EXPECT_EQ(got_counts[2], 30u);
+}
+
+TEST_F(SliceClusterTest, SolverDirectoryKeepsItsNode) {
+    std::vector<std::string> peers = {"localhost:7000", "localhost:7001"};
+    SliceCluster node1(1, peers, dir_);
+    {
+        RetrogradeSolverSlices solver;
+        solver.set_exchange(&node1);
+        ASSERT_TRUE(solver.open(dir_));
+    }
+
+    // Resuming as another node, or alone, would visit the wrong slices
+    SliceCluster node0(0, peers, dir_);
+    SliceCluster larger(1, {"localhost:7000", "localhost:7001", "localhost:7002"}, dir_);
+    for (SliceExchange* exchange : {static_cast<SliceExchange*>(&node0), static_cast<SliceExchange*>(&larger),
+                                    static_cast<SliceExchange*>(nullptr)}) {
+        RetrogradeSolverSlices solver;
+        solver.set_exchange(exchange);
+        EXPECT_FALSE(solver.open(dir_));
+    }
+
+    RetrogradeSolverSlices solver;
+    solver.set_exchange(&node1);
+    EXPECT_TRUE(solver.open(dir_));
+}
+
+// Two nodes solving the one-pawn space over localhost reach the results of
+// the bitmap solver, assembled on node 0
+TEST_F(SliceClusterTest, TwoNodesMatchBitmapSolver) {
+    init_move_tables();
+    init_symmetry();
+    const RankSpace space(1);
+
+    RetrogradeSolverBitmap reference(space);
+    ASSERT_TRUE(reference.open(dir_ + "/bitmap"));
+    ASSERT_TRUE(reference.solve());
+
+    const int port = 20000 + (getpid() + 7) % 20000;
+    std::vector<std::string> peers = {"127.0.0.1:" + std::to_string(port), "127.0.0.1:" + std::to_string(port + 1)};
+    std::vector<std::unique_ptr<SliceCluster>> nodes;
+    std::vector<std::unique_ptr<RetrogradeSolverSlices>> solvers;
+    for (int n = 0; n < 2; ++n) {
+        std::string d = dir_ + "/node" + std::to_string(n);
+        nodes.push_back(std::make_unique<SliceCluster>(n, peers, d));
+        nodes.back()->set_retry_ms(20);
+        solvers.push_back(std::make_unique<RetrogradeSolverSlices>(space));
+        solvers.back()->set_exchange(nodes.back().get());
+        solvers.back()->set_num_threads(2);
+        ASSERT_TRUE(solvers.back()->open(d));
+        ASSERT_TRUE(nodes.back()->start());
+    }
+
+    bool ok1 = false;
+    std::thread other([&] { ok1 = solvers[1]->solve(); });
+    EXPECT_TRUE(solvers[0]->solve());
+    other.join();
+    EXPECT_TRUE(ok1);
+
+    const RetrogradeSolverSlices& assembled = *solvers[0];
+    EXPECT_EQ(assembled.num_wins(), reference.num_wins());
+    EXPECT_EQ(assembled.num_losses(), reference.num_losses());
+    EXPECT_EQ(assembled.num_draws(), reference.num_draws());
+    for (uint64_t i = 0; i < space.size(); ++i) {
+        State s = space.unrank(i);
+        if (!is_canonical(s)) continue;
+        ASSERT_EQ(assembled.get_result(s), reference.get_result(s)) << s.to_string();
+    }
+}
@@ -0,0 +1,95 @@
+#include "solver_metrics.h"
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+
+using namespace bobail;
+
+TEST(SolverMetricsTest, CountsWorkPerThread) {
+    SolverMetrics m;
+    m.set_num_threads(4);
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&m, t] {
+            for (int i = 0; i < 1000; ++i) m.add_work(t, t + 1);
+        });
+    }
+    for (auto& th : threads) th.join();
+
+    SolverMetrics::Snapshot s = m.snapshot();
+    ASSERT_EQ(s.thread_items.size(), 4u);
+    ASSERT_EQ(s.thread_rates.size(), 4u);
+    for (int t = 0; t < 4; ++t) EXPECT_EQ(s.thread_items[t], 1000u * (t + 1));
+
+    // Rates only count work since the previous snapshot
+    s = m.snapshot();
+    EXPECT_EQ(s.thread_items[0], 1000u);
+    EXPECT_EQ(s.thread_rates[0], 0.0);
+}
+
+TEST(SolverMetricsTest, RecordsPhasesInOrder) {
+    SolverMetrics m;
+    EXPECT_TRUE(m.snapshot().phase.empty());
+
+    m.begin_phase("enumerate");
+    m.begin_phase("propagate");
+    SolverMetrics::Snapshot s = m.snapshot();
+    EXPECT_EQ(s.phase, "propagate");
+    ASSERT_EQ(s.phase_times.size(), 1u);
+    EXPECT_EQ(s.phase_times[0].first, "enumerate");
+
+    m.end_phase();
+    s = m.snapshot();
+    EXPECT_TRUE(s.phase.empty());
+    ASSERT_EQ(s.phase_times.size(), 2u);
+    EXPECT_EQ(s.phase_times[1].first, "propagate");
+}
+
+TEST(SolverMetricsTest, BloomFalsePositiveRate) {
+    SolverMetrics m;
+    EXPECT_EQ(m.snapshot().bloom_fp_rate(), 0.0);
+
+    // 90 new keys passed the filter, 10 more were false positives
+    m.add_bloom(90, 30, 10);
+    EXPECT_DOUBLE_EQ(m.snapshot().bloom_fp_rate(), 0.1);
+}
+
+TEST(SolverMetricsTest, GaugesReplaceByName) {
+    SolverMetrics m;
+    m.set_gauge("tt_size", 1);
+    m.set_gauge("tt_size", 5);
+    m.set_gauge("nodes", 2);
+
+    SolverMetrics::Snapshot s = m.snapshot();
+    ASSERT_EQ(s.gauges.size(), 2u);
+    EXPECT_EQ(s.gauges[0].first, "tt_size");
+    EXPECT_EQ(s.gauges[0].second, 5);
+}
+
+TEST(SolverMetricsTest, FormatsJsonAndPrometheus) {
+    SolverMetrics m;
+    m.set_num_threads(2);
+    m.begin_phase("propagate");
+    m.set_progress("Propagating", 40, 100);
+    m.set_queue(40, 100);
+    m.add_work(1, 7);
+    m.set_gauge("block_cache_hit_rate", 0.5);
+    SolverMetrics::Snapshot s = m.snapshot();
+
+    std::string json = SolverMetrics::to_json(s);
+    EXPECT_EQ(json.front(), '{');
+    EXPECT_EQ(json.back(), '}');
+    EXPECT_EQ(json.find('\n'), std::string::npos);
+    EXPECT_NE(json.find("\"phase\":\"propagate\""), std::string::npos);
+    EXPECT_NE(json.find("\"thread_items\":[0,7]"), std::string::npos);
+    EXPECT_NE(json.find("\"depth\":60"), std::string::npos);
+    EXPECT_NE(json.find("\"block_cache_hit_rate\":0.5"), std::string::npos);
+
+    std::string prom = SolverMetrics::to_prometheus(s, "bobail_retrograde");
+    EXPECT_NE(prom.find("# TYPE bobail_retrograde_queue_depth gauge\nbobail_retrograde_queue_depth 60\n"),
+              std::string::npos);
+    EXPECT_NE(prom.find("bobail_retrograde_thread_items_total{thread=\"1\"} 7\n"), std::string::npos);
+    EXPECT_NE(prom.find("bobail_retrograde_current_phase{phase=\"propagate\"} 1\n"), std::string::npos);
+    EXPECT_NE(prom.find("bobail_retrograde_block_cache_hit_rate 0.5\n"), std::string::npos);
+}
@@ -0,0 +1,56 @@
+#include "spsc_ring.h"
+#include <gtest/gtest.h>
+#include <memory>
+#include <thread>
+
+using namespace bobail;
+
+TEST(SpscRingTest, FifoAndFullRing) {
+    SpscRing<uint32_t> ring(3);
+    EXPECT_EQ(ring.capacity(), 4u);
+    for (uint32_t i = 0; i < 4; ++i) ASSERT_TRUE(ring.push(i));
+    EXPECT_FALSE(ring.push(4));
+    EXPECT_EQ(ring.size(), 4u);
+
+    uint32_t item;
+    ASSERT_TRUE(ring.pop(item));
+    EXPECT_EQ(item, 0u);
+    ASSERT_TRUE(ring.push(4));
+    for (uint32_t i = 1; i <= 4; ++i) {
+        ASSERT_TRUE(ring.pop(item));
+        EXPECT_EQ(item, i);
+    }
+    EXPECT_FALSE(ring.pop(item));
+    EXPECT_TRUE(ring.empty());
+}
+
+TEST(SpscRingTest, MovesOwningItems) {
+    SpscRing<std::unique_ptr<int>> ring(2);
+    ASSERT_TRUE(ring.push(std::make_unique<int>(7)));
+    std::unique_ptr<int> item;
+    ASSERT_TRUE(ring.pop(item));
+    ASSERT_NE(item, nullptr);
+    EXPECT_EQ(*item, 7);
+}
+
+TEST(SpscRingTest, ItemsArriveInOrderAcrossThreads) {
+    const uint32_t num_items = 500000;
+    SpscRing<uint32_t> ring(64);
+
+    std::thread consumer([&]() {
+        uint32_t expected = 0;
+        uint32_t item;
+        while (expected < num_items) {
+            if (ring.pop(item)) {
+                ASSERT_EQ(item, expected);
+                ++expected;
+            }
+        }
+    });
+
+    for (uint32_t i = 0; i < num_items; ++i) {
+        while (!ring.push(i)) std::this_thread::yield();
+    }
+    consumer.join();
+    EXPECT_TRUE(ring.empty());
+}
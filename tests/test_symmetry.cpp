@@ -109,3 +109,97 @@ TEST_F(SymmetryTest, SymmetryReducesPositions) {
     // Canonical should have fewer or equal positions
     EXPECT_LE(canonical_positions.size(), raw_positions.size());
 }
+
+namespace {
+
+// Random valid positions: 5 pawns each plus the Bobail on distinct squares
+std::vector<State> random_positions(size_t count, uint32_t seed) {
+    std::vector<State> positions;
+    for (size_t i = 0; i < count; ++i) {
+        uint32_t used = 0;
+        auto pick = [&]() {
+            int sq;
+            do {
+                seed = seed * 1103515245 + 12345;
+                sq = (seed >> 16) % NUM_SQUARES;
+            } while (used & (1u << sq));
+            used |= 1u << sq;
+            return sq;
+        };
+
+        State s{};
+        for (int p = 0; p < PAWNS_PER_SIDE; ++p) s.white_pawns |= 1u << pick();
+        for (int p = 0; p < PAWNS_PER_SIDE; ++p) s.black_pawns |= 1u << pick();
+        s.bobail_sq = static_cast<uint8_t>(pick());
+        s.white_to_move = (i & 1) == 0;
+        positions.push_back(s);
+    }
+    return positions;
+}
+
+} // namespace
+
+TEST_F(SymmetryTest, MirrorPackedMatchesApplySymmetry) {
+    for (const State& s : random_positions(5000, 7)) {
+        uint64_t packed = pack_state(s);
+        uint64_t reference = pack_state(apply_symmetry(s, 4));
+        ASSERT_EQ(mirror_packed(packed), reference) << s.to_string();
+        EXPECT_EQ(mirror_packed(reference), packed);
+
+        uint64_t expected = std::min(packed, reference);
+        EXPECT_EQ(canonical_packed(packed), expected);
+        EXPECT_EQ(canonical_pack(s), expected);
+        EXPECT_EQ(pack_state(canonicalize(s).first), expected);
+        EXPECT_EQ(canonicalize(s).second, reference < packed ? 4 : 0);
+    }
+}
+
+TEST_F(SymmetryTest, BatchCanonicalizeMatchesScalar) {
+    auto positions = random_positions(1027, 99);  // Not a multiple of the SIMD width
+    std::vector<uint64_t> packed;
+    for (const State& s : positions) packed.push_back(pack_state(s));
+
+    std::vector<uint64_t> out(packed.size());
+    canonicalize_packed_batch(packed.data(), out.data(), packed.size());
+    for (size_t i = 0; i < packed.size(); ++i) {
+        ASSERT_EQ(out[i], canonical_packed(packed[i])) << "index " << i;
+    }
+
+    // In-place operation
+    canonicalize_packed_batch(packed.data(), packed.data(), packed.size());
+    EXPECT_EQ(packed, out);
+}
+
+TEST_F(SymmetryTest, PackedKeysAreExact) {
+    HashMode saved = g_hash_mode;
+    g_hash_mode = HashMode::PACKED;
+    for (const State& s : random_positions(5000, 3)) {
+        uint64_t key = canonical_hash(s);
+        ASSERT_EQ(unmix_key(key), canonical_pack(s));
+        EXPECT_EQ(canonical_hash(apply_symmetry(s, 4)), key);
+        EXPECT_EQ(position_hash(s), mix_key(pack_state(s)));
+    }
+    g_hash_mode = saved;
+
+    for (uint64_t k : {0ULL, 1ULL, 0x00FFFFFFFFFFFFFFULL, ~0ULL}) {
+        EXPECT_EQ(unmix_key(mix_key(k)), k);
+    }
+}
+
+TEST_F(SymmetryTest, HashAfterMoveMatchesRecompute) {
+    for (RulesVariant rules : {RulesVariant::OFFICIAL, RulesVariant::FLEXIBLE}) {
+        RulesVariant saved = g_rules_variant;
+        g_rules_variant = rules;
+        for (const State& s : random_positions(500, 21)) {
+            uint64_t hash = compute_hash(s);
+            MoveList moves;
+            generate_moves(s, moves);
+            for (const Move& m : moves) {
+                State child = apply_move(s, m);
+                ASSERT_EQ(hash_after_move(hash, s, m), compute_hash(child)) << s.to_string() << m.to_string();
+                EXPECT_EQ(position_hash_after(hash, s, m, child), compute_hash(child));
+            }
+        }
+        g_rules_variant = saved;
+    }
+}
@@ -0,0 +1,178 @@
+#include "tablebase.h"
+#include "rank.h"
+#include "retrograde_bitmap.h"
+#include "symmetry.h"
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+using namespace bobail;
+
+class TablebaseTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        init_move_tables();
+        init_symmetry();
+        path_ = "/tmp/bobail_tablebase_test_" + std::to_string(getpid()) + ".tb";
+        std::remove(path_.c_str());
+    }
+
+    void TearDown() override {
+        std::remove(path_.c_str());
+    }
+
+    // Distinct canonical positions from a few deterministic playouts,
+    // with made-up results and depths
+    std::map<uint64_t, std::pair<Result, uint8_t>> sample_positions() {
+        std::map<uint64_t, std::pair<Result, uint8_t>> positions;
+        const Result results[] = {Result::WIN, Result::LOSS, Result::DRAW};
+        for (int game = 0; game < 20; ++game) {
+            State s = State::starting_position();
+            for (int ply = 0; ply < 60; ++ply) {
+                uint64_t rank = rank_state(s);
+                Result r = results[rank % 3];
+                positions[rank] = {r, r == Result::DRAW ? uint8_t(0) : static_cast<uint8_t>(rank % 200)};
+
+                if (check_terminal(s) != GameResult::ONGOING) break;
+                MoveList moves;
+                generate_moves(s, moves);
+                if (moves.empty()) break;
+                s = apply_move(s, moves[(game * 7 + ply * 13) % moves.size()]);
+            }
+        }
+        return positions;
+    }
+
+    std::string path_;
+};
+
+TEST_F(TablebaseTest, SortedRoundTrip) {
+    auto positions = sample_positions();
+    ASSERT_GT(positions.size(), Tablebase::FENCE_STRIDE);
+
+    std::vector<uint64_t> entries;
+    for (const auto& [rank, value] : positions) {
+        entries.push_back(make_tablebase_entry(rank, encode_bitmap_result(value.first), value.second));
+    }
+    ASSERT_TRUE(write_tablebase_sorted(path_, entries, true));
+
+    Tablebase tb;
+    ASSERT_TRUE(tb.open(path_));
+    EXPECT_EQ(tb.kind(), TablebaseKind::SORTED);
+    EXPECT_TRUE(tb.has_dtw());
+    EXPECT_EQ(tb.header().num_entries, positions.size());
+    EXPECT_EQ(tb.header().num_wins + tb.header().num_losses + tb.header().num_draws, positions.size());
+
+    for (const auto& [rank, value] : positions) {
+        State s = unrank_state(rank);
+        uint8_t dtw;
+        ASSERT_EQ(tb.probe(s, dtw), value.first) << rank;
+        EXPECT_EQ(dtw, value.second) << rank;
+
+        // The mirror image probes the same entry
+        State mirrored = unpack_state(mirror_packed(pack_state(s)));
+        EXPECT_EQ(tb.probe(mirrored), value.first) << rank;
+    }
+}
+
+TEST_F(TablebaseTest, MissingPositionIsUnknown) {
+    auto positions = sample_positions();
+    std::vector<uint64_t> entries;
+    for (const auto& [rank, value] : positions) {
+        entries.push_back(make_tablebase_entry(rank, encode_bitmap_result(value.first), value.second));
+    }
+    uint64_t lowest = positions.begin()->first;
+    uint64_t highest = positions.rbegin()->first;
+    entries.erase(entries.begin());
+    ASSERT_TRUE(write_tablebase_sorted(path_, entries, false));
+
+    Tablebase tb;
+    ASSERT_TRUE(tb.open(path_));
+    EXPECT_FALSE(tb.has_dtw());
+    EXPECT_EQ(tb.probe(unrank_state(lowest)), Result::UNKNOWN);
+
+    uint8_t dtw = 99;
+    EXPECT_NE(tb.probe(unrank_state(highest), dtw), Result::UNKNOWN);
+    EXPECT_EQ(dtw, 0);
+}
+
+TEST_F(TablebaseTest, BestMoveTakesFastestWin) {
+    State s = State::starting_position();
+    MoveList moves;
+    generate_moves(s, moves);
+
+    // Two winning moves: the one reaching the shorter loss for the
+    // opponent must be chosen
+    std::map<uint64_t, size_t> child_rank;
+    for (size_t i = 0; i < moves.size(); ++i) {
+        child_rank.emplace(rank_state(apply_move(s, moves[i])), i);
+    }
+    ASSERT_GE(child_rank.size(), 3u);
+    auto it = child_rank.begin();
+    uint64_t slow = it->first;
+    ++it;
+    uint64_t fast = it->first;
+    size_t fast_move = it->second;
+
+    std::vector<uint64_t> entries = {
+        make_tablebase_entry(rank_state(s), BITMAP_WIN, 5),
+        make_tablebase_entry(slow, BITMAP_LOSS, 8),
+        make_tablebase_entry(fast, BITMAP_LOSS, 4),
+    };
+    for (++it; it != child_rank.end(); ++it) {
+        entries.push_back(make_tablebase_entry(it->first, BITMAP_WIN, 3));
+    }
+    ASSERT_TRUE(write_tablebase_sorted(path_, entries, true));
+
+    Tablebase tb;
+    ASSERT_TRUE(tb.open(path_));
+    EXPECT_EQ(tb.best_move(s), moves[fast_move]);
+}
+
+TEST_F(TablebaseTest, OpensFromBuffer) {
+    auto positions = sample_positions();
+    std::vector<uint64_t> entries;
+    for (const auto& [rank, value] : positions) {
+        entries.push_back(make_tablebase_entry(rank, encode_bitmap_result(value.first), value.second));
+    }
+    ASSERT_TRUE(write_tablebase_sorted(path_, entries, true));
+
+    std::ifstream in(path_, std::ios::binary);
+    std::vector<char> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    std::vector<uint64_t> image((bytes.size() + 7) / 8);
+    std::memcpy(image.data(), bytes.data(), bytes.size());
+
+    Tablebase tb;
+    ASSERT_TRUE(tb.open_buffer(image.data(), bytes.size()));
+    for (const auto& [rank, value] : positions) {
+        ASSERT_EQ(tb.probe(unrank_state(rank)), value.first) << rank;
+    }
+
+    // A truncated image is rejected
+    Tablebase truncated;
+    EXPECT_FALSE(truncated.open_buffer(image.data(), bytes.size() - 8));
+}
+
+TEST_F(TablebaseTest, RejectsDuplicatesAndBadFiles) {
+    std::vector<uint64_t> entries = {
+        make_tablebase_entry(42, BITMAP_WIN, 1),
+        make_tablebase_entry(42, BITMAP_LOSS, 2),
+    };
+    EXPECT_FALSE(write_tablebase_sorted(path_, entries, true));
+
+    {
+        std::ofstream out(path_, std::ios::binary);
+        std::vector<char> junk(Tablebase::HEADER_BYTES, 'x');
+        out.write(junk.data(), junk.size());
+    }
+    Tablebase tb;
+    EXPECT_FALSE(tb.open(path_));
+    EXPECT_FALSE(tb.is_open());
+    EXPECT_EQ(tb.probe(State::starting_position()), Result::UNKNOWN);
+}
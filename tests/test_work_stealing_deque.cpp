@@ -0,0 +1,72 @@
+#include "work_stealing_deque.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace bobail;
+
+TEST(WorkStealingDequeTest, OwnerIsLifoThiefIsFifo) {
+    WorkStealingDeque<uint32_t> deque(8);
+    for (uint32_t i = 0; i < 4; ++i) ASSERT_TRUE(deque.push(i));
+    EXPECT_EQ(deque.size(), 4u);
+
+    uint32_t item;
+    ASSERT_TRUE(deque.steal(item));
+    EXPECT_EQ(item, 0u);
+    ASSERT_TRUE(deque.pop(item));
+    EXPECT_EQ(item, 3u);
+    ASSERT_TRUE(deque.pop(item));
+    EXPECT_EQ(item, 2u);
+    ASSERT_TRUE(deque.steal(item));
+    EXPECT_EQ(item, 1u);
+
+    EXPECT_FALSE(deque.pop(item));
+    EXPECT_FALSE(deque.steal(item));
+    EXPECT_TRUE(deque.empty());
+}
+
+TEST(WorkStealingDequeTest, PushFailsWhenFull) {
+    WorkStealingDeque<uint32_t> deque(5);
+    EXPECT_EQ(deque.capacity(), 8u);
+    for (uint32_t i = 0; i < 8; ++i) ASSERT_TRUE(deque.push(i));
+    EXPECT_FALSE(deque.push(8));
+
+    uint32_t item;
+    ASSERT_TRUE(deque.steal(item));
+    EXPECT_TRUE(deque.push(8));
+}
+
+TEST(WorkStealingDequeTest, EveryItemTakenOnce) {
+    const uint32_t num_items = 200000;
+    const int num_thieves = 3;
+    WorkStealingDeque<uint32_t> deque(1024);
+    std::vector<std::atomic<int>> taken(num_items);
+    std::atomic<bool> done{false};
+
+    std::vector<std::thread> thieves;
+    for (int t = 0; t < num_thieves; ++t) {
+        thieves.emplace_back([&]() {
+            uint32_t item;
+            while (!done.load() || !deque.empty()) {
+                if (deque.steal(item)) taken[item].fetch_add(1);
+            }
+        });
+    }
+
+    // Owner interleaves pushes and pops
+    uint32_t item;
+    for (uint32_t i = 0; i < num_items; ++i) {
+        while (!deque.push(i)) {
+            if (deque.pop(item)) taken[item].fetch_add(1);
+        }
+        if (i % 3 == 0 && deque.pop(item)) taken[item].fetch_add(1);
+    }
+    while (deque.pop(item)) taken[item].fetch_add(1);
+    done.store(true);
+    for (auto& t : thieves) t.join();
+
+    for (uint32_t i = 0; i < num_items; ++i) {
+        ASSERT_EQ(taken[i].load(), 1) << i;
+    }
+}